@@ -0,0 +1,125 @@
+/**
+ * @file statfile.c
+ * @brief Example collector plugin: metrics from an application stats file
+ *
+ * Reads a text file of "name value" lines, as many services write for
+ * monitoring, and reports every line as a metric. Names ending in "_total"
+ * are counters and shown as rates; names ending in "_bytes" are shown as
+ * sizes. The set of metrics is fixed by the file's contents at load time.
+ *
+ *     [plugins]
+ *     directory = build/plugins
+ *
+ *     [plugin.statfile]
+ *     args = /run/myapp/stats
+ *
+ * Build with "make plugins", or out of tree with:
+ *
+ *     cc -Iinclude -fPIC -shared examples/plugins/statfile.c -o statfile.so
+ */
+
+#include "sysmon_plugin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATFILE_MAX_METRICS 32
+#define STATFILE_NAME_MAX 32
+
+/**
+ * @brief Plugin context: the file and the metrics found in it
+ */
+typedef struct {
+    char path[256];
+    char names[STATFILE_MAX_METRICS][STATFILE_NAME_MAX];
+    SysmonMetricInfo metrics[STATFILE_MAX_METRICS];
+    unsigned int count;
+} StatFile;
+
+/**
+ * @brief Whether a name ends with a suffix
+ * @param name Metric name
+ * @param suffix Suffix to check
+ * @return Non-zero if it does
+ */
+static int ends_with(const char *name, const char *suffix) {
+    size_t len = strlen(name), suffix_len = strlen(suffix);
+    return len > suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+/**
+ * @brief Open the stats file and describe each of its lines as a metric
+ * @param args Path of the stats file
+ * @return Context, or NULL if the file cannot be read
+ */
+static void *statfile_init(const char *args) {
+    FILE *fp = fopen(args, "r");
+    if (!fp) return NULL;
+
+    StatFile *file = calloc(1, sizeof(*file));
+    if (!file) {
+        fclose(fp);
+        return NULL;
+    }
+    snprintf(file->path, sizeof(file->path), "%s", args);
+
+    char line[256], name[STATFILE_NAME_MAX];
+    while (fgets(line, sizeof(line), fp) && file->count < STATFILE_MAX_METRICS) {
+        double value;
+        if (line[0] == '#' || sscanf(line, "%31s %lf", name, &value) != 2) continue;
+
+        SysmonMetricInfo *metric = &file->metrics[file->count];
+        strcpy(file->names[file->count], name);
+        metric->name = file->names[file->count];
+        metric->label = file->names[file->count];
+        metric->unit = ends_with(name, "_bytes") ? "B" : "";
+        metric->kind = ends_with(name, "_total") ? SYSMON_METRIC_COUNTER : SYSMON_METRIC_GAUGE;
+        file->count++;
+    }
+    fclose(fp);
+    return file;
+}
+
+/**
+ * @brief List the metrics found at load time
+ */
+static int statfile_describe(void *ctx, const SysmonMetricInfo **metrics) {
+    StatFile *file = ctx;
+    *metrics = file->metrics;
+    return (int)file->count;
+}
+
+/**
+ * @brief Re-read the stats file; names no longer in it are left as NAN
+ */
+static int statfile_sample(void *ctx, double *values, unsigned int count) {
+    StatFile *file = ctx;
+    FILE *fp = fopen(file->path, "r");
+    if (!fp) return -1;
+
+    char line[256], name[STATFILE_NAME_MAX];
+    while (fgets(line, sizeof(line), fp)) {
+        double value;
+        if (line[0] == '#' || sscanf(line, "%31s %lf", name, &value) != 2) continue;
+        for (unsigned int i = 0; i < count && i < file->count; i++) {
+            if (strcmp(file->names[i], name) == 0) {
+                values[i] = value;
+                break;
+            }
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Free the context
+ */
+static void statfile_cleanup(void *ctx) {
+    free(ctx);
+}
+
+const SysmonPlugin sysmon_plugin = {
+    SYSMON_PLUGIN_ABI_VERSION, "statfile", "Application Stats",
+    statfile_init, statfile_describe, statfile_sample, statfile_cleanup
+};
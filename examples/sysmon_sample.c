@@ -0,0 +1,55 @@
+/**
+ * @file sysmon_sample.c
+ * @brief Minimal libsysmon client: prints CPU, memory and network once a second
+ *
+ * Build against the shared library with:
+ *
+ *     cc -Iinclude examples/sysmon_sample.c -Lbuild -lsysmon -o sysmon_sample
+ */
+
+#include "sysmon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 5;
+
+    SysmonOptions options = {
+        .api_version = SYSMON_API_VERSION,
+        .collectors = SYSMON_CPU | SYSMON_MEMORY | SYSMON_NETWORK,
+    };
+    strcpy(options.network_filter.exclude, "lo");
+
+    Sysmon *mon = sysmon_open(&options);
+    if (!mon) {
+        perror("sysmon_open");
+        return 1;
+    }
+    SysmonSnapshot *snapshot = sysmon_snapshot_create();
+    if (!snapshot) {
+        sysmon_close(mon);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (i > 0) sleep(1);
+        sysmon_sample(mon, snapshot);
+
+        const CPUStats *cpu = sysmon_snapshot_cpu(snapshot);
+        const MemoryStats *memory = sysmon_snapshot_memory(snapshot);
+        const NetworkStats *network = sysmon_snapshot_network(snapshot);
+        if (cpu) printf("cpu %5.1f%%", cpu->usage);
+        if (memory) printf("  mem %5.1f%%", memory->usage);
+        for (int n = 0; network && n < network->interface_count; n++) {
+            printf("  %s rx %.0f B/s tx %.0f B/s", network->interfaces[n].interface,
+                   network->interfaces[n].receive_speed, network->interfaces[n].send_speed);
+        }
+        printf("\n");
+    }
+
+    sysmon_snapshot_destroy(snapshot);
+    sysmon_close(mon);
+    return 0;
+}
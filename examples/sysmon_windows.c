@@ -0,0 +1,51 @@
+/**
+ * @file sysmon_windows.c
+ * @brief libsysmon client with two rate windows sampled on their own threads
+ *
+ * Prints CPU usage averaged over the last second and over the last ten
+ * seconds. Build against the shared library with:
+ *
+ *     cc -Iinclude examples/sysmon_windows.c -Lbuild -lsysmon -o sysmon_windows
+ */
+
+#include "sysmon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 20;
+
+    SysmonOptions options = {
+        .api_version = SYSMON_API_VERSION,
+        .collectors = SYSMON_CPU,
+    };
+
+    SysmonSampler *fast = sysmon_sampler_start(&options, 1000);
+    SysmonSampler *slow = sysmon_sampler_start(&options, 10000);
+    SysmonSnapshot *snapshot = sysmon_snapshot_create();
+    if (!fast || !slow || !snapshot) {
+        perror("sysmon_sampler_start");
+        sysmon_snapshot_destroy(snapshot);
+        sysmon_sampler_stop(slow);
+        sysmon_sampler_stop(fast);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        sleep(1);
+        const CPUStats *cpu;
+        if (sysmon_sampler_read(fast, snapshot) == 0 && (cpu = sysmon_snapshot_cpu(snapshot))) {
+            printf("1s %5.1f%%", cpu->usage);
+        }
+        if (sysmon_sampler_read(slow, snapshot) == 0 && (cpu = sysmon_snapshot_cpu(snapshot))) {
+            printf("  10s %5.1f%%", cpu->usage);
+        }
+        printf("\n");
+    }
+
+    sysmon_snapshot_destroy(snapshot);
+    sysmon_sampler_stop(slow);
+    sysmon_sampler_stop(fast);
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file aggregate.h
+ * @brief Aggregator side of multi-host mode: agents' snapshots per host
+ *
+ * The aggregator accepts agent connections (see stream.h), applies their
+ * snapshot frames to one value array per host and keeps a short history of
+ * each host's headline numbers for the summary grid. Hosts are identified
+ * by the name in their HELLO frame, so an agent that reconnects, or a new
+ * agent with the same name, continues the existing entry and its history.
+ */
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "stream.h"
+
+#define MAX_HOSTS 64
+#define HOST_HISTORY 60
+
+/**
+ * @brief One agent's host and its latest values
+ */
+typedef struct {
+    char name[STREAM_HOST_MAX];                 /**< Name from the agent's HELLO */
+    int online;                                 /**< Non-zero while the agent is connected */
+    long long last_update;                      /**< Monotonic ms of the last snapshot */
+    MetricSnapshot values;                      /**< Latest value of every metric slot */
+    double cpu;                                 /**< CPU busy time in percent */
+    double memory;                              /**< Memory in use in percent */
+    double load1;                               /**< 1-minute load average */
+    double rx;                                  /**< Receive throughput over all interfaces */
+    double tx;                                  /**< Transmit throughput over all interfaces */
+    double disk;                                /**< Fullest file system in percent */
+    double gpu;                                 /**< Busiest GPU in percent, NAN without GPUs */
+    unsigned int cpu_history[HOST_HISTORY];     /**< CPU percent per snapshot, oldest first */
+    unsigned int mem_history[HOST_HISTORY];     /**< Memory percent per snapshot, oldest first */
+    unsigned int history_count;                 /**< Valid entries in the histories */
+} HostInfo;
+
+/**
+ * @brief Structure to hold every host that has connected
+ */
+typedef struct {
+    HostInfo hosts[MAX_HOSTS];  /**< Hosts in order of first connection */
+    unsigned int count;         /**< Valid entries in hosts */
+    unsigned int online;        /**< Hosts with a connected agent */
+} HostStats;
+
+/**
+ * @brief Listening socket and agent connections (opaque)
+ */
+typedef struct Aggregator Aggregator;
+
+/**
+ * @brief Start listening for agents
+ * @param address Address to listen on (see stream.h)
+ * @return New aggregator, or NULL with errno set
+ */
+Aggregator *create_aggregator(const char *address);
+
+/**
+ * @brief Listening socket, to wait on for new agents
+ * @param aggregator Aggregator
+ * @return Socket descriptor
+ */
+int aggregator_fd(const Aggregator *aggregator);
+
+/**
+ * @brief Accept one pending agent connection
+ * @param aggregator Aggregator
+ * @return Non-blocking connection socket to wait on, or -1 if there is none
+ *         or the connection limit is reached
+ */
+int aggregator_accept(Aggregator *aggregator);
+
+/**
+ * @brief Read and apply whatever an agent connection has sent
+ * @param aggregator Aggregator
+ * @param fd Connection socket from aggregator_accept()
+ * @param stats Hosts to update
+ * @return 0 if the connection stays open, -1 if it was closed (end of
+ *         stream, read error, malformed or incompatible frame)
+ *
+ * @details Closing a descriptor also removes it from any epoll set.
+ */
+int aggregator_read(Aggregator *aggregator, int fd, HostStats *stats);
+
+/**
+ * @brief Close every connection and the listening socket, and free the aggregator
+ * @param aggregator Aggregator, may be NULL
+ */
+void destroy_aggregator(Aggregator *aggregator);
+
+#endif /* AGGREGATE_H */
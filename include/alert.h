@@ -0,0 +1,112 @@
+/**
+ * @file alert.h
+ * @brief Threshold and rate-of-change alerting rules
+ *
+ * Rules are read from a text file, one per line:
+ *
+ *     critical: cpu.usage > 95 for 30s
+ *     warning: disk./var.usage > 90 for 2m
+ *     rate(net.eth0.errors_in) > 10
+ *     plugin.raid.temp > 60
+ *
+ * All rules are compiled once into a single flat postfix program over a
+ * table of metric slots. Each tick every slot is sampled once from the
+ * current snapshot, then the whole program runs in one linear pass. rate()
+ * is the change between the last two updates of the metric's collector,
+ * per second of the time between them, and holds between updates. A rule
+ * fires once its condition has held for the "for" duration and resolves as
+ * soon as it no longer holds.
+ *
+ * Firing rules colour the border of the panel their metrics belong to, are
+ * appended to an optional alert log, and can run an exec hook on each
+ * transition.
+ */
+
+#ifndef ALERT_H
+#define ALERT_H
+
+#include <time.h>
+
+#define MAX_ALERT_RULES 64
+#define MAX_ACTIVE_ALERTS 16
+#define ALERT_RULE_MAX 128
+
+struct SystemStats;
+
+/**
+ * @brief Severity of a rule, in increasing order
+ */
+typedef enum {
+    ALERT_NONE,     /**< Not firing */
+    ALERT_WARNING,  /**< Default severity */
+    ALERT_CRITICAL  /**< "critical:" prefix */
+} AlertSeverity;
+
+/**
+ * @brief Panel a metric is shown in, used to colour panel borders
+ */
+typedef enum {
+    ALERT_PANEL_CPU,
+    ALERT_PANEL_MEMORY,
+    ALERT_PANEL_COUNTERS,
+    ALERT_PANEL_DISK,
+    ALERT_PANEL_NETWORK,
+    ALERT_PANEL_GPU,
+    ALERT_PANEL_EVENTS,
+    ALERT_PANEL_PLUGINS,
+    ALERT_PANEL_COUNT
+} AlertPanel;
+
+/**
+ * @brief A rule that is currently firing
+ */
+typedef struct {
+    char rule[ALERT_RULE_MAX];  /**< Rule text without the severity prefix */
+    AlertSeverity severity;     /**< Rule severity */
+    double value;               /**< Left operand of the last comparison evaluated */
+    time_t since;               /**< Wall-clock time the rule started firing */
+} ActiveAlert;
+
+/**
+ * @brief Structure to hold the alert state of the last evaluation
+ */
+typedef struct {
+    unsigned int rule_count;                  /**< Number of loaded rules */
+    ActiveAlert active[MAX_ACTIVE_ALERTS];    /**< Firing rules, in rule order */
+    unsigned int active_count;                /**< Valid entries in active */
+    unsigned int firing;                      /**< Number of firing rules (may exceed active_count) */
+    AlertSeverity panels[ALERT_PANEL_COUNT];  /**< Highest firing severity per panel */
+} AlertStats;
+
+/**
+ * @brief Load and compile alert rules
+ * @param rules_path Rules file, or NULL to run without rules
+ * @param log_path File to append transitions to, or NULL
+ * @param exec_cmd Shell command run on each transition, or NULL
+ * @return 0 on success, -1 on failure
+ *
+ * @details On failure alert_error() describes the problem, with the file
+ * and line for syntax errors.
+ */
+int init_alerts(const char *rules_path, const char *log_path, const char *exec_cmd);
+
+/**
+ * @brief Describe the last init_alerts() failure
+ * @return Error message, empty if the last call succeeded
+ */
+const char *alert_error(void);
+
+/**
+ * @brief Evaluate all rules against a snapshot
+ * @param snapshot Freshly updated statistics
+ * @param alerts Pointer to AlertStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_alert_stats(const struct SystemStats *snapshot, AlertStats *alerts);
+
+/**
+ * @brief Free the compiled rules and close the alert log
+ */
+void cleanup_alerts(void);
+
+#endif /* ALERT_H */
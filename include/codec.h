@@ -0,0 +1,100 @@
+/**
+ * @file codec.h
+ * @brief Compact encoding of successive metric snapshots
+ *
+ * Most of a snapshot does not change from one update to the next (totals,
+ * idle instances, slots without a value), and what does change usually
+ * changes by a little. The codec therefore sends a keyframe with every
+ * slot that has a value at the start and every keyframe_interval frames,
+ * and otherwise a delta frame with only the slots whose value changed.
+ *
+ * A frame is the frame type byte, the time as a varint (absolute in a
+ * keyframe, the zigzag difference to the previous frame in a delta), then
+ * one entry per slot in increasing slot order until the end of the frame:
+ *
+ *     varint  (slot - previous entry's slot - 1) << 2 | encoding
+ *     value   depending on the encoding:
+ *       CODEC_NAN      nothing; the slot no longer has a value
+ *       CODEC_INTEGER  zigzag varint of value - base
+ *       CODEC_CENTI    zigzag varint of value * 100 - base * 100, rounded
+ *       CODEC_RAW      the f64 value, little-endian
+ *
+ * The base is the receiver's previous value of the slot, or 0 in a
+ * keyframe and for slots without a value. Integral values (byte and event
+ * counts, sizes) are exact; other values are sent to 1/100, which is finer
+ * than anything displayed. Values too large for either go out as raw f64.
+ * Because the sender compares what the receiver would decode, a value that
+ * only moves below that resolution is not resent.
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "metrics.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define CODEC_KEYFRAME_INTERVAL 60
+// Type byte, time varint, and per slot a 3-byte header and a 10-byte varint
+#define CODEC_FRAME_MAX (1 + 10 + METRIC_SLOT_COUNT * 13)
+
+/**
+ * @brief Frame types, the first byte of a frame
+ */
+typedef enum {
+    CODEC_DELTA = 2,
+    CODEC_KEYFRAME = 3
+} CodecFrame;
+
+/**
+ * @brief Value encodings, the low two bits of an entry header
+ */
+typedef enum {
+    CODEC_NAN,
+    CODEC_INTEGER,
+    CODEC_CENTI,
+    CODEC_RAW
+} CodecEncoding;
+
+/**
+ * @brief One side of a stream: the values both ends have
+ *
+ * @details An encoder and its decoder hold identical states after each
+ * frame; a new connection starts both from codec_reset().
+ */
+typedef struct {
+    MetricSnapshot values;           /**< Values as decoded by the receiver */
+    long long time_ms;               /**< Time of the last frame */
+    unsigned int since_keyframe;     /**< Frames since the last keyframe */
+    unsigned int keyframe_interval;  /**< Frames between keyframes, 0 for only the first */
+    int started;                     /**< Non-zero once a keyframe was sent or received */
+} CodecState;
+
+/**
+ * @brief Start a stream over: the next frame is a keyframe
+ * @param state Encoder or decoder state
+ * @param keyframe_interval Frames between keyframes (encoder only), 0 for only the first
+ */
+void codec_reset(CodecState *state, unsigned int keyframe_interval);
+
+/**
+ * @brief Encode the next snapshot of a stream
+ * @param state Encoder state; updated to what the receiver will have
+ * @param next Values to send
+ * @param time_ms Sample time in milliseconds
+ * @param buf Output buffer of at least CODEC_FRAME_MAX bytes
+ * @return Frame length
+ */
+size_t codec_encode(CodecState *state, const MetricSnapshot *next, long long time_ms, uint8_t *buf);
+
+/**
+ * @brief Decode the next frame of a stream
+ * @param state Decoder state; updated with the frame's values
+ * @param frame Frame
+ * @param len Frame length
+ * @return 0 on success, -1 if the frame is malformed or a delta arrives
+ *         before the first keyframe
+ */
+int codec_decode(CodecState *state, const uint8_t *frame, size_t len);
+
+#endif /* CODEC_H */
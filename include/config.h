@@ -0,0 +1,194 @@
+/**
+ * @file config.h
+ * @brief INI configuration file: collectors, intervals, filters, layout and sinks
+ *
+ * Example:
+ *
+ *     [general]
+ *     interval = 1s
+ *
+ *     [disk]
+ *     exclude = /boot*,/snap*
+ *
+ *     [gpu]
+ *     enabled = false
+ *
+ *     [network]
+ *     interval = 250ms
+ *     include = eth*,wl*
+ *
+ *     [display]
+ *     panels = cpu,memory,network,disk
+ *
+ *     [events]
+ *     path = /var/tmp/kmsg.fixture
+ *
+ *     [procmem]
+ *     top = 10
+ *     budget = 4
+ *
+ *     [workingset]
+ *     enabled = true
+ *     window = 2m
+ *
+ *     [alerts]
+ *     rules = /etc/system_monitor/alert.rules
+ *     log = /var/log/system_monitor-alerts.log
+ *
+ *     [plugins]
+ *     directory = /usr/lib/system_monitor/plugins
+ *
+ *     [plugin.raid]
+ *     interval = 10s
+ *     args = /dev/sg3
+ *
+ * Every collector has its own section with "enabled" and "interval"; the
+ * disk and network sections also take "include" and "exclude" lists of
+ * shell patterns, the events section takes the "path" of the kernel
+ * log to read, and the procmem section the number of processes to show
+ * ("top") and of smaps_rollup reads per update ("budget"); the workingset
+ * section, disabled by default, takes the "window" to estimate the
+ * working set over. Plugins take the same keys plus "args" in a
+ * [plugin.<name>] section. The file is parsed without external dependencies and can
+ * be reloaded at run time (see main.c).
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "filter.h"
+
+#define CONFIG_VALUE_MAX FILTER_PATTERNS_MAX
+
+/**
+ * @brief Collectors in update order
+ */
+typedef enum {
+    COLLECTOR_CPU,
+    COLLECTOR_TOPOLOGY,
+    COLLECTOR_SCHEDULER,
+    COLLECTOR_PERF,
+    COLLECTOR_CPUFREQ,
+    COLLECTOR_MEMORY,
+    COLLECTOR_DISK,
+    COLLECTOR_GPU,
+    COLLECTOR_NETWORK,
+    COLLECTOR_THERMAL,
+    COLLECTOR_EVENTS,
+    COLLECTOR_KMEM,
+    COLLECTOR_ZONES,
+    COLLECTOR_PROCMEM,
+    COLLECTOR_WORKINGSET,
+    COLLECTOR_SWAP,
+    COLLECTOR_COUNT
+} CollectorId;
+
+/**
+ * @brief Settings shared by all collectors
+ */
+typedef struct {
+    int enabled;      /**< Non-zero to run the collector */
+    int interval_ms;  /**< Update interval, 0 to follow the general interval */
+} CollectorConfig;
+
+/**
+ * @brief Panel selection and sizing
+ */
+typedef struct {
+    char panels[CONFIG_VALUE_MAX];  /**< Panel names in priority order, empty for the default */
+    int width;                      /**< Panel width in columns */
+    int max_disks;                  /**< Disks listed in the Disk panel */
+    int max_interfaces;             /**< Interfaces listed in the Network panel */
+    int max_gpus;                   /**< GPUs listed in the GPU panel */
+} LayoutConfig;
+
+/**
+ * @brief Alert rules and the sinks alerts are sent to
+ */
+typedef struct {
+    char rules[CONFIG_VALUE_MAX];  /**< Rules file, empty for none */
+    char log[CONFIG_VALUE_MAX];    /**< Alert log file, empty for none */
+    char exec[CONFIG_VALUE_MAX];   /**< Exec hook command, empty for none */
+} AlertConfig;
+
+#define MAX_PLUGIN_SETTINGS 16
+#define PLUGIN_NAME_MAX 32
+
+/**
+ * @brief Settings of one plugin, from its [plugin.<name>] section
+ */
+typedef struct {
+    char name[PLUGIN_NAME_MAX];   /**< Plugin name */
+    int enabled;                  /**< Non-zero to load the plugin */
+    int interval_ms;              /**< Sample interval, 0 to follow the general interval */
+    char args[CONFIG_VALUE_MAX];  /**< Passed to the plugin's init() */
+} PluginSettings;
+
+/**
+ * @brief Plugin directory and per-plugin settings
+ */
+typedef struct {
+    char directory[CONFIG_VALUE_MAX];              /**< Directory of .so plugins, empty for none */
+    PluginSettings settings[MAX_PLUGIN_SETTINGS];  /**< Sections seen, in file order */
+    unsigned int count;                            /**< Valid entries in settings */
+} PluginConfig;
+
+/**
+ * @brief Complete monitor configuration
+ */
+typedef struct {
+    int interval_ms;                              /**< Default update interval */
+    CollectorConfig collectors[COLLECTOR_COUNT];  /**< Per-collector settings */
+    DeviceFilter disk_filter;                     /**< Mount points to show */
+    DeviceFilter network_filter;                  /**< Interfaces to show */
+    char kmsg_path[CONFIG_VALUE_MAX];             /**< Kernel log for the event watcher, empty for /dev/kmsg */
+    int procmem_top;                              /**< Processes in the process memory view */
+    int procmem_budget;                           /**< smaps_rollup reads per process memory update */
+    int workingset_window_ms;                     /**< Window of the working set estimate */
+    LayoutConfig layout;                          /**< Panel layout */
+    AlertConfig alerts;                           /**< Alert rules and sinks */
+    PluginConfig plugins;                         /**< Plugins to load */
+} MonitorConfig;
+
+/**
+ * @brief Section name of each collector, indexed by CollectorId
+ */
+extern const char *const collector_names[COLLECTOR_COUNT];
+
+/**
+ * @brief Fill a configuration with the built-in defaults
+ * @param config Configuration to fill
+ */
+void default_config(MonitorConfig *config);
+
+/**
+ * @brief Parse a configuration file on top of the defaults
+ * @param path Configuration file
+ * @param config Configuration to fill; left untouched on failure
+ * @return 0 on success, -1 on failure (see config_error())
+ */
+int load_config(const char *path, MonitorConfig *config);
+
+/**
+ * @brief Describe the last load_config() failure
+ * @return Error message with file and line
+ */
+const char *config_error(void);
+
+/**
+ * @brief Effective update interval of a collector
+ * @param config Configuration
+ * @param id Collector
+ * @return Interval in milliseconds
+ */
+int collector_interval(const MonitorConfig *config, CollectorId id);
+
+/**
+ * @brief Settings of a plugin
+ * @param config Configuration
+ * @param name Plugin name
+ * @return Its [plugin.<name>] settings, or NULL if there is no such section
+ */
+const PluginSettings *plugin_settings(const MonitorConfig *config, const char *name);
+
+#endif /* CONFIG_H */
@@ -6,6 +6,8 @@
 #ifndef CPU_H
 #define CPU_H
 
+#define MAX_CPUS 512
+
 /**
  * @brief Structure to hold CPU statistics
  */
@@ -13,24 +15,43 @@ typedef struct {
     double usage;         /**< CPU usage percentage */
     unsigned int cores;   /**< Number of CPU cores */
     char model_name[256]; /**< CPU model name */
+    double cpu_usage[MAX_CPUS]; /**< Per-CPU usage percentage, indexed by CPU number; negative if offline or not yet sampled */
+    unsigned int cpu_count;     /**< Highest CPU number in /proc/stat plus one */
+    double context_switches;    /**< Context switches per second (ctxt) */
+    double forks;               /**< Processes and threads created per second (processes) */
+    unsigned int procs_running; /**< Tasks currently runnable (procs_running) */
+    unsigned int procs_blocked; /**< Tasks blocked on I/O (procs_blocked) */
 } CPUStats;
 
 /**
- * @brief Initialize CPU monitoring
- * @return 0 on success, -1 on failure
+ * @brief Collector state of one CPU monitor (opaque)
+ *
+ * @details Holds the counters of the previous read. Monitors are independent,
+ * so several can sample /proc/stat at their own cadence.
+ */
+typedef struct CPUMonitor CPUMonitor;
+
+/**
+ * @brief Create a CPU monitor
+ * @return New monitor, or NULL on failure
  */
-int init_cpu_monitor(void);
+CPUMonitor *create_cpu_monitor(void);
 
 /**
  * @brief Update CPU statistics
+ * @param monitor Monitor to sample with
  * @param stats Pointer to CPUStats structure to update
  * @return 0 on success, -1 on failure
+ *
+ * @details Usage and rates cover the time since the previous update of the
+ * same monitor; the first update only records a baseline.
  */
-int update_cpu_stats(CPUStats *stats);
+int update_cpu_stats(CPUMonitor *monitor, CPUStats *stats);
 
 /**
- * @brief Clean up CPU monitoring resources
+ * @brief Free a CPU monitor
+ * @param monitor Monitor to free, may be NULL
  */
-void cleanup_cpu_monitor(void);
+void destroy_cpu_monitor(CPUMonitor *monitor);
 
-#endif /* CPU_H */ 
\ No newline at end of file
+#endif /* CPU_H */
@@ -0,0 +1,86 @@
+/**
+ * @file cpufreq.h
+ * @brief Per-core CPU frequency and idle state (C-state) monitoring
+ *
+ * Current frequencies come from cpufreq scaling_cur_freq, refined with the
+ * APERF/MPERF MSRs when /dev/cpu/N/msr is readable. Idle residency comes from
+ * the cpuidle state counters. All attributes are opened once and re-read
+ * with pread on every update.
+ */
+
+#ifndef CPUFREQ_H
+#define CPUFREQ_H
+
+#include "cpu.h"
+
+#define MAX_CSTATES 10
+#define MAX_CSTATE_NAME 16
+#define MAX_GOVERNOR_NAME 32
+
+/**
+ * @brief Structure to hold frequency and idle residency of one CPU
+ */
+typedef struct {
+    unsigned int cpu;              /**< Logical CPU number */
+    unsigned int cur_mhz;          /**< Frequency reported by cpufreq in MHz */
+    unsigned int effective_mhz;    /**< Average frequency while busy from APERF/MPERF, 0 without MSR access */
+    double residency[MAX_CSTATES]; /**< Share of the last interval spent in each idle state, percent */
+    double active;                 /**< Share of the last interval not spent idle, percent */
+} CPUCoreFreq;
+
+/**
+ * @brief Structure to hold the system-wide idle state description and averages
+ */
+typedef struct {
+    char name[MAX_CSTATE_NAME];  /**< State name, e.g. "C1E" or "C6" */
+    unsigned int latency_us;     /**< Exit latency in microseconds */
+    double residency;            /**< Average residency over all CPUs, percent */
+    double entries_per_sec;      /**< Entries into this state per second, summed over CPUs */
+} CStateStats;
+
+/**
+ * @brief Structure to hold CPU frequency statistics
+ */
+typedef struct {
+    CPUCoreFreq cores[MAX_CPUS];      /**< Per-CPU values */
+    unsigned int count;                    /**< Number of CPUs reported */
+    char governor[MAX_GOVERNOR_NAME];      /**< Scaling governor of the first CPU */
+    char driver[MAX_GOVERNOR_NAME];        /**< Scaling driver, e.g. "intel_pstate" */
+    unsigned int min_mhz;                  /**< Lowest current frequency over all CPUs */
+    unsigned int max_mhz;                  /**< Highest current frequency over all CPUs */
+    unsigned int avg_mhz;                  /**< Average current frequency */
+    unsigned int hw_max_mhz;               /**< Hardware maximum (cpuinfo_max_freq) */
+    CStateStats cstates[MAX_CSTATES];      /**< Idle states, shallowest first */
+    unsigned int cstate_count;             /**< Number of idle states */
+    int msr_available;                     /**< Non-zero if APERF/MPERF could be read */
+} CPUFreqStats;
+
+/**
+ * @brief Collector state of one frequency monitor (opaque)
+ */
+typedef struct CPUFreqMonitor CPUFreqMonitor;
+
+/**
+ * @brief Create a frequency and idle state monitor
+ * @return New monitor, or NULL on failure
+ *
+ * @details A machine without cpufreq or cpuidle (e.g. some VMs) is not an
+ * error; the corresponding fields simply stay zero.
+ */
+CPUFreqMonitor *create_cpufreq_monitor(void);
+
+/**
+ * @brief Update frequency and idle state statistics
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to CPUFreqStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_cpufreq_stats(CPUFreqMonitor *monitor, CPUFreqStats *stats);
+
+/**
+ * @brief Free a frequency monitor and close its descriptors
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_cpufreq_monitor(CPUFreqMonitor *monitor);
+
+#endif /* CPUFREQ_H */
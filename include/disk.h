@@ -6,6 +6,8 @@
 #ifndef DISK_H
 #define DISK_H
 
+#include "filter.h"
+
 #define MAX_DISKS 8
 #define MAX_DISK_NAME 32
 #define MAX_MOUNT_PATH 256
@@ -34,21 +36,29 @@ typedef struct {
 } DiskInfo;
 
 /**
- * @brief Initialize disk monitoring
- * @return 0 on success, -1 on failure
+ * @brief Collector state of one disk monitor (opaque)
+ */
+typedef struct DiskMonitor DiskMonitor;
+
+/**
+ * @brief Create a disk monitor
+ * @param filter Mount point patterns, or NULL for all
+ * @return New monitor, or NULL on failure
  */
-int init_disk_monitor(void);
+DiskMonitor *create_disk_monitor(const DeviceFilter *filter);
 
 /**
  * @brief Update disk statistics
+ * @param monitor Monitor to sample with
  * @param stats Pointer to DiskInfo structure to update
  * @return 0 on success, -1 on failure
  */
-int update_disk_stats(DiskInfo *stats);
+int update_disk_stats(DiskMonitor *monitor, DiskInfo *stats);
 
 /**
- * @brief Clean up disk monitoring resources
+ * @brief Free a disk monitor
+ * @param monitor Monitor to free, may be NULL
  */
-void cleanup_disk_monitor(void);
+void destroy_disk_monitor(DiskMonitor *monitor);
 
-#endif /* DISK_H */ 
\ No newline at end of file
+#endif /* DISK_H */
\ No newline at end of file
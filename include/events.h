@@ -0,0 +1,140 @@
+/**
+ * @file events.h
+ * @brief Kernel event watcher: OOM kills, hung tasks, link flaps and I/O errors
+ *
+ * Records are read from /dev/kmsg without blocking, both from the main
+ * loop as soon as the kernel logs them and on every update. Each record
+ * is "PRIO,SEQ,TIMESTAMP_US,FLAGS;MESSAGE" followed by optional " KEY=VALUE"
+ * dictionary lines. Messages that match a known pattern become events in a
+ * fixed-size ring. The other records are skipped:
+ *
+ *     Out of memory: Killed process 1234 (stress) total-vm:...
+ *     Memory cgroup out of memory: Killed process 1234 (stress) ...
+ *     INFO: task kworker/0:1:12 blocked for more than 120 seconds.
+ *     e1000e 0000:00:19.0 eth0: NIC Link is Down
+ *     blk_update_request: I/O error, dev sda, sector 2048 ...
+ *     Buffer I/O error on dev sda1, logical block 0, async page read
+ *
+ * Opening /dev/kmsg replays the kernel's buffer, so events from before the
+ * monitor started are listed too. Alongside the ring, the watcher keeps a
+ * history of memory usage, one sample per update, marked with the events
+ * that arrived during each update, so an OOM kill can be seen against the
+ * memory pressure that led to it. Any file in the same format can stand in
+ * for /dev/kmsg ([events] path); lines appended to it are picked up on the
+ * next update.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <time.h>
+
+#define MAX_EVENTS 64
+#define MAX_EVENT_SUBJECT 32
+#define MAX_EVENT_MESSAGE 128
+#define EVENT_HISTORY 60
+#define DEFAULT_KMSG_PATH "/dev/kmsg"
+
+/**
+ * @brief What a kernel event reports
+ */
+typedef enum {
+    EVENT_OOM_KILL,   /**< The OOM killer (global or cgroup) killed a process */
+    EVENT_HUNG_TASK,  /**< A task was blocked longer than hung_task_timeout_secs */
+    EVENT_LINK_DOWN,  /**< A network interface lost its link */
+    EVENT_LINK_UP,    /**< A network interface regained its link */
+    EVENT_IO_ERROR,   /**< A block device reported an I/O error */
+    EVENT_KINDS
+} KernelEventKind;
+
+/**
+ * @brief One kernel event
+ */
+typedef struct {
+    KernelEventKind kind;                /**< What happened */
+    time_t time;                         /**< Wall-clock time, derived from the record's timestamp */
+    unsigned long long timestamp_us;     /**< Record timestamp, microseconds since boot */
+    int level;                           /**< Syslog level of the record, 0 (emerg) to 7 (debug) */
+    int pid;                             /**< Process killed or hung, 0 if none */
+    char subject[MAX_EVENT_SUBJECT];     /**< Process, interface or device name */
+    char message[MAX_EVENT_MESSAGE];     /**< Record text, truncated */
+} KernelEvent;
+
+/**
+ * @brief Structure to hold the most recent kernel events
+ */
+typedef struct {
+    KernelEvent events[MAX_EVENTS];  /**< Ring; see kernel_event() */
+    unsigned long total;             /**< Events seen since the watcher started */
+    unsigned long oom_kills;         /**< OOM kills seen */
+    unsigned long hung_tasks;        /**< Hung-task warnings seen */
+    unsigned long link_flaps;        /**< Link-down transitions seen */
+    unsigned long io_errors;         /**< Block I/O errors seen */
+    unsigned int memory_history[EVENT_HISTORY];  /**< Memory usage in percent per update, oldest first */
+    unsigned char history_marks[EVENT_HISTORY];  /**< Most severe event kind + 1 per update, 0 for none */
+    unsigned int history_count;                  /**< Valid entries in the history */
+    int available;                   /**< Non-zero if the record source could be opened */
+    char error[64];                  /**< Why not, if not available */
+} EventStats;
+
+/**
+ * @brief Collector state of one event watcher (opaque)
+ */
+typedef struct EventMonitor EventMonitor;
+
+/**
+ * @brief Short name of each event kind, e.g. "OOM"
+ */
+extern const char *const event_kind_names[EVENT_KINDS];
+
+/**
+ * @brief Create an event watcher
+ * @param path Record source, NULL or empty for /dev/kmsg
+ * @return New watcher, or NULL on allocation failure
+ *
+ * @details A source that cannot be opened (reading /dev/kmsg usually needs
+ * root or kernel.dmesg_restrict=0) is not an error: the watcher reports it
+ * through EventStats.available and EventStats.error.
+ */
+EventMonitor *create_event_monitor(const char *path);
+
+/**
+ * @brief Descriptor to wait on for new records
+ * @param monitor Event watcher
+ * @return Non-blocking descriptor, or -1 if the source is not open
+ */
+int event_monitor_fd(const EventMonitor *monitor);
+
+/**
+ * @brief Read every pending record and add the recognized events
+ * @param monitor Event watcher
+ * @param stats Events to update
+ * @return 0 on success, -1 on invalid arguments
+ */
+int update_event_stats(EventMonitor *monitor, EventStats *stats);
+
+/**
+ * @brief Append one update to the memory history, marked with its events
+ * @param monitor Event watcher
+ * @param stats Events to update
+ * @param memory_usage Memory usage in percent
+ *
+ * @details Events replayed from before the first update are not marked.
+ */
+void update_event_history(EventMonitor *monitor, EventStats *stats, double memory_usage);
+
+/**
+ * @brief Look up a recent event
+ * @param stats Events
+ * @param age 0 for the newest event, 1 for the one before, ...
+ * @return Event, or NULL if fewer than age + 1 events are kept
+ */
+const KernelEvent *kernel_event(const EventStats *stats, unsigned int age);
+
+/**
+ * @brief Close the record source and free a watcher
+ * @param monitor Event watcher, may be NULL
+ */
+void destroy_event_monitor(EventMonitor *monitor);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,30 @@
+/**
+ * @file filter.h
+ * @brief Device selection by shell patterns
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#define FILTER_PATTERNS_MAX 256
+
+/**
+ * @brief Comma-separated shell patterns selecting devices by name
+ *
+ * @details A device is kept if it matches "include" (or "include" is empty)
+ * and does not match "exclude".
+ */
+typedef struct {
+    char include[FILTER_PATTERNS_MAX];  /**< Patterns to keep, empty for all */
+    char exclude[FILTER_PATTERNS_MAX];  /**< Patterns to drop */
+} DeviceFilter;
+
+/**
+ * @brief Check a device name against a filter
+ * @param filter Filter to apply, or NULL to keep every device
+ * @param name Device name
+ * @return Non-zero if the device should be shown
+ */
+int filter_match(const DeviceFilter *filter, const char *name);
+
+#endif /* FILTER_H */
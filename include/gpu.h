@@ -6,14 +6,34 @@
 #ifndef GPU_H
 #define GPU_H
 
+#include "pidcache.h"
+
 #define MAX_GPUS 4
 #define MAX_GPU_NAME 128
+#define MAX_GPU_BUS_ID 32
+#define MAX_GPU_DRIVER 16
+#define GPU_SAMPLE_HISTORY 64
+#define MAX_GPU_PROCESSES 8
+
+/**
+ * @brief Per-process GPU usage
+ */
+typedef struct {
+    unsigned int pid;                   /**< Process id */
+    char name[PROCESS_NAME_MAX];        /**< Command name */
+    char cgroup[PROCESS_CGROUP_MAX];    /**< Cgroup path */
+    unsigned long long memory_used;     /**< GPU memory held by the process in bytes */
+    unsigned int sm_util;               /**< SM utilization percentage over the last interval */
+    unsigned int mem_util;              /**< Memory controller utilization percentage */
+} GPUProcessStats;
 
 /**
  * @brief Structure to hold GPU statistics
  */
 typedef struct {
     char name[MAX_GPU_NAME];    /**< GPU model name */
+    char pci_bus_id[MAX_GPU_BUS_ID]; /**< PCI bus id, empty if unknown */
+    char driver[MAX_GPU_DRIVER];     /**< Kernel driver for DRM GPUs, empty for NVML */
     int temperature;            /**< GPU temperature in Celsius */
     double utilization;         /**< GPU utilization percentage */
     unsigned long memory_total; /**< Total GPU memory in bytes */
@@ -21,6 +41,17 @@ typedef struct {
     unsigned long memory_free;  /**< Free GPU memory in bytes */
     int power_usage;           /**< Power usage in milliwatts */
     int fan_speed;             /**< Fan speed percentage */
+    int memory_temperature;    /**< HBM/VRAM temperature in Celsius, 0 if unknown */
+    unsigned int freq_mhz;     /**< Current graphics clock in MHz, 0 if unknown */
+    unsigned int max_freq_mhz; /**< Maximum graphics clock in MHz, 0 if unknown */
+    double rc6_residency;      /**< Share of the last interval spent in RC6/GT idle (Intel) */
+    unsigned long long energy_consumed; /**< Energy since driver load in millijoules */
+    unsigned int util_samples[GPU_SAMPLE_HISTORY];  /**< Recent driver utilization samples (%), oldest first */
+    unsigned int util_sample_count;                 /**< Valid entries in util_samples */
+    unsigned int power_samples[GPU_SAMPLE_HISTORY]; /**< Recent driver power samples (mW), oldest first */
+    unsigned int power_sample_count;                /**< Valid entries in power_samples */
+    GPUProcessStats processes[MAX_GPU_PROCESSES];   /**< Top processes by GPU memory */
+    unsigned int process_count;                     /**< Valid entries in processes */
     int supported;             /**< Whether this GPU is supported and accessible */
 } GPUStats;
 
@@ -34,21 +65,34 @@ typedef struct {
 } GPUInfo;
 
 /**
- * @brief Initialize GPU monitoring
- * @return 0 on success, -1 on failure
+ * @brief Collector state of one GPU monitor (opaque)
+ *
+ * @details Holds the NVML binding or the DRM/sysfs card table, the per-device
+ * descriptors and the scratch buffers for NVML queries.
+ */
+typedef struct GPUMonitor GPUMonitor;
+
+/**
+ * @brief Create a GPU monitor
+ * @return New monitor, or NULL on failure
+ *
+ * @details Uses NVML when the driver library can be loaded and initialized,
+ * and DRM/sysfs otherwise.
  */
-int init_gpu_monitor(void);
+GPUMonitor *create_gpu_monitor(void);
 
 /**
  * @brief Update GPU statistics
+ * @param monitor Monitor to sample with
  * @param info Pointer to GPUInfo structure to update
  * @return 0 on success, -1 on failure
  */
-int update_gpu_stats(GPUInfo *info);
+int update_gpu_stats(GPUMonitor *monitor, GPUInfo *info);
 
 /**
- * @brief Clean up GPU monitoring resources
+ * @brief Free a GPU monitor and release the driver resources it holds
+ * @param monitor Monitor to free, may be NULL
  */
-void cleanup_gpu_monitor(void);
+void destroy_gpu_monitor(GPUMonitor *monitor);
 
-#endif /* GPU_H */ 
\ No newline at end of file
+#endif /* GPU_H */
\ No newline at end of file
@@ -0,0 +1,112 @@
+/**
+ * @file kmem.h
+ * @brief Kernel memory breakdown: slab caches, kernel stacks, page tables and huge pages
+ *
+ * MemoryStats counts everything that is neither free nor cache as used,
+ * including memory the kernel holds for itself and huge pages reserved up
+ * front. This collector splits that part out:
+ *
+ * - SUnreclaim, KernelStack, PageTables, VmallocUsed and Percpu from
+ *   /proc/meminfo, summed up as the kernel's own memory;
+ * - HugePages_* and Hugetlb from /proc/meminfo, and per page size from
+ *   /sys/kernel/mm/hugepages/hugepages-<size>kB;
+ * - the largest slab caches from /proc/slabinfo, which is usually only
+ *   readable by root.
+ *
+ * Leaks in the kernel (a dentry or inode cache that never shrinks, a driver
+ * leaking allocations) grow by a few kilobytes per second, invisible from
+ * one update to the next. Growth is therefore measured against samples kept
+ * KMEM_SAMPLE_MS apart over the last KMEM_SAMPLES of them, about ten
+ * minutes, so a steady leak shows as a steady rate.
+ */
+
+#ifndef KMEM_H
+#define KMEM_H
+
+#define MAX_SLAB_CACHES 8
+#define MAX_SLAB_NAME 32
+#define MAX_HUGEPAGE_SIZES 4
+#define KMEM_SAMPLES 60
+#define KMEM_SAMPLE_MS 10000
+
+/**
+ * @brief Huge page pool of one page size
+ */
+typedef struct {
+    unsigned long size;      /**< Page size in bytes */
+    unsigned long total;     /**< Pages in the pool (nr_hugepages) */
+    unsigned long free;      /**< Pages not allocated */
+    unsigned long reserved;  /**< Free pages promised to mappings */
+    unsigned long surplus;   /**< Pages above nr_hugepages from overcommit */
+} HugePageStats;
+
+/**
+ * @brief One slab cache
+ */
+typedef struct {
+    char name[MAX_SLAB_NAME];  /**< Cache name, e.g. "dentry" */
+    unsigned long size;        /**< Bytes in allocated objects, used or not */
+    unsigned long active;      /**< Bytes in objects in use */
+    double growth;             /**< Change of size in bytes per second over the window */
+} SlabCacheStats;
+
+/**
+ * @brief Structure to hold the kernel memory breakdown
+ *
+ * @details Sizes are in bytes unless noted otherwise.
+ */
+typedef struct {
+    unsigned long slab;                /**< All slab caches */
+    unsigned long slab_reclaimable;    /**< Slab the kernel can free under pressure (counted as cache) */
+    unsigned long slab_unreclaimable;  /**< Slab that stays allocated */
+    unsigned long kernel_stack;        /**< Kernel stacks of all tasks */
+    unsigned long page_tables;         /**< Page tables */
+    unsigned long vmalloc_used;        /**< vmalloc() allocations */
+    unsigned long percpu;              /**< Per-CPU allocations */
+    unsigned long kernel;              /**< Sum of the unreclaimable kernel memory above */
+    unsigned long hugetlb;             /**< Memory in huge page pools of all sizes */
+    unsigned long hugepages_total;     /**< Pages of the default size in the pool */
+    unsigned long hugepages_free;      /**< Pages of the default size not allocated */
+    unsigned long hugepage_size;       /**< Default huge page size */
+    HugePageStats hugepages[MAX_HUGEPAGE_SIZES];  /**< Pools by page size, smallest first */
+    unsigned int hugepage_count;                  /**< Valid entries in hugepages */
+    double kernel_growth;              /**< Change of kernel in bytes per second over the window */
+    double slab_unreclaimable_growth;  /**< Change of slab_unreclaimable in bytes per second */
+    double slab_growth;                /**< Change of slab in bytes per second */
+    unsigned int growth_window;        /**< Seconds the growth rates span, 0 until the second update */
+    SlabCacheStats caches[MAX_SLAB_CACHES];  /**< Largest slab caches, largest first */
+    unsigned int cache_count;                /**< Valid entries in caches */
+    int slabinfo_available;            /**< Non-zero if /proc/slabinfo could be read */
+    char slabinfo_error[64];           /**< Why not, if not available */
+} KmemStats;
+
+/**
+ * @brief Collector state of one kernel memory monitor (opaque)
+ */
+typedef struct KmemMonitor KmemMonitor;
+
+/**
+ * @brief Create a kernel memory monitor
+ * @return New monitor, or NULL if /proc/meminfo cannot be opened
+ *
+ * @details Opens /proc/meminfo and /proc/slabinfo once and discovers the
+ * huge page sizes. An unreadable slabinfo is not an error: the monitor
+ * reports it through KmemStats.slabinfo_available.
+ */
+KmemMonitor *create_kmem_monitor(void);
+
+/**
+ * @brief Update the kernel memory breakdown
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to KmemStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_kmem_stats(KmemMonitor *monitor, KmemStats *stats);
+
+/**
+ * @brief Free a kernel memory monitor and close its files
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_kmem_monitor(KmemMonitor *monitor);
+
+#endif /* KMEM_H */
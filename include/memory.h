@@ -27,7 +27,7 @@
  * including both physical RAM and swap space. All values are in bytes unless
  * otherwise specified.
  *
- * @see init_memory_monitoring
+ * @see create_memory_monitor
  * @see update_memory_stats
  */
 typedef struct {
@@ -44,20 +44,25 @@ typedef struct {
 } MemoryStats;
 
 /**
- * @brief Initialize memory monitoring
- * @return 0 on successful initialization, -1 on failure
+ * @brief Collector state of one memory monitor (opaque)
+ */
+typedef struct MemoryMonitor MemoryMonitor;
+
+/**
+ * @brief Create a memory monitor
+ * @return New monitor, or NULL on failure
  * 
- * @details Sets up necessary resources for memory monitoring. Must be called
- * before using update_memory_stats().
+ * @details Opens /proc/meminfo once; every update re-reads it from the
+ * start instead of reopening it.
  * 
- * @note This function is idempotent - calling it multiple times has no effect
- * @see cleanup_memory_monitoring
+ * @see destroy_memory_monitor
  * @see update_memory_stats
  */
-int init_memory_monitoring(void);
+MemoryMonitor *create_memory_monitor(void);
 
 /**
  * @brief Update memory statistics
+ * @param monitor Monitor to sample with
  * @param stats Pointer to MemoryStats structure to update
  * @return 0 on success, -1 on failure
  * 
@@ -65,23 +70,21 @@ int init_memory_monitoring(void);
  * fields in the provided MemoryStats structure. This includes calculating
  * derived values like usage percentages.
  * 
- * @note Requires prior call to init_memory_monitoring()
  * @warning The stats parameter must not be NULL
  * @see MemoryStats
- * @see init_memory_monitoring
+ * @see create_memory_monitor
  */
-int update_memory_stats(MemoryStats *stats);
+int update_memory_stats(MemoryMonitor *monitor, MemoryStats *stats);
 
 /**
- * @brief Clean up memory monitoring resources
+ * @brief Free a memory monitor
+ * @param monitor Monitor to free, may be NULL
  * 
- * @details Releases any resources allocated during memory monitoring.
- * Should be called before program exit for proper cleanup.
+ * @details Closes /proc/meminfo and releases the monitor.
  * 
- * @note This function is safe to call even if init_memory_monitoring() was not called
- * @see init_memory_monitoring
+ * @see create_memory_monitor
  */
-void cleanup_memory_monitoring(void);
+void destroy_memory_monitor(MemoryMonitor *monitor);
 
 /** @} */ // end of memory group
 
@@ -0,0 +1,273 @@
+/**
+ * @file metrics.h
+ * @brief Self-describing registry of the built-in metrics
+ *
+ * Every metric the collectors produce is listed once in METRIC_TABLE with
+ * its name, unit, type, instance label and the SystemStats field it comes
+ * from. The table is expanded at compile time into the MetricId enum, the
+ * slot layout of a flat value array and the metric_info[] descriptors, so
+ * consumers such as alerting or an exporter iterate over metrics generically
+ * instead of knowing each SystemStats field.
+ *
+ * A metric with an instance label (per CPU, mount point, interface or GPU)
+ * owns one slot per possible instance, so the slot of every value is fixed
+ * at compile time:
+ *
+ *     double usage = snapshot->values[metric_info[METRIC_DISK_USAGE].slot + 2];
+ *
+ * Slots without a value (an instance that does not exist or an offline
+ * CPU) hold NAN.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "cpu.h"
+#include "disk.h"
+#include "gpu.h"
+#include "network.h"
+#include <stddef.h>
+
+/**
+ * @brief How a metric's value behaves over time
+ */
+typedef enum {
+    METRIC_GAUGE,    /**< Current level; may go up and down */
+    METRIC_COUNTER,  /**< Monotonic total since boot */
+    METRIC_RATE      /**< Change per second over the last interval */
+} MetricType;
+
+/**
+ * @brief What the instance label of a metric selects
+ */
+typedef enum {
+    METRIC_SCALAR,         /**< No label, one slot */
+    METRIC_PER_CPU,        /**< cpu: CPU number, MAX_CPUS slots */
+    METRIC_PER_DISK,       /**< mount: mount point, MAX_DISKS slots */
+    METRIC_PER_INTERFACE,  /**< interface: interface name, MAX_INTERFACES slots */
+    METRIC_PER_GPU,        /**< gpu: GPU index, MAX_GPUS slots */
+    METRIC_INSTANCE_KINDS
+} MetricInstance;
+
+// Slots a metric of each instance kind occupies
+#define METRIC_SLOTS_METRIC_SCALAR 1
+#define METRIC_SLOTS_METRIC_PER_CPU MAX_CPUS
+#define METRIC_SLOTS_METRIC_PER_DISK MAX_DISKS
+#define METRIC_SLOTS_METRIC_PER_INTERFACE MAX_INTERFACES
+#define METRIC_SLOTS_METRIC_PER_GPU MAX_GPUS
+
+/*
+ * X(id, name, unit, type, instance, field, help)
+ *
+ * field is the member of SystemStats the value is read from; for per-CPU
+ * metrics the element [0] of a per-CPU array, for the others the member of
+ * element [0] of the disk, interface or GPU array. Its C type is picked up
+ * automatically and must be double, int, unsigned int or unsigned long.
+ */
+#define METRIC_TABLE(X) \
+    X(CPU_USAGE, "cpu.usage", "%", METRIC_GAUGE, METRIC_SCALAR, cpu.usage, "CPU busy time") \
+    X(CPU_CORE_USAGE, "cpu.usage", "%", METRIC_GAUGE, METRIC_PER_CPU, cpu.cpu_usage[0], "Busy time of one CPU") \
+    X(CPU_CONTEXT_SWITCHES, "cpu.context_switches", "1/s", METRIC_RATE, METRIC_SCALAR, cpu.context_switches, "Context switches") \
+    X(CPU_FORKS, "cpu.forks", "1/s", METRIC_RATE, METRIC_SCALAR, cpu.forks, "Processes and threads created") \
+    X(CPU_PROCS_RUNNING, "cpu.procs_running", "", METRIC_GAUGE, METRIC_SCALAR, cpu.procs_running, "Runnable tasks") \
+    X(CPU_PROCS_BLOCKED, "cpu.procs_blocked", "", METRIC_GAUGE, METRIC_SCALAR, cpu.procs_blocked, "Tasks blocked on I/O") \
+    X(SCHED_LOAD1, "sched.load1", "", METRIC_GAUGE, METRIC_SCALAR, scheduler.load1, "1-minute load average") \
+    X(SCHED_LOAD5, "sched.load5", "", METRIC_GAUGE, METRIC_SCALAR, scheduler.load5, "5-minute load average") \
+    X(SCHED_LOAD15, "sched.load15", "", METRIC_GAUGE, METRIC_SCALAR, scheduler.load15, "15-minute load average") \
+    X(SCHED_RUNNABLE, "sched.runnable", "", METRIC_GAUGE, METRIC_SCALAR, scheduler.runnable, "Runnable scheduling entities") \
+    X(SCHED_RUN_DELAY, "sched.run_delay", "ms/s", METRIC_RATE, METRIC_SCALAR, scheduler.total_run_delay, "Run-queue wait summed over CPUs") \
+    X(SCHED_MAX_RUN_DELAY, "sched.max_run_delay", "ms/s", METRIC_RATE, METRIC_SCALAR, scheduler.max_run_delay, "Largest per-CPU run-queue wait") \
+    X(SCHED_WAIT_PER_SLICE, "sched.wait_per_slice", "us", METRIC_GAUGE, METRIC_SCALAR, scheduler.avg_wait_per_slice, "Average wait before a timeslice") \
+    X(CPUFREQ_AVG_MHZ, "cpufreq.avg_mhz", "MHz", METRIC_GAUGE, METRIC_SCALAR, cpufreq.avg_mhz, "Average CPU frequency") \
+    X(CPUFREQ_MIN_MHZ, "cpufreq.min_mhz", "MHz", METRIC_GAUGE, METRIC_SCALAR, cpufreq.min_mhz, "Lowest CPU frequency") \
+    X(THERMAL_PACKAGE_TEMP, "thermal.package_temp", "C", METRIC_GAUGE, METRIC_SCALAR, thermal.package_temp, "Package temperature") \
+    X(THERMAL_CORE_TEMP_MAX, "thermal.core_temp_max", "C", METRIC_GAUGE, METRIC_SCALAR, thermal.core_temp_max, "Hottest core temperature") \
+    X(THERMAL_CORE_TEMP_AVG, "thermal.core_temp_avg", "C", METRIC_GAUGE, METRIC_SCALAR, thermal.core_temp_avg, "Average core temperature") \
+    X(THERMAL_CORE_THROTTLE, "thermal.core_throttle_events", "", METRIC_COUNTER, METRIC_SCALAR, thermal.core_throttle_count, "Core thermal throttling events, all CPUs") \
+    X(THERMAL_PACKAGE_THROTTLE, "thermal.package_throttle_events", "", METRIC_COUNTER, METRIC_SCALAR, thermal.package_throttle_count, "Package thermal throttling events, all packages") \
+    X(THERMAL_THROTTLING, "thermal.throttling", "", METRIC_GAUGE, METRIC_SCALAR, thermal.throttling, "1 while a CPU is throttling") \
+    X(PERF_IPC, "perf.ipc", "", METRIC_GAUGE, METRIC_SCALAR, perf.total.ipc, "Instructions per cycle") \
+    X(PERF_GHZ, "perf.ghz", "GHz", METRIC_GAUGE, METRIC_SCALAR, perf.total.ghz, "Unhalted cycles per second") \
+    X(PERF_CACHE_MPKI, "perf.cache_mpki", "", METRIC_GAUGE, METRIC_SCALAR, perf.total.cache_mpki, "Cache misses per 1000 instructions") \
+    X(PERF_BRANCH_MPKI, "perf.branch_mpki", "", METRIC_GAUGE, METRIC_SCALAR, perf.total.branch_mpki, "Branch misses per 1000 instructions") \
+    X(PERF_STALLED_FRONTEND, "perf.stalled_frontend", "%", METRIC_GAUGE, METRIC_SCALAR, perf.total.stalled_frontend, "Front-end stalled cycles") \
+    X(PERF_STALLED_BACKEND, "perf.stalled_backend", "%", METRIC_GAUGE, METRIC_SCALAR, perf.total.stalled_backend, "Back-end stalled cycles") \
+    X(PERF_MIGRATIONS, "perf.migrations", "1/s", METRIC_RATE, METRIC_SCALAR, perf.total.migrations, "CPU migrations") \
+    X(PERF_PAGE_FAULTS, "perf.page_faults", "1/s", METRIC_RATE, METRIC_SCALAR, perf.total.page_faults, "Page faults") \
+    X(MEM_USAGE, "mem.usage", "%", METRIC_GAUGE, METRIC_SCALAR, memory.usage, "Memory in use") \
+    X(MEM_SWAP_USAGE, "mem.swap_usage", "%", METRIC_GAUGE, METRIC_SCALAR, memory.swap_usage, "Swap in use") \
+    X(MEM_TOTAL, "mem.total", "B", METRIC_GAUGE, METRIC_SCALAR, memory.total, "Total memory") \
+    X(MEM_USED, "mem.used", "B", METRIC_GAUGE, METRIC_SCALAR, memory.used, "Used memory") \
+    X(MEM_FREE, "mem.free", "B", METRIC_GAUGE, METRIC_SCALAR, memory.free, "Free memory") \
+    X(MEM_AVAILABLE, "mem.available", "B", METRIC_GAUGE, METRIC_SCALAR, memory.available, "Available memory") \
+    X(MEM_CACHED, "mem.cached", "B", METRIC_GAUGE, METRIC_SCALAR, memory.cached, "Page cache") \
+    X(DISK_USAGE, "disk.usage", "%", METRIC_GAUGE, METRIC_PER_DISK, disks.disks[0].usage, "File system space in use") \
+    X(DISK_TOTAL, "disk.total", "B", METRIC_GAUGE, METRIC_PER_DISK, disks.disks[0].total, "File system size") \
+    X(DISK_FREE, "disk.free", "B", METRIC_GAUGE, METRIC_PER_DISK, disks.disks[0].free, "Free space") \
+    X(DISK_AVAILABLE, "disk.available", "B", METRIC_GAUGE, METRIC_PER_DISK, disks.disks[0].available, "Space available to users") \
+    X(DISK_READS, "disk.reads", "", METRIC_COUNTER, METRIC_PER_DISK, disks.disks[0].reads, "Reads completed") \
+    X(DISK_WRITES, "disk.writes", "", METRIC_COUNTER, METRIC_PER_DISK, disks.disks[0].writes, "Writes completed") \
+    X(DISK_IO_IN_PROGRESS, "disk.io_in_progress", "", METRIC_GAUGE, METRIC_PER_DISK, disks.disks[0].io_in_progress, "I/O operations in flight") \
+    X(NET_RX, "net.rx", "B/s", METRIC_RATE, METRIC_PER_INTERFACE, network.interfaces[0].receive_speed, "Receive throughput") \
+    X(NET_TX, "net.tx", "B/s", METRIC_RATE, METRIC_PER_INTERFACE, network.interfaces[0].send_speed, "Transmit throughput") \
+    X(NET_BYTES_RECEIVED, "net.bytes_received", "B", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].bytes_received, "Bytes received") \
+    X(NET_BYTES_SENT, "net.bytes_sent", "B", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].bytes_sent, "Bytes sent") \
+    X(NET_PACKETS_RECEIVED, "net.packets_received", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].packets_received, "Packets received") \
+    X(NET_PACKETS_SENT, "net.packets_sent", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].packets_sent, "Packets sent") \
+    X(NET_ERRORS_IN, "net.errors_in", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].errors_in, "Receive errors") \
+    X(NET_ERRORS_OUT, "net.errors_out", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].errors_out, "Transmit errors") \
+    X(NET_DROPS_IN, "net.drops_in", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].drops_in, "Received packets dropped") \
+    X(NET_DROPS_OUT, "net.drops_out", "", METRIC_COUNTER, METRIC_PER_INTERFACE, network.interfaces[0].drops_out, "Transmitted packets dropped") \
+    X(GPU_TEMPERATURE, "gpu.temperature", "C", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].temperature, "GPU temperature") \
+    X(GPU_UTILIZATION, "gpu.utilization", "%", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].utilization, "GPU busy time") \
+    X(GPU_MEMORY_USED, "gpu.memory_used", "B", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].memory_used, "GPU memory in use") \
+    X(GPU_MEMORY_TOTAL, "gpu.memory_total", "B", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].memory_total, "GPU memory size") \
+    X(GPU_POWER, "gpu.power_mw", "mW", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].power_usage, "GPU power draw") \
+    X(GPU_FAN_SPEED, "gpu.fan_speed", "%", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].fan_speed, "GPU fan speed") \
+    X(GPU_FREQ_MHZ, "gpu.freq_mhz", "MHz", METRIC_GAUGE, METRIC_PER_GPU, gpus.gpus[0].freq_mhz, "GPU clock") \
+    X(EVENTS_OOM_KILLS, "events.oom_kills", "", METRIC_COUNTER, METRIC_SCALAR, events.oom_kills, "Processes killed by the OOM killer") \
+    X(EVENTS_HUNG_TASKS, "events.hung_tasks", "", METRIC_COUNTER, METRIC_SCALAR, events.hung_tasks, "Hung-task warnings") \
+    X(EVENTS_LINK_FLAPS, "events.link_flaps", "", METRIC_COUNTER, METRIC_SCALAR, events.link_flaps, "Network links that went down") \
+    X(EVENTS_IO_ERRORS, "events.io_errors", "", METRIC_COUNTER, METRIC_SCALAR, events.io_errors, "Block device I/O errors") \
+    X(KMEM_SLAB, "kmem.slab", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.slab, "Slab caches") \
+    X(KMEM_SLAB_UNRECLAIMABLE, "kmem.slab_unreclaimable", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.slab_unreclaimable, "Slab the kernel cannot reclaim") \
+    X(KMEM_KERNEL_STACK, "kmem.kernel_stack", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.kernel_stack, "Kernel stacks") \
+    X(KMEM_PAGE_TABLES, "kmem.page_tables", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.page_tables, "Page tables") \
+    X(KMEM_VMALLOC_USED, "kmem.vmalloc_used", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.vmalloc_used, "vmalloc allocations") \
+    X(KMEM_KERNEL, "kmem.kernel", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.kernel, "Unreclaimable kernel memory") \
+    X(KMEM_HUGETLB, "kmem.hugetlb", "B", METRIC_GAUGE, METRIC_SCALAR, kmem.hugetlb, "Memory in huge page pools") \
+    X(KMEM_HUGEPAGES_TOTAL, "kmem.hugepages_total", "", METRIC_GAUGE, METRIC_SCALAR, kmem.hugepages_total, "Default-size huge pages in the pool") \
+    X(KMEM_HUGEPAGES_FREE, "kmem.hugepages_free", "", METRIC_GAUGE, METRIC_SCALAR, kmem.hugepages_free, "Default-size huge pages not allocated") \
+    X(KMEM_KERNEL_GROWTH, "kmem.kernel_growth", "B/s", METRIC_RATE, METRIC_SCALAR, kmem.kernel_growth, "Kernel memory growth over the last minutes") \
+    X(KMEM_SLAB_UNRECLAIMABLE_GROWTH, "kmem.slab_unreclaimable_growth", "B/s", METRIC_RATE, METRIC_SCALAR, kmem.slab_unreclaimable_growth, "Unreclaimable slab growth over the last minutes") \
+    X(ZONES_NEAR_LOW, "zones.near_low", "", METRIC_GAUGE, METRIC_SCALAR, zones.near_low, "Zones between their low and high watermark") \
+    X(ZONES_BELOW_LOW, "zones.below_low", "", METRIC_GAUGE, METRIC_SCALAR, zones.below_low, "Zones below their low watermark") \
+    X(ZONES_BELOW_MIN, "zones.below_min", "", METRIC_GAUGE, METRIC_SCALAR, zones.below_min, "Zones below their min watermark") \
+    X(ZONES_UNUSABLE_COSTLY, "zones.unusable_costly", "%", METRIC_GAUGE, METRIC_SCALAR, zones.unusable_costly, "Free memory unusable for order-3 allocations") \
+    X(ZONES_UNUSABLE_THP, "zones.unusable_thp", "%", METRIC_GAUGE, METRIC_SCALAR, zones.unusable_thp, "Free memory unusable for transparent huge pages") \
+    X(PROCMEM_READS, "procmem.smaps_reads", "", METRIC_GAUGE, METRIC_SCALAR, procmem.reads, "smaps_rollup files read in the last update") \
+    X(PROCMEM_READ_MS, "procmem.read_ms", "ms", METRIC_GAUGE, METRIC_SCALAR, procmem.read_ms, "Time spent reading smaps_rollup in the last update") \
+    X(WORKINGSET_BYTES, "workingset.bytes", "B", METRIC_GAUGE, METRIC_SCALAR, workingset.working_set, "Memory touched within the window") \
+    X(WORKINGSET_REFAULTED, "workingset.refaulted", "B", METRIC_GAUGE, METRIC_SCALAR, workingset.refaulted, "Evicted pages read back in within the window") \
+    X(WORKINGSET_COVERAGE, "workingset.coverage", "%", METRIC_GAUGE, METRIC_SCALAR, workingset.coverage, "Share of page frames measured by idle page tracking") \
+    X(WORKINGSET_SCAN_MS, "workingset.scan_ms", "ms", METRIC_GAUGE, METRIC_SCALAR, workingset.scan_ms, "Time spent sweeping the idle page bitmap in the last update") \
+    X(SWAP_IN, "swap.in", "B/s", METRIC_RATE, METRIC_SCALAR, swap.swap_in, "Swapped in") \
+    X(SWAP_OUT, "swap.out", "B/s", METRIC_RATE, METRIC_SCALAR, swap.swap_out, "Swapped out") \
+    X(SWAP_SPILL, "swap.spill", "B/s", METRIC_RATE, METRIC_SCALAR, swap.spill, "Swapped out past zram") \
+    X(SWAP_ZRAM_RATIO, "swap.zram_ratio", "", METRIC_GAUGE, METRIC_SCALAR, swap.zram_ratio, "zram data per byte of memory used") \
+    X(SWAP_ZRAM_STRUGGLING, "swap.zram_struggling", "", METRIC_GAUGE, METRIC_SCALAR, swap.zram_struggling, "zram devices full or failing writes") \
+    X(SWAP_ZRAM_FAILED_WRITES, "swap.zram_failed_writes", "1/s", METRIC_RATE, METRIC_SCALAR, swap.zram_failed_writes, "Failed zram writes") \
+    X(SWAP_ZSWAP_RATIO, "swap.zswap_ratio", "", METRIC_GAUGE, METRIC_SCALAR, swap.zswap_ratio, "zswap stored data per byte of pool") \
+    X(SWAP_ZSWAP_WRITTEN_BACK, "swap.zswap_written_back", "B/s", METRIC_RATE, METRIC_SCALAR, swap.zswap_written_back, "Written back from the zswap pool to swap") \
+    X(SWAP_ZSWAP_REJECTED, "swap.zswap_rejected", "1/s", METRIC_RATE, METRIC_SCALAR, swap.zswap_rejected, "Pages zswap refused to store")
+
+/**
+ * @brief Identifier of each metric, the index into metric_info[]
+ */
+typedef enum {
+#define METRIC_ID(id, name, unit, type, instance, field, help) METRIC_##id,
+    METRIC_TABLE(METRIC_ID)
+#undef METRIC_ID
+    METRIC_COUNT
+} MetricId;
+
+/**
+ * @brief First and last slot of each metric in the value array
+ *
+ * @details Each metric's last slot is its first plus its instance count
+ * minus one, and the next metric starts right after it.
+ */
+enum {
+#define METRIC_SLOT(id, name, unit, type, instance, field, help) \
+    METRIC_SLOT_##id, METRIC_SLOT_LAST_##id = METRIC_SLOT_##id + METRIC_SLOTS_##instance - 1,
+    METRIC_TABLE(METRIC_SLOT)
+#undef METRIC_SLOT
+    METRIC_SLOT_COUNT
+};
+
+/**
+ * @brief C type of the SystemStats field a metric is read from
+ */
+typedef enum {
+    METRIC_FIELD_DOUBLE,
+    METRIC_FIELD_INT,
+    METRIC_FIELD_UINT,
+    METRIC_FIELD_ULONG,
+    METRIC_FIELD_ULLONG
+} MetricField;
+
+/**
+ * @brief Description of one metric
+ */
+typedef struct {
+    const char *name;         /**< Dotted name; per-instance metrics may share it with a scalar */
+    const char *unit;         /**< Unit of the value, "" for plain counts */
+    MetricType type;          /**< Gauge, counter or rate */
+    MetricInstance instance;  /**< Instance label, METRIC_SCALAR for none */
+    const char *help;         /**< One-line description */
+    unsigned int slot;        /**< First slot in MetricSnapshot.values */
+    unsigned int slots;       /**< Number of slots, one per possible instance */
+    MetricField field;        /**< C type of the source field */
+    size_t offset;            /**< Offset of the source field of instance 0 in SystemStats */
+} MetricInfo;
+
+/**
+ * @brief Descriptors of all built-in metrics, indexed by MetricId
+ */
+extern const MetricInfo metric_info[METRIC_COUNT];
+
+/**
+ * @brief Label name of each instance kind, NULL for METRIC_SCALAR
+ */
+extern const char *const metric_instance_labels[METRIC_INSTANCE_KINDS];
+
+/**
+ * @brief Name of each metric type ("gauge", "counter", "rate")
+ */
+extern const char *const metric_type_names[];
+
+/**
+ * @brief Every built-in metric as one dense array, slot layout from metric_info[]
+ */
+typedef struct {
+    double values[METRIC_SLOT_COUNT];  /**< NAN where there is no value */
+} MetricSnapshot;
+
+struct SystemStats;
+
+/**
+ * @brief Find a metric by name
+ * @param name Dotted metric name
+ * @param per_instance Non-zero for the per-instance metric of that name
+ * @return MetricId, or -1 if there is no such metric
+ */
+int find_metric(const char *name, int per_instance);
+
+/**
+ * @brief Label value of one instance, e.g. the mount point of a disk
+ * @param stats Current statistics
+ * @param kind Instance kind
+ * @param index Instance index
+ * @param buf Buffer for numeric labels (CPU and GPU numbers)
+ * @param size Size of the buffer
+ * @return Label value, or NULL if the instance does not exist
+ */
+const char *metric_instance_label(const struct SystemStats *stats, MetricInstance kind,
+                                  unsigned int index, char *buf, size_t size);
+
+/**
+ * @brief Number of instances that currently exist
+ * @param stats Current statistics
+ * @param kind Instance kind
+ * @return Instances with values; 1 for METRIC_SCALAR
+ */
+unsigned int metric_instance_count(const struct SystemStats *stats, MetricInstance kind);
+
+/**
+ * @brief Flatten a SystemStats into the metric value array
+ * @param stats Current statistics
+ * @param snapshot Snapshot to fill
+ */
+void update_metric_snapshot(const struct SystemStats *stats, MetricSnapshot *snapshot);
+
+#endif /* METRICS_H */
@@ -6,6 +6,8 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 
+#include "filter.h"
+
 #include <stddef.h>
 
 #define MAX_INTERFACES 16
@@ -37,21 +39,32 @@ typedef struct {
 } NetworkStats;
 
 /**
- * @brief Initialize network monitoring
- * @return 0 on success, -1 on failure
+ * @brief Collector state of one network monitor (opaque)
+ */
+typedef struct NetworkMonitor NetworkMonitor;
+
+/**
+ * @brief Create a network monitor
+ * @param filter Interface name patterns, or NULL for all
+ * @return New monitor, or NULL if /proc/net/dev cannot be read
  */
-int init_network_monitoring(void);
+NetworkMonitor *create_network_monitor(const DeviceFilter *filter);
 
 /**
  * @brief Update network statistics
+ * @param monitor Monitor to sample with
  * @param stats Pointer to NetworkStats structure to update
  * @return 0 on success, -1 on failure
+ *
+ * @details Speeds cover the time since the previous update of the same
+ * monitor.
  */
-int update_network_stats(NetworkStats *stats);
+int update_network_stats(NetworkMonitor *monitor, NetworkStats *stats);
 
 /**
- * @brief Clean up network monitoring resources
+ * @brief Free a network monitor
+ * @param monitor Monitor to free, may be NULL
  */
-void cleanup_network_monitoring(void);
+void destroy_network_monitor(NetworkMonitor *monitor);
 
-#endif /* NETWORK_H */ 
\ No newline at end of file
+#endif /* NETWORK_H */
\ No newline at end of file
@@ -0,0 +1,294 @@
+/**
+ * @file nvml_binding.h
+ * @brief Typed, versioned binding to the NVIDIA Management Library
+ *
+ * NVML is loaded at runtime with dlopen(), so nothing checks our view of its
+ * ABI against the installed driver. This header mirrors the official NVML
+ * type definitions for the subset of the API we use. The loader picks the
+ * newest entry point version the driver exports (e.g. _v3 before _v2) and
+ * normalises versioned structs, so callers see a single layout.
+ */
+
+#ifndef NVML_BINDING_H
+#define NVML_BINDING_H
+
+/**
+ * @brief Mirrors nvmlReturn_t
+ */
+typedef enum {
+    NVML_SUCCESS = 0,
+    NVML_ERROR_UNINITIALIZED = 1,
+    NVML_ERROR_INVALID_ARGUMENT = 2,
+    NVML_ERROR_NOT_SUPPORTED = 3,
+    NVML_ERROR_NO_PERMISSION = 4,
+    NVML_ERROR_ALREADY_INITIALIZED = 5,
+    NVML_ERROR_NOT_FOUND = 6,
+    NVML_ERROR_INSUFFICIENT_SIZE = 7,
+    NVML_ERROR_INSUFFICIENT_POWER = 8,
+    NVML_ERROR_DRIVER_NOT_LOADED = 9,
+    NVML_ERROR_TIMEOUT = 10,
+    NVML_ERROR_IRQ_ISSUE = 11,
+    NVML_ERROR_LIBRARY_NOT_FOUND = 12,
+    NVML_ERROR_FUNCTION_NOT_FOUND = 13,
+    NVML_ERROR_CORRUPTED_INFOROM = 14,
+    NVML_ERROR_GPU_IS_LOST = 15,
+    NVML_ERROR_RESET_REQUIRED = 16,
+    NVML_ERROR_OPERATING_SYSTEM = 17,
+    NVML_ERROR_LIB_RM_VERSION_MISMATCH = 18,
+    NVML_ERROR_IN_USE = 19,
+    NVML_ERROR_MEMORY = 20,
+    NVML_ERROR_NO_DATA = 21,
+    NVML_ERROR_VGPU_ECC_NOT_SUPPORTED = 22,
+    NVML_ERROR_INSUFFICIENT_RESOURCES = 23,
+    NVML_ERROR_FREQ_NOT_SUPPORTED = 24,
+    NVML_ERROR_ARGUMENT_VERSION_MISMATCH = 25,
+    NVML_ERROR_DEPRECATED = 26,
+    NVML_ERROR_NOT_READY = 27,
+    NVML_ERROR_GPU_NOT_FOUND = 28,
+    NVML_ERROR_INVALID_STATE = 29,
+    NVML_ERROR_UNKNOWN = 999
+} NVMLReturn;
+
+/**
+ * @brief What a caller should do after an NVML error
+ */
+typedef enum {
+    NVML_POLICY_OK = 0,        /**< Call succeeded */
+    NVML_POLICY_RETRY,         /**< Transient; try again next tick */
+    NVML_POLICY_SKIP,          /**< Metric unavailable on this device; stop asking */
+    NVML_POLICY_REDISCOVER     /**< Handle or library state is stale; rebuild the device table */
+} NVMLPolicy;
+
+/** Mirrors nvmlTemperatureSensors_t */
+typedef enum {
+    NVML_TEMPERATURE_GPU = 0
+} NVMLTemperatureSensor;
+
+/** Mirrors nvmlSamplingType_t */
+typedef enum {
+    NVML_TOTAL_POWER_SAMPLES = 0,
+    NVML_GPU_UTILIZATION_SAMPLES = 1,
+    NVML_MEMORY_UTILIZATION_SAMPLES = 2
+} NVMLSamplingType;
+
+/** Mirrors nvmlValueType_t */
+typedef enum {
+    NVML_VALUE_TYPE_DOUBLE = 0,
+    NVML_VALUE_TYPE_UNSIGNED_INT = 1,
+    NVML_VALUE_TYPE_UNSIGNED_LONG = 2,
+    NVML_VALUE_TYPE_UNSIGNED_LONG_LONG = 3,
+    NVML_VALUE_TYPE_SIGNED_LONG_LONG = 4,
+    NVML_VALUE_TYPE_SIGNED_INT = 5
+} NVMLValueType;
+
+// Field ids (nvmlFieldValue_t.fieldId)
+#define NVML_FI_DEV_MEMORY_TEMP 82
+#define NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION 83
+#define NVML_FI_DEV_POWER_INSTANT 186
+
+#define NVML_DEVICE_NAME_V2_BUFFER_SIZE 96
+#define NVML_DEVICE_UUID_V2_BUFFER_SIZE 96
+#define NVML_DEVICE_PCI_BUS_ID_BUFFER_SIZE 32
+#define NVML_DEVICE_PCI_BUS_ID_BUFFER_V2_SIZE 16
+
+/** Reported as usedGpuMemory when the driver can't attribute memory */
+#define NVML_VALUE_NOT_AVAILABLE (~0ULL)
+
+/** Builds the version field of versioned NVML structs (NVML_STRUCT_VERSION) */
+#define NVML_STRUCT_VERSION(type, ver) ((unsigned int)(sizeof(type) | ((ver) << 24U)))
+
+/** Opaque device handle (nvmlDevice_t) */
+typedef struct NVMLDeviceOpaque *NVMLDeviceHandle;
+
+/** Mirrors nvmlUtilization_t */
+typedef struct {
+    unsigned int gpu;       /**< Percent of time a kernel was executing */
+    unsigned int memory;    /**< Percent of time device memory was read or written */
+} NVMLUtilization;
+
+/** Mirrors nvmlMemory_t (v1) */
+typedef struct {
+    unsigned long long total;
+    unsigned long long free;
+    unsigned long long used;
+} NVMLMemory;
+
+/** Mirrors nvmlMemory_v2_t */
+typedef struct {
+    unsigned int version;           /**< NVML_STRUCT_VERSION(NVMLMemoryV2, 2) */
+    unsigned long long total;
+    unsigned long long reserved;    /**< Reserved by the driver/firmware */
+    unsigned long long free;
+    unsigned long long used;
+} NVMLMemoryV2;
+
+/** Mirrors nvmlPciInfo_t (as filled by nvmlDeviceGetPciInfo_v3) */
+typedef struct {
+    char bus_id_legacy[NVML_DEVICE_PCI_BUS_ID_BUFFER_V2_SIZE];
+    unsigned int domain;
+    unsigned int bus;
+    unsigned int device;
+    unsigned int pci_device_id;
+    unsigned int pci_subsystem_id;
+    char bus_id[NVML_DEVICE_PCI_BUS_ID_BUFFER_SIZE];
+} NVMLPciInfo;
+
+/** Mirrors nvmlValue_t */
+typedef union {
+    double d;
+    unsigned int ui;
+    unsigned long ul;
+    unsigned long long ull;
+    long long sll;
+    int si;
+} NVMLValue;
+
+/** Mirrors nvmlFieldValue_t */
+typedef struct {
+    unsigned int field_id;
+    unsigned int scope_id;
+    long long timestamp;
+    long long latency_usec;
+    NVMLValueType value_type;
+    NVMLReturn nvml_return;
+    NVMLValue value;
+} NVMLFieldValue;
+
+/** Mirrors nvmlSample_t */
+typedef struct {
+    unsigned long long timestamp;
+    NVMLValue value;
+} NVMLSample;
+
+/** Mirrors nvmlProcessInfo_v1_t (legacy nvmlDeviceGet*RunningProcesses) */
+typedef struct {
+    unsigned int pid;
+    unsigned long long used_gpu_memory;
+} NVMLProcessInfoV1;
+
+/** Mirrors nvmlProcessInfo_t (_v2 and _v3 entry points) */
+typedef struct {
+    unsigned int pid;
+    unsigned long long used_gpu_memory;
+    unsigned int gpu_instance_id;
+    unsigned int compute_instance_id;
+} NVMLProcessInfo;
+
+/** Mirrors nvmlProcessUtilizationSample_t */
+typedef struct {
+    unsigned int pid;
+    unsigned long long timestamp;
+    unsigned int sm_util;
+    unsigned int mem_util;
+    unsigned int enc_util;
+    unsigned int dec_util;
+} NVMLProcessUtilizationSample;
+
+/** Normalised memory information, whichever entry point filled it */
+typedef struct {
+    unsigned long long total;
+    unsigned long long reserved;    /**< 0 when only the v1 entry point exists */
+    unsigned long long free;
+    unsigned long long used;
+} NVMLMemoryInfo;
+
+/**
+ * @brief Resolved NVML entry points
+ *
+ * Required entry points are always non-NULL after a successful
+ * nvml_binding_load(); optional ones are NULL when the driver lacks them.
+ * The *_version fields record which variant was bound.
+ */
+typedef struct {
+    void *library;  /**< dlopen() handle, NULL when not loaded */
+
+    // Required
+    NVMLReturn (*init)(void);
+    NVMLReturn (*shutdown)(void);
+    NVMLReturn (*device_get_count)(unsigned int *count);
+    NVMLReturn (*device_get_handle_by_index)(unsigned int index, NVMLDeviceHandle *device);
+    NVMLReturn (*device_get_name)(NVMLDeviceHandle device, char *name, unsigned int length);
+    NVMLReturn (*device_get_temperature)(NVMLDeviceHandle device, NVMLTemperatureSensor sensor,
+                                         unsigned int *temp);
+    NVMLReturn (*device_get_utilization_rates)(NVMLDeviceHandle device, NVMLUtilization *utilization);
+    NVMLReturn (*device_get_power_usage)(NVMLDeviceHandle device, unsigned int *power);
+    NVMLReturn (*device_get_fan_speed)(NVMLDeviceHandle device, unsigned int *speed);
+
+    // Versioned; use nvml_get_memory_info() / nvml_get_running_processes()
+    NVMLReturn (*device_get_memory_info)(NVMLDeviceHandle device, NVMLMemory *memory);
+    NVMLReturn (*device_get_memory_info_v2)(NVMLDeviceHandle device, NVMLMemoryV2 *memory);
+    NVMLReturn (*device_get_compute_processes)(NVMLDeviceHandle device, unsigned int *count, void *infos);
+    NVMLReturn (*device_get_graphics_processes)(NVMLDeviceHandle device, unsigned int *count, void *infos);
+    int process_info_version;   /**< 3, 2 or 1 (legacy NVMLProcessInfoV1 layout); 0 if absent */
+
+    // Optional
+    const char *(*error_string)(NVMLReturn result);
+    NVMLReturn (*device_get_uuid)(NVMLDeviceHandle device, char *uuid, unsigned int length);
+    NVMLReturn (*device_get_pci_info)(NVMLDeviceHandle device, NVMLPciInfo *pci);
+    NVMLReturn (*device_get_field_values)(NVMLDeviceHandle device, int count, NVMLFieldValue *values);
+    NVMLReturn (*device_get_samples)(NVMLDeviceHandle device, NVMLSamplingType type,
+                                     unsigned long long last_seen, NVMLValueType *value_type,
+                                     unsigned int *count, NVMLSample *samples);
+    NVMLReturn (*device_get_process_utilization)(NVMLDeviceHandle device,
+                                                 NVMLProcessUtilizationSample *samples,
+                                                 unsigned int *count, unsigned long long last_seen);
+} NVMLBinding;
+
+/**
+ * @brief Load NVML and bind the newest available version of each entry point
+ * @param binding Binding to fill
+ * @return 0 on success, -1 if the library or a required entry point is missing
+ *
+ * @details The SYSMON_NVML_LIBRARY environment variable overrides the library
+ * path; no fallback to the system library is attempted when it is set.
+ */
+int nvml_binding_load(NVMLBinding *binding);
+
+/**
+ * @brief Unload NVML and clear the binding
+ * @param binding Binding to clear
+ */
+void nvml_binding_unload(NVMLBinding *binding);
+
+/**
+ * @brief Map an NVML return code to the action a caller should take
+ * @param ret NVML return code
+ * @return Policy for the caller
+ */
+NVMLPolicy nvml_error_policy(NVMLReturn ret);
+
+/**
+ * @brief Symbolic name of an NVML return code
+ * @param ret NVML return code
+ * @return Static string, e.g. "GPU_IS_LOST"
+ */
+const char *nvml_return_name(NVMLReturn ret);
+
+/**
+ * @brief Query device memory through the newest bound entry point
+ * @param binding Loaded binding
+ * @param device Device handle
+ * @param info Receives the normalised memory information
+ * @return NVML return code
+ *
+ * @details Falls back to the v1 entry point if the driver rejects the v2
+ * struct version.
+ */
+NVMLReturn nvml_get_memory_info(NVMLBinding *binding, NVMLDeviceHandle device, NVMLMemoryInfo *info);
+
+/**
+ * @brief List compute or graphics processes in the current layout
+ * @param binding Loaded binding
+ * @param device Device handle
+ * @param graphics Non-zero for graphics contexts, zero for compute contexts
+ * @param infos Output array
+ * @param count In: capacity of @p infos; out: number of processes
+ * @return NVML return code (NVML_ERROR_FUNCTION_NOT_FOUND if unbound)
+ *
+ * @details Legacy (v1) results are widened to NVMLProcessInfo with instance
+ * ids set to ~0.
+ */
+NVMLReturn nvml_get_running_processes(const NVMLBinding *binding, NVMLDeviceHandle device,
+                                      int graphics, NVMLProcessInfo *infos, unsigned int *count);
+
+#endif /* NVML_BINDING_H */
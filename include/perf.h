@@ -0,0 +1,97 @@
+/**
+ * @file perf.h
+ * @brief Hardware performance counter monitoring via perf_event_open
+ *
+ * One counter group is opened per CPU (cycles, instructions, cache misses,
+ * branch misses and, where the PMU has them, stalled cycles) and read with a
+ * single read() per group using PERF_FORMAT_GROUP. From these the collector
+ * derives IPC and misses per thousand instructions (MPKI), which separate a
+ * core that is stalled on memory from one doing useful work.
+ *
+ * Where hardware counters are unavailable (most VMs, or restricted PMUs) it
+ * falls back to software events (context switches, migrations and page
+ * faults), so the panel still shows something useful. The fallback is per
+ * CPU: a CPU whose hardware group fails to open next to others that succeed
+ * still gets software events.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include "cpu.h"
+
+/**
+ * @brief Which kind of counters the collector managed to open
+ */
+typedef enum {
+    PERF_MODE_NONE,     /**< No counters (no permission or no perf support) */
+    PERF_MODE_HARDWARE, /**< Hardware PMU counters */
+    PERF_MODE_SOFTWARE  /**< Software event fallback */
+} PerfMode;
+
+/**
+ * @brief Structure to hold the derived counter metrics of one CPU
+ *
+ * @details Hardware fields are zero in software mode and vice versa.
+ */
+typedef struct {
+    unsigned int cpu;           /**< Logical CPU number */
+    PerfMode mode;              /**< Counter kind of this CPU; software where its hardware group failed to open */
+    int counted;                /**< Non-zero if the counters ran in the interval; all values are 0 otherwise */
+    double ghz;                 /**< Unhalted cycles per second of wall time in GHz, per CPU (idle time lowers it) */
+    double cycles;              /**< Unhalted cycles per second of wall time */
+    double ipc;                 /**< Instructions per cycle */
+    double cache_mpki;          /**< Last-level cache misses per 1000 instructions */
+    double branch_mpki;         /**< Branch mispredictions per 1000 instructions */
+    double stalled_frontend;    /**< Front-end stalled cycles, percent of cycles */
+    double stalled_backend;     /**< Back-end stalled cycles, percent of cycles */
+    double context_switches;    /**< Context switches per second (software mode) */
+    double migrations;          /**< CPU migrations per second (software mode) */
+    double page_faults;         /**< Page faults per second (software mode) */
+} PerfCPUStats;
+
+/**
+ * @brief Structure to hold performance counter statistics
+ */
+typedef struct {
+    PerfMode mode;                /**< Counter kind in use */
+    PerfCPUStats cpus[MAX_CPUS];  /**< Per-CPU values, in CPU order */
+    unsigned int count;           /**< Number of CPUs with counters */
+    unsigned int counted;         /**< CPUs whose counters ran in the interval */
+    unsigned int fallback;        /**< CPUs on software events in hardware mode, left out of total */
+    PerfCPUStats total;           /**< System-wide values over the counted CPUs of mode (rates summed, ratios over all of them) */
+    int has_stalled_frontend;     /**< Non-zero if front-end stall counts are available */
+    int has_stalled_backend;      /**< Non-zero if back-end stall counts are available */
+    double multiplexed;           /**< Share of time counters were actually running, percent (100 unless the PMU is oversubscribed) */
+    int paranoid;                 /**< kernel.perf_event_paranoid, shown when no counters could be opened */
+} PerfStats;
+
+/**
+ * @brief Collector state of one counter monitor (opaque)
+ */
+typedef struct PerfMonitor PerfMonitor;
+
+/**
+ * @brief Open per-CPU counter groups
+ * @return New monitor, or NULL on failure
+ *
+ * @details Missing permission or perf support is not an error: the mode is
+ * then PERF_MODE_NONE.
+ */
+PerfMonitor *create_perf_monitor(void);
+
+/**
+ * @brief Read all counter groups and derive per-CPU and system-wide metrics
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to PerfStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_perf_stats(PerfMonitor *monitor, PerfStats *stats);
+
+/**
+ * @brief Close all counter groups and free the monitor
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_perf_monitor(PerfMonitor *monitor);
+
+#endif /* PERF_H */
@@ -0,0 +1,64 @@
+/**
+ * @file pidcache.h
+ * @brief Cached pid to process name/cgroup lookups
+ *
+ * Collectors that attribute resources to processes (e.g. per-process GPU
+ * usage) see the same pids tick after tick. This cache reads
+ * /proc/[pid]/comm and /proc/[pid]/cgroup once per pid and keeps the result
+ * for as long as the pid keeps being looked up.
+ */
+
+#ifndef PIDCACHE_H
+#define PIDCACHE_H
+
+#include <sys/types.h>
+
+#define PROCESS_NAME_MAX 16
+#define PROCESS_CGROUP_MAX 96
+
+/**
+ * @brief Cached identity of a process
+ */
+typedef struct {
+    pid_t pid;                          /**< Process id, 0 for an empty slot */
+    char name[PROCESS_NAME_MAX];        /**< Command name from /proc/[pid]/comm */
+    char cgroup[PROCESS_CGROUP_MAX];    /**< Cgroup path (v2 unified path if present) */
+    unsigned int generation;            /**< Last generation the entry was looked up in */
+} ProcessIdentity;
+
+/**
+ * @brief Pid cache of one collector (opaque)
+ */
+typedef struct PidCache PidCache;
+
+/**
+ * @brief Create an empty pid cache
+ * @return New cache, or NULL on allocation failure
+ */
+PidCache *create_pidcache(void);
+
+/**
+ * @brief Look up a process, reading /proc only on a cache miss
+ * @param cache Cache to look in
+ * @param pid Process id
+ * @return Cached identity; name is "?" if the process could not be read.
+ *         The pointer is valid until the next pidcache_sweep().
+ */
+const ProcessIdentity *pidcache_lookup(PidCache *cache, pid_t pid);
+
+/**
+ * @brief Drop entries not looked up since the previous sweep
+ * @param cache Cache to sweep
+ *
+ * @details Call once per collection cycle after all lookups. A pid that
+ * disappears for a whole cycle is forgotten, so a recycled pid is re-read.
+ */
+void pidcache_sweep(PidCache *cache);
+
+/**
+ * @brief Free a pid cache
+ * @param cache Cache to free, may be NULL
+ */
+void destroy_pidcache(PidCache *cache);
+
+#endif /* PIDCACHE_H */
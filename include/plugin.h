@@ -0,0 +1,98 @@
+/**
+ * @file plugin.h
+ * @brief Registry of collector plugins loaded from a directory
+ *
+ * Every *.so file in the configured plugin directory that exports a
+ * SysmonPlugin (see sysmon_plugin.h) is loaded in name order, unless its
+ * [plugin.<name>] section disables it. The registry samples each plugin at
+ * its own interval, turns counters into rates, and publishes the values in
+ * PluginStats, from which the Plugins panel and alert rules
+ * (plugin.<plugin>.<metric>) read them.
+ */
+
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include "config.h"
+#include "sysmon_plugin.h"
+
+#define MAX_PLUGINS 16
+#define MAX_PLUGIN_METRICS 32
+
+/**
+ * @brief One metric of a loaded plugin and its latest value
+ */
+typedef struct {
+    char name[PLUGIN_NAME_MAX];  /**< Metric identifier */
+    char label[48];              /**< Panel text */
+    char unit[16];               /**< Unit of the sampled value */
+    int counter;                 /**< Non-zero if value is a rate per second of a counter */
+    double value;                /**< Latest value, NAN if unavailable */
+} PluginMetric;
+
+/**
+ * @brief A loaded plugin and its latest sample
+ */
+typedef struct {
+    char name[PLUGIN_NAME_MAX];                 /**< Plugin name */
+    char title[64];                             /**< Panel heading */
+    PluginMetric metrics[MAX_PLUGIN_METRICS];   /**< Described metrics, in order */
+    unsigned int metric_count;                  /**< Valid entries in metrics */
+    int valid;                                  /**< Non-zero if the last sample succeeded */
+    long long updated_ms;                       /**< Monotonic milliseconds of the last sample, 0 before the first */
+} PluginInfo;
+
+/**
+ * @brief Structure to hold the values of all loaded plugins
+ */
+typedef struct {
+    PluginInfo plugins[MAX_PLUGINS];  /**< Loaded plugins, in load order */
+    unsigned int count;               /**< Valid entries in plugins */
+} PluginStats;
+
+/**
+ * @brief Load, unload and reschedule plugins to match a configuration
+ * @param config Configuration to apply
+ * @param stats Statistics; rewritten when the set of plugins changes
+ * @return 0 on success, -1 if a plugin failed to load (see plugin_error())
+ *
+ * @details Plugins are only reloaded when the directory, or the "enabled"
+ * or "args" setting of a plugin changed; interval changes just reschedule
+ * them. A plugin that fails to load is skipped and the others still load.
+ */
+int configure_plugins(const MonitorConfig *config, PluginStats *stats);
+
+/**
+ * @brief Describe the last configure_plugins() failure
+ * @return Error message, empty if the last call succeeded
+ */
+const char *plugin_error(void);
+
+/**
+ * @brief Sample every plugin whose interval has elapsed
+ * @param stats Statistics to update
+ * @return 0 on success, -1 if stats is NULL
+ *
+ * @details A plugin whose sample fails is marked invalid for that tick;
+ * it does not fail the update.
+ */
+int update_plugins(PluginStats *stats);
+
+/**
+ * @brief Shortest sample interval of the loaded plugins
+ * @return Interval in milliseconds, 0 if no plugin is loaded
+ */
+int plugin_tick(void);
+
+/**
+ * @brief Lines the loaded plugins take in the Plugins panel
+ * @return One heading line per plugin plus one line per metric
+ */
+int plugin_rows(void);
+
+/**
+ * @brief Clean up and unload every plugin
+ */
+void stop_plugins(void);
+
+#endif /* PLUGIN_H */
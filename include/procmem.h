@@ -0,0 +1,84 @@
+/**
+ * @file procmem.h
+ * @brief Per-process memory detail from smaps_rollup, on a read budget
+ *
+ * Every update ranks all processes by resident set size from the cheap
+ * /proc/[pid]/statm. RSS alone does not say whether a process's memory is
+ * anonymous or file-backed, shared with others or swapped out;
+ * /proc/[pid]/smaps_rollup does, with its Pss, Anonymous, Swap and
+ * Shared_Clean totals. But reading it walks the process's page tables,
+ * which takes milliseconds for a process of many gigabytes.
+ *
+ * So smaps_rollup is read for the top processes only, and at most budget
+ * of them per update: processes never read come first, then those read
+ * longest ago. The results are cached per pid and shown with their age
+ * until the next read; a process that leaves the top is forgotten.
+ */
+
+#ifndef PROCMEM_H
+#define PROCMEM_H
+
+#include "pidcache.h"
+
+#define MAX_MEMORY_PROCESSES 16
+#define DEFAULT_PROCMEM_TOP 10
+#define DEFAULT_PROCMEM_BUDGET 4
+
+/**
+ * @brief Memory of one process
+ *
+ * @details Sizes are in bytes. The smaps_rollup values are from the last
+ * read, age_ms ago.
+ */
+typedef struct {
+    pid_t pid;                     /**< Process id */
+    char name[PROCESS_NAME_MAX];   /**< Command name */
+    unsigned long rss;             /**< Resident set size from statm, current */
+    unsigned long pss;             /**< Proportional set size: shared pages divided among their users */
+    unsigned long anonymous;       /**< Anonymous memory (heap, stacks, private copies) */
+    unsigned long swap;            /**< Anonymous memory swapped out */
+    unsigned long shared_clean;    /**< Unmodified pages shared with other processes */
+    long long age_ms;              /**< Time since smaps_rollup was read, -1 if not yet */
+    int detailed;                  /**< Non-zero if the smaps_rollup values are valid */
+} ProcessMemoryStats;
+
+/**
+ * @brief Structure to hold the largest processes by RSS
+ */
+typedef struct {
+    ProcessMemoryStats processes[MAX_MEMORY_PROCESSES];  /**< Largest first */
+    unsigned int count;      /**< Valid entries in processes */
+    unsigned int scanned;    /**< Processes ranked in the last update */
+    unsigned int reads;      /**< smaps_rollup files read in the last update */
+    unsigned int budget;     /**< Most smaps_rollup reads per update */
+    double read_ms;          /**< Time spent reading smaps_rollup in the last update */
+} ProcessMemoryInfo;
+
+/**
+ * @brief Collector state of one process memory monitor (opaque)
+ */
+typedef struct ProcessMemoryMonitor ProcessMemoryMonitor;
+
+/**
+ * @brief Create a process memory monitor
+ * @param top Number of processes to report, up to MAX_MEMORY_PROCESSES
+ * @param budget Most smaps_rollup reads per update, at least 1
+ * @return New monitor, or NULL on allocation failure
+ */
+ProcessMemoryMonitor *create_process_memory_monitor(unsigned int top, unsigned int budget);
+
+/**
+ * @brief Rank processes and refresh the smaps_rollup values within the budget
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to ProcessMemoryInfo structure to update
+ * @return 0 on success, -1 if /proc cannot be listed
+ */
+int update_process_memory_stats(ProcessMemoryMonitor *monitor, ProcessMemoryInfo *stats);
+
+/**
+ * @brief Free a process memory monitor and its cache
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_process_memory_monitor(ProcessMemoryMonitor *monitor);
+
+#endif /* PROCMEM_H */
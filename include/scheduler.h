@@ -0,0 +1,63 @@
+/**
+ * @file scheduler.h
+ * @brief Scheduler saturation monitoring: load average and run-queue delay
+ *
+ * Reads /proc/loadavg and the per-CPU run_delay counter of /proc/schedstat,
+ * the cumulative time tasks spent runnable but waiting for a CPU. Unlike
+ * CPU usage, run-queue delay keeps growing once a CPU is saturated, which
+ * makes it the better signal for latency-sensitive workloads.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "cpu.h"
+
+/**
+ * @brief Structure to hold scheduler statistics
+ */
+typedef struct {
+    double load1;                 /**< 1-minute load average */
+    double load5;                 /**< 5-minute load average */
+    double load15;                /**< 15-minute load average */
+    unsigned int runnable;        /**< Runnable scheduling entities (loadavg field 4) */
+    unsigned int threads;         /**< Total scheduling entities (loadavg field 4) */
+    double run_delay[MAX_CPUS];   /**< Per-CPU run-queue wait, ms per second of wall time, indexed by CPU number */
+    double wait_per_slice[MAX_CPUS]; /**< Per-CPU average wait before each timeslice, µs */
+    unsigned int cpu_count;       /**< Highest CPU number in /proc/schedstat plus one */
+    double total_run_delay;       /**< Run-queue wait summed over CPUs, ms per second */
+    double avg_wait_per_slice;    /**< Average wait before a timeslice over all CPUs, µs */
+    double max_run_delay;         /**< Largest per-CPU run-queue wait, ms per second */
+    unsigned int max_run_delay_cpu; /**< CPU with the largest run-queue wait */
+    int schedstat_available;      /**< Non-zero if /proc/schedstat could be read */
+} SchedulerStats;
+
+/**
+ * @brief Collector state of one scheduler monitor (opaque)
+ */
+typedef struct SchedulerMonitor SchedulerMonitor;
+
+/**
+ * @brief Create a scheduler monitor
+ * @return New monitor, or NULL on failure
+ */
+SchedulerMonitor *create_scheduler_monitor(void);
+
+/**
+ * @brief Update scheduler statistics
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to SchedulerStats structure to update
+ * @return 0 on success, -1 on failure
+ *
+ * @details A kernel without CONFIG_SCHEDSTATS only loses the run-queue
+ * fields; that is not an error.
+ */
+int update_scheduler_stats(SchedulerMonitor *monitor, SchedulerStats *stats);
+
+/**
+ * @brief Free a scheduler monitor
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_scheduler_monitor(SchedulerMonitor *monitor);
+
+#endif /* SCHEDULER_H */
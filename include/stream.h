@@ -0,0 +1,141 @@
+/**
+ * @file stream.h
+ * @brief Snapshot streaming between agents and an aggregator
+ *
+ * An agent (--agent ADDR) connects to an aggregator (--aggregate ADDR) and
+ * sends the metric registry's value array (see metrics.h) once per update,
+ * encoded by the snapshot codec (see codec.h): a keyframe when the
+ * connection opens and every CODEC_KEYFRAME_INTERVAL updates, and in
+ * between only the slots that changed, as small integer deltas.
+ *
+ * Addresses are "unix:PATH" (or any PATH containing a '/') for a Unix
+ * socket, or "HOST:PORT" for TCP; an aggregator may leave out the host
+ * (":PORT") to listen on all addresses.
+ *
+ * Every frame is a 32-bit little-endian payload length followed by the
+ * payload, whose first byte is the message type:
+ *
+ *     HELLO              u8 type, u16 version, u16 slot count, host name (rest)
+ *     KEYFRAME, DELTA    a codec frame, whose first byte is the type
+ *
+ * Integers are little-endian. The slot count lets the aggregator refuse
+ * agents built with a different metric table.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "codec.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define STREAM_VERSION 2
+#define STREAM_HEADER_SIZE 4
+#define STREAM_FRAME_MAX (STREAM_HEADER_SIZE + CODEC_FRAME_MAX)
+#define STREAM_HOST_MAX 64
+
+/**
+ * @brief Message types, the first payload byte
+ */
+typedef enum {
+    STREAM_HELLO = 1,
+    STREAM_DELTA = CODEC_DELTA,
+    STREAM_KEYFRAME = CODEC_KEYFRAME
+} StreamMessage;
+
+/**
+ * @brief Open a listening socket
+ * @param address Address to listen on
+ * @return Non-blocking socket, or -1 with errno set
+ */
+int stream_listen(const char *address);
+
+/**
+ * @brief Connect to an aggregator
+ * @param address Aggregator address
+ * @return Connected (blocking) socket, or -1 with errno set
+ *
+ * @details The connection is made non-blocking and waited for in epoll, so
+ * an unresponsive aggregator costs at most a second, over all its
+ * addresses, before failing with ETIMEDOUT.
+ */
+int stream_connect(const char *address);
+
+/**
+ * @brief Length of the frame at the start of a buffer
+ * @param buf Received bytes
+ * @param have Number of bytes in buf
+ * @return Frame length including the header, 0 if the frame is not complete
+ *         yet, -1 if the length is invalid
+ */
+long stream_frame_length(const uint8_t *buf, size_t have);
+
+/**
+ * @brief Encode a HELLO frame
+ * @param buf Output buffer of at least STREAM_FRAME_MAX bytes
+ * @param host Host name
+ * @return Frame length
+ */
+size_t stream_encode_hello(uint8_t *buf, const char *host);
+
+/**
+ * @brief Decode a HELLO frame
+ * @param frame Complete frame
+ * @param len Frame length
+ * @param host Buffer of STREAM_HOST_MAX bytes for the host name
+ * @return 0 on success, -1 if the frame is not a compatible HELLO
+ */
+int stream_decode_hello(const uint8_t *frame, size_t len, char *host);
+
+/**
+ * @brief Encode the next snapshot of a connection
+ * @param buf Output buffer of at least STREAM_FRAME_MAX bytes
+ * @param codec Encoder state of the connection
+ * @param next Values to send
+ * @param time_ms Sample time in milliseconds
+ * @return Frame length
+ */
+size_t stream_encode_snapshot(uint8_t *buf, CodecState *codec, const MetricSnapshot *next,
+                              long long time_ms);
+
+/**
+ * @brief Apply a KEYFRAME or DELTA frame
+ * @param frame Complete frame
+ * @param len Frame length
+ * @param codec Decoder state of the connection; holds the values and time
+ * @return 0 on success, -1 if the frame is malformed
+ */
+int stream_decode_snapshot(const uint8_t *frame, size_t len, CodecState *codec);
+
+/**
+ * @brief Sending side of a stream (opaque)
+ */
+typedef struct StreamAgent StreamAgent;
+
+/**
+ * @brief Create an agent; it connects on the first send
+ * @param address Aggregator address
+ * @param host Host name to announce
+ * @return New agent, or NULL on allocation failure
+ */
+StreamAgent *create_stream_agent(const char *address, const char *host);
+
+/**
+ * @brief Send the changed slots of a snapshot
+ * @param agent Agent
+ * @param snapshot Current values
+ * @param time_ms Sample time in milliseconds
+ * @return 0 if sent, -1 if the aggregator is unreachable
+ *
+ * @details A lost connection is reopened on a later send, at most every
+ * few seconds, and starts over with a keyframe.
+ */
+int stream_agent_send(StreamAgent *agent, const MetricSnapshot *snapshot, long long time_ms);
+
+/**
+ * @brief Close an agent's connection and free it
+ * @param agent Agent, may be NULL
+ */
+void destroy_stream_agent(StreamAgent *agent);
+
+#endif /* STREAM_H */
@@ -0,0 +1,136 @@
+/**
+ * @file swap.h
+ * @brief Swap devices, swap traffic and zram/zswap compression
+ *
+ * MemoryStats only says how full swap is. This collector adds where the
+ * pages go and how fast:
+ *
+ * - /proc/swaps: size, use and priority of each swap device or file;
+ * - /proc/vmstat: pages swapped in and out (pswpin, pswpout) and, on
+ *   kernels with zswap counters, pages stored to and loaded from zswap;
+ * - /sys/block/zram<N>: original and compressed size, memory used against
+ *   the device's limit (mm_stat), failed writes (io_stat) and bytes read
+ *   and written (stat);
+ * - zswap, the compressed cache in front of swap: the pool size and the
+ *   stored, written back and rejected pages from debugfs
+ *   (/sys/kernel/debug/zswap) when it is mounted, or the Zswap and
+ *   Zswapped lines of /proc/meminfo (6.x kernels) otherwise.
+ *
+ * zram stops keeping up when its device fills up or reaches its memory
+ * limit, when writes to it fail, or when the pages it is given barely
+ * compress; swap-outs then land on the next, slower device. Each zram
+ * device gets a state from these, and the swap-out traffic the zram
+ * devices do not account for is reported as spill.
+ */
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#define MAX_SWAP_DEVICES 8
+#define MAX_ZRAM_DEVICES 8
+#define MAX_SWAP_NAME 64
+#define ZRAM_FULL_PERCENT 90  // Data or memory use from which a zram device counts as full
+#define ZRAM_POOR_RATIO 1.5   // Compression ratio below which zram gains little
+
+/**
+ * @brief One active swap area from /proc/swaps
+ *
+ * @details Sizes are in bytes.
+ */
+typedef struct {
+    char name[MAX_SWAP_NAME];   /**< Device or file */
+    char type[12];              /**< "partition" or "file" */
+    unsigned long size;         /**< Size */
+    unsigned long used;         /**< Space in use */
+    int priority;               /**< Higher is used first */
+    int zram;                   /**< zram device number, -1 if not zram */
+} SwapDeviceStats;
+
+/**
+ * @brief Whether a zram device keeps up
+ */
+typedef enum {
+    ZRAM_OK,       /**< Room left and writes succeed */
+    ZRAM_POOR,     /**< Compresses below ZRAM_POOR_RATIO */
+    ZRAM_FULL,     /**< Data or memory at ZRAM_FULL_PERCENT of its size or limit */
+    ZRAM_FAILING   /**< Writes failed in the last interval */
+} ZramState;
+
+/**
+ * @brief One zram device
+ *
+ * @details Sizes are in bytes, rates per second over the last interval.
+ */
+typedef struct {
+    unsigned int index;            /**< N of zram<N> */
+    char algorithm[16];            /**< Compression algorithm in use */
+    unsigned long disksize;        /**< Uncompressed capacity */
+    unsigned long data;            /**< Uncompressed data stored (orig_data_size) */
+    unsigned long compressed;      /**< Compressed size of the data (compr_data_size) */
+    unsigned long memory;          /**< Memory used, including allocator overhead (mem_used_total) */
+    unsigned long memory_limit;    /**< Memory limit, 0 if unlimited */
+    double ratio;                  /**< data / memory */
+    double read_rate;              /**< Bytes read (swap-ins) */
+    double write_rate;             /**< Bytes written (swap-outs) */
+    double failed_writes;          /**< Failed writes */
+    ZramState state;               /**< Whether the device keeps up */
+} ZramStats;
+
+/**
+ * @brief Structure to hold swap devices, traffic and compression
+ *
+ * @details Sizes are in bytes, rates per second over the last interval.
+ */
+typedef struct {
+    SwapDeviceStats devices[MAX_SWAP_DEVICES];  /**< Active swap areas, as listed */
+    unsigned int device_count;   /**< Valid entries in devices */
+    double swap_in;              /**< Bytes swapped in */
+    double swap_out;             /**< Bytes swapped out */
+    double spill;                /**< Swap-outs not written to zram; 0 without zram swap */
+
+    ZramStats zram[MAX_ZRAM_DEVICES];  /**< Initialised zram devices */
+    unsigned int zram_count;     /**< Valid entries in zram */
+    double zram_ratio;           /**< Data / memory over all zram devices, 0 without data */
+    unsigned int zram_struggling;  /**< zram devices full or failing writes */
+    double zram_failed_writes;   /**< Failed writes over all zram devices */
+
+    int zswap_enabled;           /**< Non-zero if zswap is enabled */
+    int zswap_debugfs;           /**< Non-zero if the debugfs counters are read */
+    unsigned long zswap_pool;    /**< Compressed pool size */
+    unsigned long zswap_stored;  /**< Uncompressed size of the stored pages */
+    double zswap_ratio;          /**< stored / pool, 0 without data */
+    double zswap_in;             /**< Bytes loaded from zswap */
+    double zswap_out;            /**< Bytes stored to zswap */
+    double zswap_written_back;   /**< Bytes written back from the pool to swap */
+    double zswap_rejected;       /**< Pages refused (poor compression, allocation or pool limit) */
+} SwapStats;
+
+/**
+ * @brief Collector state of one swap monitor (opaque)
+ */
+typedef struct SwapMonitor SwapMonitor;
+
+/**
+ * @brief Create a swap monitor
+ * @return New monitor, or NULL if /proc/swaps or /proc/vmstat cannot be opened
+ *
+ * @details zram devices and the zswap debugfs directory are looked up
+ * once here and their attributes kept open.
+ */
+SwapMonitor *create_swap_monitor(void);
+
+/**
+ * @brief Update swap devices, traffic and compression
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to SwapStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_swap_stats(SwapMonitor *monitor, SwapStats *stats);
+
+/**
+ * @brief Free a swap monitor and close its files
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_swap_monitor(SwapMonitor *monitor);
+
+#endif /* SWAP_H */
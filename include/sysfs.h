@@ -0,0 +1,97 @@
+/**
+ * @file sysfs.h
+ * @brief Helpers for reading sysfs attributes over persistent file descriptors
+ *
+ * Collectors discover the attributes they need once, keep the descriptors
+ * open and re-read them with pread() on every tick, avoiding an
+ * open/read/close cycle per value.
+ *
+ * All paths are absolute system paths (e.g. "/sys/class/drm"). If the
+ * SYSMON_SYSFS_ROOT environment variable is set, it is prepended to every
+ * path, so a fake /sys tree can stand in for the real one.
+ */
+
+#ifndef SYSFS_H
+#define SYSFS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Build a path under the configured sysfs root
+ * @param buf Buffer to store the path
+ * @param size Size of the buffer
+ * @param fmt printf-style format of the absolute path
+ * @return 0 on success, -1 if the path was truncated
+ */
+int sysfs_path(char *buf, size_t size, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Open an attribute for repeated reading
+ * @param path Absolute path (the sysfs root is prepended)
+ * @return File descriptor, or -1 if the attribute does not exist
+ */
+int sysfs_open(const char *path);
+
+/**
+ * @brief Close a descriptor opened with sysfs_open() and mark it closed
+ * @param fd Pointer to the descriptor; set to -1
+ */
+void sysfs_close(int *fd);
+
+/**
+ * @brief Re-read an attribute from the start
+ * @param fd Descriptor from sysfs_open()
+ * @param buf Buffer to store the contents, without trailing newline
+ * @param size Size of the buffer
+ * @return Number of bytes read, or -1 on failure
+ */
+int sysfs_pread(int fd, char *buf, size_t size);
+
+/**
+ * @brief Re-read an unsigned integer attribute
+ * @param fd Descriptor from sysfs_open()
+ * @param value Pointer to store the value
+ * @return 0 on success, -1 on failure
+ */
+int sysfs_pread_ull(int fd, unsigned long long *value);
+
+/**
+ * @brief Read a string attribute once
+ * @param path Absolute path (the sysfs root is prepended)
+ * @param buf Buffer to store the contents, without trailing newline
+ * @param size Size of the buffer
+ * @return 0 on success, -1 on failure
+ */
+int sysfs_read_string(const char *path, char *buf, size_t size);
+
+/**
+ * @brief Read an unsigned integer attribute once
+ * @param path Absolute path (the sysfs root is prepended)
+ * @param value Pointer to store the value
+ * @return 0 on success, -1 on failure
+ */
+int sysfs_read_ull(const char *path, unsigned long long *value);
+
+/**
+ * @brief Find the first hwmon directory below a device directory
+ * @param device_dir Absolute device directory (e.g. "/sys/class/drm/card0/device")
+ * @param buf Buffer to store the absolute hwmon directory
+ * @param size Size of the buffer
+ * @return 0 on success, -1 if the device has no hwmon node
+ */
+int sysfs_find_hwmon(const char *device_dir, char *buf, size_t size);
+
+/**
+ * @brief List the numeric suffixes of directory entries named prefix<N>suffix
+ * @param dir_path Absolute directory (the sysfs root is prepended)
+ * @param prefix Entry name prefix, e.g. "cpu" or "temp"
+ * @param suffix Required remainder after the number, e.g. "_input" or ""
+ * @param indices Array to store the indices, sorted ascending
+ * @param max Capacity of indices; the lowest max indices are kept
+ * @return Number of indices stored (0 if the directory does not exist)
+ */
+unsigned int sysfs_list_indices(const char *dir_path, const char *prefix, const char *suffix,
+                                unsigned int *indices, unsigned int max);
+
+#endif /* SYSFS_H */
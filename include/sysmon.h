@@ -0,0 +1,193 @@
+/**
+ * @file sysmon.h
+ * @brief libsysmon: the CPU, memory, disk, network and GPU collectors as a library
+ *
+ * Usage:
+ *
+ *     SysmonOptions options = { .api_version = SYSMON_API_VERSION,
+ *                               .collectors = SYSMON_CPU | SYSMON_NETWORK };
+ *     Sysmon *mon = sysmon_open(&options);
+ *     SysmonSnapshot *snap = sysmon_snapshot_create();
+ *     for (;;) {
+ *         sysmon_sample(mon, snap);
+ *         const CPUStats *cpu = sysmon_snapshot_cpu(snap);
+ *         ...
+ *     }
+ *     sysmon_snapshot_destroy(snap);
+ *     sysmon_close(mon);
+ *
+ * A handle owns one context per collector, so rates and deltas cover the
+ * time since the previous sysmon_sample() on the same handle. The library
+ * keeps no state outside the handles: handles opened side by side, for
+ * instance a 1 s and a 60 s rate window, do not disturb each other and may
+ * run on different threads. A single handle or snapshot must not be used
+ * from two threads at once.
+ *
+ * A sampler runs a handle on a thread of its own at a fixed cadence and
+ * keeps the latest snapshot for any thread to copy out:
+ *
+ *     SysmonSampler *minute = sysmon_sampler_start(&options, 60000);
+ *     ...
+ *     if (sysmon_sampler_read(minute, snap) == 0) ...
+ *     sysmon_sampler_stop(minute);
+ *
+ * Snapshots are caller-owned buffers; sampling writes into them without
+ * allocating. Both handles and snapshots are opaque, and the statistics
+ * structures they expose only change together with SYSMON_API_VERSION.
+ */
+
+#ifndef SYSMON_H
+#define SYSMON_H
+
+#include "cpu.h"
+#include "disk.h"
+#include "filter.h"
+#include "gpu.h"
+#include "memory.h"
+#include "network.h"
+
+/**
+ * @brief Version of this header, checked by sysmon_open()
+ */
+#define SYSMON_API_VERSION 1
+
+/**
+ * @brief Collectors a handle can run, as a bit mask
+ */
+typedef enum {
+    SYSMON_CPU     = 1 << 0,
+    SYSMON_MEMORY  = 1 << 1,
+    SYSMON_DISK    = 1 << 2,
+    SYSMON_NETWORK = 1 << 3,
+    SYSMON_GPU     = 1 << 4,
+    SYSMON_ALL     = (1 << 5) - 1
+} SysmonCollector;
+
+/**
+ * @brief Settings of a handle
+ */
+typedef struct {
+    unsigned int api_version;     /**< Must be SYSMON_API_VERSION */
+    unsigned int collectors;      /**< SysmonCollector bits, 0 for all */
+    DeviceFilter disk_filter;     /**< Mount points to report */
+    DeviceFilter network_filter;  /**< Interfaces to report */
+} SysmonOptions;
+
+/**
+ * @brief Collector handle (opaque)
+ */
+typedef struct Sysmon Sysmon;
+
+/**
+ * @brief Caller-owned sample buffer (opaque)
+ */
+typedef struct SysmonSnapshot SysmonSnapshot;
+
+/**
+ * @brief Handle sampled on a background thread (opaque)
+ */
+typedef struct SysmonSampler SysmonSampler;
+
+/**
+ * @brief Version of the library that was loaded
+ * @return SYSMON_API_VERSION of the library build
+ */
+unsigned int sysmon_version(void);
+
+/**
+ * @brief Create a handle and its collector contexts
+ * @param options Settings, or NULL for every collector and no filters
+ * @return New handle, or NULL with errno set (EINVAL for a version
+ *         mismatch or unknown collector bits)
+ */
+Sysmon *sysmon_open(const SysmonOptions *options);
+
+/**
+ * @brief Sample every collector of a handle into a snapshot
+ * @param mon Handle
+ * @param snapshot Buffer to fill
+ * @return 0 if every collector succeeded, -1 if any failed
+ *
+ * @details Collectors that fail are left out of the snapshot; their
+ * accessors return NULL until a later sample succeeds.
+ */
+int sysmon_sample(Sysmon *mon, SysmonSnapshot *snapshot);
+
+/**
+ * @brief Collectors a handle runs
+ * @param mon Handle
+ * @return SysmonCollector bits
+ */
+unsigned int sysmon_collectors(const Sysmon *mon);
+
+/**
+ * @brief Destroy a handle and its collector contexts
+ * @param mon Handle, may be NULL
+ */
+void sysmon_close(Sysmon *mon);
+
+/**
+ * @brief Allocate an empty snapshot
+ * @return New snapshot, or NULL on allocation failure
+ */
+SysmonSnapshot *sysmon_snapshot_create(void);
+
+/**
+ * @brief Free a snapshot
+ * @param snapshot Snapshot, may be NULL
+ */
+void sysmon_snapshot_destroy(SysmonSnapshot *snapshot);
+
+/**
+ * @brief Collectors present in a snapshot
+ * @param snapshot Snapshot
+ * @return SysmonCollector bits of the collectors that filled it
+ */
+unsigned int sysmon_snapshot_valid(const SysmonSnapshot *snapshot);
+
+/**
+ * @brief Time a snapshot was taken
+ * @param snapshot Snapshot
+ * @return CLOCK_MONOTONIC milliseconds, 0 if never filled
+ */
+long long sysmon_snapshot_time(const SysmonSnapshot *snapshot);
+
+/**
+ * @brief Statistics of one collector in a snapshot
+ * @param snapshot Snapshot
+ * @return Statistics, or NULL if the collector is not in the snapshot
+ */
+const CPUStats *sysmon_snapshot_cpu(const SysmonSnapshot *snapshot);
+const MemoryStats *sysmon_snapshot_memory(const SysmonSnapshot *snapshot);
+const DiskInfo *sysmon_snapshot_disks(const SysmonSnapshot *snapshot);
+const NetworkStats *sysmon_snapshot_network(const SysmonSnapshot *snapshot);
+const GPUInfo *sysmon_snapshot_gpus(const SysmonSnapshot *snapshot);
+
+/**
+ * @brief Open a handle and sample it on a thread of its own
+ * @param options Settings, as for sysmon_open()
+ * @param interval_ms Time between samples, at least 1
+ * @return New sampler, or NULL with errno set
+ *
+ * @details The first sample is taken right away, so rates appear one
+ * interval after the start.
+ */
+SysmonSampler *sysmon_sampler_start(const SysmonOptions *options, unsigned int interval_ms);
+
+/**
+ * @brief Copy the latest sample of a sampler
+ * @param sampler Sampler
+ * @param snapshot Buffer to fill
+ * @return 0 on success, -1 if no sample has been taken yet
+ *
+ * @details Safe to call from any thread, concurrently with the sampler.
+ */
+int sysmon_sampler_read(SysmonSampler *sampler, SysmonSnapshot *snapshot);
+
+/**
+ * @brief Stop the sampling thread and close its handle
+ * @param sampler Sampler, may be NULL
+ */
+void sysmon_sampler_stop(SysmonSampler *sampler);
+
+#endif /* SYSMON_H */
@@ -0,0 +1,102 @@
+/**
+ * @file sysmon_plugin.h
+ * @brief ABI of collector plugins loaded from a directory at run time
+ *
+ * A plugin is a shared object that exports one SysmonPlugin named
+ * "sysmon_plugin":
+ *
+ *     static const SysmonMetricInfo metrics[] = {
+ *         {"temp", "Controller temperature", "C", SYSMON_METRIC_GAUGE},
+ *         {"errors", "Media errors", "", SYSMON_METRIC_COUNTER},
+ *     };
+ *
+ *     static int describe(void *ctx, const SysmonMetricInfo **out) {
+ *         *out = metrics;
+ *         return 2;
+ *     }
+ *
+ *     const SysmonPlugin sysmon_plugin = {
+ *         SYSMON_PLUGIN_ABI_VERSION, "raid", "RAID Controller",
+ *         raid_init, describe, raid_sample, raid_cleanup
+ *     };
+ *
+ * The monitor calls init() once with the "args" setting of the plugin's
+ * config section, describe() once after that, then sample() at the
+ * plugin's interval and cleanup() before unloading it. All calls come from
+ * the monitor's main thread, so sample() should not block for long.
+ *
+ * This header is self-contained so that plugins can be built outside the
+ * tree with nothing but a copy of it.
+ */
+
+#ifndef SYSMON_PLUGIN_H
+#define SYSMON_PLUGIN_H
+
+/**
+ * @brief Version of this ABI; plugins built for another version are refused
+ */
+#define SYSMON_PLUGIN_ABI_VERSION 1
+
+/**
+ * @brief Name of the SysmonPlugin a plugin exports
+ */
+#define SYSMON_PLUGIN_SYMBOL "sysmon_plugin"
+
+/**
+ * @brief How the monitor treats a sampled value
+ */
+typedef enum {
+    SYSMON_METRIC_GAUGE,   /**< Shown as sampled */
+    SYSMON_METRIC_COUNTER  /**< Monotonic count; shown as a rate per second */
+} SysmonMetricKind;
+
+/**
+ * @brief Description of one metric of a plugin
+ */
+typedef struct {
+    const char *name;       /**< Identifier used in alert rules: plugin.<plugin>.<name> */
+    const char *label;      /**< Text shown in the panel */
+    const char *unit;       /**< Unit of the value ("B" is shown scaled), may be "" */
+    SysmonMetricKind kind;  /**< Gauge or counter */
+} SysmonMetricInfo;
+
+/**
+ * @brief Entry points of a plugin
+ */
+typedef struct {
+    unsigned int abi_version;  /**< Must be SYSMON_PLUGIN_ABI_VERSION */
+    const char *name;          /**< Short name: config section [plugin.<name>] and alert metrics */
+    const char *title;         /**< Panel heading */
+
+    /**
+     * @brief Create the plugin's context
+     * @param args "args" setting of the plugin's config section, "" if unset
+     * @return Context passed to the other calls, or NULL on failure
+     */
+    void *(*init)(const char *args);
+
+    /**
+     * @brief List the metrics sample() fills, in order
+     * @param ctx Context from init()
+     * @param metrics Set to an array that stays valid until cleanup()
+     * @return Number of metrics, or -1 on failure
+     */
+    int (*describe)(void *ctx, const SysmonMetricInfo **metrics);
+
+    /**
+     * @brief Take one sample
+     * @param ctx Context from init()
+     * @param values One value per described metric; NAN for unavailable ones
+     * @param count Number of values
+     * @return 0 on success, -1 if nothing could be sampled
+     */
+    int (*sample)(void *ctx, double *values, unsigned int count);
+
+    /**
+     * @brief Free the context
+     * @param ctx Context from init()
+     */
+    void (*cleanup)(void *ctx);
+} SysmonPlugin;
+
+#endif /* SYSMON_PLUGIN_H */
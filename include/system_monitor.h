@@ -4,7 +4,7 @@
  * 
  * This header defines the main structures and functions for the system monitoring
  * application. It includes functionality for monitoring CPU, memory, disk, GPU,
- * and network statistics, as well as the ncurses-based user interface.
+ * network and thermal statistics, as well as the ncurses-based user interface.
  */
 
 #ifndef SYSTEM_MONITOR_H
@@ -24,10 +24,26 @@
 #include <string.h>
 #include <unistd.h>
 #include "cpu.h"
+#include "cpufreq.h"
 #include "memory.h"
 #include "disk.h"
 #include "gpu.h"
 #include "network.h"
+#include "thermal.h"
+#include "topology.h"
+#include "scheduler.h"
+#include "perf.h"
+#include "alert.h"
+#include "metrics.h"
+#include "events.h"
+#include "kmem.h"
+#include "zones.h"
+#include "procmem.h"
+#include "workingset.h"
+#include "swap.h"
+#include "plugin.h"
+#include "aggregate.h"
+#include "config.h"
 
 /**
  * @brief Structure to hold system statistics
@@ -37,17 +53,47 @@
  * disk, GPU, and network information.
  *
  * @see CPUStats
+ * @see CPUFreqStats
  * @see MemoryStats
  * @see DiskInfo
  * @see GPUInfo
  * @see NetworkStats
+ * @see ThermalStats
+ * @see TopologyStats
+ * @see SchedulerStats
+ * @see PerfStats
+ * @see EventStats
+ * @see KmemStats
+ * @see ZoneInfo
+ * @see ProcessMemoryInfo
+ * @see WorkingSetStats
+ * @see SwapStats
+ * @see PluginStats
+ * @see MetricSnapshot
+ * @see AlertStats
  */
-typedef struct {
+typedef struct SystemStats {
     CPUStats cpu;        /**< CPU statistics including usage and frequency information */
+    CPUFreqStats cpufreq; /**< Per-core frequency, governor and idle state residency */
+    TopologyStats topology; /**< CPU usage aggregated per core, L3 domain and package */
+    SchedulerStats scheduler; /**< Load average and run-queue delay */
+    PerfStats perf;       /**< IPC, MPKI and other performance counter metrics */
     MemoryStats memory;  /**< Memory statistics including RAM and swap usage */
     DiskInfo disks;      /**< Disk statistics including space and I/O metrics */
     GPUInfo gpus;        /**< GPU statistics including temperature and memory usage */
     NetworkStats network; /**< Network interface statistics */
+    ThermalStats thermal; /**< Temperature sensors and thermal throttling counters */
+    EventStats events;    /**< Recent OOM kills, hung tasks, link flaps and I/O errors */
+    KmemStats kmem;       /**< Slab, kernel stacks, page tables and huge pages */
+    ZoneInfo zones;       /**< Zone watermarks and free blocks per order */
+    ProcessMemoryInfo procmem; /**< Largest processes with PSS, anonymous, swap and shared memory */
+    WorkingSetStats workingset; /**< Memory touched within the window, system-wide and per cgroup */
+    SwapStats swap;       /**< Swap devices, swap traffic and zram/zswap compression */
+    PluginStats plugins;  /**< Metrics of the loaded collector plugins */
+    MetricSnapshot metrics; /**< The built-in metrics above as one flat array (see metrics.h) */
+    AlertStats alerts;    /**< Firing alert rules, evaluated after every update */
+    long long updated_ms[COLLECTOR_COUNT]; /**< Monotonic milliseconds of each collector's last update, 0 if stopped */
+    int update_failed[COLLECTOR_COUNT];   /**< Non-zero if the collector's last update failed */
 } SystemStats;
 
 /**
@@ -72,14 +118,85 @@ int init_display(void);
  */
 void cleanup_display(void);
 
+/**
+ * @brief Apply panel selection and sizing
+ * @param[in] layout Layout settings
+ *
+ * @details May be called before init_display(); afterwards the panels are
+ * laid out again on the next display_stats().
+ */
+void configure_display(const LayoutConfig *layout);
+
+/**
+ * @brief Show a status message in the header, e.g. a failed config reload
+ * @param[in] message Message text, or NULL to clear it
+ */
+void display_set_status(const char *message);
+
+/**
+ * @brief Start, stop and restart collectors to match a configuration
+ * @param[in] config Configuration to apply
+ * @param[in,out] stats Statistics; the fields of stopped collectors are cleared
+ * @return 0 on success, -1 if a collector failed to start (see collector_error())
+ *
+ * @details Only collectors that are newly enabled, disabled, or whose own
+ * settings (such as device filters) changed are initialized or cleaned up.
+ * The others keep running with their state, so rates and history survive
+ * a reload. A collector that fails to start stays stopped. Plugins are
+ * configured along with the built-in collectors (see configure_plugins()).
+ */
+int configure_collectors(const MonitorConfig *config, SystemStats *stats);
+
+/**
+ * @brief Describe the last configure_collectors() failure
+ * @return Error message, empty if the last call succeeded
+ */
+const char *collector_error(void);
+
+/**
+ * @brief Collector whose statistics hold a field of SystemStats
+ * @param[in] offset Offset of the field in SystemStats
+ * @return Collector, or -1 if no collector writes the field
+ */
+int collector_of_field(size_t offset);
+
+/**
+ * @brief Shortest update interval of the running collectors and plugins
+ * @return Interval in milliseconds
+ */
+int collector_tick(void);
+
+/**
+ * @brief Descriptor of the kernel event watcher, to wait on in the main loop
+ * @return Descriptor, or -1 if the watcher is stopped or has no source
+ *
+ * @details The descriptor changes when a reload restarts the watcher.
+ * A fixture file cannot be waited on; it is read on every update instead.
+ */
+int collector_event_fd(void);
+
+/**
+ * @brief Read pending kernel events outside the regular update
+ * @param[in,out] stats Statistics whose events are updated
+ * @return 0 on success, -1 if the watcher is not running
+ */
+int update_events(SystemStats *stats);
+
+/**
+ * @brief Clean up all running collectors, in reverse order, and unload plugins
+ */
+void stop_collectors(void);
+
 /**
  * @brief Update system statistics
  * @param[in,out] stats Pointer to SystemStats structure to update with fresh data
- * @return 0 on success, -1 on failure
+ * @return 0 on success, -1 if any collector, plugin or the alert evaluation failed
  * 
- * @details Gathers fresh statistics from all monitored subsystems and updates
- * the provided SystemStats structure. This is the main function for collecting
- * system metrics.
+ * @details Gathers fresh statistics from every running collector whose
+ * interval has elapsed and updates the provided SystemStats structure. This
+ * is the main function for collecting system metrics. A failing collector
+ * does not hold up the others: it is flagged in update_failed, keeps its
+ * previous statistics, and the snapshot and alerts are still updated.
  * 
  * @warning The stats parameter must not be NULL
  * @see SystemStats
@@ -100,6 +217,17 @@ int update_stats(SystemStats *stats);
  */
 void display_stats(const SystemStats *stats);
 
+/**
+ * @brief Display the multi-host summary grid of an aggregator
+ * @param[in] stats Hosts that have connected
+ *
+ * @details Draws one cell per host with CPU and memory history, load,
+ * disk, GPU and network throughput, in place of the single-host panels.
+ *
+ * @note init_display() must be called before using this function
+ */
+void display_hosts(const HostStats *stats);
+
 /** @} */ // end of core group
 
 #endif /* SYSTEM_MONITOR_H */ 
\ No newline at end of file
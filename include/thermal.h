@@ -0,0 +1,85 @@
+/**
+ * @file thermal.h
+ * @brief Temperature sensor and thermal throttling monitoring
+ *
+ * Sensors are discovered once from /sys/class/hwmon and /sys/class/thermal
+ * and re-read over persistent descriptors. Package and core temperatures are
+ * reported alongside the per-CPU thermal_throttle counters, so that a hot
+ * package can be tied to the throttling events it caused.
+ */
+
+#ifndef THERMAL_H
+#define THERMAL_H
+
+#define MAX_THERMAL_SENSORS 64
+#define MAX_THERMAL_LABEL 32
+
+/**
+ * @brief What a temperature sensor measures
+ */
+typedef enum {
+    THERMAL_SENSOR_OTHER,   /**< Board, chipset, NVMe or other sensor */
+    THERMAL_SENSOR_PACKAGE, /**< Whole CPU package (coretemp package, k10temp Tctl/Tdie) */
+    THERMAL_SENSOR_CORE     /**< Single core or core complex */
+} ThermalSensorKind;
+
+/**
+ * @brief Structure to hold a single temperature reading
+ */
+typedef struct {
+    char label[MAX_THERMAL_LABEL];  /**< Sensor label, e.g. "Package id 0" or "Core 3" */
+    char chip[MAX_THERMAL_LABEL];   /**< hwmon chip name or thermal zone type */
+    ThermalSensorKind kind;         /**< What the sensor measures */
+    double temperature;             /**< Current temperature in °C */
+    double critical;                /**< Critical trip point in °C (0 if unknown) */
+    int valid;                      /**< Non-zero if the last read succeeded */
+} ThermalSensor;
+
+/**
+ * @brief Structure to hold thermal statistics
+ */
+typedef struct {
+    ThermalSensor sensors[MAX_THERMAL_SENSORS]; /**< Discovered sensors */
+    unsigned int count;                         /**< Number of sensors */
+    double package_temp;            /**< Hottest package temperature in °C (0 if none) */
+    double core_temp_max;           /**< Hottest core temperature in °C (0 if none) */
+    double core_temp_avg;           /**< Average core temperature in °C (0 if none) */
+    unsigned long long core_throttle_count;    /**< Core throttle events since boot, all CPUs */
+    unsigned long long package_throttle_count; /**< Package throttle events since boot, all packages */
+    unsigned long core_throttle_events;        /**< Core throttle events since the last update */
+    unsigned long package_throttle_events;     /**< Package throttle events since the last update */
+    unsigned long long core_throttle_ms;       /**< CPU-milliseconds of core throttling since the last update, summed over CPUs (0 if the kernel does not report it) */
+    unsigned long long package_throttle_ms;    /**< Milliseconds of package throttling since the last update, summed over packages (0 if the kernel does not report it) */
+    unsigned int throttling_cpus;   /**< CPUs with new core throttle events since the last update */
+    int throttling;                 /**< Non-zero if any throttle event occurred since the last update */
+} ThermalStats;
+
+/**
+ * @brief Collector state of one thermal monitor (opaque)
+ */
+typedef struct ThermalMonitor ThermalMonitor;
+
+/**
+ * @brief Create a thermal monitor
+ * @return New monitor, or NULL on failure
+ *
+ * @details Discovers hwmon temperature inputs, thermal zones and per-CPU
+ * thermal_throttle counters. Finding no sensors is not an error.
+ */
+ThermalMonitor *create_thermal_monitor(void);
+
+/**
+ * @brief Update thermal statistics
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to ThermalStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_thermal_stats(ThermalMonitor *monitor, ThermalStats *stats);
+
+/**
+ * @brief Free a thermal monitor and close its descriptors
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_thermal_monitor(ThermalMonitor *monitor);
+
+#endif /* THERMAL_H */
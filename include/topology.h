@@ -0,0 +1,76 @@
+/**
+ * @file topology.h
+ * @brief CPU topology discovery and topology-aware usage aggregation
+ *
+ * The topology (SMT siblings, physical cores, L3 cache domains and
+ * packages) is read once from sysfs at init. Each update folds the
+ * per-CPU usage of CPUStats into per-core, per-L3 and per-package averages,
+ * which stay readable on machines with hundreds of logical CPUs.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "cpu.h"
+
+#define MAX_TOPOLOGY_PACKAGES 16
+#define MAX_TOPOLOGY_L3 128
+#define MAX_TOPOLOGY_CORES MAX_CPUS
+
+/**
+ * @brief Structure to hold the aggregated usage of one group of CPUs
+ */
+typedef struct {
+    unsigned int id;         /**< Package id for packages, sequential index otherwise */
+    int parent;              /**< Index of the enclosing L3 domain (cores) or package (L3 domains); -1 for packages */
+    unsigned int cpu_count;  /**< Online logical CPUs in the group */
+    unsigned int first_cpu;  /**< Lowest logical CPU number in the group */
+    unsigned int sampled;    /**< CPUs with a usage sample in this update, those usage averages */
+    double usage;            /**< Average usage of the group's sampled CPUs, percent */
+    double max_usage;        /**< Usage of the busiest CPU in the group, percent */
+} TopologyGroup;
+
+/**
+ * @brief Structure to hold topology-aware CPU usage
+ *
+ * @details When the kernel reports no L3 cache (some VMs and ARM systems),
+ * every package forms a single L3 domain, so the core -> L3 -> package
+ * hierarchy is always complete.
+ */
+typedef struct {
+    TopologyGroup packages[MAX_TOPOLOGY_PACKAGES]; /**< Physical packages (sockets) */
+    unsigned int package_count;                    /**< Number of packages */
+    TopologyGroup l3[MAX_TOPOLOGY_L3];             /**< L3 cache domains (CCX/CCD on AMD) */
+    unsigned int l3_count;                         /**< Number of L3 domains */
+    TopologyGroup cores[MAX_TOPOLOGY_CORES];       /**< Physical cores, SMT siblings combined */
+    unsigned int core_count;                       /**< Number of physical cores */
+    unsigned int threads_per_core;                 /**< Largest number of SMT siblings on a core */
+} TopologyStats;
+
+/**
+ * @brief Discovered CPU topology (opaque)
+ */
+typedef struct CPUTopology CPUTopology;
+
+/**
+ * @brief Discover the CPU topology
+ * @return New topology, or NULL on failure
+ */
+CPUTopology *create_topology(void);
+
+/**
+ * @brief Aggregate per-CPU usage over the discovered topology
+ * @param topo Topology to aggregate over
+ * @param cpu CPU statistics with per-CPU usage
+ * @param stats Pointer to TopologyStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_topology_stats(const CPUTopology *topo, const CPUStats *cpu, TopologyStats *stats);
+
+/**
+ * @brief Free a topology
+ * @param topo Topology to free, may be NULL
+ */
+void destroy_topology(CPUTopology *topo);
+
+#endif /* TOPOLOGY_H */
@@ -0,0 +1,114 @@
+/**
+ * @file workingset.h
+ * @brief Estimate of the memory touched over the last window, system-wide and per cgroup
+ *
+ * Resident memory is an upper bound of what a workload needs: caches and
+ * cold anonymous pages stay resident until something else wants the room.
+ * The working set is the part touched recently, here within the configured
+ * window (60 seconds by default). Two sources give it:
+ *
+ * - /sys/kernel/mm/page_idle/bitmap (idle page tracking; root and
+ *   CONFIG_IDLE_PAGE_TRACKING): one bit per page frame. Writing a 1 marks
+ *   a page on the LRU lists idle; any access clears the bit. The bitmap is
+ *   swept incrementally, a share of it per update so that one full pass
+ *   takes the window: each 64-bit word is read, its set bits (pages not
+ *   touched since the previous pass) counted, and all 64 pages marked idle
+ *   again with a single write. The working set is the LRU pages minus the
+ *   idle ones.
+ *
+ * - The workingset_* counters of /proc/vmstat and of each cgroup's
+ *   memory.stat: the active LRU lists hold pages used more than once
+ *   recently, and a refault is a page evicted too early and read back in.
+ *   The estimate is the active pages plus the pages refaulted within the
+ *   window. It is coarser, but needs no privileges and costs nothing.
+ *
+ * The system-wide figure comes from the bitmap when it can be written and
+ * from the counters otherwise. Per-cgroup figures always come from the
+ * counters, for the direct children of the cgroup v2 root, or of the v1
+ * memory hierarchy when the memory controller is mounted there.
+ *
+ * Sweeping makes the kernel walk the page tables mapping each page, so
+ * the collector is disabled by default; enable it in [workingset].
+ */
+
+#ifndef WORKINGSET_H
+#define WORKINGSET_H
+
+#define MAX_WORKINGSET_CGROUPS 8
+#define MAX_CGROUP_NAME 48
+#define DEFAULT_WORKINGSET_WINDOW_MS 60000
+
+/**
+ * @brief Where the system-wide estimate comes from
+ */
+typedef enum {
+    WORKINGSET_COUNTERS,    /**< Active pages plus refaults over the window */
+    WORKINGSET_IDLE_PAGES   /**< Idle page tracking */
+} WorkingSetMethod;
+
+/**
+ * @brief Working set of one cgroup
+ *
+ * @details Sizes are in bytes.
+ */
+typedef struct {
+    char name[MAX_CGROUP_NAME];   /**< Path below the cgroup root, e.g. "/system.slice" */
+    unsigned long usage;          /**< Memory charged to the cgroup */
+    unsigned long active;         /**< Pages on the active LRU lists */
+    unsigned long refaulted;      /**< Evicted pages read back in within the window */
+    unsigned long working_set;    /**< active + refaulted */
+} CgroupWorkingSet;
+
+/**
+ * @brief Structure to hold the working set estimates
+ *
+ * @details Sizes are in bytes. With idle page tracking the estimate is
+ * scaled from the swept share of memory until the first full pass.
+ */
+typedef struct {
+    WorkingSetMethod method;      /**< Source of working_set */
+    unsigned long working_set;    /**< Memory touched within the window, system-wide */
+    unsigned long lru;            /**< Pages on the LRU lists (anon, file, unevictable) */
+    unsigned long active;         /**< Pages on the active LRU lists */
+    unsigned long refaulted;      /**< Evicted pages read back in within the window */
+    unsigned long idle;           /**< LRU pages not touched in the window (idle page tracking) */
+    double coverage;              /**< Share of page frames measured so far, percent */
+    double scan_ms;               /**< Time spent sweeping the bitmap in the last update */
+    unsigned int window;          /**< Configured window in seconds */
+    unsigned int span;            /**< Seconds the refault counts cover, up to the window */
+    char idle_error[64];          /**< Why idle page tracking is not used, empty if it is */
+    CgroupWorkingSet cgroups[MAX_WORKINGSET_CGROUPS];  /**< Largest working set first */
+    unsigned int cgroup_count;    /**< Valid entries in cgroups */
+} WorkingSetStats;
+
+/**
+ * @brief Collector state of one working set monitor (opaque)
+ */
+typedef struct WorkingSetMonitor WorkingSetMonitor;
+
+/**
+ * @brief Create a working set monitor
+ * @param window_ms Window to estimate the working set over, in milliseconds
+ * @return New monitor, or NULL if /proc/meminfo or /proc/vmstat cannot be
+ *         opened or on allocation failure
+ *
+ * @details Falls back to the counters if the page_idle bitmap cannot be
+ * opened for writing; the reason is reported in idle_error.
+ */
+WorkingSetMonitor *create_workingset_monitor(unsigned int window_ms);
+
+/**
+ * @brief Sweep the next share of the bitmap and update the estimates
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to WorkingSetStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_workingset_stats(WorkingSetMonitor *monitor, WorkingSetStats *stats);
+
+/**
+ * @brief Free a working set monitor and close its files
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_workingset_monitor(WorkingSetMonitor *monitor);
+
+#endif /* WORKINGSET_H */
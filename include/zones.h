@@ -0,0 +1,107 @@
+/**
+ * @file zones.h
+ * @brief Memory zone watermarks and buddy allocator fragmentation
+ *
+ * Free memory is not the same as allocatable memory: a request for 2^order
+ * contiguous pages fails, or stalls in compaction, when the free pages of a
+ * zone are scattered over smaller blocks. Each zone of each NUMA node is
+ * read from two files:
+ *
+ * - /proc/buddyinfo: free blocks per order,
+ *
+ *       Node 0, zone   Normal    212    435    194     89 ...
+ *
+ * - /proc/zoneinfo: free pages and the min/low/high watermarks. kswapd
+ *   starts reclaiming when a zone drops below low and stops at high;
+ *   below min, allocations reclaim directly and stall.
+ *
+ * From the blocks per order, the unusable free space index of each order
+ * is computed: the fraction of free memory in blocks too small for an
+ * allocation of that order (0 when every free page is usable, 1 when no
+ * block is large enough).
+ *
+ * Both files are read once per update through stdio buffers owned by the
+ * monitor, line by line into a fixed-size ZoneInfo, so a large zoneinfo
+ * (it lists the per-CPU page sets of every zone) costs no allocations.
+ */
+
+#ifndef ZONES_H
+#define ZONES_H
+
+#define MAX_ZONES 32
+#define MAX_ZONE_NAME 12
+#define MAX_ZONE_ORDERS 16
+#define ZONE_COSTLY_ORDER 3  // PAGE_ALLOC_COSTLY_ORDER; larger requests may fail instead of retrying
+
+/**
+ * @brief Where a zone's free pages are relative to its watermarks
+ */
+typedef enum {
+    ZONE_OK,         /**< At or above the high watermark */
+    ZONE_NEAR_LOW,   /**< Between low and high: kswapd reclaims if it was woken */
+    ZONE_BELOW_LOW,  /**< Below low: kswapd is reclaiming */
+    ZONE_BELOW_MIN   /**< Below min: allocations reclaim directly and stall */
+} ZoneWatermark;
+
+/**
+ * @brief One zone of one NUMA node
+ *
+ * @details Page counts are in pages of ZoneInfo.page_size.
+ */
+typedef struct {
+    int node;                                 /**< NUMA node */
+    char name[MAX_ZONE_NAME];                 /**< Zone name, e.g. "Normal" */
+    unsigned long free;                       /**< Free pages */
+    unsigned long min;                        /**< Min watermark */
+    unsigned long low;                        /**< Low watermark */
+    unsigned long high;                       /**< High watermark */
+    unsigned long managed;                    /**< Pages managed by the buddy allocator */
+    unsigned long blocks[MAX_ZONE_ORDERS];    /**< Free blocks of each order */
+    double unusable[MAX_ZONE_ORDERS];         /**< Unusable free space index of each order, 0-1 */
+    ZoneWatermark watermark;                  /**< Free pages against the watermarks */
+} ZoneStats;
+
+/**
+ * @brief Structure to hold the populated zones of all nodes
+ */
+typedef struct {
+    ZoneStats zones[MAX_ZONES];           /**< Zones in node, then zone order */
+    unsigned int count;                   /**< Number of zones */
+    unsigned int dropped;                 /**< Populated zones that did not fit in MAX_ZONES */
+    unsigned int order_count;             /**< Orders listed in buddyinfo (MAX_ORDER + 1) */
+    unsigned long page_size;              /**< Page size in bytes */
+    unsigned int thp_order;               /**< Order of a transparent huge page */
+    double unusable[MAX_ZONE_ORDERS];     /**< Unusable free space index of each order over all zones */
+    double unusable_costly;               /**< unusable[ZONE_COSTLY_ORDER] in percent */
+    double unusable_thp;                  /**< unusable[thp_order] in percent */
+    unsigned int near_low;                /**< Zones between their low and high watermark */
+    unsigned int below_low;               /**< Zones below their low watermark, including below min */
+    unsigned int below_min;               /**< Zones below their min watermark */
+} ZoneInfo;
+
+/**
+ * @brief Collector state of one zone monitor (opaque)
+ */
+typedef struct ZoneMonitor ZoneMonitor;
+
+/**
+ * @brief Create a zone monitor
+ * @return New monitor, or NULL if /proc/buddyinfo or /proc/zoneinfo cannot be opened
+ */
+ZoneMonitor *create_zone_monitor(void);
+
+/**
+ * @brief Update zone watermarks and fragmentation
+ * @param monitor Monitor to sample with
+ * @param stats Pointer to ZoneInfo structure to update
+ * @return 0 on success, -1 on failure
+ */
+int update_zone_stats(ZoneMonitor *monitor, ZoneInfo *stats);
+
+/**
+ * @brief Free a zone monitor and close its files
+ * @param monitor Monitor to free, may be NULL
+ */
+void destroy_zone_monitor(ZoneMonitor *monitor);
+
+#endif /* ZONES_H */
@@ -0,0 +1,273 @@
+/**
+ * @file aggregate.c
+ * @brief Implementation of the multi-host aggregator
+ */
+
+#include "aggregate.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief An agent connection and its partly received frame
+ */
+typedef struct {
+    int fd;      // -1 if the entry is free
+    int host;    // Index into HostStats, -1 until the HELLO arrived
+    CodecState codec;
+    size_t have;
+    uint8_t buf[STREAM_FRAME_MAX];
+} Connection;
+
+struct Aggregator {
+    int listen_fd;
+    char unix_path[256];  // Socket file to remove on exit, empty for TCP
+    Connection connections[MAX_HOSTS];
+};
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+Aggregator *create_aggregator(const char *address) {
+    Aggregator *aggregator = calloc(1, sizeof(*aggregator));
+    if (!aggregator) return NULL;
+
+    aggregator->listen_fd = stream_listen(address);
+    if (aggregator->listen_fd < 0) {
+        int saved = errno;
+        free(aggregator);
+        errno = saved;
+        return NULL;
+    }
+    if (!strncmp(address, "unix:", 5)) snprintf(aggregator->unix_path, sizeof(aggregator->unix_path), "%s", address + 5);
+    else if (strchr(address, '/')) snprintf(aggregator->unix_path, sizeof(aggregator->unix_path), "%s", address);
+
+    for (int i = 0; i < MAX_HOSTS; i++) aggregator->connections[i].fd = -1;
+    return aggregator;
+}
+
+int aggregator_fd(const Aggregator *aggregator) {
+    return aggregator->listen_fd;
+}
+
+int aggregator_accept(Aggregator *aggregator) {
+    int fd = accept(aggregator->listen_fd, NULL, NULL);
+    if (fd < 0) return -1;
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_HOSTS; i++) {
+        Connection *conn = &aggregator->connections[i];
+        if (conn->fd >= 0) continue;
+        conn->fd = fd;
+        conn->host = -1;
+        conn->have = 0;
+        return fd;
+    }
+    close(fd);  // No room for another agent
+    return -1;
+}
+
+/**
+ * @brief Find a connection by descriptor
+ * @param aggregator Aggregator
+ * @param fd Connection socket
+ * @return Connection, or NULL if fd is not an agent connection
+ */
+static Connection *find_connection(Aggregator *aggregator, int fd) {
+    for (int i = 0; i < MAX_HOSTS; i++) {
+        if (aggregator->connections[i].fd == fd) return &aggregator->connections[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Close a connection and mark its host offline
+ * @param conn Connection
+ * @param stats Hosts
+ */
+static void close_connection(Connection *conn, HostStats *stats) {
+    if (conn->host >= 0 && stats->hosts[conn->host].online) {
+        stats->hosts[conn->host].online = 0;
+        stats->online--;
+    }
+    close(conn->fd);
+    conn->fd = -1;
+    conn->host = -1;
+    conn->have = 0;
+}
+
+/**
+ * @brief Attach a connection to its host on HELLO
+ * @param aggregator Aggregator
+ * @param conn Connection that sent the HELLO
+ * @param name Announced host name
+ * @param stats Hosts
+ * @return 0 on success, -1 if the host table is full
+ *
+ * @details A connection for a host that is still online replaces the
+ * older one, which is most likely an agent that restarted before its old
+ * connection timed out.
+ */
+static int attach_host(Aggregator *aggregator, Connection *conn, const char *name, HostStats *stats) {
+    int index = -1;
+    for (unsigned int i = 0; i < stats->count; i++) {
+        if (strcmp(stats->hosts[i].name, name) == 0) index = (int)i;
+    }
+    if (index < 0) {
+        if (stats->count >= MAX_HOSTS) return -1;
+        index = (int)stats->count++;
+        memset(&stats->hosts[index], 0, sizeof(stats->hosts[index]));
+        snprintf(stats->hosts[index].name, sizeof(stats->hosts[index].name), "%s", name);
+    }
+
+    for (int i = 0; i < MAX_HOSTS; i++) {
+        Connection *other = &aggregator->connections[i];
+        if (other != conn && other->fd >= 0 && other->host == index) close_connection(other, stats);
+    }
+
+    // The agent starts over with a keyframe
+    HostInfo *host = &stats->hosts[index];
+    codec_reset(&conn->codec, 0);
+    host->online = 1;
+    host->last_update = now_ms();
+    stats->online++;
+    conn->host = index;
+    return 0;
+}
+
+/**
+ * @brief Sum or maximum over the instance slots of a metric, skipping NAN
+ * @param values Metric values
+ * @param id Metric
+ * @param sum Non-zero to sum, zero for the maximum
+ * @return Result, NAN if no instance has a value
+ */
+static double combine_slots(const MetricSnapshot *values, MetricId id, int sum) {
+    const MetricInfo *info = &metric_info[id];
+    double result = NAN;
+    for (unsigned int i = 0; i < info->slots; i++) {
+        double v = values->values[info->slot + i];
+        if (isnan(v)) continue;
+        if (isnan(result)) result = v;
+        else if (sum) result += v;
+        else if (v > result) result = v;
+    }
+    return result;
+}
+
+/**
+ * @brief Append a percentage to a history ring kept oldest first
+ * @param history History samples
+ * @param count Valid samples before this one
+ * @param value Percentage, NAN counts as 0
+ */
+static void push_history(unsigned int *history, unsigned int count, double value) {
+    unsigned int sample = isnan(value) || value < 0 ? 0 : (unsigned int)(value + 0.5);
+    if (count >= HOST_HISTORY) {
+        memmove(history, history + 1, (HOST_HISTORY - 1) * sizeof(*history));
+        count = HOST_HISTORY - 1;
+    }
+    history[count] = sample;
+}
+
+/**
+ * @brief Recompute a host's headline numbers after a snapshot
+ * @param host Host
+ */
+static void summarize_host(HostInfo *host) {
+    const MetricSnapshot *values = &host->values;
+    host->cpu = values->values[metric_info[METRIC_CPU_USAGE].slot];
+    host->memory = values->values[metric_info[METRIC_MEM_USAGE].slot];
+    host->load1 = values->values[metric_info[METRIC_SCHED_LOAD1].slot];
+    host->rx = combine_slots(values, METRIC_NET_RX, 1);
+    host->tx = combine_slots(values, METRIC_NET_TX, 1);
+    host->disk = combine_slots(values, METRIC_DISK_USAGE, 0);
+    host->gpu = combine_slots(values, METRIC_GPU_UTILIZATION, 0);
+
+    push_history(host->cpu_history, host->history_count, host->cpu);
+    push_history(host->mem_history, host->history_count, host->memory);
+    if (host->history_count < HOST_HISTORY) host->history_count++;
+}
+
+/**
+ * @brief Apply one complete frame
+ * @param aggregator Aggregator
+ * @param conn Connection the frame came from
+ * @param frame Frame
+ * @param len Frame length
+ * @param stats Hosts
+ * @return 0 on success, -1 if the connection must be closed
+ */
+static int handle_frame(Aggregator *aggregator, Connection *conn, const uint8_t *frame, size_t len,
+                        HostStats *stats) {
+    if (conn->host < 0) {
+        char name[STREAM_HOST_MAX];
+        if (stream_decode_hello(frame, len, name) != 0) return -1;
+        return attach_host(aggregator, conn, name, stats);
+    }
+
+    HostInfo *host = &stats->hosts[conn->host];
+    if (stream_decode_snapshot(frame, len, &conn->codec) != 0) return -1;
+    host->values = conn->codec.values;
+    host->last_update = now_ms();
+    summarize_host(host);
+    return 0;
+}
+
+int aggregator_read(Aggregator *aggregator, int fd, HostStats *stats) {
+    Connection *conn = find_connection(aggregator, fd);
+    if (!conn) return -1;
+
+    for (;;) {
+        ssize_t n = read(fd, conn->buf + conn->have, sizeof(conn->buf) - conn->have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (n <= 0) {
+            close_connection(conn, stats);
+            return -1;
+        }
+        conn->have += (size_t)n;
+
+        // Apply every complete frame and keep the tail for the next read
+        size_t used = 0;
+        long len;
+        while ((len = stream_frame_length(conn->buf + used, conn->have - used)) > 0) {
+            if (handle_frame(aggregator, conn, conn->buf + used, (size_t)len, stats) != 0) {
+                close_connection(conn, stats);
+                return -1;
+            }
+            used += (size_t)len;
+        }
+        if (len < 0) {
+            close_connection(conn, stats);
+            return -1;
+        }
+        memmove(conn->buf, conn->buf + used, conn->have - used);
+        conn->have -= used;
+    }
+}
+
+void destroy_aggregator(Aggregator *aggregator) {
+    if (!aggregator) return;
+    for (int i = 0; i < MAX_HOSTS; i++) {
+        if (aggregator->connections[i].fd >= 0) close(aggregator->connections[i].fd);
+    }
+    close(aggregator->listen_fd);
+    if (aggregator->unix_path[0]) unlink(aggregator->unix_path);
+    free(aggregator);
+}
@@ -0,0 +1,871 @@
+/**
+ * @file alert.c
+ * @brief Implementation of the alerting rules engine
+ */
+
+#include "alert.h"
+#include "system_monitor.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_METRIC_SLOTS 128
+#define MAX_PROGRAM 1024
+#define MAX_STACK 32
+#define MAX_INSTANCE_NAME 64
+#define MAX_RULE_LINE 512
+
+extern char **environ;
+
+/**
+ * @brief Panel of each metric group, for colouring panel borders
+ */
+typedef struct {
+    const char *group;
+    AlertPanel panel;
+} GroupPanel;
+
+static const GroupPanel group_panels[] = {
+    {"cpu", ALERT_PANEL_CPU},
+    {"sched", ALERT_PANEL_CPU},
+    {"cpufreq", ALERT_PANEL_CPU},
+    {"thermal", ALERT_PANEL_CPU},
+    {"perf", ALERT_PANEL_COUNTERS},
+    {"mem", ALERT_PANEL_MEMORY},
+    {"disk", ALERT_PANEL_DISK},
+    {"net", ALERT_PANEL_NETWORK},
+    {"gpu", ALERT_PANEL_GPU},
+    {"events", ALERT_PANEL_EVENTS},
+    {"kmem", ALERT_PANEL_MEMORY},
+    {"zones", ALERT_PANEL_MEMORY},
+    {"procmem", ALERT_PANEL_MEMORY},
+    {"workingset", ALERT_PANEL_MEMORY},
+    {"swap", ALERT_PANEL_MEMORY},
+    {"plugin", ALERT_PANEL_PLUGINS},
+};
+
+/**
+ * @brief One distinct metric referenced by the rules, sampled once per tick
+ */
+typedef struct {
+    int metric;      // MetricId, -1 for a plugin metric
+    int collector;   // CollectorId writing the metric, -1 for a plugin metric
+    char instance[MAX_INSTANCE_NAME];
+    char field[PLUGIN_NAME_MAX];  // Metric name of plugin metrics
+    int index;       // Instance index found last tick, -1 if unknown
+    int needs_rate;  // Referenced through rate()
+    double value;    // NAN if the metric is missing from the snapshot
+    double rate;     // Change per second between the source's last two updates, NAN if unknown
+    double prev;
+    long long prev_ms;  // Source update time of prev
+    int has_prev;
+} MetricSlot;
+
+// Program opcodes; operands are taken from and results pushed to the stack
+typedef enum {
+    OP_CONST,
+    OP_LOAD,
+    OP_RATE,
+    OP_NEG,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_GT,
+    OP_GE,
+    OP_LT,
+    OP_LE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_OR,
+    OP_END_RULE  // Pops the rule's condition
+} OpCode;
+
+/**
+ * @brief One instruction of the flat evaluation program
+ */
+typedef struct {
+    OpCode op;
+    unsigned int arg;  // Slot for OP_LOAD/OP_RATE, rule for OP_END_RULE
+    double value;      // Constant for OP_CONST
+} Instruction;
+
+/**
+ * @brief A compiled rule and its firing state
+ */
+typedef struct {
+    char text[ALERT_RULE_MAX];
+    AlertSeverity severity;
+    double for_seconds;
+    unsigned int panel_mask;  // Bit per AlertPanel of the metrics it references
+    double pending_since;     // Monotonic time the condition started holding, < 0 if it does not
+    int firing;
+    time_t fired_at;
+    double value;
+} AlertRule;
+
+/**
+ * @brief Recursive descent parser state for one rule
+ */
+typedef struct {
+    const char *pos;
+    const char *error;
+    AlertRule *rule;
+    int depth;      // Stack depth of the code emitted so far
+    int max_depth;
+} Parser;
+
+static AlertRule rules[MAX_ALERT_RULES];
+static unsigned int rule_count = 0;
+static MetricSlot slots[MAX_METRIC_SLOTS];
+static unsigned int slot_count = 0;
+static Instruction program[MAX_PROGRAM];
+static unsigned int program_length = 0;
+static FILE *log_file = NULL;
+static char *exec_command = NULL;
+static char error[256] = "";
+
+static int parse_or(Parser *p);
+
+/**
+ * @brief Append an instruction and track the stack depth it leaves
+ * @param p Parser state
+ * @param op Opcode
+ * @param arg Slot or rule index
+ * @param value Constant
+ * @return 0 on success, -1 if the program or stack is full
+ */
+static int emit(Parser *p, OpCode op, unsigned int arg, double value) {
+    if (program_length >= MAX_PROGRAM) {
+        p->error = "too many rules";
+        return -1;
+    }
+    program[program_length].op = op;
+    program[program_length].arg = arg;
+    program[program_length].value = value;
+    program_length++;
+
+    if (op == OP_CONST || op == OP_LOAD || op == OP_RATE) p->depth++;
+    else if (op != OP_NEG) p->depth--;
+    if (p->depth > p->max_depth) p->max_depth = p->depth;
+    if (p->max_depth > MAX_STACK) {
+        p->error = "expression too deeply nested";
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Skip whitespace
+ * @param p Parser state
+ */
+static void skip_space(Parser *p) {
+    while (isspace((unsigned char)*p->pos)) p->pos++;
+}
+
+/**
+ * @brief Consume a literal token if it comes next
+ * @param p Parser state
+ * @param token Token text
+ * @return Non-zero if the token was consumed
+ */
+static int accept(Parser *p, const char *token) {
+    skip_space(p);
+    size_t len = strlen(token);
+    if (strncmp(p->pos, token, len) != 0) return 0;
+    p->pos += len;
+    return 1;
+}
+
+/**
+ * @brief Whether a character can be part of a metric name
+ *
+ * @details Mount points and interface names may contain '/', '-' and '.',
+ * so arithmetic operators next to a metric name need surrounding spaces.
+ */
+static int is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '/' || c == '-';
+}
+
+/**
+ * @brief Read a name (metric or keyword) at the current position
+ * @param p Parser state
+ * @param buf Buffer for the name
+ * @param size Size of the buffer
+ * @return Length of the name, 0 if none starts here
+ */
+static size_t read_name(Parser *p, char *buf, size_t size) {
+    skip_space(p);
+    if (!isalpha((unsigned char)*p->pos)) return 0;
+
+    size_t len = 0;
+    while (is_name_char(p->pos[len])) len++;
+    size_t copy = len < size ? len : size - 1;
+    memcpy(buf, p->pos, copy);
+    buf[copy] = '\0';
+    p->pos += len;
+    return len;
+}
+
+/**
+ * @brief Find or add the slot for a metric name
+ * @param p Parser state
+ * @param name Metric name, "group.field" or "group.instance.field"
+ * @param rate Non-zero if referenced through rate()
+ * @return Slot index, or -1 on error
+ */
+static int resolve_metric(Parser *p, const char *name, int rate) {
+    const char *first = strchr(name, '.');
+    const char *last = strrchr(name, '.');
+    if (!first || !last[1]) {
+        p->error = "metric names look like group.field or group.instance.field";
+        return -1;
+    }
+
+    char group[32] = "";
+    char instance[MAX_INSTANCE_NAME] = "";
+    size_t group_len = (size_t)(first - name);
+    if (group_len >= sizeof(group)) group_len = sizeof(group) - 1;
+    memcpy(group, name, group_len);
+    if (last > first) {
+        size_t len = (size_t)(last - first - 1);
+        if (len == 0 || len >= sizeof(instance)) {
+            p->error = "bad instance name";
+            return -1;
+        }
+        memcpy(instance, first + 1, len);
+        instance[len] = '\0';
+    }
+
+    const GroupPanel *group_panel = NULL;
+    for (size_t i = 0; i < sizeof(group_panels) / sizeof(group_panels[0]); i++) {
+        if (strcmp(group_panels[i].group, group) == 0) group_panel = &group_panels[i];
+    }
+
+    // Plugin metrics are looked up by name each tick; the rest live in the registry
+    int metric = -1;
+    const char *field = last + 1;
+    if (group_panel && group_panel->panel == ALERT_PANEL_PLUGINS) {
+        if (!instance[0]) {
+            p->error = "plugin metrics look like plugin.<plugin>.<metric>";
+            return -1;
+        }
+        if (strlen(field) >= PLUGIN_NAME_MAX) {
+            p->error = "plugin metric name too long";
+            return -1;
+        }
+    } else {
+        char registry_name[sizeof(group) + PLUGIN_NAME_MAX + 1];
+        snprintf(registry_name, sizeof(registry_name), "%s.%s", group, field);
+        metric = group_panel ? find_metric(registry_name, instance[0] != '\0') : -1;
+        if (metric < 0) {
+            p->error = "unknown metric";
+            return -1;
+        }
+        MetricInstance kind = metric_info[metric].instance;
+        if ((kind == METRIC_PER_CPU || kind == METRIC_PER_GPU) &&
+            strspn(instance, "0123456789") != strlen(instance)) {
+            p->error = "cpu and gpu instances are numbers";
+            return -1;
+        }
+        field = "";
+    }
+    p->rule->panel_mask |= 1u << group_panel->panel;
+
+    // Each distinct metric gets one slot shared by all rules
+    for (unsigned int i = 0; i < slot_count; i++) {
+        if (slots[i].metric == metric && strcmp(slots[i].instance, instance) == 0 &&
+            strcmp(slots[i].field, field) == 0) {
+            slots[i].needs_rate |= rate;
+            return (int)i;
+        }
+    }
+    if (slot_count >= MAX_METRIC_SLOTS) {
+        p->error = "too many distinct metrics";
+        return -1;
+    }
+    MetricSlot *slot = &slots[slot_count];
+    memset(slot, 0, sizeof(*slot));
+    slot->metric = metric;
+    slot->collector = metric >= 0 ? collector_of_field(metric_info[metric].offset) : -1;
+    strcpy(slot->instance, instance);
+    strcpy(slot->field, field);
+    slot->index = -1;
+    slot->needs_rate = rate;
+    slot->rate = NAN;
+    return (int)slot_count++;
+}
+
+/**
+ * @brief primary := number | metric | rate(metric) | ( expr )
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_primary(Parser *p) {
+    char name[MAX_INSTANCE_NAME + 64];
+
+    skip_space(p);
+    if (accept(p, "(")) {
+        if (parse_or(p) != 0) return -1;
+        if (!accept(p, ")")) {
+            p->error = "expected ')'";
+            return -1;
+        }
+        return 0;
+    }
+
+    if (isdigit((unsigned char)*p->pos) || *p->pos == '.') {
+        char *end;
+        double value = strtod(p->pos, &end);
+        if (end == p->pos) {
+            p->error = "bad number";
+            return -1;
+        }
+        p->pos = end;
+        return emit(p, OP_CONST, 0, value);
+    }
+
+    const char *start = p->pos;
+    if (read_name(p, name, sizeof(name)) == 0) {
+        p->error = "expected a number, metric or '('";
+        return -1;
+    }
+
+    int rate = 0;
+    if (strcmp(name, "rate") == 0) {
+        if (!accept(p, "(") || read_name(p, name, sizeof(name)) == 0) {
+            p->error = "expected rate(metric)";
+            return -1;
+        }
+        if (!accept(p, ")")) {
+            p->error = "expected ')'";
+            return -1;
+        }
+        rate = 1;
+    }
+
+    int slot = resolve_metric(p, name, rate);
+    if (slot < 0) {
+        p->pos = start;  // Point the error at the metric name
+        return -1;
+    }
+    return emit(p, rate ? OP_RATE : OP_LOAD, (unsigned int)slot, 0);
+}
+
+/**
+ * @brief unary := '-' unary | primary
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_unary(Parser *p) {
+    if (accept(p, "-")) {
+        if (parse_unary(p) != 0) return -1;
+        return emit(p, OP_NEG, 0, 0);
+    }
+    return parse_primary(p);
+}
+
+/**
+ * @brief term := unary (('*' | '/') unary)*
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_term(Parser *p) {
+    if (parse_unary(p) != 0) return -1;
+    for (;;) {
+        OpCode op;
+        if (accept(p, "*")) op = OP_MUL;
+        else if (accept(p, "/")) op = OP_DIV;
+        else return 0;
+        if (parse_unary(p) != 0 || emit(p, op, 0, 0) != 0) return -1;
+    }
+}
+
+/**
+ * @brief sum := term (('+' | '-') term)*
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_sum(Parser *p) {
+    if (parse_term(p) != 0) return -1;
+    for (;;) {
+        OpCode op;
+        if (accept(p, "+")) op = OP_ADD;
+        else if (accept(p, "-")) op = OP_SUB;
+        else return 0;
+        if (parse_term(p) != 0 || emit(p, op, 0, 0) != 0) return -1;
+    }
+}
+
+/**
+ * @brief compare := sum [('>' | '>=' | '<' | '<=' | '==' | '!=') sum]
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_compare(Parser *p) {
+    if (parse_sum(p) != 0) return -1;
+
+    OpCode op;
+    if (accept(p, ">=")) op = OP_GE;
+    else if (accept(p, "<=")) op = OP_LE;
+    else if (accept(p, "==")) op = OP_EQ;
+    else if (accept(p, "!=")) op = OP_NE;
+    else if (accept(p, ">")) op = OP_GT;
+    else if (accept(p, "<")) op = OP_LT;
+    else return 0;
+
+    if (parse_sum(p) != 0) return -1;
+    return emit(p, op, 0, 0);
+}
+
+/**
+ * @brief and := compare ('&&' compare)*
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_and(Parser *p) {
+    if (parse_compare(p) != 0) return -1;
+    while (accept(p, "&&")) {
+        if (parse_compare(p) != 0 || emit(p, OP_AND, 0, 0) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief or := and ('||' and)*
+ * @param p Parser state
+ * @return 0 on success, -1 on error
+ */
+static int parse_or(Parser *p) {
+    if (parse_and(p) != 0) return -1;
+    while (accept(p, "||")) {
+        if (parse_and(p) != 0 || emit(p, OP_OR, 0, 0) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse a "for" duration such as 30s, 2m, 1h or 500ms
+ * @param p Parser state
+ * @param seconds Duration in seconds
+ * @return 0 on success, -1 on error
+ */
+static int parse_duration(Parser *p, double *seconds) {
+    char *end;
+    skip_space(p);
+    double value = strtod(p->pos, &end);
+    if (end == p->pos || value < 0) {
+        p->error = "expected a duration after 'for'";
+        return -1;
+    }
+    p->pos = end;
+
+    if (strncmp(p->pos, "ms", 2) == 0) {
+        value /= 1000;
+        p->pos += 2;
+    } else if (*p->pos == 's') {
+        p->pos++;
+    } else if (*p->pos == 'm') {
+        value *= 60;
+        p->pos++;
+    } else if (*p->pos == 'h') {
+        value *= 3600;
+        p->pos++;
+    }
+    *seconds = value;
+    return 0;
+}
+
+/**
+ * @brief Compile one rule line and append it to the program
+ * @param line Rule text with comments and line ending removed
+ * @param error Set to a message on failure
+ * @param where Set to the position of the error on failure
+ * @return 0 on success, -1 on error
+ */
+static int compile_rule(const char *line, const char **error, const char **where) {
+    if (rule_count >= MAX_ALERT_RULES) {
+        *error = "too many rules";
+        *where = line;
+        return -1;
+    }
+
+    AlertRule *rule = &rules[rule_count];
+    memset(rule, 0, sizeof(*rule));
+    rule->severity = ALERT_WARNING;
+    rule->pending_since = -1;
+
+    Parser p = {line, NULL, rule, 0, 0};
+    skip_space(&p);
+    if (accept(&p, "critical:")) rule->severity = ALERT_CRITICAL;
+    else if (accept(&p, "warning:")) rule->severity = ALERT_WARNING;
+    skip_space(&p);
+    snprintf(rule->text, sizeof(rule->text), "%s", p.pos);
+
+    int ret = parse_or(&p);
+    if (ret == 0) {
+        char word[8];
+        const char *before = p.pos;
+        if (read_name(&p, word, sizeof(word)) > 0) {
+            if (strcmp(word, "for") == 0) ret = parse_duration(&p, &rule->for_seconds);
+            else p.pos = before;
+        }
+    }
+    if (ret == 0) {
+        skip_space(&p);
+        if (*p.pos) {
+            p.error = "unexpected text";
+            ret = -1;
+        }
+    }
+    if (ret == 0) ret = emit(&p, OP_END_RULE, rule_count, 0);
+
+    if (ret != 0) {
+        *error = p.error;
+        *where = p.pos;
+        return -1;
+    }
+    rule_count++;
+    return 0;
+}
+
+/**
+ * @brief Read and compile a rules file
+ * @param path Rules file
+ * @return 0 on success, -1 on failure
+ */
+static int load_rules(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        snprintf(error, sizeof(error), "%s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    char line[MAX_RULE_LINE];
+    unsigned int line_no = 0;
+    int ret = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        line[strcspn(line, "#\r\n")] = '\0';
+
+        const char *text = line;
+        while (isspace((unsigned char)*text)) text++;
+        if (!*text) continue;
+
+        const char *message, *where;
+        if (compile_rule(text, &message, &where) != 0) {
+            snprintf(error, sizeof(error), "%s:%u: %s near \"%.24s\"", path, line_no, message, where);
+            ret = -1;
+            break;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+int init_alerts(const char *rules_path, const char *log_path, const char *exec_cmd) {
+    rule_count = slot_count = program_length = 0;
+    error[0] = '\0';
+
+    if (rules_path && load_rules(rules_path) != 0) return -1;
+
+    if (log_path) {
+        log_file = fopen(log_path, "ae");
+        if (!log_file) {
+            snprintf(error, sizeof(error), "%s: %s", log_path, strerror(errno));
+            return -1;
+        }
+    }
+    if (exec_cmd) {
+        exec_command = strdup(exec_cmd);
+        if (!exec_command) {
+            cleanup_alerts();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Find a plugin metric by name
+ * @param plugins Plugin statistics
+ * @param plugin Plugin name
+ * @param metric Metric name
+ * @return plugin index * MAX_PLUGIN_METRICS + metric index, -1 if not loaded
+ */
+static int plugin_metric_index(const PluginStats *plugins, const char *plugin, const char *metric) {
+    for (unsigned int i = 0; i < plugins->count; i++) {
+        const PluginInfo *info = &plugins->plugins[i];
+        if (strcmp(info->name, plugin) != 0) continue;
+        for (unsigned int m = 0; m < info->metric_count; m++) {
+            if (strcmp(info->metrics[m].name, metric) == 0) return (int)(i * MAX_PLUGIN_METRICS + m);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Find the instance index a slot's label refers to
+ * @param stats Current snapshot
+ * @param slot Metric slot of a per-instance registry metric; its cached index is updated
+ * @return Instance index, or -1 if the instance is gone
+ */
+static int instance_index(const SystemStats *stats, MetricSlot *slot) {
+    MetricInstance kind = metric_info[slot->metric].instance;
+    char buf[16];
+
+    if (kind == METRIC_PER_CPU || kind == METRIC_PER_GPU) {
+        int i = atoi(slot->instance);
+        return (unsigned int)i < metric_instance_count(stats, kind) ? i : -1;
+    }
+
+    // Mounts and interfaces rarely move, so try last tick's index first
+    const char *label = slot->index >= 0 ?
+                        metric_instance_label(stats, kind, (unsigned int)slot->index, buf, sizeof(buf)) : NULL;
+    if (label && strcmp(label, slot->instance) == 0) return slot->index;
+    for (unsigned int i = 0; (label = metric_instance_label(stats, kind, i, buf, sizeof(buf))); i++) {
+        if (strcmp(label, slot->instance) == 0) {
+            slot->index = (int)i;
+            return slot->index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Read one metric from the snapshot
+ * @param stats Current snapshot
+ * @param slot Metric slot
+ * @return Metric value, NAN if unavailable
+ */
+static double sample_metric(const SystemStats *stats, MetricSlot *slot) {
+    if (slot->metric < 0) {
+        // Plugins may have been reloaded in a different order since last tick
+        int i = plugin_metric_index(&stats->plugins, slot->instance, slot->field);
+        if (i < 0) return NAN;
+        return stats->plugins.plugins[i / MAX_PLUGIN_METRICS].metrics[i % MAX_PLUGIN_METRICS].value;
+    }
+
+    const MetricInfo *info = &metric_info[slot->metric];
+    int i = info->instance == METRIC_SCALAR ? 0 : instance_index(stats, slot);
+    return i >= 0 ? stats->metrics.values[info->slot + i] : NAN;
+}
+
+/**
+ * @brief When the source of a metric last updated
+ * @param stats Snapshot
+ * @param slot Metric
+ * @return Monotonic milliseconds, 0 if the source is not running
+ */
+static long long metric_updated(const SystemStats *stats, const MetricSlot *slot) {
+    if (slot->metric < 0) {
+        int i = plugin_metric_index(&stats->plugins, slot->instance, slot->field);
+        return i >= 0 ? stats->plugins.plugins[i / MAX_PLUGIN_METRICS].updated_ms : 0;
+    }
+    return slot->collector >= 0 ? stats->updated_ms[slot->collector] : 0;
+}
+
+/**
+ * @brief Whether a stack value counts as true (NAN never does)
+ */
+static int truthy(double value) {
+    return !isnan(value) && value != 0;
+}
+
+/**
+ * @brief Run the exec hook for a rule transition
+ * @param rule Rule that changed state
+ * @param state "firing" or "resolved"
+ *
+ * @details The hook gets the details in SYSMON_ALERT_* variables. It runs
+ * through a double fork, so the monitor neither blocks on it nor has to reap
+ * it, with its output sent to /dev/null to keep the screen intact.
+ */
+static void run_hook(const AlertRule *rule, const char *state) {
+    char env_state[32], env_severity[32], env_value[64], env_rule[ALERT_RULE_MAX + 32];
+    snprintf(env_state, sizeof(env_state), "SYSMON_ALERT_STATE=%s", state);
+    snprintf(env_severity, sizeof(env_severity), "SYSMON_ALERT_SEVERITY=%s",
+             rule->severity == ALERT_CRITICAL ? "critical" : "warning");
+    snprintf(env_value, sizeof(env_value), "SYSMON_ALERT_VALUE=%g", rule->value);
+    snprintf(env_rule, sizeof(env_rule), "SYSMON_ALERT_RULE=%s", rule->text);
+
+    // Build the environment before forking; the child only makes syscalls
+    size_t count = 0;
+    while (environ[count]) count++;
+    char **envp = malloc((count + 5) * sizeof(*envp));
+    if (!envp) return;
+    envp[0] = env_state;
+    envp[1] = env_severity;
+    envp[2] = env_value;
+    envp[3] = env_rule;
+    memcpy(envp + 4, environ, (count + 1) * sizeof(*envp));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (fork() != 0) _exit(0);
+        // The monitor blocks the signals it reads through signalfd
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        int null = open("/dev/null", O_RDWR);
+        if (null >= 0) {
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        execle("/bin/sh", "sh", "-c", exec_command, (char *)NULL, envp);
+        _exit(127);
+    }
+    if (pid > 0) waitpid(pid, NULL, 0);
+    free(envp);
+}
+
+/**
+ * @brief Record a rule transition in the log and run the hook
+ * @param rule Rule that changed state
+ * @param state "firing" or "resolved"
+ */
+static void notify(const AlertRule *rule, const char *state) {
+    if (log_file) {
+        char stamp[32];
+        struct tm tm;
+        time_t now = time(NULL);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S%z", localtime_r(&now, &tm));
+        fprintf(log_file, "%s %s %s value=%g %s\n", stamp, state,
+                rule->severity == ALERT_CRITICAL ? "critical" : "warning", rule->value, rule->text);
+        fflush(log_file);
+    }
+    if (exec_command) run_hook(rule, state);
+}
+
+/**
+ * @brief Advance a rule's state machine with this tick's condition
+ * @param rule Rule to update
+ * @param holds Whether the condition held this tick
+ * @param now Monotonic time in seconds
+ */
+static void update_rule(AlertRule *rule, int holds, double now) {
+    if (!holds) {
+        rule->pending_since = -1;
+        if (rule->firing) {
+            rule->firing = 0;
+            notify(rule, "resolved");
+        }
+        return;
+    }
+
+    if (rule->pending_since < 0) rule->pending_since = now;
+    if (!rule->firing && now - rule->pending_since >= rule->for_seconds) {
+        rule->firing = 1;
+        rule->fired_at = time(NULL);
+        notify(rule, "firing");
+    }
+}
+
+int update_alert_stats(const SystemStats *snapshot, AlertStats *alerts) {
+    if (!snapshot || !alerts) return -1;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    // Sample every referenced metric once. Collectors run on their own
+    // intervals, so a rate only moves when the metric's source updated, over
+    // the time between that update and the one before
+    for (unsigned int i = 0; i < slot_count; i++) {
+        MetricSlot *slot = &slots[i];
+        slot->value = sample_metric(snapshot, slot);
+        if (!slot->needs_rate) continue;
+        long long updated = metric_updated(snapshot, slot);
+        if (updated == slot->prev_ms) continue;
+        slot->rate = slot->has_prev && updated > slot->prev_ms && !isnan(slot->value) ?
+                     (slot->value - slot->prev) * 1000.0 / (double)(updated - slot->prev_ms) : NAN;
+        slot->prev = slot->value;
+        slot->prev_ms = updated;
+        slot->has_prev = updated > 0 && !isnan(slot->value);
+    }
+
+    // One linear pass over all rules
+    double stack[MAX_STACK];
+    int sp = 0;
+    double observed = NAN;
+    for (unsigned int pc = 0; pc < program_length; pc++) {
+        const Instruction *in = &program[pc];
+        double a, b;
+        switch (in->op) {
+        case OP_CONST: stack[sp++] = in->value; continue;
+        case OP_LOAD: stack[sp++] = slots[in->arg].value; continue;
+        case OP_RATE: stack[sp++] = slots[in->arg].rate; continue;
+        case OP_NEG: stack[sp - 1] = -stack[sp - 1]; continue;
+        case OP_END_RULE:
+            rules[in->arg].value = observed;
+            update_rule(&rules[in->arg], truthy(stack[--sp]), now);
+            observed = NAN;
+            continue;
+        default:
+            break;
+        }
+
+        // Binary operators
+        b = stack[--sp];
+        a = stack[sp - 1];
+        switch (in->op) {
+        case OP_ADD: a = a + b; break;
+        case OP_SUB: a = a - b; break;
+        case OP_MUL: a = a * b; break;
+        case OP_DIV: a = b != 0 ? a / b : NAN; break;
+        case OP_GT: observed = a; a = a > b; break;
+        case OP_GE: observed = a; a = a >= b; break;
+        case OP_LT: observed = a; a = a < b; break;
+        case OP_LE: observed = a; a = a <= b; break;
+        case OP_EQ: observed = a; a = a == b; break;
+        case OP_NE: observed = a; a = !isnan(a) && !isnan(b) && a != b; break;
+        case OP_AND: a = truthy(a) && truthy(b); break;
+        case OP_OR: a = truthy(a) || truthy(b); break;
+        default: break;
+        }
+        stack[sp - 1] = a;
+    }
+
+    memset(alerts, 0, sizeof(*alerts));
+    alerts->rule_count = rule_count;
+    for (unsigned int i = 0; i < rule_count; i++) {
+        const AlertRule *rule = &rules[i];
+        if (!rule->firing) continue;
+
+        alerts->firing++;
+        if (alerts->active_count < MAX_ACTIVE_ALERTS) {
+            ActiveAlert *active = &alerts->active[alerts->active_count++];
+            snprintf(active->rule, sizeof(active->rule), "%s", rule->text);
+            active->severity = rule->severity;
+            active->value = rule->value;
+            active->since = rule->fired_at;
+        }
+        for (int panel = 0; panel < ALERT_PANEL_COUNT; panel++) {
+            if ((rule->panel_mask & (1u << panel)) && rule->severity > alerts->panels[panel]) {
+                alerts->panels[panel] = rule->severity;
+            }
+        }
+    }
+    return 0;
+}
+
+const char *alert_error(void) {
+    return error;
+}
+
+void cleanup_alerts(void) {
+    if (log_file) fclose(log_file);
+    log_file = NULL;
+    free(exec_command);
+    exec_command = NULL;
+    rule_count = slot_count = program_length = 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file codec.c
+ * @brief Implementation of the snapshot codec
+ */
+
+#include "codec.h"
+#include <math.h>
+#include <string.h>
+
+// Scaled values and bases stay below 2^52, so their difference fits an int64
+#define CODEC_LIMIT 4503599627370496.0
+
+void codec_reset(CodecState *state, unsigned int keyframe_interval) {
+    for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) state->values.values[slot] = NAN;
+    state->time_ms = 0;
+    state->since_keyframe = 0;
+    state->keyframe_interval = keyframe_interval;
+    state->started = 0;
+}
+
+/**
+ * @brief Append an unsigned LEB128 varint
+ * @param p Output position
+ * @param v Value
+ * @return Position after the varint
+ */
+static uint8_t *put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ * @param p Input position, advanced past the varint
+ * @param end End of the input
+ * @param v Value read
+ * @return 0 on success, -1 if the varint is truncated or too long
+ */
+static int get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return -1;
+        uint8_t byte = *(*p)++;
+        *v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Map a signed value to an unsigned one with small magnitudes small
+ */
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * @brief Round to the nearest integer, halves away from zero
+ * @param v Value below CODEC_LIMIT in magnitude
+ * @return Rounded value
+ *
+ * @details Written out rather than llround() so the codec needs no libm.
+ */
+static int64_t round_scaled(double v) {
+    return (int64_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+/**
+ * @brief Scaled integer base of a slot for the INTEGER and CENTI encodings
+ * @param prev Receiver's value, NAN for none
+ * @param scale 1 or 100
+ * @param base Base to difference against
+ * @return 0 on success, -1 if the previous value is out of range
+ */
+static int scaled_base(double prev, double scale, int64_t *base) {
+    if (isnan(prev)) {
+        *base = 0;
+        return 0;
+    }
+    if (!(fabs(prev * scale) < CODEC_LIMIT)) return -1;
+    *base = round_scaled(prev * scale);
+    return 0;
+}
+
+size_t codec_encode(CodecState *state, const MetricSnapshot *next, long long time_ms, uint8_t *buf) {
+    int keyframe = !state->started ||
+                   (state->keyframe_interval && state->since_keyframe >= state->keyframe_interval);
+    uint8_t *p = buf;
+
+    if (keyframe) {
+        *p++ = CODEC_KEYFRAME;
+        p = put_varint(p, (uint64_t)time_ms);
+        state->since_keyframe = 0;
+        state->started = 1;
+    } else {
+        *p++ = CODEC_DELTA;
+        p = put_varint(p, zigzag(time_ms - state->time_ms));
+        state->since_keyframe++;
+    }
+    state->time_ms = time_ms;
+
+    int last = -1;
+    for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) {
+        double value = next->values[slot];
+        double prev = keyframe ? NAN : state->values.values[slot];
+        double decoded = value;
+        CodecEncoding encoding;
+        int64_t base, delta = 0;
+
+        if (isnan(value)) {
+            if (isnan(prev)) {
+                state->values.values[slot] = NAN;  // A keyframe drops slots without a value
+                continue;
+            }
+            encoding = CODEC_NAN;
+        } else if (fabs(value) < CODEC_LIMIT && value == (double)(int64_t)value &&
+                   scaled_base(prev, 1, &base) == 0) {
+            encoding = CODEC_INTEGER;
+            delta = (int64_t)value - base;
+            decoded = (double)(int64_t)value;
+        } else if (fabs(value * 100) < CODEC_LIMIT && scaled_base(prev, 100, &base) == 0) {
+            encoding = CODEC_CENTI;
+            int64_t centi = round_scaled(value * 100);
+            delta = centi - base;
+            decoded = centi / 100.0;
+        } else {
+            encoding = CODEC_RAW;
+        }
+
+        // Skip what the receiver already has, comparing bit patterns
+        if (!isnan(prev) && memcmp(&decoded, &prev, sizeof(double)) == 0) continue;
+
+        p = put_varint(p, (uint64_t)(slot - last - 1) << 2 | encoding);
+        if (encoding == CODEC_INTEGER || encoding == CODEC_CENTI) {
+            p = put_varint(p, zigzag(delta));
+        } else if (encoding == CODEC_RAW) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            for (int i = 0; i < 8; i++) *p++ = (uint8_t)(bits >> (8 * i));
+        }
+        state->values.values[slot] = decoded;
+        last = (int)slot;
+    }
+    return (size_t)(p - buf);
+}
+
+int codec_decode(CodecState *state, const uint8_t *frame, size_t len) {
+    const uint8_t *p = frame, *end = frame + len;
+    uint64_t v;
+
+    if (len < 2) return -1;
+    int keyframe = *p == CODEC_KEYFRAME;
+    if (!keyframe && (*p != CODEC_DELTA || !state->started)) return -1;
+    p++;
+    if (get_varint(&p, end, &v) != 0) return -1;
+
+    if (keyframe) {
+        for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) state->values.values[slot] = NAN;
+        state->time_ms = (long long)v;
+        state->started = 1;
+    } else {
+        state->time_ms += unzigzag(v);
+    }
+
+    uint64_t slot = (uint64_t)-1;
+    while (p < end) {
+        if (get_varint(&p, end, &v) != 0) return -1;
+        slot += (v >> 2) + 1;
+        if (slot >= METRIC_SLOT_COUNT) return -1;
+
+        double *value = &state->values.values[slot];
+        CodecEncoding encoding = (CodecEncoding)(v & 3);
+        double scale = encoding == CODEC_CENTI ? 100 : 1;
+        int64_t base;
+        uint64_t bits = 0;
+
+        switch (encoding) {
+        case CODEC_NAN:
+            *value = NAN;
+            break;
+        case CODEC_INTEGER:
+        case CODEC_CENTI:
+            if (scaled_base(*value, scale, &base) != 0 || get_varint(&p, end, &v) != 0) return -1;
+            *value = (double)(base + unzigzag(v)) / scale;
+            break;
+        case CODEC_RAW:
+            if (end - p < 8) return -1;
+            for (int i = 0; i < 8; i++) bits |= (uint64_t)*p++ << (8 * i);
+            memcpy(value, &bits, sizeof(bits));
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,340 @@
+/**
+ * @file config.c
+ * @brief Implementation of the INI configuration parser
+ */
+
+#include "config.h"
+#include "disk.h"
+#include "gpu.h"
+#include "network.h"
+#include "procmem.h"
+#include "workingset.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONFIG_LINE_MAX 1024
+#define MIN_INTERVAL_MS 50
+#define MAX_INTERVAL_MS 3600000
+
+const char *const collector_names[COLLECTOR_COUNT] = {
+    "cpu", "topology", "scheduler", "perf", "cpufreq",
+    "memory", "disk", "gpu", "network", "thermal", "events", "kmem", "zones", "procmem",
+    "workingset", "swap"
+};
+
+// Panel names accepted in [display] panels
+static const char *const panel_names[] = {
+    "cpu", "memory", "topology", "counters", "disk", "network", "gpu", "events", "kmem", "zones", "procmem",
+    "workingset", "swap", "plugins"
+};
+
+static char error[CONFIG_VALUE_MAX + 64] = "";
+
+/**
+ * @brief Record a parse error with its location
+ * @param path Configuration file
+ * @param line Line number
+ * @param fmt printf-style message
+ */
+static void set_error(const char *path, unsigned int line, const char *fmt, ...) {
+    int n = snprintf(error, sizeof(error), "%s:%u: ", path, line);
+    if (n < 0 || (size_t)n >= sizeof(error)) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(error + n, sizeof(error) - n, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * @brief Strip leading and trailing whitespace in place
+ * @param s String to trim
+ * @return Pointer to the first non-blank character
+ */
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1])) s[--len] = '\0';
+    return s;
+}
+
+/**
+ * @brief Parse a boolean value
+ * @param value Value text
+ * @param out Parsed value
+ * @return 0 on success, -1 if the text is not a boolean
+ */
+static int parse_bool(const char *value, int *out) {
+    if (!strcmp(value, "true") || !strcmp(value, "yes") || !strcmp(value, "on") || !strcmp(value, "1")) {
+        *out = 1;
+    } else if (!strcmp(value, "false") || !strcmp(value, "no") || !strcmp(value, "off") || !strcmp(value, "0")) {
+        *out = 0;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse an interval such as 500, 500ms, 2s or 1m (bare numbers are ms)
+ * @param value Value text
+ * @param out Interval in milliseconds
+ * @return 0 on success, -1 if the text is not a valid interval
+ */
+static int parse_interval_value(const char *value, int *out) {
+    char *end;
+    double ms = strtod(value, &end);
+    if (end == value) return -1;
+
+    if (!strcmp(end, "s")) ms *= 1000;
+    else if (!strcmp(end, "m")) ms *= 60000;
+    else if (*end && strcmp(end, "ms") != 0) return -1;
+
+    if (ms < MIN_INTERVAL_MS || ms > MAX_INTERVAL_MS) return -1;
+    *out = (int)ms;
+    return 0;
+}
+
+/**
+ * @brief Parse a positive integer
+ * @param value Value text
+ * @param max Largest accepted value
+ * @param out Parsed value
+ * @return 0 on success, -1 if the text is not in 1..max
+ */
+static int parse_count(const char *value, int max, int *out) {
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end || n < 1 || n > max) return -1;
+    *out = (int)n;
+    return 0;
+}
+
+/**
+ * @brief Copy a string value, rejecting values that do not fit
+ * @param dst Destination buffer of CONFIG_VALUE_MAX bytes
+ * @param value Value text
+ * @return 0 on success, -1 if the value is too long
+ */
+static int copy_value(char *dst, const char *value) {
+    if (strlen(value) >= CONFIG_VALUE_MAX) return -1;
+    strcpy(dst, value);
+    return 0;
+}
+
+/**
+ * @brief Check a comma-separated panel list
+ * @param value Panel list
+ * @return 0 if every name is a known panel, -1 otherwise
+ */
+static int check_panels(const char *value) {
+    const char *p = value;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        size_t i;
+        for (i = 0; i < sizeof(panel_names) / sizeof(panel_names[0]); i++) {
+            if (strlen(panel_names[i]) == len && strncmp(panel_names[i], p, len) == 0) break;
+        }
+        if (i == sizeof(panel_names) / sizeof(panel_names[0])) return -1;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Find or add the settings of a plugin section
+ * @param plugins Plugin settings being built
+ * @param name Plugin name from the section header
+ * @return Settings of the plugin, or NULL if the name is empty, too long or
+ *         there are too many plugin sections
+ */
+static PluginSettings *add_plugin_settings(PluginConfig *plugins, const char *name) {
+    if (!*name || strlen(name) >= PLUGIN_NAME_MAX) return NULL;
+    for (unsigned int i = 0; i < plugins->count; i++) {
+        if (!strcmp(plugins->settings[i].name, name)) return &plugins->settings[i];
+    }
+    if (plugins->count >= MAX_PLUGIN_SETTINGS) return NULL;
+
+    PluginSettings *plugin = &plugins->settings[plugins->count++];
+    memset(plugin, 0, sizeof(*plugin));
+    strcpy(plugin->name, name);
+    plugin->enabled = 1;
+    return plugin;
+}
+
+/**
+ * @brief Apply one key of a section
+ * @param config Configuration being built
+ * @param section Current section name
+ * @param key Key name
+ * @param value Value text
+ * @return NULL on success, otherwise a description of the problem
+ */
+static const char *apply_key(MonitorConfig *config, const char *section,
+                             const char *key, const char *value) {
+    if (!strcmp(section, "general")) {
+        if (!strcmp(key, "interval")) {
+            return parse_interval_value(value, &config->interval_ms) ? "bad interval" : NULL;
+        }
+        return "unknown key";
+    }
+
+    if (!strcmp(section, "display")) {
+        LayoutConfig *layout = &config->layout;
+        if (!strcmp(key, "panels")) {
+            if (check_panels(value) != 0) return "unknown panel";
+            return copy_value(layout->panels, value) ? "value too long" : NULL;
+        }
+        if (!strcmp(key, "width")) return parse_count(value, 1000, &layout->width) || layout->width < 70 ?
+                                           "width must be at least 70" : NULL;
+        if (!strcmp(key, "max_disks")) return parse_count(value, MAX_DISKS, &layout->max_disks) ? "bad count" : NULL;
+        if (!strcmp(key, "max_interfaces")) return parse_count(value, MAX_INTERFACES, &layout->max_interfaces) ? "bad count" : NULL;
+        if (!strcmp(key, "max_gpus")) return parse_count(value, MAX_GPUS, &layout->max_gpus) ? "bad count" : NULL;
+        return "unknown key";
+    }
+
+    if (!strcmp(section, "alerts")) {
+        char *dst = !strcmp(key, "rules") ? config->alerts.rules :
+                    !strcmp(key, "log") ? config->alerts.log :
+                    !strcmp(key, "exec") ? config->alerts.exec : NULL;
+        if (!dst) return "unknown key";
+        return copy_value(dst, value) ? "value too long" : NULL;
+    }
+
+    if (!strcmp(section, "plugins")) {
+        if (!strcmp(key, "directory")) return copy_value(config->plugins.directory, value) ? "value too long" : NULL;
+        return "unknown key";
+    }
+
+    if (!strncmp(section, "plugin.", 7)) {
+        PluginSettings *plugin = add_plugin_settings(&config->plugins, section + 7);
+        if (!plugin) return "too many plugin sections or bad plugin name";
+        if (!strcmp(key, "enabled")) return parse_bool(value, &plugin->enabled) ? "expected true or false" : NULL;
+        if (!strcmp(key, "interval")) return parse_interval_value(value, &plugin->interval_ms) ? "bad interval" : NULL;
+        if (!strcmp(key, "args")) return copy_value(plugin->args, value) ? "value too long" : NULL;
+        return "unknown key";
+    }
+
+    for (int id = 0; id < COLLECTOR_COUNT; id++) {
+        if (strcmp(section, collector_names[id]) != 0) continue;
+
+        CollectorConfig *collector = &config->collectors[id];
+        if (!strcmp(key, "enabled")) return parse_bool(value, &collector->enabled) ? "expected true or false" : NULL;
+        if (!strcmp(key, "interval")) return parse_interval_value(value, &collector->interval_ms) ? "bad interval" : NULL;
+
+        DeviceFilter *filter = id == COLLECTOR_DISK ? &config->disk_filter :
+                               id == COLLECTOR_NETWORK ? &config->network_filter : NULL;
+        if (filter && !strcmp(key, "include")) return copy_value(filter->include, value) ? "value too long" : NULL;
+        if (filter && !strcmp(key, "exclude")) return copy_value(filter->exclude, value) ? "value too long" : NULL;
+        if (id == COLLECTOR_EVENTS && !strcmp(key, "path")) return copy_value(config->kmsg_path, value) ? "value too long" : NULL;
+        if (id == COLLECTOR_PROCMEM && !strcmp(key, "top")) {
+            return parse_count(value, MAX_MEMORY_PROCESSES, &config->procmem_top) ? "bad count" : NULL;
+        }
+        if (id == COLLECTOR_PROCMEM && !strcmp(key, "budget")) {
+            return parse_count(value, MAX_MEMORY_PROCESSES, &config->procmem_budget) ? "bad count" : NULL;
+        }
+        if (id == COLLECTOR_WORKINGSET && !strcmp(key, "window")) {
+            return parse_interval_value(value, &config->workingset_window_ms) ? "bad interval" : NULL;
+        }
+        return "unknown key";
+    }
+    return "unknown section";
+}
+
+void default_config(MonitorConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->interval_ms = 1000;
+    for (int id = 0; id < COLLECTOR_COUNT; id++) config->collectors[id].enabled = 1;
+    config->layout.width = 70;
+    config->layout.max_disks = 2;
+    config->layout.max_interfaces = 2;
+    config->layout.max_gpus = 2;
+    config->procmem_top = DEFAULT_PROCMEM_TOP;
+    config->procmem_budget = DEFAULT_PROCMEM_BUDGET;
+    config->workingset_window_ms = DEFAULT_WORKINGSET_WINDOW_MS;
+    config->collectors[COLLECTOR_WORKINGSET].enabled = 0;  // Sweeping idle pages costs page table walks
+}
+
+int load_config(const char *path, MonitorConfig *config) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        snprintf(error, sizeof(error), "%s: cannot open", path);
+        return -1;
+    }
+
+    MonitorConfig parsed;
+    default_config(&parsed);
+
+    char line[CONFIG_LINE_MAX];
+    char section[64] = "general";
+    unsigned int line_no = 0;
+    int ret = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char *text = trim(line);
+        if (!*text || *text == '#' || *text == ';') continue;
+
+        if (*text == '[') {
+            char *close = strchr(text, ']');
+            if (!close || close[1]) {
+                set_error(path, line_no, "expected [section]");
+                ret = -1;
+                break;
+            }
+            *close = '\0';
+            snprintf(section, sizeof(section), "%s", trim(text + 1));
+            continue;
+        }
+
+        char *eq = strchr(text, '=');
+        if (!eq) {
+            set_error(path, line_no, "expected key = value");
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+        char *key = trim(text);
+        char *value = trim(eq + 1);
+
+        // Quotes are optional, but keep leading or trailing blanks
+        size_t len = strlen(value);
+        if (len >= 2 && (value[0] == '"' || value[0] == '\'') && value[len - 1] == value[0]) {
+            value[len - 1] = '\0';
+            value++;
+        }
+
+        const char *problem = apply_key(&parsed, section, key, value);
+        if (problem) {
+            set_error(path, line_no, "[%s] %s: %s", section, key, problem);
+            ret = -1;
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (ret == 0) {
+        *config = parsed;
+        error[0] = '\0';
+    }
+    return ret;
+}
+
+const char *config_error(void) {
+    return error;
+}
+
+int collector_interval(const MonitorConfig *config, CollectorId id) {
+    int interval = config->collectors[id].interval_ms;
+    return interval > 0 ? interval : config->interval_ms;
+}
+
+const PluginSettings *plugin_settings(const MonitorConfig *config, const char *name) {
+    for (unsigned int i = 0; i < config->plugins.count; i++) {
+        if (!strcmp(config->plugins.settings[i].name, name)) return &config->plugins.settings[i];
+    }
+    return NULL;
+}
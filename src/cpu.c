@@ -5,35 +5,133 @@
 
 #include "cpu.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 
-// Static variables for CPU usage calculation
-static unsigned long long prev_idle = 0;
-static unsigned long long prev_total = 0;
+/**
+ * @brief Counters of the previous read, used to turn totals into rates
+ */
+struct CPUMonitor {
+    unsigned long long prev_idle;
+    unsigned long long prev_total;
+    unsigned long long prev_cpu_idle[MAX_CPUS];
+    unsigned long long prev_cpu_total[MAX_CPUS];
+    unsigned long long prev_ctxt;
+    unsigned long long prev_forks;
+    struct timespec prev_read;
+    char model_name[256];  // Read once; the CPU model does not change
+};
 
 /**
- * @brief Read CPU statistics from /proc/stat
+ * @brief Parse the counters of one "cpu" line of /proc/stat
+ * @param line Line contents following the "cpu" or "cpuN" label
  * @param idle Pointer to store idle time
  * @param total Pointer to store total time
  * @return 0 on success, -1 on failure
  */
-static int read_cpu_stats(unsigned long long *idle, unsigned long long *total) {
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp) return -1;
-
+static int parse_cpu_line(const char *line, unsigned long long *idle, unsigned long long *total) {
     unsigned long long user, nice, system, idle_time, iowait, irq, softirq, steal;
-    if (fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+    if (sscanf(line, "%llu %llu %llu %llu %llu %llu %llu %llu",
                &user, &nice, &system, &idle_time, &iowait, &irq, &softirq, &steal) != 8) {
-        fclose(fp);
         return -1;
     }
 
     *idle = idle_time + iowait;
     *total = *idle + user + nice + system + irq + softirq + steal;
+    return 0;
+}
+
+/**
+ * @brief Compute usage from the change in idle and total time
+ * @param idle Current idle time
+ * @param total Current total time
+ * @param prev_idle_time Previous idle time; updated
+ * @param prev_total_time Previous total time; updated
+ * @return Usage percentage, or a negative value before the first interval
+ */
+static double usage_delta(unsigned long long idle, unsigned long long total,
+                          unsigned long long *prev_idle_time, unsigned long long *prev_total_time) {
+    double usage = -1;
+
+    if (*prev_total_time != 0 && total > *prev_total_time) {
+        unsigned long long total_diff = total - *prev_total_time;
+        unsigned long long idle_diff = idle - *prev_idle_time;
+        usage = 100.0 * (1.0 - ((double)idle_diff / total_diff));
+    }
+
+    *prev_idle_time = idle;
+    *prev_total_time = total;
+    return usage;
+}
+
+/**
+ * @brief Turn a cumulative counter into a per-second rate
+ * @param value Current counter value
+ * @param prev Previous value; updated
+ * @param seconds Time since the previous read, or 0 before the first one
+ * @return Rate per second, 0 before the first interval
+ */
+static double counter_rate(unsigned long long value, unsigned long long *prev, double seconds) {
+    double rate = (seconds > 0 && *prev != 0 && value >= *prev) ? (value - *prev) / seconds : 0;
+    *prev = value;
+    return rate;
+}
+
+/**
+ * @brief Read usage, context switch, fork and run-queue counters from /proc/stat
+ * @param monitor Counters of the previous read; updated
+ * @param stats Pointer to CPUStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+static int read_cpu_stats(CPUMonitor *monitor, CPUStats *stats) {
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) return -1;
+
+    char line[512];
+    int found = 0;
+    unsigned long long idle, total, value;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = monitor->prev_read.tv_sec ? (now.tv_sec - monitor->prev_read.tv_sec) +
+                                                 (now.tv_nsec - monitor->prev_read.tv_nsec) / 1e9 : 0;
+    monitor->prev_read = now;
+
+    // CPUs missing from this read (offline, or beyond the last one listed) keep no stale value
+    for (unsigned int i = 0; i < MAX_CPUS; i++) stats->cpu_usage[i] = -1;
+    stats->cpu_count = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned int cpu;
+        int consumed = 0;
+
+        if (strncmp(line, "cpu ", 4) == 0) {
+            if (parse_cpu_line(line + 4, &idle, &total) != 0) break;
+            double usage = usage_delta(idle, total, &monitor->prev_idle, &monitor->prev_total);
+            if (usage >= 0) stats->usage = usage;
+            found = 1;
+        } else if (sscanf(line, "cpu%u %n", &cpu, &consumed) == 1 && consumed > 0) {
+            if (cpu >= MAX_CPUS || parse_cpu_line(line + consumed, &idle, &total) != 0) continue;
+            // Stays -1 until the CPU has a full interval, so averages skip it
+            stats->cpu_usage[cpu] = usage_delta(idle, total, &monitor->prev_cpu_idle[cpu],
+                                                &monitor->prev_cpu_total[cpu]);
+            if (cpu + 1 > stats->cpu_count) stats->cpu_count = cpu + 1;
+        } else if (sscanf(line, "ctxt %llu", &value) == 1) {
+            stats->context_switches = counter_rate(value, &monitor->prev_ctxt, seconds);
+        } else if (sscanf(line, "processes %llu", &value) == 1) {
+            stats->forks = counter_rate(value, &monitor->prev_forks, seconds);
+        } else if (sscanf(line, "procs_running %llu", &value) == 1) {
+            stats->procs_running = (unsigned int)value;
+        } else if (sscanf(line, "procs_blocked %llu", &value) == 1) {
+            stats->procs_blocked = (unsigned int)value;
+            break;  // Last line we need; softirq follows
+        }
+    }
 
     fclose(fp);
-    return 0;
+    return found ? 0 : -1;
 }
 
 /**
@@ -69,44 +167,30 @@ static int get_cpu_model(char *model_name, size_t size) {
     return -1;
 }
 
-int init_cpu_monitor(void) {
-    prev_idle = 0;
-    prev_total = 0;
-    return 0;
+CPUMonitor *create_cpu_monitor(void) {
+    CPUMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    if (get_cpu_model(monitor->model_name, sizeof(monitor->model_name)) != 0) {
+        strcpy(monitor->model_name, "Unknown CPU");
+    }
+    return monitor;
 }
 
-int update_cpu_stats(CPUStats *stats) {
-    if (!stats) return -1;
+int update_cpu_stats(CPUMonitor *monitor, CPUStats *stats) {
+    if (!monitor || !stats) return -1;
 
-    // Get CPU model name (only if not already set)
-    if (stats->model_name[0] == '\0') {
-        if (get_cpu_model(stats->model_name, sizeof(stats->model_name)) != 0) {
-            strcpy(stats->model_name, "Unknown CPU");
-        }
-    }
+    memcpy(stats->model_name, monitor->model_name, sizeof(stats->model_name));
 
     // Get number of CPU cores
     stats->cores = sysconf(_SC_NPROCESSORS_ONLN);
 
-    // Get CPU usage
-    unsigned long long idle, total;
-    if (read_cpu_stats(&idle, &total) != 0) return -1;
-
-    if (prev_total != 0) {
-        unsigned long long total_diff = total - prev_total;
-        unsigned long long idle_diff = idle - prev_idle;
-
-        if (total_diff > 0) {
-            stats->usage = 100.0 * (1.0 - ((double)idle_diff / total_diff));
-        }
-    }
-
-    prev_idle = idle;
-    prev_total = total;
+    // Get total and per-CPU usage and the scheduler counters
+    if (read_cpu_stats(monitor, stats) != 0) return -1;
 
     return 0;
 }
 
-void cleanup_cpu_monitor(void) {
-    // Nothing to clean up for now
-} 
\ No newline at end of file
+void destroy_cpu_monitor(CPUMonitor *monitor) {
+    free(monitor);
+}
@@ -0,0 +1,287 @@
+/**
+ * @file cpufreq.c
+ * @brief Implementation of CPU frequency and idle state monitoring
+ */
+
+#include "cpufreq.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#define MSR_IA32_MPERF 0xE7
+#define MSR_IA32_APERF 0xE8
+
+/**
+ * @brief Open descriptors and previous counter values of one CPU
+ */
+typedef struct {
+    unsigned int cpu;
+    int cur_fd;                                     // cpufreq/scaling_cur_freq
+    int msr_fd;                                     // /dev/cpu/N/msr, -1 without permission
+    int idle_time_fds[MAX_CSTATES];                 // cpuidle/stateN/time (µs)
+    int idle_usage_fds[MAX_CSTATES];                // cpuidle/stateN/usage (entries)
+    unsigned long long prev_time[MAX_CSTATES];
+    unsigned long long prev_usage[MAX_CSTATES];
+    unsigned long long prev_aperf;
+    unsigned long long prev_mperf;
+} FreqCPU;
+
+/**
+ * @brief Per-CPU descriptors and the properties shared by all CPUs
+ */
+struct CPUFreqMonitor {
+    FreqCPU *freq_cpus;
+    unsigned int freq_cpu_count;
+    CStateStats cstate_info[MAX_CSTATES];  // Names and latencies, shared by all CPUs
+    unsigned int cstate_index[MAX_CSTATES]; // N of cpuidle/stateN for each entry of cstate_info
+    unsigned int cstate_count;
+    char driver[MAX_GOVERNOR_NAME];
+    int governor_fd;
+    unsigned int hw_max_mhz;
+    unsigned int base_mhz;                 // Nominal frequency MPERF ticks at
+    struct timespec prev_time;
+    int primed;
+};
+
+/**
+ * @brief Read a model-specific register
+ * @param fd Descriptor of /dev/cpu/N/msr
+ * @param reg Register number
+ * @param value Pointer to store the value
+ * @return 0 on success, -1 on failure
+ */
+static int read_msr(int fd, unsigned int reg, unsigned long long *value) {
+    return pread(fd, value, sizeof(*value), reg) == sizeof(*value) ? 0 : -1;
+}
+
+/**
+ * @brief Read the idle state names and exit latencies from the first CPU
+ * @param monitor Monitor to fill
+ * @param cpu CPU number to read from
+ */
+static void discover_cstates(CPUFreqMonitor *monitor, unsigned int cpu) {
+    unsigned int *states = monitor->cstate_index;
+    char path[256];
+
+    // The state numbers need not start at 0 or be contiguous
+    char dir[128];
+    snprintf(dir, sizeof(dir), "/sys/devices/system/cpu/cpu%u/cpuidle", cpu);
+    monitor->cstate_count = sysfs_list_indices(dir, "state", "", states, MAX_CSTATES);
+
+    for (unsigned int i = 0; i < monitor->cstate_count; i++) {
+        CStateStats *state = &monitor->cstate_info[i];
+        unsigned long long latency = 0;
+
+        memset(state, 0, sizeof(*state));
+        snprintf(path, sizeof(path), "%s/state%u/name", dir, states[i]);
+        if (sysfs_read_string(path, state->name, sizeof(state->name)) != 0) {
+            snprintf(state->name, sizeof(state->name), "state%u", states[i]);
+        }
+        snprintf(path, sizeof(path), "%s/state%u/latency", dir, states[i]);
+        sysfs_read_ull(path, &latency);
+        state->latency_us = (unsigned int)latency;
+    }
+}
+
+/**
+ * @brief Open the frequency, MSR and idle descriptors of one CPU
+ * @param monitor Monitor the CPU belongs to
+ * @param fc Descriptor set to fill
+ * @param cpu Logical CPU number
+ * @return 0 on success, -1 if the CPU exposes neither cpufreq nor cpuidle
+ */
+static int open_cpu(const CPUFreqMonitor *monitor, FreqCPU *fc, unsigned int cpu) {
+    char path[256];
+    int any = 0;
+
+    fc->cpu = cpu;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", cpu);
+    fc->cur_fd = sysfs_open(path);
+    if (fc->cur_fd >= 0) any = 1;
+
+    // Needs CAP_SYS_RAWIO and the msr module; silently skipped otherwise
+    snprintf(path, sizeof(path), "/dev/cpu/%u/msr", cpu);
+    fc->msr_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    for (unsigned int i = 0; i < MAX_CSTATES; i++) {
+        fc->idle_time_fds[i] = fc->idle_usage_fds[i] = -1;
+        if (i >= monitor->cstate_count) continue;
+        unsigned int state = monitor->cstate_index[i];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpuidle/state%u/time", cpu, state);
+        fc->idle_time_fds[i] = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpuidle/state%u/usage", cpu, state);
+        fc->idle_usage_fds[i] = sysfs_open(path);
+        if (fc->idle_time_fds[i] >= 0) any = 1;
+    }
+
+    if (!any && fc->msr_fd < 0) return -1;
+    return 0;
+}
+
+/**
+ * @brief Close every descriptor of one CPU
+ * @param fc Descriptor set
+ */
+static void close_cpu(FreqCPU *fc) {
+    sysfs_close(&fc->cur_fd);
+    sysfs_close(&fc->msr_fd);
+    for (unsigned int i = 0; i < MAX_CSTATES; i++) {
+        sysfs_close(&fc->idle_time_fds[i]);
+        sysfs_close(&fc->idle_usage_fds[i]);
+    }
+}
+
+/**
+ * @brief Return the growth of a counter and remember the new value
+ * @param primed Whether the previous value is valid
+ * @param value Current value
+ * @param prev Previous value; updated
+ * @return Increase since the previous read, 0 before the first interval or after a reset
+ */
+static unsigned long long counter_delta(int primed, unsigned long long value, unsigned long long *prev) {
+    unsigned long long delta = (primed && value > *prev) ? value - *prev : 0;
+    *prev = value;
+    return delta;
+}
+
+CPUFreqMonitor *create_cpufreq_monitor(void) {
+    unsigned int cpus[MAX_CPUS];
+    unsigned long long value;
+    char path[256];
+
+    CPUFreqMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+    monitor->governor_fd = -1;
+
+    unsigned int count = sysfs_list_indices("/sys/devices/system/cpu", "cpu", "", cpus, MAX_CPUS);
+    if (count == 0) return monitor;
+
+    discover_cstates(monitor, cpus[0]);
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_driver", cpus[0]);
+    sysfs_read_string(path, monitor->driver, sizeof(monitor->driver));
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_governor", cpus[0]);
+    monitor->governor_fd = sysfs_open(path);
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", cpus[0]);
+    if (sysfs_read_ull(path, &value) == 0) monitor->hw_max_mhz = (unsigned int)(value / 1000);
+
+    // MPERF counts at the nominal (base) frequency; fall back to the maximum
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/base_frequency", cpus[0]);
+    monitor->base_mhz = sysfs_read_ull(path, &value) == 0 ? (unsigned int)(value / 1000)
+                                                          : monitor->hw_max_mhz;
+
+    monitor->freq_cpus = calloc(count, sizeof(*monitor->freq_cpus));
+    if (!monitor->freq_cpus) {
+        destroy_cpufreq_monitor(monitor);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        FreqCPU *fc = &monitor->freq_cpus[monitor->freq_cpu_count];
+        if (open_cpu(monitor, fc, cpus[i]) == 0) {
+            monitor->freq_cpu_count++;
+        } else {
+            close_cpu(fc);
+        }
+    }
+
+    return monitor;
+}
+
+int update_cpufreq_stats(CPUFreqMonitor *monitor, CPUFreqStats *stats) {
+    if (!monitor || !stats) return -1;
+
+    int primed = monitor->primed;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double interval_us = (now.tv_sec - monitor->prev_time.tv_sec) * 1e6 +
+                         (now.tv_nsec - monitor->prev_time.tv_nsec) / 1e3;
+    monitor->prev_time = now;
+
+    unsigned long long mhz_sum = 0;
+    unsigned int mhz_count = 0;
+    char buf[MAX_GOVERNOR_NAME];
+
+    stats->count = monitor->freq_cpu_count;
+    stats->min_mhz = 0;
+    stats->max_mhz = 0;
+    stats->hw_max_mhz = monitor->hw_max_mhz;
+    stats->msr_available = 0;
+    memcpy(stats->driver, monitor->driver, sizeof(stats->driver));
+    if (sysfs_pread(monitor->governor_fd, buf, sizeof(buf)) > 0) {
+        memcpy(stats->governor, buf, sizeof(stats->governor));
+    } else {
+        stats->governor[0] = '\0';
+    }
+
+    stats->cstate_count = monitor->cstate_count;
+    for (unsigned int s = 0; s < monitor->cstate_count; s++) {
+        stats->cstates[s] = monitor->cstate_info[s];
+    }
+
+    for (unsigned int i = 0; i < monitor->freq_cpu_count; i++) {
+        FreqCPU *fc = &monitor->freq_cpus[i];
+        CPUCoreFreq *core = &stats->cores[i];
+        unsigned long long value;
+
+        core->cpu = fc->cpu;
+        core->cur_mhz = 0;
+        core->effective_mhz = 0;
+        if (sysfs_pread_ull(fc->cur_fd, &value) == 0) {
+            core->cur_mhz = (unsigned int)(value / 1000);
+            mhz_sum += core->cur_mhz;
+            mhz_count++;
+            if (stats->min_mhz == 0 || core->cur_mhz < stats->min_mhz) stats->min_mhz = core->cur_mhz;
+            if (core->cur_mhz > stats->max_mhz) stats->max_mhz = core->cur_mhz;
+        }
+
+        // APERF/MPERF ratio scales the base frequency to the delivered one
+        unsigned long long aperf, mperf;
+        if (fc->msr_fd >= 0 && read_msr(fc->msr_fd, MSR_IA32_APERF, &aperf) == 0 &&
+            read_msr(fc->msr_fd, MSR_IA32_MPERF, &mperf) == 0) {
+            unsigned long long da = counter_delta(primed, aperf, &fc->prev_aperf);
+            unsigned long long dm = counter_delta(primed, mperf, &fc->prev_mperf);
+            if (dm > 0) core->effective_mhz = (unsigned int)(monitor->base_mhz * (double)da / dm);
+            stats->msr_available = 1;
+        }
+
+        double idle = 0;
+        for (unsigned int s = 0; s < monitor->cstate_count; s++) {
+            core->residency[s] = 0;
+            if (sysfs_pread_ull(fc->idle_time_fds[s], &value) == 0) {
+                unsigned long long dt = counter_delta(primed, value, &fc->prev_time[s]);
+                if (primed && interval_us > 0) core->residency[s] = 100.0 * dt / interval_us;
+                if (core->residency[s] > 100) core->residency[s] = 100;
+                idle += core->residency[s];
+                stats->cstates[s].residency += core->residency[s];
+            }
+            if (sysfs_pread_ull(fc->idle_usage_fds[s], &value) == 0) {
+                unsigned long long entries = counter_delta(primed, value, &fc->prev_usage[s]);
+                if (primed && interval_us > 0) stats->cstates[s].entries_per_sec += entries * 1e6 / interval_us;
+            }
+        }
+        core->active = (primed && idle < 100) ? 100 - idle : 0;
+    }
+
+    if (monitor->freq_cpu_count > 0) {
+        for (unsigned int s = 0; s < monitor->cstate_count; s++) {
+            stats->cstates[s].residency /= monitor->freq_cpu_count;
+        }
+    }
+    stats->avg_mhz = mhz_count ? (unsigned int)(mhz_sum / mhz_count) : 0;
+    monitor->primed = 1;
+    return 0;
+}
+
+void destroy_cpufreq_monitor(CPUFreqMonitor *monitor) {
+    if (!monitor) return;
+    for (unsigned int i = 0; i < monitor->freq_cpu_count; i++) close_cpu(&monitor->freq_cpus[i]);
+    free(monitor->freq_cpus);
+    sysfs_close(&monitor->governor_fd);
+    free(monitor);
+}
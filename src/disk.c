@@ -5,15 +5,21 @@
 
 #include "disk.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/statvfs.h>
 #include <mntent.h>
 #include <unistd.h>
 #include <ctype.h>
 
-// Static variables for disk I/O statistics
-static unsigned long prev_reads[MAX_DISKS] = {0};
-static unsigned long prev_writes[MAX_DISKS] = {0};
+/**
+ * @brief Mount point selection and I/O counters of the previous update
+ */
+struct DiskMonitor {
+    DeviceFilter filter;
+    unsigned long prev_reads[MAX_DISKS];
+    unsigned long prev_writes[MAX_DISKS];
+};
 
 /**
  * @brief Check if a device name corresponds to a real disk
@@ -89,24 +95,29 @@ static int get_disk_io_stats(const char *device, unsigned long *reads,
     return -1;
 }
 
-int init_disk_monitor(void) {
-    memset(prev_reads, 0, sizeof(prev_reads));
-    memset(prev_writes, 0, sizeof(prev_writes));
-    return 0;
+DiskMonitor *create_disk_monitor(const DeviceFilter *filter) {
+    DiskMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+    if (filter) monitor->filter = *filter;
+    return monitor;
 }
 
-int update_disk_stats(DiskInfo *info) {
-    if (!info) return -1;
+int update_disk_stats(DiskMonitor *monitor, DiskInfo *info) {
+    if (!monitor || !info) return -1;
 
     FILE *mtab = setmntent("/etc/mtab", "r");
     if (!mtab) return -1;
 
+    // getmntent() returns a static entry; monitors may run on several threads
+    struct mntent entry;
     struct mntent *ent;
+    char strings[1024];
     info->count = 0;
 
-    while ((ent = getmntent(mtab)) && info->count < MAX_DISKS) {
+    while ((ent = getmntent_r(mtab, &entry, strings, sizeof(strings))) && info->count < MAX_DISKS) {
         // Skip non-disk filesystems
         if (!is_real_disk(ent->mnt_fsname)) continue;
+        if (!filter_match(&monitor->filter, ent->mnt_dir)) continue;
 
         DiskStats *disk = &info->disks[info->count];
         struct statvfs fs_stats;
@@ -132,12 +143,12 @@ int update_disk_stats(DiskInfo *info) {
             // Get I/O statistics
             unsigned long reads, writes, io_in_progress;
             if (get_disk_io_stats(disk->device, &reads, &writes, &io_in_progress) == 0) {
-                disk->reads = reads - prev_reads[info->count];
-                disk->writes = writes - prev_writes[info->count];
+                disk->reads = reads - monitor->prev_reads[info->count];
+                disk->writes = writes - monitor->prev_writes[info->count];
                 disk->io_in_progress = io_in_progress;
                 
-                prev_reads[info->count] = reads;
-                prev_writes[info->count] = writes;
+                monitor->prev_reads[info->count] = reads;
+                monitor->prev_writes[info->count] = writes;
             } else {
                 disk->reads = 0;
                 disk->writes = 0;
@@ -152,6 +163,6 @@ int update_disk_stats(DiskInfo *info) {
     return 0;
 }
 
-void cleanup_disk_monitor(void) {
-    // Nothing to clean up for now
+void destroy_disk_monitor(DiskMonitor *monitor) {
+    free(monitor);
 } 
\ No newline at end of file
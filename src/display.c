@@ -4,15 +4,26 @@
  */
 
 #include "system_monitor.h"
+#include <math.h>
 #include <stdio.h>
+#include <time.h>
 
 // Window dimensions and positions
 #define HEADER_HEIGHT 3
-#define CPU_WIN_HEIGHT 6
-#define MEM_WIN_HEIGHT 7
-#define DISK_WIN_HEIGHT 8
-#define NET_WIN_HEIGHT 8
-#define GPU_WIN_HEIGHT 8
+#define CPU_WIN_HEIGHT 11
+#define MEM_WIN_HEIGHT 8
+#define DISK_WIN_HEIGHT 9  // Two disks; grows with max_disks
+#define NET_WIN_HEIGHT 9   // Two interfaces; grows with max_interfaces
+#define GPU_WIN_HEIGHT 12
+#define TOPO_WIN_HEIGHT 8
+#define PERF_WIN_HEIGHT 8
+#define EVENTS_WIN_HEIGHT 9
+#define KMEM_WIN_HEIGHT 15
+#define ZONES_WIN_HEIGHT 9   // Four zones
+#define PROCMEM_WIN_HEIGHT 14  // Ten processes
+#define WORKINGSET_WIN_HEIGHT 14  // Eight cgroups
+#define SWAP_WIN_HEIGHT 14  // Four swap areas and four zram devices
+#define PLUGIN_WIN_MAX_HEIGHT 20  // Grows with the loaded plugins up to this
 #define WIN_WIDTH 70
 #define PADDING 1
 
@@ -26,11 +37,16 @@
 
 // Global window pointers
 static WINDOW *header_win = NULL;
-static WINDOW *cpu_win = NULL;
-static WINDOW *mem_win = NULL;
-static WINDOW *disk_win = NULL;
-static WINDOW *net_win = NULL;
-static WINDOW *gpu_win = NULL;
+
+// Terminal size the current layout was computed for
+static int layout_lines = 0;
+static int layout_cols = 0;
+
+// Panel selection and sizing from the configuration
+static LayoutConfig layout = {"", WIN_WIDTH, 2, 2, 2};
+
+// Header status message, e.g. a failed configuration reload
+static char status[64] = "";
 
 /**
  * @brief Convert bytes to human readable format
@@ -70,35 +86,1079 @@ static void format_speed(double bytes_per_sec, char *buf, size_t size) {
     snprintf(buf, size, "%.1f %s", speed, units[i]);
 }
 
+/**
+ * @brief Render recent percentage samples as a one-line ASCII sparkline
+ * @param samples Samples in percent, oldest first
+ * @param count Number of samples
+ * @param buf Buffer to store the result
+ * @param width Maximum number of characters to render (buffer must hold width + 1)
+ */
+static void format_sparkline(const unsigned int *samples, unsigned int count,
+                             char *buf, unsigned int width) {
+    static const char levels[] = " .:-=+*#";
+    unsigned int start = count > width ? count - width : 0;
+    unsigned int n = 0;
+
+    for (unsigned int i = start; i < count; i++) {
+        unsigned int v = samples[i] > 100 ? 100 : samples[i];
+        buf[n++] = levels[v * (sizeof(levels) - 2) / 100];
+    }
+    buf[n] = '\0';
+}
+
 /**
  * @brief Draw a fancy box around a window
  * @param win Window to draw box around
  * @param title Title of the box
+ * @param color Colour pair of the border
  */
-static void draw_fancy_box(WINDOW *win, const char *title) {
+static void draw_fancy_box(WINDOW *win, const char *title, int color) {
     int width, height;
     getmaxyx(win, height, width);
     (void)height;  // Suppress unused variable warning
     
-    wattron(win, COLOR_PAIR(COLOR_BORDER) | A_BOLD);
+    wattron(win, COLOR_PAIR(color) | A_BOLD);
     box(win, 0, 0);
     mvwprintw(win, 0, (width - strlen(title) - 4) / 2, "┤ %s ├", title);
-    wattroff(win, COLOR_PAIR(COLOR_BORDER) | A_BOLD);
+    wattroff(win, COLOR_PAIR(color) | A_BOLD);
+}
+
+/**
+ * @brief Pick the border colour for an alert severity
+ * @param severity Highest severity firing on the panel
+ * @return Colour pair number
+ */
+static int alert_color(AlertSeverity severity) {
+    if (severity == ALERT_CRITICAL) return COLOR_CRITICAL;
+    if (severity == ALERT_WARNING) return COLOR_WARNING;
+    return COLOR_BORDER;
+}
+
+/**
+ * @brief Draw the CPU panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_cpu_panel(WINDOW *win, const SystemStats *stats) {
+    int row = 1;
+    mvwprintw(win, row++, 2, "CPU Usage: ");
+    wattron(win, A_BOLD);
+    wprintw(win, "%.1f%%", stats->cpu.usage);
+    wattroff(win, A_BOLD);
+    mvwprintw(win, row++, 2, "Model: %s", stats->cpu.model_name);
+    mvwprintw(win, row++, 2, "Cores: %u", stats->cpu.cores);
+    
+    // Scheduler saturation: load, run queue and time spent waiting for a CPU
+    const SchedulerStats *sched = &stats->scheduler;
+    mvwprintw(win, row++, 2, "Load: %.2f %.2f %.2f  Running: %u  Blocked: %u",
+              sched->load1, sched->load5, sched->load15,
+              stats->cpu.procs_running, stats->cpu.procs_blocked);
+    mvwprintw(win, row, 2, "Ctx/s: %.0f  Forks/s: %.0f", stats->cpu.context_switches, stats->cpu.forks);
+    if (sched->schedstat_available) {
+        // More than 1 ms of waiting per ms of wall time means tasks queue behind each other
+        int color = sched->max_run_delay >= 1000 ? COLOR_CRITICAL :
+                    sched->max_run_delay >= 100 ? COLOR_WARNING : COLOR_NORMAL;
+        wprintw(win, "  Runq wait: ");
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%.1f ms/s", sched->total_run_delay);
+        wattroff(win, COLOR_PAIR(color));
+        wprintw(win, " (%.0f us/slice)", sched->avg_wait_per_slice);
+    }
+    row++;
+    
+    // Frequency and idle states, when cpufreq/cpuidle are present
+    const CPUFreqStats *freq = &stats->cpufreq;
+    if (freq->avg_mhz > 0) {
+        mvwprintw(win, row, 2, "Freq: %u MHz avg (%u-%u", freq->avg_mhz, freq->min_mhz, freq->max_mhz);
+        if (freq->hw_max_mhz > 0) wprintw(win, ", max %u", freq->hw_max_mhz);
+        wprintw(win, ")");
+        if (freq->governor[0]) wprintw(win, "  %s/%s", freq->driver, freq->governor);
+    }
+    row++;
+    if (freq->cstate_count > 0) {
+        mvwprintw(win, row, 2, "Idle:");
+        for (unsigned int s = 0; s < freq->cstate_count; s++) {
+            if (freq->cstates[s].residency < 0.5) continue;
+            wprintw(win, " %s %.0f%%", freq->cstates[s].name, freq->cstates[s].residency);
+        }
+    }
+    row++;
+    
+    // Temperature and throttling, when the platform exposes them
+    const ThermalStats *thermal = &stats->thermal;
+    if (thermal->package_temp > 0 || thermal->core_temp_max > 0) {
+        mvwprintw(win, row, 2, "Temp: ");
+        if (thermal->package_temp > 0) {
+            int color = thermal->throttling ? COLOR_CRITICAL :
+                        thermal->package_temp >= 85 ? COLOR_WARNING : COLOR_NORMAL;
+            wattron(win, COLOR_PAIR(color));
+            wprintw(win, "Package %.0f°C  ", thermal->package_temp);
+            wattroff(win, COLOR_PAIR(color));
+        }
+        if (thermal->core_temp_max > 0) {
+            wprintw(win, "Cores max %.0f°C avg %.0f°C", thermal->core_temp_max, thermal->core_temp_avg);
+        }
+    }
+    row++;
+    if (thermal->throttling) {
+        wattron(win, COLOR_PAIR(COLOR_CRITICAL) | A_BOLD);
+        // Core time is summed over CPUs, so it is CPU time rather than a duration
+        mvwprintw(win, row, 2, "THROTTLING: %lu core on %u CPUs",
+                  thermal->core_throttle_events, thermal->throttling_cpus);
+        if (thermal->core_throttle_ms > 0) wprintw(win, " (%llu CPU-ms)", thermal->core_throttle_ms);
+        wprintw(win, ", %lu package", thermal->package_throttle_events);
+        if (thermal->package_throttle_ms > 0) wprintw(win, " (%llu ms)", thermal->package_throttle_ms);
+        wattroff(win, COLOR_PAIR(COLOR_CRITICAL) | A_BOLD);
+    } else if (thermal->core_throttle_count || thermal->package_throttle_count) {
+        mvwprintw(win, row, 2, "Throttle events since boot: %llu core, %llu package",
+                  thermal->core_throttle_count, thermal->package_throttle_count);
+    }
+    row++;
+}
+
+/**
+ * @brief Pick the colour pair for a usage percentage
+ * @param usage Usage in percent
+ * @return Colour pair number
+ */
+static int usage_color(double usage) {
+    if (usage >= 90) return COLOR_CRITICAL;
+    if (usage >= 70) return COLOR_WARNING;
+    return COLOR_NORMAL;
+}
+
+/**
+ * @brief Draw the CPU topology panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details Each L3 domain is drawn as a cell with its average usage followed
+ * by one character per physical core, so a busy core or a saturated L3
+ * stands out even with hundreds of CPUs. Cells wrap to fill the panel.
+ */
+static void draw_topology_panel(WINDOW *win, const SystemStats *stats) {
+    static const char levels[] = "_.:-=+*#";  // Idle cores stay visible
+    const TopologyStats *topo = &stats->topology;
+    int height, width;
+    getmaxyx(win, height, width);
+    int right = width - 2;
+    int row = 1;
+
+    mvwprintw(win, row, 2, "%u cores x %u threads  ", topo->core_count, topo->threads_per_core);
+    for (unsigned int p = 0; p < topo->package_count; p++) {
+        const TopologyGroup *pkg = &topo->packages[p];
+        wprintw(win, " Pkg%u ", pkg->id);
+        wattron(win, COLOR_PAIR(usage_color(pkg->usage)) | A_BOLD);
+        wprintw(win, "%3.0f%%", pkg->usage);
+        wattroff(win, COLOR_PAIR(usage_color(pkg->usage)) | A_BOLD);
+    }
+    row++;
+
+    int col = 2;
+    for (unsigned int l = 0; l < topo->l3_count; l++) {
+        const TopologyGroup *l3 = &topo->l3[l];
+        unsigned int l3_cores = 0;
+        for (unsigned int c = 0; c < topo->core_count; c++) {
+            if (topo->cores[c].parent == (int)l) l3_cores++;
+        }
+
+        // Start a new line if the cell does not fit; very wide cells wrap inside
+        int cell_width = 9 + (int)l3_cores;
+        if (col > 2 && col + cell_width > right) {
+            row++;
+            col = 2;
+        }
+        if (row >= height - 1) {
+            mvwprintw(win, height - 2, right - 4, "...");
+            break;
+        }
+
+        wattron(win, COLOR_PAIR(usage_color(l3->usage)));
+        mvwprintw(win, row, col, "L3.%-2u%3.0f%%", l3->id, l3->usage);
+        wattroff(win, COLOR_PAIR(usage_color(l3->usage)));
+        col += 9;
+        for (unsigned int c = 0; c < topo->core_count; c++) {
+            const TopologyGroup *core = &topo->cores[c];
+            if (core->parent != (int)l) continue;
+            if (col >= right) {
+                if (++row >= height - 1) break;
+                col = 11;
+            }
+            double usage = core->usage > 100 ? 100 : core->usage;
+            wattron(win, COLOR_PAIR(usage_color(core->max_usage)));
+            mvwaddch(win, row, col++, levels[(int)(usage * (sizeof(levels) - 2) / 100)]);
+            wattroff(win, COLOR_PAIR(usage_color(core->max_usage)));
+        }
+        col++;
+    }
 }
 
 /**
- * @brief Create a new centered window
+ * @brief Sort key used to pick the CPUs shown in the counters panel
+ * @param cpu Per-CPU counter metrics
+ * @param mode Counter mode in use
+ * @return Cycle rate in hardware mode, context switch rate otherwise
+ */
+static double perf_activity(const PerfCPUStats *cpu, PerfMode mode) {
+    return mode == PERF_MODE_HARDWARE ? cpu->cycles : cpu->context_switches;
+}
+
+/**
+ * @brief Draw the performance counters panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details The first line holds the system-wide figures; the rest lists the
+ * busiest CPUs (by cycles, or by context switches in software mode) in cells.
+ */
+static void draw_perf_panel(WINDOW *win, const SystemStats *stats) {
+    const PerfStats *perf = &stats->perf;
+    const PerfCPUStats *total = &perf->total;
+    int height, width;
+    getmaxyx(win, height, width);
+    int row = 1;
+
+    if (perf->mode == PERF_MODE_NONE) {
+        mvwprintw(win, row, 2, "Counters unavailable (perf_event_paranoid=%d)", perf->paranoid);
+        mvwprintw(win, row + 1, 2, "Run with CAP_PERFMON or set the sysctl to 0 or lower");
+        return;
+    }
+
+    if (perf->mode == PERF_MODE_HARDWARE) {
+        mvwprintw(win, row++, 2, "IPC ");
+        wattron(win, A_BOLD);
+        wprintw(win, "%.2f", total->ipc);
+        wattroff(win, A_BOLD);
+        wprintw(win, "  LLC MPKI %.1f  Branch MPKI %.1f  %.2f GHz",
+                total->cache_mpki, total->branch_mpki, total->ghz);
+        if (perf->has_stalled_frontend || perf->has_stalled_backend) {
+            mvwprintw(win, row++, 2, "Stalled cycles: front-end %.0f%%  back-end %.0f%%",
+                      total->stalled_frontend, total->stalled_backend);
+        }
+    } else {
+        mvwprintw(win, row++, 2, "No PMU, software events: ctx %.0f/s  migr %.0f/s  faults %.0f/s",
+                  total->context_switches, total->migrations, total->page_faults);
+    }
+    if (perf->multiplexed < 99.5) {
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        wprintw(win, "  mux %.0f%%", perf->multiplexed);
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+    }
+    if (perf->counted < perf->count) {
+        unsigned int missing = perf->count - perf->counted;
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        wprintw(win, "  n/c %u cpu%s", missing, missing == 1 ? "" : "s");
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+    }
+    if (perf->fallback) {
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        wprintw(win, "  sw %u cpu%s", perf->fallback, perf->fallback == 1 ? "" : "s");
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+    }
+
+    // Busiest CPUs, picked by repeated selection (the panel holds at most a few dozen)
+    enum { CELL_WIDTH = 17 };
+    int columns = (width - 4) / CELL_WIDTH;
+    int slots = columns * (height - 1 - row);
+    unsigned char shown[MAX_CPUS] = {0};
+    for (int n = 0; n < slots && n < (int)perf->count; n++) {
+        int best = -1;
+        for (unsigned int i = 0; i < perf->count; i++) {
+            if (shown[i]) continue;
+            if (best < 0 || perf_activity(&perf->cpus[i], perf->mode) >
+                            perf_activity(&perf->cpus[best], perf->mode)) best = (int)i;
+        }
+        shown[best] = 1;
+
+        const PerfCPUStats *cpu = &perf->cpus[best];
+        int y = row + n / columns;
+        int x = 2 + (n % columns) * CELL_WIDTH;
+        if (!cpu->counted) {
+            // Counters never ran in the interval: no value rather than a misleading 0
+            wattron(win, COLOR_PAIR(COLOR_WARNING));
+            mvwprintw(win, y, x, "cpu%-3u  n/c", cpu->cpu);
+            wattroff(win, COLOR_PAIR(COLOR_WARNING));
+        } else if (cpu->mode == PERF_MODE_HARDWARE) {
+            int color = cpu->cycles > 0 && cpu->ipc < 0.5 ? COLOR_WARNING : COLOR_NORMAL;
+            wattron(win, COLOR_PAIR(color));
+            mvwprintw(win, y, x, "cpu%-3u %4.2f %5.1f", cpu->cpu, cpu->ipc, cpu->cache_mpki);
+            wattroff(win, COLOR_PAIR(color));
+        } else {
+            mvwprintw(win, y, x, "cpu%-3u %6.0f/s", cpu->cpu, cpu->context_switches);
+        }
+    }
+}
+
+/**
+ * @brief Draw the Memory panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_memory_panel(WINDOW *win, const SystemStats *stats) {
+    char buf[256];
+    int row = 1;
+    format_bytes(stats->memory.total, buf, sizeof(buf));
+    mvwprintw(win, row++, 2, "Total Memory: %s", buf);
+    format_bytes(stats->memory.used, buf, sizeof(buf));
+    mvwprintw(win, row++, 2, "Used Memory:  %s (%.1f%%)", 
+              buf, stats->memory.usage);
+    format_bytes(stats->memory.free, buf, sizeof(buf));
+    mvwprintw(win, row++, 2, "Free Memory:  %s", buf);
+    format_bytes(stats->memory.cached, buf, sizeof(buf));
+    mvwprintw(win, row++, 2, "Cache:        %s", buf);
+    mvwprintw(win, row++, 2, "Swap Usage:   %.1f%%", stats->memory.swap_usage);
+
+    // Usage over the last updates with the kernel events that arrived in each
+    const EventStats *events = &stats->events;
+    if (events->history_count > 0) {
+        static const char marks[EVENT_KINDS] = {'O', 'H', 'v', '^', 'E'};
+        unsigned int width = getmaxx(win) - 18;
+        unsigned int start = events->history_count > width ? events->history_count - width : 0;
+        format_sparkline(events->memory_history, events->history_count, buf, width);
+        mvwprintw(win, row, 2, "History:      %s", buf);
+        for (unsigned int i = start; i < events->history_count; i++) {
+            int mark = events->history_marks[i];
+            if (!mark) continue;
+            int color = mark - 1 == EVENT_LINK_UP ? COLOR_GOOD :
+                        mark - 1 == EVENT_LINK_DOWN ? COLOR_WARNING : COLOR_CRITICAL;
+            wattron(win, COLOR_PAIR(color) | A_BOLD);
+            mvwaddch(win, row, 16 + (int)(i - start), marks[mark - 1]);
+            wattroff(win, COLOR_PAIR(color) | A_BOLD);
+        }
+    }
+}
+
+/**
+ * @brief Draw the Events panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details The counts line, then the newest events first. The same events
+ * are marked on the Memory panel's history line.
+ */
+static void draw_events_panel(WINDOW *win, const SystemStats *stats) {
+    const EventStats *events = &stats->events;
+    int height = getmaxy(win);
+    int width = getmaxx(win);
+
+    if (!events->available) {
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        mvwprintw(win, 1, 2, "%.*s", width - 4, events->error[0] ? events->error : "Not available");
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+        return;
+    }
+
+    mvwprintw(win, 1, 2, "OOM kills: %lu  Hung tasks: %lu  Link down: %lu  I/O errors: %lu",
+              events->oom_kills, events->hung_tasks, events->link_flaps, events->io_errors);
+    if (events->total == 0) {
+        mvwprintw(win, 2, 2, "No kernel events");
+        return;
+    }
+
+    for (int row = 2, age = 0; row < height - 1; row++, age++) {
+        const KernelEvent *event = kernel_event(events, (unsigned int)age);
+        if (!event) break;
+
+        char when[16], who[48];
+        struct tm tm;
+        strftime(when, sizeof(when), "%H:%M:%S", localtime_r(&event->time, &tm));
+        if (event->pid) snprintf(who, sizeof(who), "%s[%d]", event->subject, event->pid);
+        else snprintf(who, sizeof(who), "%s", event->subject);
+
+        int color = event->kind == EVENT_LINK_UP ? COLOR_GOOD :
+                    event->kind == EVENT_LINK_DOWN ? COLOR_WARNING : COLOR_CRITICAL;
+        mvwprintw(win, row, 2, "%s ", when);
+        wattron(win, COLOR_PAIR(color) | A_BOLD);
+        wprintw(win, "%-4s", event_kind_names[event->kind]);
+        wattroff(win, COLOR_PAIR(color) | A_BOLD);
+        wprintw(win, " %-20.20s %.*s", who, width > 41 ? width - 41 : 0, event->message);
+    }
+}
+
+/**
+ * @brief Format a growth rate per hour, e.g. "+12.0 MB/h"
+ * @param bytes_per_sec Growth in bytes per second, negative for shrinking
+ * @param buf Buffer to store the result
+ * @param size Size of the buffer
+ */
+static void format_growth(double bytes_per_sec, char *buf, size_t size) {
+    char amount[32];
+    double per_hour = bytes_per_sec * 3600;
+    format_bytes((unsigned long)(per_hour < 0 ? -per_hour : per_hour), amount, sizeof(amount));
+    snprintf(buf, size, "%s%s/h", per_hour < 0 ? "-" : "+", amount);
+}
+
+/**
+ * @brief Pick the colour of a growth rate
+ * @param stats Current statistics
+ * @param bytes_per_sec Growth in bytes per second
+ * @return Colour pair number
+ *
+ * @details Growth of 1% of RAM per hour or more is a leak worth a look, 10%
+ * fills memory within hours. Rates over less than a minute are not judged.
+ */
+static int growth_color(const SystemStats *stats, double bytes_per_sec) {
+    double per_hour = bytes_per_sec * 3600;
+    if (stats->kmem.growth_window < 60 || stats->memory.total == 0) return COLOR_NORMAL;
+    if (per_hour >= stats->memory.total / 10.0) return COLOR_CRITICAL;
+    if (per_hour >= stats->memory.total / 100.0) return COLOR_WARNING;
+    return COLOR_NORMAL;
+}
+
+/**
+ * @brief Draw the Kernel Memory panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details How much of the memory counted as used belongs to the kernel
+ * and the huge page pools, then the largest slab caches. Growth rates span
+ * up to the last ten minutes.
+ */
+static void draw_kmem_panel(WINDOW *win, const SystemStats *stats) {
+    const KmemStats *kmem = &stats->kmem;
+    int height = getmaxy(win);
+    int width = getmaxx(win);
+    char a[32], b[32], c[32], d[32];
+    int row = 1;
+
+    format_bytes(kmem->kernel, a, sizeof(a));
+    format_bytes(stats->memory.used, b, sizeof(b));
+    format_growth(kmem->kernel_growth, c, sizeof(c));
+    mvwprintw(win, row, 2, "Kernel: %s of %s used (%.0f%%)  Growth: ", a, b,
+              stats->memory.used ? 100.0 * kmem->kernel / stats->memory.used : 0.0);
+    int color = growth_color(stats, kmem->kernel_growth);
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "%s", c);
+    wattroff(win, COLOR_PAIR(color));
+    row++;
+
+    format_bytes(kmem->slab, a, sizeof(a));
+    format_bytes(kmem->slab_unreclaimable, b, sizeof(b));
+    format_growth(kmem->slab_unreclaimable_growth, c, sizeof(c));
+    mvwprintw(win, row, 2, "Slab: %s  Unreclaimable: %s  Growth: ", a, b);
+    color = growth_color(stats, kmem->slab_unreclaimable_growth);
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "%s", c);
+    wattroff(win, COLOR_PAIR(color));
+    row++;
+
+    format_bytes(kmem->kernel_stack, a, sizeof(a));
+    format_bytes(kmem->page_tables, b, sizeof(b));
+    format_bytes(kmem->vmalloc_used, c, sizeof(c));
+    format_bytes(kmem->percpu, d, sizeof(d));
+    mvwprintw(win, row++, 2, "Stacks: %s  Page tables: %s", a, b);
+    mvwprintw(win, row++, 2, "Vmalloc: %s  Percpu: %s", c, d);
+
+    // Pools by page size; reserved and surplus pages only when there are any
+    format_bytes(kmem->hugetlb, a, sizeof(a));
+    mvwprintw(win, row, 2, "Huge pages: %s", a);
+    for (unsigned int i = 0; i < kmem->hugepage_count && getcurx(win) < width - 32; i++) {
+        const HugePageStats *pool = &kmem->hugepages[i];
+        format_bytes(pool->size, b, sizeof(b));
+        wprintw(win, "  %s %lu/%lu free", b, pool->free, pool->total);
+        if (pool->reserved) wprintw(win, " %lu rsvd", pool->reserved);
+        if (pool->surplus) wprintw(win, " %lu surp", pool->surplus);
+    }
+    row++;
+
+    if (!kmem->slabinfo_available) {
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        mvwprintw(win, row, 2, "%.*s", width - 4, kmem->slabinfo_error[0] ? kmem->slabinfo_error :
+                                                                           "Slab caches not available");
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+        return;
+    }
+
+    wattron(win, A_BOLD);
+    mvwprintw(win, row++, 2, "%-28s %10s %10s %12s", "Slab cache", "Size", "Active", "Growth");
+    wattroff(win, A_BOLD);
+    for (unsigned int i = 0; i < kmem->cache_count && row < height - 1; i++, row++) {
+        const SlabCacheStats *cache = &kmem->caches[i];
+        format_bytes(cache->size, a, sizeof(a));
+        format_bytes(cache->active, b, sizeof(b));
+        format_growth(cache->growth, c, sizeof(c));
+        mvwprintw(win, row, 2, "%-28.28s %10s %10s ", cache->name, a, b);
+        color = growth_color(stats, cache->growth);
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%12s", c);
+        wattroff(win, COLOR_PAIR(color));
+    }
+}
+
+/**
+ * @brief Format a count in at most four characters, e.g. "9999", "120k", "1.5M"
+ * @param value Count
+ * @param buf Buffer to store the result
+ * @param size Size of the buffer
+ */
+static void format_count(unsigned long value, char *buf, size_t size) {
+    if (value < 10000) snprintf(buf, size, "%lu", value);
+    else if (value < 1000000) snprintf(buf, size, "%luk", value / 1000);
+    else if (value < 10000000) snprintf(buf, size, "%.1fM", value / 1e6);
+    else snprintf(buf, size, "%luM", value / 1000000);
+}
+
+/**
+ * @brief Draw the Memory Zones panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details Free blocks of each order per zone, red where no block of that
+ * order or larger is left and yellow where 90% of the zone's free memory
+ * is in smaller blocks. Zone names are coloured by their watermarks. The
+ * last row is the unusable free space index over all zones.
+ */
+static void draw_zones_panel(WINDOW *win, const SystemStats *stats) {
+    const ZoneInfo *zones = &stats->zones;
+    int height = getmaxy(win);
+    char buf[32];
+
+    unsigned long free = 0;
+    for (unsigned int i = 0; i < zones->count; i++) free += zones->zones[i].free;
+    format_bytes(free * zones->page_size, buf, sizeof(buf));
+    mvwprintw(win, 1, 2, "Free: %s in %u zones  ", buf, zones->count);
+    if (zones->dropped) {
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        wprintw(win, "%u not read  ", zones->dropped);
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+    }
+    int color = zones->near_low ? COLOR_WARNING : COLOR_NORMAL;
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "Near low: %u  ", zones->near_low);
+    wattroff(win, COLOR_PAIR(color));
+    color = zones->below_low ? COLOR_CRITICAL : COLOR_NORMAL;
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "Below low: %u  Below min: %u", zones->below_low, zones->below_min);
+    wattroff(win, COLOR_PAIR(color));
+
+    wattron(win, A_BOLD);
+    mvwprintw(win, 2, 2, "%-9s %8s", "Zone", "Free");
+    for (unsigned int order = 0; order < zones->order_count; order++) wprintw(win, "%4u", order);
+    wattroff(win, A_BOLD);
+
+    int row = 3;
+    for (unsigned int i = 0; i < zones->count && row < height - 2; i++, row++) {
+        const ZoneStats *zone = &zones->zones[i];
+        char name[24];
+        snprintf(name, sizeof(name), "%d/%s", zone->node, zone->name);
+        color = zone->watermark >= ZONE_BELOW_LOW ? COLOR_CRITICAL :
+                zone->watermark == ZONE_NEAR_LOW ? COLOR_WARNING : COLOR_NORMAL;
+        wattron(win, COLOR_PAIR(color));
+        mvwprintw(win, row, 2, "%-9.9s", name);
+        wattroff(win, COLOR_PAIR(color));
+        format_bytes(zone->free * zones->page_size, buf, sizeof(buf));
+        wprintw(win, " %8s", buf);
+
+        for (unsigned int order = 0; order < zones->order_count; order++) {
+            color = zone->unusable[order] >= 1.0 ? COLOR_CRITICAL :
+                    zone->unusable[order] >= 0.9 ? COLOR_WARNING : COLOR_NORMAL;
+            format_count(zone->blocks[order], buf, sizeof(buf));
+            wattron(win, COLOR_PAIR(color));
+            wprintw(win, "%4s", buf);
+            wattroff(win, COLOR_PAIR(color));
+        }
+    }
+
+    mvwprintw(win, row, 2, "%-18s", "Unusable %");
+    for (unsigned int order = 0; order < zones->order_count; order++) {
+        wprintw(win, "%4.0f", 100.0 * zones->unusable[order]);
+    }
+}
+
+/**
+ * @brief Format a size in at most five characters, e.g. "1.2G" or "512M"
+ * @param bytes Number of bytes
+ * @param buf Buffer to store the result
+ * @param size Size of the buffer
+ */
+static void format_size(unsigned long bytes, char *buf, size_t size) {
+    static const char units[] = "BKMGT";
+    double value = bytes;
+    int i = 0;
+
+    while (value >= 1024 && i < 4) {
+        value /= 1024;
+        i++;
+    }
+    snprintf(buf, size, i > 0 && value < 10 ? "%.1f%c" : "%.0f%c", value, units[i]);
+}
+
+/**
+ * @brief Draw the Process Memory panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details RSS is current; the other columns are from the last
+ * smaps_rollup read of the process, Age ago, or "-" if it could not be read.
+ */
+static void draw_procmem_panel(WINDOW *win, const SystemStats *stats) {
+    const ProcessMemoryInfo *procmem = &stats->procmem;
+    int height = getmaxy(win);
+
+    mvwprintw(win, 1, 2, "Processes: %u  smaps_rollup: %u/%u reads, %.1f ms",
+              procmem->scanned, procmem->reads, procmem->budget, procmem->read_ms);
+    wattron(win, A_BOLD);
+    mvwprintw(win, 2, 2, "%7s %-15s %6s %6s %6s %6s %6s %5s",
+              "PID", "Name", "RSS", "PSS", "Anon", "Swap", "Shared", "Age");
+    wattroff(win, A_BOLD);
+
+    for (unsigned int i = 0; i < procmem->count && 3 + (int)i < height - 1; i++) {
+        const ProcessMemoryStats *process = &procmem->processes[i];
+        char rss[8], pss[8] = "-", anon[8] = "-", swap[8] = "-", shared[8] = "-", age[24] = "-";
+        format_size(process->rss, rss, sizeof(rss));
+        if (process->detailed) {
+            format_size(process->pss, pss, sizeof(pss));
+            format_size(process->anonymous, anon, sizeof(anon));
+            format_size(process->swap, swap, sizeof(swap));
+            format_size(process->shared_clean, shared, sizeof(shared));
+        }
+        if (process->age_ms >= 0) snprintf(age, sizeof(age), "%llds", process->age_ms / 1000);
+
+        mvwprintw(win, 3 + i, 2, "%7d %-15.15s %6s %6s %6s ", (int)process->pid, process->name, rss, pss, anon);
+        int color = process->detailed && process->swap > 0 ? COLOR_WARNING : COLOR_NORMAL;
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%6s", swap);
+        wattroff(win, COLOR_PAIR(color));
+        wprintw(win, " %6s %5s", shared, age);
+    }
+}
+
+/**
+ * @brief Draw the Working Set panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details Refaults within the window are highlighted: memory that was
+ * needed again soon after being evicted.
+ */
+static void draw_workingset_panel(WINDOW *win, const SystemStats *stats) {
+    const WorkingSetStats *ws = &stats->workingset;
+    int height = getmaxy(win);
+    char working_set[32], lru[32], buf[32];
+
+    if (ws->window == 0) {
+        mvwprintw(win, 1, 2, "Not running; enable it in the [workingset] section");
+        return;
+    }
+    format_bytes(ws->working_set, working_set, sizeof(working_set));
+    format_bytes(ws->lru, lru, sizeof(lru));
+    mvwprintw(win, 1, 2, "Working set: %s of %s on the LRU lists, last %us", working_set, lru, ws->window);
+
+    if (ws->method == WORKINGSET_IDLE_PAGES) {
+        format_bytes(ws->idle, buf, sizeof(buf));
+        int color = ws->coverage < 100 ? COLOR_WARNING : COLOR_NORMAL;
+        wattron(win, COLOR_PAIR(color));
+        mvwprintw(win, 2, 2, "Idle pages: %s, %.0f%% swept, %.1f ms", buf, ws->coverage, ws->scan_ms);
+        wattroff(win, COLOR_PAIR(color));
+    } else {
+        format_bytes(ws->active, buf, sizeof(buf));
+        mvwprintw(win, 2, 2, "Active: %s  ", buf);
+        wattron(win, COLOR_PAIR(COLOR_WARNING));
+        wprintw(win, "%s", ws->idle_error[0] ? ws->idle_error : "idle page tracking off");
+        wattroff(win, COLOR_PAIR(COLOR_WARNING));
+    }
+    format_bytes(ws->refaulted, buf, sizeof(buf));
+    int color = ws->refaulted > 0 ? COLOR_WARNING : COLOR_NORMAL;
+    mvwprintw(win, 3, 2, "Refaulted: ");
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "%s", buf);
+    wattroff(win, COLOR_PAIR(color));
+    wprintw(win, " in %us", ws->span);
+
+    wattron(win, A_BOLD);
+    mvwprintw(win, 4, 2, "%-34s %6s %6s %7s %6s", "Cgroup", "Usage", "Active", "Refault", "WSet");
+    wattroff(win, A_BOLD);
+    for (unsigned int i = 0; i < ws->cgroup_count && 5 + (int)i < height - 1; i++) {
+        const CgroupWorkingSet *cgroup = &ws->cgroups[i];
+        char usage[8], active[8], refaulted[8], set[8];
+        format_size(cgroup->usage, usage, sizeof(usage));
+        format_size(cgroup->active, active, sizeof(active));
+        format_size(cgroup->refaulted, refaulted, sizeof(refaulted));
+        format_size(cgroup->working_set, set, sizeof(set));
+
+        mvwprintw(win, 5 + i, 2, "%-34.34s %6s %6s ", cgroup->name, usage, active);
+        color = cgroup->refaulted > 0 ? COLOR_WARNING : COLOR_NORMAL;
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%7s", refaulted);
+        wattroff(win, COLOR_PAIR(color));
+        wprintw(win, " %6s", set);
+    }
+}
+
+/**
+ * @brief Draw the Swap panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ *
+ * @details Up to four swap areas and four zram devices; a zram device that
+ * is full or failing writes is red, one that compresses poorly yellow.
+ * Spill is swap-out traffic that went past zram to a slower device.
+ */
+static void draw_swap_panel(WINDOW *win, const SystemStats *stats) {
+    static const char *const zram_states[] = {"ok", "poor", "full", "failing"};
+    const SwapStats *swap = &stats->swap;
+    int height = getmaxy(win);
+    char in[32], out[32], spill[32];
+    int row = 1;
+
+    format_speed(swap->swap_in, in, sizeof(in));
+    format_speed(swap->swap_out, out, sizeof(out));
+    format_speed(swap->spill, spill, sizeof(spill));
+    mvwprintw(win, row, 2, "In: %s  Out: %s  Spill: ", in, out);
+    int color = swap->spill > 0 ? COLOR_WARNING : COLOR_NORMAL;
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "%s", spill);
+    wattroff(win, COLOR_PAIR(color));
+    row++;
+
+    wattron(win, A_BOLD);
+    mvwprintw(win, row++, 2, "%-28s %-9s %6s %6s %5s", "Swap area", "Type", "Size", "Used", "Prio");
+    wattroff(win, A_BOLD);
+    if (swap->device_count == 0) mvwprintw(win, row++, 2, "No swap areas");
+    for (unsigned int i = 0; i < swap->device_count && i < 4 && row < height - 1; i++) {
+        const SwapDeviceStats *device = &swap->devices[i];
+        char size[8], used[8];
+        format_size(device->size, size, sizeof(size));
+        format_size(device->used, used, sizeof(used));
+        mvwprintw(win, row, 2, "%-28.28s %-9.9s %6s ", device->name, device->type, size);
+        color = usage_color(device->size ? 100.0 * device->used / device->size : 0.0);
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%6s", used);
+        wattroff(win, COLOR_PAIR(color));
+        wprintw(win, " %5d", device->priority);
+        row++;
+    }
+
+    if (swap->zram_count > 0 && row < height - 1) {
+        wattron(win, A_BOLD);
+        mvwprintw(win, row++, 2, "%-6s %-6s %6s %6s %5s %9s %9s %-7s",
+                  "zram", "Algo", "Data", "Memory", "Ratio", "Read", "Write", "State");
+        wattroff(win, A_BOLD);
+    }
+    for (unsigned int i = 0; i < swap->zram_count && i < 4 && row < height - 1; i++) {
+        const ZramStats *zram = &swap->zram[i];
+        char name[16], data[8], memory[8], read[32], write[32];
+        snprintf(name, sizeof(name), "zram%u", zram->index);
+        format_size(zram->data, data, sizeof(data));
+        format_size(zram->memory, memory, sizeof(memory));
+        format_speed(zram->read_rate, read, sizeof(read));
+        format_speed(zram->write_rate, write, sizeof(write));
+        mvwprintw(win, row, 2, "%-6s %-6.6s %6s %6s %4.1fx %9s %9s ",
+                  name, zram->algorithm, data, memory, zram->ratio, read, write);
+        color = zram->state >= ZRAM_FULL ? COLOR_CRITICAL : zram->state == ZRAM_POOR ? COLOR_WARNING : COLOR_GOOD;
+        wattron(win, COLOR_PAIR(color));
+        wprintw(win, "%-7s", zram_states[zram->state]);
+        wattroff(win, COLOR_PAIR(color));
+        row++;
+    }
+
+    if (row >= height - 1) return;
+    if (!swap->zswap_enabled && swap->zswap_pool == 0) {
+        mvwprintw(win, row, 2, "zswap: off");
+        return;
+    }
+    char stored[8], pool[8], back[32];
+    format_size(swap->zswap_stored, stored, sizeof(stored));
+    format_size(swap->zswap_pool, pool, sizeof(pool));
+    format_speed(swap->zswap_out, out, sizeof(out));
+    format_speed(swap->zswap_written_back, back, sizeof(back));
+    mvwprintw(win, row, 2, "zswap: %s in %s (%.1fx)  Out: %s  Back: ", stored, pool, swap->zswap_ratio, out);
+    color = swap->zswap_written_back > 0 || swap->zswap_rejected > 0 ? COLOR_WARNING : COLOR_NORMAL;
+    wattron(win, COLOR_PAIR(color));
+    wprintw(win, "%s", back);
+    wattroff(win, COLOR_PAIR(color));
+}
+
+/**
+ * @brief Draw the Disk panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_disk_panel(WINDOW *win, const SystemStats *stats) {
+    char buf[256];
+    int height = getmaxy(win);
+    int row = 1;
+    mvwprintw(win, row++, 2, "Disk Usage:");
+    for (int i = 0; i < stats->disks.count && i < layout.max_disks && row + 3 <= height - 1; i++) {
+        const DiskStats *disk = &stats->disks.disks[i];
+        mvwprintw(win, row++, 2, "  %s: %.1f%% used",
+                  disk->mount_point,
+                  disk->usage);
+        format_bytes(disk->total, buf, sizeof(buf));
+        mvwprintw(win, row++, 4, "Total: %s", buf);
+        format_bytes(disk->available, buf, sizeof(buf));
+        mvwprintw(win, row++, 4, "Free: %s", buf);
+    }
+}
+
+/**
+ * @brief Draw the Network panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_network_panel(WINDOW *win, const SystemStats *stats) {
+    char buf[256];
+    int row = 1;
+    int height = getmaxy(win);
+    for (int i = 0; i < stats->network.interface_count && i < layout.max_interfaces &&
+                    row + 3 <= height - 1; i++) {
+        const NetworkInterfaceStats *if_stats = &stats->network.interfaces[i];
+        mvwprintw(win, row++, 2, "Interface: %s", if_stats->interface);
+        
+        format_speed(if_stats->receive_speed, buf, sizeof(buf));
+        mvwprintw(win, row++, 4, "RX: %s", buf);
+        
+        format_speed(if_stats->send_speed, buf, sizeof(buf));
+        mvwprintw(win, row++, 4, "TX: %s", buf);
+        row++;
+    }
+}
+
+/**
+ * @brief Draw the GPU panel contents
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_gpu_panel(WINDOW *win, const SystemStats *stats) {
+    char buf[256];
+    int height = getmaxy(win);
+    int row = 1;
+    for (unsigned int i = 0; i < stats->gpus.count && (int)i < layout.max_gpus; i++) {
+        const GPUStats *gpu = &stats->gpus.gpus[i];
+        mvwprintw(win, row++, 2, "GPU %u: %s", i, gpu->name);
+        mvwprintw(win, row++, 4, "Usage: %.1f%%", gpu->utilization);
+        if (gpu->util_sample_count > 0) {
+            format_sparkline(gpu->util_samples, gpu->util_sample_count, buf, 40);
+            wprintw(win, "  [%s]", buf);
+        }
+        mvwprintw(win, row, 4, "Temperature: %d°C", gpu->temperature);
+        if (gpu->power_usage > 0) wprintw(win, "  Power: %.1f W", gpu->power_usage / 1000.0);
+        if (gpu->freq_mhz > 0) {
+            wprintw(win, "  Clock: %u", gpu->freq_mhz);
+            if (gpu->max_freq_mhz > 0) wprintw(win, "/%u", gpu->max_freq_mhz);
+            wprintw(win, " MHz");
+        }
+        row++;
+        if (gpu->memory_total > 0) {
+            format_bytes(gpu->memory_used, buf, sizeof(buf));
+            mvwprintw(win, row++, 4, "Memory Used: %s", buf);
+        }
+        // Top processes by GPU memory
+        for (unsigned int p = 0; p < gpu->process_count && p < 2 &&
+                             row < height - 1; p++) {
+            const GPUProcessStats *proc = &gpu->processes[p];
+            const char *cgroup = strrchr(proc->cgroup, '/');
+            cgroup = (cgroup && cgroup[1]) ? cgroup + 1 : proc->cgroup;
+            format_bytes(proc->memory_used, buf, sizeof(buf));
+            mvwprintw(win, row++, 6, "%-7u %-15s %10s SM %3u%%  %.20s",
+                      proc->pid, proc->name, buf, proc->sm_util, cgroup);
+        }
+        row++;
+        if (row >= height - 1) break;
+    }
+}
+
+/**
+ * @brief Format one plugin value with its unit
+ * @param metric Plugin metric
+ * @param buf Buffer to store the result
+ * @param size Size of the buffer
+ *
+ * @details Byte values are scaled like the built-in panels; counters are
+ * shown per second.
+ */
+static void format_plugin_value(const PluginMetric *metric, char *buf, size_t size) {
+    if (isnan(metric->value)) {
+        snprintf(buf, size, "-");
+    } else if (!strcmp(metric->unit, "B") && metric->value >= 0) {
+        if (metric->counter) format_speed(metric->value, buf, size);
+        else format_bytes((unsigned long)metric->value, buf, size);
+    } else {
+        snprintf(buf, size, "%.6g%s%s%s", metric->value, metric->unit[0] ? " " : "",
+                 metric->unit, metric->counter ? "/s" : "");
+    }
+}
+
+/**
+ * @brief Draw the Plugins panel: every loaded plugin as a heading and its metrics
+ * @param win Panel window
+ * @param stats Current statistics
+ */
+static void draw_plugin_panel(WINDOW *win, const SystemStats *stats) {
+    char buf[64];
+    int height = getmaxy(win);
+    int row = 1;
+    if (stats->plugins.count == 0) {
+        mvwprintw(win, row, 2, "No plugins loaded");
+        return;
+    }
+    for (unsigned int i = 0; i < stats->plugins.count && row < height - 1; i++) {
+        const PluginInfo *plugin = &stats->plugins.plugins[i];
+        wattron(win, A_BOLD);
+        mvwprintw(win, row++, 2, "%s", plugin->title);
+        wattroff(win, A_BOLD);
+        if (!plugin->valid) wprintw(win, "  (no data)");
+        for (unsigned int m = 0; m < plugin->metric_count && row < height - 1; m++) {
+            format_plugin_value(&plugin->metrics[m], buf, sizeof(buf));
+            mvwprintw(win, row++, 4, "%-40.40s %s", plugin->metrics[m].label, buf);
+        }
+    }
+}
+
+/**
+ * @brief A titled panel and the function that fills it
+ */
+typedef struct {
+    const char *key;  // Name used in the [display] panels setting
+    const char *title;
+    int height;
+    void (*draw)(WINDOW *win, const SystemStats *stats);
+    AlertPanel alert;  // Alerts on these metrics colour the border
+    WINDOW *win;       // NULL if the panel did not fit the terminal
+} Panel;
+
+// Panels in priority order; later panels are dropped first on small terminals
+static Panel panels[] = {
+    {"cpu", "CPU", CPU_WIN_HEIGHT, draw_cpu_panel, ALERT_PANEL_CPU, NULL},
+    {"memory", "Memory", MEM_WIN_HEIGHT, draw_memory_panel, ALERT_PANEL_MEMORY, NULL},
+    {"topology", "CPU Topology", TOPO_WIN_HEIGHT, draw_topology_panel, ALERT_PANEL_CPU, NULL},
+    {"counters", "Counters", PERF_WIN_HEIGHT, draw_perf_panel, ALERT_PANEL_COUNTERS, NULL},
+    {"disk", "Disk", DISK_WIN_HEIGHT, draw_disk_panel, ALERT_PANEL_DISK, NULL},
+    {"network", "Network", NET_WIN_HEIGHT, draw_network_panel, ALERT_PANEL_NETWORK, NULL},
+    {"gpu", "GPU", GPU_WIN_HEIGHT, draw_gpu_panel, ALERT_PANEL_GPU, NULL},
+    {"events", "Kernel Events", EVENTS_WIN_HEIGHT, draw_events_panel, ALERT_PANEL_EVENTS, NULL},
+    {"kmem", "Kernel Memory", KMEM_WIN_HEIGHT, draw_kmem_panel, ALERT_PANEL_MEMORY, NULL},
+    {"zones", "Memory Zones", ZONES_WIN_HEIGHT, draw_zones_panel, ALERT_PANEL_MEMORY, NULL},
+    {"procmem", "Process Memory", PROCMEM_WIN_HEIGHT, draw_procmem_panel, ALERT_PANEL_MEMORY, NULL},
+    {"workingset", "Working Set", WORKINGSET_WIN_HEIGHT, draw_workingset_panel, ALERT_PANEL_MEMORY, NULL},
+    {"swap", "Swap", SWAP_WIN_HEIGHT, draw_swap_panel, ALERT_PANEL_MEMORY, NULL},
+    {"plugins", "Plugins", 3, draw_plugin_panel, ALERT_PANEL_PLUGINS, NULL},
+};
+
+#define PANEL_COUNT (int)(sizeof(panels) / sizeof(panels[0]))
+
+// Panels to lay out, as indices into panels[], in the configured order
+static int order[PANEL_COUNT] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+static int order_count = PANEL_COUNT;
+
+/**
+ * @brief Delete all panel and header windows
+ */
+static void destroy_windows(void) {
+    if (header_win) delwin(header_win);
+    header_win = NULL;
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (panels[i].win) delwin(panels[i].win);
+        panels[i].win = NULL;
+    }
+}
+
+/**
+ * @brief Create a window with the usual update optimizations
  * @param height Window height
  * @param width Window width
  * @param starty Starting Y position
- * @return Pointer to the new window
+ * @param startx Starting X position
+ * @return Pointer to the new window, or NULL on failure
  */
-static WINDOW *create_centered_win(int height, int width, int starty) {
-    int startx = (COLS - width) / 2;
+static WINDOW *create_win(int height, int width, int starty, int startx) {
     WINDOW *win = newwin(height, width, starty, startx);
+    if (!win) return NULL;
+    scrollok(win, FALSE);
+    leaveok(win, TRUE);
+    idlok(win, TRUE);
+    idcok(win, TRUE);
     return win;
 }
 
+/**
+ * @brief Lay the panels out in as many columns as the terminal allows
+ * @return 0 on success, -1 if not even the first panel fits
+ *
+ * @details Panels fill each column top to bottom in priority order and move
+ * to the next column when they no longer fit. A panel that fits nowhere is
+ * skipped rather than drawn off screen.
+ */
+static int layout_panels(void) {
+    destroy_windows();
+    layout_lines = LINES;
+    layout_cols = COLS;
+
+    int width = layout.width;
+    int columns = (COLS + PADDING) / (width + PADDING);
+    if (columns < 1) columns = 1;
+    int top = HEADER_HEIGHT + PADDING;
+    int left = (COLS - (columns * (width + PADDING) - PADDING)) / 2;
+    if (left < 0) left = 0;
+
+    header_win = create_win(HEADER_HEIGHT, width, 0, (COLS - width) / 2 > 0 ? (COLS - width) / 2 : 0);
+    if (!header_win) return -1;
+
+    int column = 0;
+    int y = top;
+    for (int n = 0; n < order_count && column < columns; n++) {
+        Panel *panel = &panels[order[n]];
+        if (y + panel->height > LINES) {
+            column++;
+            y = top;
+            if (column >= columns || y + panel->height > LINES) continue;
+        }
+        int x = left + column * (width + PADDING);
+        panel->win = create_win(panel->height, width, y, x);
+        if (!panel->win) return -1;
+        draw_fancy_box(panel->win, panel->title, COLOR_BORDER);
+        y += panel->height + PADDING;
+    }
+
+    draw_fancy_box(header_win, "", COLOR_BORDER);
+    clear();
+    refresh();
+    return panels[order[0]].win ? 0 : -1;
+}
+
+void configure_display(const LayoutConfig *config) {
+    layout = *config;
+    order_count = 0;
+
+    // Empty means every panel in the default order, plugins only if any are loaded
+    const char *p = layout.panels[0] ? layout.panels :
+                    plugin_rows() > 0 ? "cpu,memory,topology,counters,disk,network,gpu,events,kmem,zones,procmem,workingset,swap,plugins" :
+                                        "cpu,memory,topology,counters,disk,network,gpu,events,kmem,zones,procmem,workingset,swap";
+    while (*p && order_count < PANEL_COUNT) {
+        size_t len = strcspn(p, ",");
+        for (int i = 0; i < PANEL_COUNT; i++) {
+            if (strlen(panels[i].key) == len && strncmp(panels[i].key, p, len) == 0) {
+                order[order_count++] = i;
+                break;
+            }
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    if (order_count == 0) order[order_count++] = 0;
+
+    // List panels grow with the number of entries they show
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (!strcmp(panels[i].key, "disk")) panels[i].height = 3 + 3 * layout.max_disks;
+        else if (!strcmp(panels[i].key, "network")) panels[i].height = 1 + 4 * layout.max_interfaces;
+        else if (!strcmp(panels[i].key, "plugins")) {
+            int rows = plugin_rows() > 0 ? plugin_rows() : 1;
+            panels[i].height = rows + 2 < PLUGIN_WIN_MAX_HEIGHT ? rows + 2 : PLUGIN_WIN_MAX_HEIGHT;
+        }
+    }
+
+    // Lay out again on the next update
+    layout_lines = 0;
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (panels[i].win) delwin(panels[i].win);
+        panels[i].win = NULL;
+    }
+}
+
+void display_set_status(const char *message) {
+    snprintf(status, sizeof(status), "%s", message ? message : "");
+}
+
 int init_display(void) {
     // Initialize ncurses
     if (!initscr()) {
@@ -106,15 +1166,13 @@ int init_display(void) {
         return -1;
     }
 
-    // Check terminal size
-    int required_height = HEADER_HEIGHT + CPU_WIN_HEIGHT + MEM_WIN_HEIGHT + 
-                         DISK_WIN_HEIGHT + NET_WIN_HEIGHT + GPU_WIN_HEIGHT + 
-                         PADDING * 6;
+    // Check terminal size: at least the header and the first panel
+    int required_height = HEADER_HEIGHT + PADDING + panels[order[0]].height;
     
-    if (LINES < required_height || COLS < (WIN_WIDTH + 2)) {
+    if (LINES < required_height || COLS < (layout.width + 2)) {
         endwin();
         fprintf(stderr, "Terminal too small. Minimum size: %dx%d\n", 
-                WIN_WIDTH + 2, required_height);
+                layout.width + 2, required_height);
         return -1;
     }
 
@@ -141,61 +1199,18 @@ int init_display(void) {
     noecho();                 // Don't echo input
     curs_set(0);             // Hide cursor
 
-    // Calculate window positions
-    int current_y = 0;
-    header_win = create_centered_win(HEADER_HEIGHT, WIN_WIDTH, current_y);
-    current_y += HEADER_HEIGHT + PADDING;
-    
-    cpu_win = create_centered_win(CPU_WIN_HEIGHT, WIN_WIDTH, current_y);
-    current_y += CPU_WIN_HEIGHT + PADDING;
-    
-    mem_win = create_centered_win(MEM_WIN_HEIGHT, WIN_WIDTH, current_y);
-    current_y += MEM_WIN_HEIGHT + PADDING;
-    
-    disk_win = create_centered_win(DISK_WIN_HEIGHT, WIN_WIDTH, current_y);
-    current_y += DISK_WIN_HEIGHT + PADDING;
-    
-    net_win = create_centered_win(NET_WIN_HEIGHT, WIN_WIDTH, current_y);
-    current_y += NET_WIN_HEIGHT + PADDING;
-    
-    gpu_win = create_centered_win(GPU_WIN_HEIGHT, WIN_WIDTH, current_y);
+    // Enable scrolling and optimize window updates
+    scrollok(stdscr, FALSE);
 
-    if (!header_win || !cpu_win || !mem_win || !disk_win || !net_win || !gpu_win) {
+    if (layout_panels() != 0) {
         cleanup_display();
         return -1;
     }
-
-    // Enable scrolling and optimize window updates
-    scrollok(stdscr, FALSE);
-    
-    // Optimize all windows
-    WINDOW *windows[] = {header_win, cpu_win, mem_win, disk_win, net_win, gpu_win};
-    for (int i = 0; i < 6; i++) {
-        scrollok(windows[i], FALSE);
-        leaveok(windows[i], TRUE);
-        idlok(windows[i], TRUE);
-        idcok(windows[i], TRUE);
-    }
-
-    // Draw initial window borders
-    draw_fancy_box(header_win, "");
-    draw_fancy_box(cpu_win, "CPU");
-    draw_fancy_box(mem_win, "Memory");
-    draw_fancy_box(disk_win, "Disk");
-    draw_fancy_box(net_win, "Network");
-    draw_fancy_box(gpu_win, "GPU");
-    
-    refresh();
     return 0;
 }
 
 void cleanup_display(void) {
-    if (header_win) delwin(header_win);
-    if (cpu_win) delwin(cpu_win);
-    if (mem_win) delwin(mem_win);
-    if (disk_win) delwin(disk_win);
-    if (net_win) delwin(net_win);
-    if (gpu_win) delwin(gpu_win);
+    destroy_windows();
     endwin();
 }
 
@@ -204,92 +1219,170 @@ void cleanup_display(void) {
  * @param stats Pointer to SystemStats structure containing current statistics
  */
 void display_stats(const SystemStats *stats) {
-    char buf[256];
-    int row;
-    
-    // Header - only update the time
-    mvwprintw(header_win, 1, (WIN_WIDTH - 14) / 2, "SYSTEM MONITOR");
-    wrefresh(header_win);
-    
-    // CPU
-    werase(cpu_win);
-    row = 1;
-    mvwprintw(cpu_win, row++, 2, "CPU Usage: ");
-    wattron(cpu_win, A_BOLD);
-    wprintw(cpu_win, "%.1f%%", stats->cpu.usage);
-    wattroff(cpu_win, A_BOLD);
-    mvwprintw(cpu_win, row++, 2, "Model: %s", stats->cpu.model_name);
-    mvwprintw(cpu_win, row++, 2, "Cores: %u", stats->cpu.cores);
-    draw_fancy_box(cpu_win, "CPU");
-    wrefresh(cpu_win);
-    
-    // Memory
-    werase(mem_win);
-    row = 1;
-    format_bytes(stats->memory.total, buf, sizeof(buf));
-    mvwprintw(mem_win, row++, 2, "Total Memory: %s", buf);
-    format_bytes(stats->memory.used, buf, sizeof(buf));
-    mvwprintw(mem_win, row++, 2, "Used Memory:  %s (%.1f%%)", 
-              buf, stats->memory.usage);
-    format_bytes(stats->memory.free, buf, sizeof(buf));
-    mvwprintw(mem_win, row++, 2, "Free Memory:  %s", buf);
-    format_bytes(stats->memory.cached, buf, sizeof(buf));
-    mvwprintw(mem_win, row++, 2, "Cache:        %s", buf);
-    mvwprintw(mem_win, row++, 2, "Swap Usage:   %.1f%%", stats->memory.swap_usage);
-    draw_fancy_box(mem_win, "Memory");
-    wrefresh(mem_win);
-    
-    // Network
-    werase(net_win);
-    row = 1;
-    for (int i = 0; i < stats->network.interface_count && i < 3; i++) {
-        const NetworkInterfaceStats *if_stats = &stats->network.interfaces[i];
-        mvwprintw(net_win, row++, 2, "Interface: %s", if_stats->interface);
-        
-        format_speed(if_stats->receive_speed, buf, sizeof(buf));
-        mvwprintw(net_win, row++, 4, "RX: %s", buf);
-        
-        format_speed(if_stats->send_speed, buf, sizeof(buf));
-        mvwprintw(net_win, row++, 4, "TX: %s", buf);
-        row++;
+    // Re-flow the panels when the terminal was resized
+    if (getch() == KEY_RESIZE || LINES != layout_lines || COLS != layout_cols) {
+        layout_panels();
     }
-    draw_fancy_box(net_win, "Network");
-    wrefresh(net_win);
-    
-    // Disk
-    werase(disk_win);
-    row = 1;
-    mvwprintw(disk_win, row++, 2, "Disk Usage:");
-    for (int i = 0; i < stats->disks.count && i < 3; i++) {
-        const DiskStats *disk = &stats->disks.disks[i];
-        mvwprintw(disk_win, row++, 2, "  %s: %.1f%% used",
-                  disk->mount_point,
-                  disk->usage);
-        format_bytes(disk->total, buf, sizeof(buf));
-        mvwprintw(disk_win, row++, 4, "Total: %s", buf);
-        format_bytes(disk->available, buf, sizeof(buf));
-        mvwprintw(disk_win, row++, 4, "Free: %s", buf);
+
+    // Header - title and the alert summary
+    const AlertStats *alerts = &stats->alerts;
+    AlertSeverity worst = ALERT_NONE;
+    for (unsigned int i = 0; i < alerts->active_count; i++) {
+        if (alerts->active[i].severity > worst) worst = alerts->active[i].severity;
     }
-    draw_fancy_box(disk_win, "Disk");
-    wrefresh(disk_win);
-    
-    // GPU
-    werase(gpu_win);
-    row = 1;
-    for (unsigned int i = 0; i < stats->gpus.count && i < 2; i++) {
-        const GPUStats *gpu = &stats->gpus.gpus[i];
-        mvwprintw(gpu_win, row++, 2, "GPU %u: %s", i, gpu->name);
-        mvwprintw(gpu_win, row++, 4, "Usage: %.1f%%", gpu->utilization);
-        mvwprintw(gpu_win, row++, 4, "Temperature: %d°C", gpu->temperature);
-        if (gpu->memory_total > 0) {
-            format_bytes(gpu->memory_used, buf, sizeof(buf));
-            mvwprintw(gpu_win, row++, 4, "Memory Used: %s", buf);
+    int width = layout.width;
+    int title = (width - 14) / 2;
+    wmove(header_win, 1, 1);
+    wclrtoeol(header_win);
+    mvwprintw(header_win, 1, title, "SYSTEM MONITOR");
+    if (status[0]) {
+        wattron(header_win, COLOR_PAIR(COLOR_WARNING));
+        mvwprintw(header_win, 1, 2, "%.*s", title - 3, status);
+        wattroff(header_win, COLOR_PAIR(COLOR_WARNING));
+    } else {
+        // Collectors whose last update failed; their panels show older data
+        char failed[64] = "";
+        size_t len = 0;
+        for (int id = 0; id < COLLECTOR_COUNT && len < sizeof(failed); id++) {
+            if (!stats->update_failed[id]) continue;
+            len += (size_t)snprintf(failed + len, sizeof(failed) - len, "%s%s",
+                                    len ? ", " : "Failed: ", collector_names[id]);
         }
-        row++;
+        if (failed[0]) {
+            wattron(header_win, COLOR_PAIR(COLOR_CRITICAL));
+            mvwprintw(header_win, 1, 2, "%.*s", title - 3, failed);
+            wattroff(header_win, COLOR_PAIR(COLOR_CRITICAL));
+        }
+    }
+    if (alerts->firing > 0) {
+        wattron(header_win, COLOR_PAIR(alert_color(worst)) | A_BOLD);
+        mvwprintw(header_win, 1, width - 18, "%3u alert%s", alerts->firing,
+                  alerts->firing == 1 ? " " : "s");
+        wattroff(header_win, COLOR_PAIR(alert_color(worst)) | A_BOLD);
+    } else if (alerts->rule_count > 0) {
+        wattron(header_win, COLOR_PAIR(COLOR_GOOD));
+        mvwprintw(header_win, 1, width - 18, "%3u rules ok", alerts->rule_count);
+        wattroff(header_win, COLOR_PAIR(COLOR_GOOD));
+    }
+    draw_fancy_box(header_win, "", alert_color(worst));
+    wnoutrefresh(header_win);
+    
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        WINDOW *win = panels[i].win;
+        if (!win) continue;
+        werase(win);
+        panels[i].draw(win, stats);
+        draw_fancy_box(win, panels[i].title, alert_color(alerts->panels[panels[i].alert]));
+        wnoutrefresh(win);
     }
-    draw_fancy_box(gpu_win, "GPU");
-    wrefresh(gpu_win);
     
     // Use doupdate() instead of refresh() for smoother updates
     doupdate();
-} 
\ No newline at end of file
+}
+
+#define HOST_CELL_WIDTH 38
+#define HOST_CELL_HEIGHT 7
+
+/**
+ * @brief Draw one host of the multi-host grid
+ * @param win Cell window
+ * @param host Host
+ * @param now Monotonic time in milliseconds
+ */
+static void draw_host_cell(WINDOW *win, const HostInfo *host, long long now) {
+    char spark[HOST_HISTORY + 1];
+    char rx[32], tx[32];
+    int spark_width = HOST_CELL_WIDTH - 16;
+
+    if (!host->online) {
+        wattron(win, COLOR_PAIR(COLOR_CRITICAL));
+        mvwprintw(win, 1, 2, "offline");
+        wattroff(win, COLOR_PAIR(COLOR_CRITICAL));
+    } else if (host->history_count == 0) {
+        mvwprintw(win, 1, 2, "waiting for data");
+    }
+    if (host->history_count == 0) return;
+
+    format_sparkline(host->cpu_history, host->history_count, spark, spark_width);
+    mvwprintw(win, 2, 2, "CPU ");
+    wattron(win, COLOR_PAIR(usage_color(host->cpu)) | A_BOLD);
+    wprintw(win, "%5.1f%%", host->cpu);
+    wattroff(win, COLOR_PAIR(usage_color(host->cpu)) | A_BOLD);
+    mvwprintw(win, 2, 14, "%s", spark);
+
+    format_sparkline(host->mem_history, host->history_count, spark, spark_width);
+    mvwprintw(win, 3, 2, "Mem ");
+    wattron(win, COLOR_PAIR(usage_color(host->memory)) | A_BOLD);
+    wprintw(win, "%5.1f%%", host->memory);
+    wattroff(win, COLOR_PAIR(usage_color(host->memory)) | A_BOLD);
+    mvwprintw(win, 3, 14, "%s", spark);
+
+    mvwprintw(win, 4, 2, "Load %.2f", host->load1);
+    if (!isnan(host->disk)) wprintw(win, "  Disk %.0f%%", host->disk);
+    if (!isnan(host->gpu)) wprintw(win, "  GPU %.0f%%", host->gpu);
+
+    format_speed(isnan(host->rx) ? 0 : host->rx, rx, sizeof(rx));
+    format_speed(isnan(host->tx) ? 0 : host->tx, tx, sizeof(tx));
+    mvwprintw(win, 5, 2, "RX %s  TX %s", rx, tx);
+
+    // Agents that stop sending while connected show their data's age
+    if (host->online) {
+        long long age = (now - host->last_update) / 1000;
+        if (age >= 5) {
+            wattron(win, COLOR_PAIR(COLOR_WARNING));
+            mvwprintw(win, 1, 2, "no update for %llds", age);
+            wattroff(win, COLOR_PAIR(COLOR_WARNING));
+        }
+    }
+}
+
+void display_hosts(const HostStats *stats) {
+    // The grid draws on stdscr; the single-host panels are not used
+    if (header_win) {
+        destroy_windows();
+        layout_lines = 0;
+    }
+    getch();  // Lets ncurses pick up a resize
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long long now = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+
+    werase(stdscr);
+    attron(COLOR_PAIR(COLOR_HEADER) | A_BOLD);
+    mvprintw(0, 1, "SYSTEM MONITOR - %u host%s, %u online", stats->count,
+             stats->count == 1 ? "" : "s", stats->online);
+    attroff(COLOR_PAIR(COLOR_HEADER) | A_BOLD);
+    if (status[0]) {
+        attron(COLOR_PAIR(COLOR_WARNING));
+        mvprintw(1, 1, "%.*s", COLS - 2, status);
+        attroff(COLOR_PAIR(COLOR_WARNING));
+    } else if (stats->count == 0) {
+        mvprintw(1, 1, "Waiting for agents");
+    }
+
+    int columns = (COLS + PADDING) / (HOST_CELL_WIDTH + PADDING);
+    if (columns < 1) columns = 1;
+    int top = 2;
+    for (unsigned int i = 0; i < stats->count; i++) {
+        int y = top + (int)(i / columns) * HOST_CELL_HEIGHT;
+        int x = (int)(i % columns) * (HOST_CELL_WIDTH + PADDING);
+        if (y + HOST_CELL_HEIGHT > LINES || x + HOST_CELL_WIDTH > COLS) {
+            mvprintw(LINES - 1, 1, "%u more host%s not shown", stats->count - i,
+                     stats->count - i == 1 ? "" : "s");
+            break;
+        }
+
+        WINDOW *cell = derwin(stdscr, HOST_CELL_HEIGHT, HOST_CELL_WIDTH, y, x);
+        if (!cell) break;
+        const HostInfo *host = &stats->hosts[i];
+        draw_host_cell(cell, host, now);
+        int color = !host->online ? COLOR_CRITICAL :
+                    host->history_count > 0 && host->cpu >= 90 ? COLOR_WARNING : COLOR_BORDER;
+        char title[STREAM_HOST_MAX];
+        snprintf(title, sizeof(title), "%.*s", HOST_CELL_WIDTH - 6, host->name);
+        draw_fancy_box(cell, title, color);
+        delwin(cell);
+    }
+    refresh();
+}
@@ -0,0 +1,227 @@
+/**
+ * @file events.c
+ * @brief Implementation of the kernel event watcher
+ */
+
+#include "events.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// One /dev/kmsg read returns one whole record of at most 8 KB
+#define KMSG_RECORD_MAX 8192
+
+const char *const event_kind_names[EVENT_KINDS] = {
+    "OOM", "Hung", "Down", "Up", "I/O"
+};
+
+struct EventMonitor {
+    int fd;                            // -1 if the source could not be opened
+    char error[64];
+    size_t have;                       // Bytes of an incomplete line in buf (files only)
+    unsigned long marked;              // EventStats.total when the history was last updated
+    int history_started;
+    char buf[2 * KMSG_RECORD_MAX];
+};
+
+EventMonitor *create_event_monitor(const char *path) {
+    EventMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    if (!path || !*path) path = DEFAULT_KMSG_PATH;
+    monitor->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (monitor->fd < 0) snprintf(monitor->error, sizeof(monitor->error), "%s: %s", path, strerror(errno));
+    return monitor;
+}
+
+int event_monitor_fd(const EventMonitor *monitor) {
+    return monitor ? monitor->fd : -1;
+}
+
+/**
+ * @brief Wall-clock time of a record timestamp
+ * @param timestamp_us Microseconds since boot
+ * @return Wall-clock time
+ */
+static time_t record_time(unsigned long long timestamp_us) {
+    struct timespec mono;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    long long ago = mono.tv_sec - (long long)(timestamp_us / 1000000);
+    return time(NULL) - (ago > 0 ? ago : 0);
+}
+
+/**
+ * @brief Copy the word that ends right before a position
+ * @param start Start of the message
+ * @param end Position after the word (and any spaces before end)
+ * @param out Output buffer of MAX_EVENT_SUBJECT bytes
+ *
+ * @details A trailing ':' is dropped, so "eth0: Link is Down" gives "eth0".
+ */
+static void word_before(const char *start, const char *end, char *out) {
+    while (end > start && end[-1] == ' ') end--;
+    if (end > start && end[-1] == ':') end--;
+    const char *word = end;
+    while (word > start && word[-1] != ' ') word--;
+    snprintf(out, MAX_EVENT_SUBJECT, "%.*s", (int)(end - word), word);
+}
+
+/**
+ * @brief Recognize an event in a record's message
+ * @param message Message text
+ * @param event Event to fill (kind, pid, subject)
+ * @return 0 if the message is an event, -1 otherwise
+ */
+static int match_event(const char *message, KernelEvent *event) {
+    const char *p;
+
+    // Global and memory cgroup OOM kills; older kernels say "Kill process"
+    if (strstr(message, "out of memory") || strstr(message, "Out of memory")) {
+        if ((p = strstr(message, "Killed process ")) != NULL) p += 15;
+        else if ((p = strstr(message, "Kill process ")) != NULL) p += 13;
+        else return -1;
+        if (sscanf(p, "%d (%31[^)])", &event->pid, event->subject) < 1) return -1;
+        event->kind = EVENT_OOM_KILL;
+        return 0;
+    }
+
+    // "INFO: task NAME:PID blocked for more than N seconds."; NAME may contain ':'
+    if ((p = strstr(message, "task ")) != NULL && strstr(p, " blocked for more than ")) {
+        const char *name = p + 5;
+        const char *end = strstr(name, " blocked for more than ");
+        const char *colon = end;
+        while (colon > name && *colon != ':') colon--;
+        if (colon == name) return -1;
+        event->pid = atoi(colon + 1);
+        snprintf(event->subject, sizeof(event->subject), "%.*s", (int)(colon - name), name);
+        event->kind = EVENT_HUNG_TASK;
+        return 0;
+    }
+
+    // Drivers differ in the prefix but end with "[NIC ]Link is Up|Down"
+    int down = (p = strstr(message, "Link is Down")) != NULL;
+    if (down || (p = strstr(message, "Link is Up")) != NULL) {
+        if (p >= message + 4 && !strncmp(p - 4, "NIC ", 4)) p -= 4;
+        word_before(message, p, event->subject);
+        if (!event->subject[0]) return -1;
+        event->kind = down ? EVENT_LINK_DOWN : EVENT_LINK_UP;
+        return 0;
+    }
+
+    // Block layer ("I/O error, dev sda, sector ...") and buffer cache
+    if ((p = strstr(message, "I/O error, dev ")) != NULL) p += 15;
+    else if ((p = strstr(message, "I/O error on dev ")) != NULL) p += 17;
+    if (p) {
+        if (sscanf(p, "%31[^, ]", event->subject) != 1) return -1;
+        event->kind = EVENT_IO_ERROR;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse one record line and add it to the ring if it is an event
+ * @param line Record header and message, without the newline
+ * @param stats Events to update
+ */
+static void parse_record(const char *line, EventStats *stats) {
+    unsigned int prio;
+    unsigned long long seq, timestamp_us;
+    const char *message = strchr(line, ';');
+    if (!message || sscanf(line, "%u,%llu,%llu", &prio, &seq, &timestamp_us) != 3) return;
+    message++;
+
+    KernelEvent event;
+    memset(&event, 0, sizeof(event));
+    if (match_event(message, &event) != 0) return;
+    event.timestamp_us = timestamp_us;
+    event.time = record_time(timestamp_us);
+    event.level = prio & 7;
+    snprintf(event.message, sizeof(event.message), "%s", message);
+
+    stats->events[stats->total % MAX_EVENTS] = event;
+    stats->total++;
+    if (event.kind == EVENT_OOM_KILL) stats->oom_kills++;
+    else if (event.kind == EVENT_HUNG_TASK) stats->hung_tasks++;
+    else if (event.kind == EVENT_LINK_DOWN) stats->link_flaps++;
+    else if (event.kind == EVENT_IO_ERROR) stats->io_errors++;
+}
+
+/**
+ * @brief Parse the complete lines in the buffer and keep the rest
+ * @param monitor Event watcher
+ * @param stats Events to update
+ */
+static void parse_lines(EventMonitor *monitor, EventStats *stats) {
+    char *line = monitor->buf;
+    char *end = monitor->buf + monitor->have;
+    char *newline;
+
+    while ((newline = memchr(line, '\n', end - line)) != NULL) {
+        *newline = '\0';
+        if (line[0] != ' ') parse_record(line, stats);  // " KEY=VALUE" lines belong to the record
+        line = newline + 1;
+    }
+    monitor->have = end - line;
+    memmove(monitor->buf, line, monitor->have);
+
+    // A line that cannot be a record; start over at the next newline
+    if (monitor->have >= KMSG_RECORD_MAX) monitor->have = 0;
+}
+
+int update_event_stats(EventMonitor *monitor, EventStats *stats) {
+    if (!monitor || !stats) return -1;
+
+    stats->available = monitor->fd >= 0;
+    snprintf(stats->error, sizeof(stats->error), "%s", monitor->error);
+    if (monitor->fd < 0) return 0;
+
+    for (;;) {
+        ssize_t n = read(monitor->fd, monitor->buf + monitor->have, sizeof(monitor->buf) - monitor->have);
+        // EPIPE: records were overwritten before we read them; carry on with the next
+        if (n < 0 && (errno == EINTR || errno == EPIPE)) continue;
+        if (n <= 0) break;  // EAGAIN on /dev/kmsg, end of a fixture file
+        monitor->have += (size_t)n;
+        parse_lines(monitor, stats);
+    }
+    return 0;
+}
+
+void update_event_history(EventMonitor *monitor, EventStats *stats, double memory_usage) {
+    // Severity of each kind for the history mark; higher wins
+    static const int rank[EVENT_KINDS] = {5, 4, 2, 1, 3};
+
+    if (!monitor->history_started) {
+        monitor->marked = stats->total;  // Skip the replayed backlog
+        monitor->history_started = 1;
+    }
+    int mark = 0;
+    for (unsigned long seen = monitor->marked; seen < stats->total; seen++) {
+        const KernelEvent *event = kernel_event(stats, (unsigned int)(stats->total - 1 - seen));
+        if (event && (!mark || rank[event->kind] > rank[mark - 1])) mark = event->kind + 1;
+    }
+    monitor->marked = stats->total;
+
+    if (stats->history_count == EVENT_HISTORY) {
+        memmove(stats->memory_history, stats->memory_history + 1, (EVENT_HISTORY - 1) * sizeof(stats->memory_history[0]));
+        memmove(stats->history_marks, stats->history_marks + 1, EVENT_HISTORY - 1);
+        stats->history_count--;
+    }
+    stats->memory_history[stats->history_count] = memory_usage > 0 ? (unsigned int)(memory_usage + 0.5) : 0;
+    stats->history_marks[stats->history_count] = (unsigned char)mark;
+    stats->history_count++;
+}
+
+const KernelEvent *kernel_event(const EventStats *stats, unsigned int age) {
+    if (age >= stats->total || age >= MAX_EVENTS) return NULL;
+    return &stats->events[(stats->total - 1 - age) % MAX_EVENTS];
+}
+
+void destroy_event_monitor(EventMonitor *monitor) {
+    if (!monitor) return;
+    if (monitor->fd >= 0) close(monitor->fd);
+    free(monitor);
+}
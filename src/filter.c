@@ -0,0 +1,44 @@
+/**
+ * @file filter.c
+ * @brief Implementation of device name filters
+ */
+
+#include "filter.h"
+#include <ctype.h>
+#include <fnmatch.h>
+#include <string.h>
+
+/**
+ * @brief Check a name against a comma-separated pattern list
+ * @param patterns Pattern list
+ * @param name Name to check
+ * @return Non-zero if any pattern matches
+ */
+static int match_any(const char *patterns, const char *name) {
+    char pattern[FILTER_PATTERNS_MAX];
+    const char *p = patterns;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (len > 0 && len < sizeof(pattern)) {
+            // Patterns may be padded with blanks around the commas
+            const char *start = p;
+            while (len > 0 && isspace((unsigned char)*start)) {
+                start++;
+                len--;
+            }
+            while (len > 0 && isspace((unsigned char)start[len - 1])) len--;
+            memcpy(pattern, start, len);
+            pattern[len] = '\0';
+            if (len > 0 && fnmatch(pattern, name, 0) == 0) return 1;
+        }
+        p += strcspn(p, ",");
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+int filter_match(const DeviceFilter *filter, const char *name) {
+    if (!filter) return 1;
+    if (filter->include[0] && !match_any(filter->include, name)) return 0;
+    return !match_any(filter->exclude, name);
+}
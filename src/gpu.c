@@ -4,189 +4,866 @@
  */
 
 #include "gpu.h"
+#include "nvml_binding.h"
+#include "pidcache.h"
+#include "sysfs.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dlfcn.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
 
-// NVIDIA NVML function pointers
+// PCI vendor ids of GPUs read through DRM/sysfs
+#define PCI_VENDOR_AMD 0x1002
+#define PCI_VENDOR_INTEL 0x8086
+
+// Upper bound on samples fetched per buffer per tick
+#define NVML_MAX_SAMPLES 128
+// Upper bound on processes fetched per GPU per tick
+#define NVML_MAX_PROCESSES 64
+
+/**
+ * @brief Per-device NVML queries, used to stop issuing ones a device rejects
+ */
+enum {
+    NVML_METRIC_TEMPERATURE    = 1 << 0,
+    NVML_METRIC_UTILIZATION    = 1 << 1,
+    NVML_METRIC_MEMORY         = 1 << 2,
+    NVML_METRIC_POWER          = 1 << 3,
+    NVML_METRIC_FAN            = 1 << 4,
+    NVML_METRIC_FIELDS         = 1 << 5,
+    NVML_METRIC_UTIL_SAMPLES   = 1 << 6,
+    NVML_METRIC_POWER_SAMPLES  = 1 << 7,
+    NVML_METRIC_COMPUTE_PROCS  = 1 << 8,
+    NVML_METRIC_GRAPHICS_PROCS = 1 << 9,
+    NVML_METRIC_PROCESS_UTIL   = 1 << 10
+};
+
+/**
+ * @brief Per-device descriptor holding everything that stays constant while
+ *        the driver is loaded
+ */
 typedef struct {
-    void *handle;
-    int (*nvmlInit)(void);
-    int (*nvmlShutdown)(void);
-    int (*nvmlDeviceGetCount)(unsigned int *);
-    int (*nvmlDeviceGetHandleByIndex)(unsigned int, void **);
-    int (*nvmlDeviceGetName)(void *, char *, unsigned int);
-    int (*nvmlDeviceGetTemperature)(void *, int, unsigned int *);
-    int (*nvmlDeviceGetUtilizationRates)(void *, void *);
-    int (*nvmlDeviceGetMemoryInfo)(void *, void *);
-    int (*nvmlDeviceGetPowerUsage)(void *, unsigned int *);
-    int (*nvmlDeviceGetFanSpeed)(void *, unsigned int *);
-} NVMLFunctions;
-
-static NVMLFunctions nvml = {0};
-
-/**
- * @brief Load NVIDIA NVML library and functions
- * @return 0 on success, -1 on failure
- */
-static int load_nvml(void) {
-    // Try to load NVML library
-    nvml.handle = dlopen("libnvidia-ml.so", RTLD_LAZY);
-    if (!nvml.handle) {
-        nvml.handle = dlopen("libnvidia-ml.so.1", RTLD_LAZY);
-    }
-    if (!nvml.handle) return -1;
-
-    // Load NVML functions
-    *(void **)(&nvml.nvmlInit) = dlsym(nvml.handle, "nvmlInit_v2");
-    *(void **)(&nvml.nvmlShutdown) = dlsym(nvml.handle, "nvmlShutdown");
-    *(void **)(&nvml.nvmlDeviceGetCount) = dlsym(nvml.handle, "nvmlDeviceGetCount_v2");
-    *(void **)(&nvml.nvmlDeviceGetHandleByIndex) = dlsym(nvml.handle, "nvmlDeviceGetHandleByIndex_v2");
-    *(void **)(&nvml.nvmlDeviceGetName) = dlsym(nvml.handle, "nvmlDeviceGetName");
-    *(void **)(&nvml.nvmlDeviceGetTemperature) = dlsym(nvml.handle, "nvmlDeviceGetTemperature");
-    *(void **)(&nvml.nvmlDeviceGetUtilizationRates) = dlsym(nvml.handle, "nvmlDeviceGetUtilizationRates");
-    *(void **)(&nvml.nvmlDeviceGetMemoryInfo) = dlsym(nvml.handle, "nvmlDeviceGetMemoryInfo");
-    *(void **)(&nvml.nvmlDeviceGetPowerUsage) = dlsym(nvml.handle, "nvmlDeviceGetPowerUsage");
-    *(void **)(&nvml.nvmlDeviceGetFanSpeed) = dlsym(nvml.handle, "nvmlDeviceGetFanSpeed");
-
-    // Check if all functions were loaded
-    return (nvml.nvmlInit && nvml.nvmlShutdown && nvml.nvmlDeviceGetCount &&
-            nvml.nvmlDeviceGetHandleByIndex && nvml.nvmlDeviceGetName &&
-            nvml.nvmlDeviceGetTemperature && nvml.nvmlDeviceGetUtilizationRates &&
-            nvml.nvmlDeviceGetMemoryInfo && nvml.nvmlDeviceGetPowerUsage &&
-            nvml.nvmlDeviceGetFanSpeed) ? 0 : -1;
-}
-
-/**
- * @brief Try to read GPU information from sysfs (for non-NVIDIA GPUs)
- * @param info Pointer to GPUInfo structure
+    NVMLDeviceHandle handle;            /**< NVML device handle */
+    char name[MAX_GPU_NAME];            /**< GPU model name */
+    char uuid[NVML_DEVICE_UUID_V2_BUFFER_SIZE]; /**< Unique id ("GPU-..."), empty if unknown */
+    char pci_bus_id[MAX_GPU_BUS_ID];    /**< PCI bus id (domain:bus:device.function) */
+    unsigned int pci_device_id;         /**< Combined PCI device/vendor id */
+    unsigned long memory_total;         /**< Total GPU memory in bytes */
+    unsigned int skipped;               /**< NVML_METRIC_* bits the device doesn't support */
+    unsigned long long last_util_ts;    /**< Newest utilization sample seen */
+    unsigned long long last_power_ts;   /**< Newest power sample seen */
+    unsigned long long last_process_ts; /**< Newest per-process utilization sample seen */
+} NVMLDevice;
+
+/**
+ * @brief Per-card descriptor for GPUs read through DRM/sysfs
+ *
+ * @details Discovered once at init. Every dynamic attribute is kept open and
+ * re-read with pread(); a descriptor of -1 means the driver does not expose
+ * that attribute.
+ */
+typedef struct {
+    unsigned int card;                  /**< DRM card number */
+    unsigned int vendor;                /**< PCI vendor id */
+    char name[MAX_GPU_NAME];            /**< GPU model name */
+    char pci_bus_id[MAX_GPU_BUS_ID];    /**< PCI bus id */
+    char driver[MAX_GPU_DRIVER];        /**< Kernel driver (amdgpu, i915, xe, ...) */
+    unsigned long memory_total;         /**< VRAM size in bytes, 0 if unknown */
+    unsigned int max_freq_mhz;          /**< Maximum graphics clock in MHz */
+    int busy_fd;                        /**< amdgpu gpu_busy_percent */
+    int vram_used_fd;                   /**< amdgpu mem_info_vram_used */
+    int temp_fd;                        /**< hwmon temp1_input (millidegrees C) */
+    int power_fd;                       /**< hwmon power1_average/power1_input (microwatts) */
+    int pwm_fd;                         /**< hwmon pwm1 (0-255) */
+    int freq_fd;                        /**< Current graphics clock */
+    unsigned int freq_divisor;          /**< Converts freq_fd's unit to MHz */
+    int rc6_fd;                         /**< i915/xe RC6 (GT idle) residency in ms */
+    unsigned long long prev_rc6_ms;     /**< Residency at the previous tick */
+    struct timespec prev_rc6_time;      /**< Time of the previous residency read */
+    int have_rc6_baseline;              /**< Whether prev_rc6_* are valid */
+} SysfsGPU;
+
+/**
+ * @brief NVML binding, device tables and query scratch buffers of one monitor
+ */
+struct GPUMonitor {
+    NVMLBinding nvml;
+    NVMLDevice nvml_devices[MAX_GPUS];
+    unsigned int nvml_device_count;
+    int nvml_devices_stale;  // Set when the table must be rebuilt
+    SysfsGPU sysfs_gpus[MAX_GPUS];
+    unsigned int sysfs_gpu_count;
+    NVMLSample sample_buffer[NVML_MAX_SAMPLES];
+    NVMLProcessInfo process_buffer[NVML_MAX_PROCESSES];
+    NVMLProcessUtilizationSample process_util_buffer[NVML_MAX_PROCESSES];
+    GPUProcessStats process_table[NVML_MAX_PROCESSES];
+    PidCache *pids;  // Names and cgroups of the processes seen on the devices
+};
+
+/**
+ * @brief Check whether a query is still worth issuing on a device
+ */
+#define NVML_WANTS(dev, metric) (!((dev)->skipped & (metric)))
+
+/**
+ * @brief Apply the error policy to the result of a per-device query
+ * @param monitor Monitor owning the device table
+ * @param dev Device the query was issued on
+ * @param metric NVML_METRIC_* bit of the query
+ * @param ret Return code of the query
+ * @return 1 if the call succeeded, 0 otherwise
+ *
+ * @details Unsupported metrics are skipped on this device from now on, stale
+ * handles trigger a rebuild of the descriptor table on the next tick, and
+ * transient errors are simply retried next tick.
+ */
+static int nvml_check(GPUMonitor *monitor, NVMLDevice *dev, unsigned int metric, NVMLReturn ret) {
+    switch (nvml_error_policy(ret)) {
+        case NVML_POLICY_OK:
+            return 1;
+        case NVML_POLICY_SKIP:
+            dev->skipped |= metric;
+            return 0;
+        case NVML_POLICY_REDISCOVER:
+            monitor->nvml_devices_stale = 1;
+            return 0;
+        case NVML_POLICY_RETRY:
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Carry a device's sample positions over a rebuild of the table
+ * @param monitor Monitor holding the previous table
+ * @param dev Newly discovered device
+ *
+ * @details Indices and handles can change when the table is rebuilt after a
+ * lost GPU, so the device is matched by UUID or, without one, by PCI bus
+ * id. Starting from 0 instead would fetch the driver's whole sample buffer
+ * again and add samples already in the history a second time.
+ */
+static void keep_sample_positions(const GPUMonitor *monitor, NVMLDevice *dev) {
+    for (unsigned int i = 0; i < monitor->nvml_device_count; i++) {
+        const NVMLDevice *old = &monitor->nvml_devices[i];
+        int same = dev->uuid[0] ? strcmp(old->uuid, dev->uuid) == 0 :
+                   dev->pci_bus_id[0] && strcmp(old->pci_bus_id, dev->pci_bus_id) == 0;
+        if (!same) continue;
+        dev->last_util_ts = old->last_util_ts;
+        dev->last_power_ts = old->last_power_ts;
+        dev->last_process_ts = old->last_process_ts;
+        return;
+    }
+}
+
+/**
+ * @brief Resolve NVML handles and static properties for all devices
+ * @param monitor Monitor whose device table is rebuilt
+ * @return 0 on success, -1 on failure (the table stays stale)
+ *
+ * @details Handles, names, PCI ids and memory totals never change while the
+ * driver is loaded, so they are queried once here instead of on every tick.
+ * The table is rebuilt only after a dynamic query reports a stale handle;
+ * the new one is built aside and replaces it only once complete.
+ */
+static int discover_nvml_devices(GPUMonitor *monitor) {
+    NVMLDevice found[MAX_GPUS];
+    unsigned int device_count = 0;
+
+    if (monitor->nvml.device_get_count(&device_count) != NVML_SUCCESS) return -1;
+    if (device_count > MAX_GPUS) device_count = MAX_GPUS;
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        NVMLDevice *dev = &found[i];
+        memset(dev, 0, sizeof(*dev));
+
+        if (monitor->nvml.device_get_handle_by_index(i, &dev->handle) != NVML_SUCCESS) return -1;
+
+        char name[NVML_DEVICE_NAME_V2_BUFFER_SIZE];
+        if (monitor->nvml.device_get_name(dev->handle, name, sizeof(name)) != NVML_SUCCESS) {
+            strcpy(name, "Unknown GPU");
+        }
+        strncpy(dev->name, name, MAX_GPU_NAME - 1);
+
+        if (monitor->nvml.device_get_uuid &&
+            monitor->nvml.device_get_uuid(dev->handle, dev->uuid, sizeof(dev->uuid)) != NVML_SUCCESS) {
+            dev->uuid[0] = '\0';
+        }
+
+        NVMLPciInfo pci = {0};
+        if (monitor->nvml.device_get_pci_info &&
+            monitor->nvml.device_get_pci_info(dev->handle, &pci) == NVML_SUCCESS) {
+            strncpy(dev->pci_bus_id, pci.bus_id, MAX_GPU_BUS_ID - 1);
+            dev->pci_device_id = pci.pci_device_id;
+        }
+
+        NVMLMemoryInfo memory = {0};
+        if (nvml_get_memory_info(&monitor->nvml, dev->handle, &memory) == NVML_SUCCESS) {
+            dev->memory_total = memory.total;
+        }
+
+        // Optional entry points the driver doesn't export are skipped up front
+        if (!monitor->nvml.device_get_field_values) dev->skipped |= NVML_METRIC_FIELDS;
+        if (!monitor->nvml.device_get_samples) {
+            dev->skipped |= NVML_METRIC_UTIL_SAMPLES | NVML_METRIC_POWER_SAMPLES;
+        }
+        if (!monitor->nvml.device_get_compute_processes) dev->skipped |= NVML_METRIC_COMPUTE_PROCS;
+        if (!monitor->nvml.device_get_graphics_processes) dev->skipped |= NVML_METRIC_GRAPHICS_PROCS;
+        if (!monitor->nvml.device_get_process_utilization) dev->skipped |= NVML_METRIC_PROCESS_UTIL;
+
+        keep_sample_positions(monitor, dev);
+    }
+
+    memcpy(monitor->nvml_devices, found, device_count * sizeof(found[0]));
+    monitor->nvml_device_count = device_count;
+    monitor->nvml_devices_stale = 0;
+    return 0;
+}
+
+/**
+ * @brief Convert an NVML value to an unsigned integer
+ * @param value Value to convert
+ * @param type Which union member is set
+ * @return The value, or 0 for unknown types
+ */
+static unsigned long long nvml_value_to_ull(const NVMLValue *value, NVMLValueType type) {
+    switch (type) {
+        case NVML_VALUE_TYPE_DOUBLE: return value->d > 0 ? (unsigned long long)value->d : 0;
+        case NVML_VALUE_TYPE_UNSIGNED_INT: return value->ui;
+        case NVML_VALUE_TYPE_UNSIGNED_LONG: return value->ul;
+        case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG: return value->ull;
+        case NVML_VALUE_TYPE_SIGNED_LONG_LONG: return value->sll > 0 ? (unsigned long long)value->sll : 0;
+        case NVML_VALUE_TYPE_SIGNED_INT: return value->si > 0 ? (unsigned long long)value->si : 0;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Append samples to a fixed-size history, dropping the oldest
+ * @param history History array (oldest first)
+ * @param count In/out number of valid entries
+ * @param samples New samples (oldest first)
+ * @param n Number of new samples
+ * @param type Value type of the samples
+ */
+static void push_samples(unsigned int *history, unsigned int *count,
+                         const NVMLSample *samples, unsigned int n, NVMLValueType type) {
+    if (n >= GPU_SAMPLE_HISTORY) {
+        samples += n - GPU_SAMPLE_HISTORY;
+        n = GPU_SAMPLE_HISTORY;
+    }
+    unsigned int keep = *count;
+    if (keep + n > GPU_SAMPLE_HISTORY) {
+        unsigned int drop = keep + n - GPU_SAMPLE_HISTORY;
+        memmove(history, history + drop, (keep - drop) * sizeof(*history));
+        keep -= drop;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        history[keep + i] = (unsigned int)nvml_value_to_ull(&samples[i].value, type);
+    }
+    *count = keep + n;
+}
+
+/**
+ * @brief Fetch the driver's sample buffer since the last seen timestamp
+ * @param monitor Monitor the device belongs to
+ * @param dev Device descriptor
+ * @param sampling_type Buffer to fetch
+ * @param metric NVML_METRIC_* bit for the buffer
+ * @param last_ts In/out newest sample timestamp already consumed
+ * @param history History array to append to
+ * @param count In/out number of valid history entries
+ * @param mean Receives the mean of the new samples
+ * @return Number of new samples, or -1 if the buffer could not be read
+ */
+static int fetch_samples(GPUMonitor *monitor, NVMLDevice *dev, NVMLSamplingType sampling_type,
+                         unsigned int metric, unsigned long long *last_ts, unsigned int *history,
+                         unsigned int *count, double *mean) {
+    NVMLValueType value_type = NVML_VALUE_TYPE_UNSIGNED_INT;
+    unsigned int n = NVML_MAX_SAMPLES;
+
+    NVMLReturn ret = monitor->nvml.device_get_samples(dev->handle, sampling_type, *last_ts,
+                                                      &value_type, &n, monitor->sample_buffer);
+    // NOT_FOUND just means no new samples since last_ts
+    if (ret == NVML_ERROR_NOT_FOUND) return 0;
+    if (!nvml_check(monitor, dev, metric, ret)) return -1;
+    if (n > NVML_MAX_SAMPLES) n = NVML_MAX_SAMPLES;
+
+    // The driver's ring may also hand back samples we have already consumed
+    unsigned int first = 0;
+    while (first < n && monitor->sample_buffer[first].timestamp <= *last_ts) first++;
+    if (first == n) return 0;
+
+    double sum = 0;
+    for (unsigned int i = first; i < n; i++) {
+        sum += (double)nvml_value_to_ull(&monitor->sample_buffer[i].value, value_type);
+        unsigned long long timestamp = monitor->sample_buffer[i].timestamp;
+        if (timestamp > *last_ts) *last_ts = timestamp;
+    }
+    *mean = sum / (n - first);
+    push_samples(history, count, monitor->sample_buffer + first, n - first, value_type);
+    return (int)(n - first);
+}
+
+/**
+ * @brief Find or append a process in a scratch process table
+ * @param table Scratch table of at least NVML_MAX_PROCESSES entries
+ * @param count In/out number of used entries in @p table
+ * @param pid Process id
+ * @return The entry, or NULL if the table is full
+ */
+static GPUProcessStats *process_entry(GPUProcessStats *table, unsigned int *count, unsigned int pid) {
+    for (unsigned int i = 0; i < *count; i++) {
+        if (table[i].pid == pid) return &table[i];
+    }
+    if (*count >= NVML_MAX_PROCESSES) return NULL;
+    GPUProcessStats *entry = &table[(*count)++];
+    memset(entry, 0, sizeof(*entry));
+    entry->pid = pid;
+    return entry;
+}
+
+/**
+ * @brief Merge one running-process list into the scratch table
+ * @param monitor Monitor the device belongs to
+ * @param dev Device descriptor
+ * @param graphics Non-zero for graphics contexts, zero for compute contexts
+ * @param table Scratch table
+ * @param count In/out number of used entries
+ */
+static void collect_running_processes(GPUMonitor *monitor, NVMLDevice *dev, int graphics,
+                                      GPUProcessStats *table, unsigned int *count) {
+    unsigned int metric = graphics ? NVML_METRIC_GRAPHICS_PROCS : NVML_METRIC_COMPUTE_PROCS;
+    if (!NVML_WANTS(dev, metric)) return;
+
+    unsigned int n = NVML_MAX_PROCESSES;
+    NVMLReturn ret = nvml_get_running_processes(&monitor->nvml, dev->handle, graphics,
+                                                monitor->process_buffer, &n);
+    // INSUFFICIENT_SIZE still fills the buffer; we only show the top few anyway
+    if (ret != NVML_ERROR_INSUFFICIENT_SIZE && !nvml_check(monitor, dev, metric, ret)) return;
+    if (n > NVML_MAX_PROCESSES) n = NVML_MAX_PROCESSES;
+
+    for (unsigned int i = 0; i < n; i++) {
+        GPUProcessStats *entry = process_entry(table, count, monitor->process_buffer[i].pid);
+        if (!entry) break;
+        if (monitor->process_buffer[i].used_gpu_memory != NVML_VALUE_NOT_AVAILABLE) {
+            entry->memory_used += monitor->process_buffer[i].used_gpu_memory;
+        }
+    }
+}
+
+/**
+ * @brief Order processes by GPU memory, then SM utilization, descending
+ */
+static int compare_processes(const void *a, const void *b) {
+    const GPUProcessStats *pa = a;
+    const GPUProcessStats *pb = b;
+    if (pa->memory_used != pb->memory_used) return pa->memory_used < pb->memory_used ? 1 : -1;
+    if (pa->sm_util != pb->sm_util) return pa->sm_util < pb->sm_util ? 1 : -1;
+    return 0;
+}
+
+/**
+ * @brief Attribute GPU memory and SM utilization to processes
+ * @param monitor Monitor the device belongs to
+ * @param dev Device descriptor
+ * @param gpu GPUStats whose top-N process table is refreshed
+ *
+ * @details Joins the compute and graphics running-process lists with the
+ * per-process utilization samples since the last tick, then resolves pids to
+ * names and cgroups through the pid cache so /proc is only read for pids we
+ * have not seen recently.
+ */
+static void update_nvml_processes(GPUMonitor *monitor, NVMLDevice *dev, GPUStats *gpu) {
+    GPUProcessStats *table = monitor->process_table;
+    unsigned int count = 0;
+
+    collect_running_processes(monitor, dev, 0, table, &count);
+    collect_running_processes(monitor, dev, 1, table, &count);
+
+    if (NVML_WANTS(dev, NVML_METRIC_PROCESS_UTIL) && count > 0) {
+        unsigned int n = NVML_MAX_PROCESSES;
+        NVMLReturn ret = monitor->nvml.device_get_process_utilization(dev->handle,
+                                                                      monitor->process_util_buffer,
+                                                                      &n, dev->last_process_ts);
+        if (ret == NVML_SUCCESS) {
+            if (n > NVML_MAX_PROCESSES) n = NVML_MAX_PROCESSES;
+            for (unsigned int i = 0; i < n; i++) {
+                const NVMLProcessUtilizationSample *sample = &monitor->process_util_buffer[i];
+                if (sample->timestamp > dev->last_process_ts) dev->last_process_ts = sample->timestamp;
+                // Only attribute to processes that still hold a context
+                for (unsigned int j = 0; j < count; j++) {
+                    if (table[j].pid != sample->pid) continue;
+                    if (sample->sm_util > table[j].sm_util) table[j].sm_util = sample->sm_util;
+                    if (sample->mem_util > table[j].mem_util) table[j].mem_util = sample->mem_util;
+                    break;
+                }
+            }
+        } else if (ret != NVML_ERROR_NOT_FOUND) {
+            nvml_check(monitor, dev, NVML_METRIC_PROCESS_UTIL, ret);
+        }
+    }
+
+    qsort(table, count, sizeof(*table), compare_processes);
+    if (count > MAX_GPU_PROCESSES) count = MAX_GPU_PROCESSES;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const ProcessIdentity *id = pidcache_lookup(monitor->pids, (pid_t)table[i].pid);
+        memcpy(table[i].name, id->name, sizeof(table[i].name));
+        memcpy(table[i].cgroup, id->cgroup, sizeof(table[i].cgroup));
+        gpu->processes[i] = table[i];
+    }
+    gpu->process_count = count;
+}
+
+/**
+ * @brief Refresh the dynamic metrics of one NVIDIA GPU
+ * @param monitor Monitor the device belongs to
+ * @param dev Device descriptor
+ * @param gpu GPUStats to update
+ *
+ * @details Power, energy and memory temperature come from a single batched
+ * nvmlDeviceGetFieldValues call. Utilization and power history come from the
+ * driver's sample buffers, which hold sub-second samples since the last
+ * timestamp we consumed; the power buffer is only read when the batch had no
+ * instantaneous power. Each falls back to the individual query when the
+ * driver does not support the batched form. GPU temperature and memory use
+ * have no field ids and are always queried individually.
  */
-static void read_sysfs_gpu_info(GPUInfo *info) {
-    FILE *fp;
-    char path[256];
-    char line[256];
-    unsigned int gpu_count = 0;
-
-    // Try to find GPUs in sysfs
-    for (unsigned int i = 0; i < MAX_GPUS; i++) {
-        snprintf(path, sizeof(path), "/sys/class/drm/card%u/device/vendor", i);
-        fp = fopen(path, "r");
-        if (!fp) continue;
-
-        GPUStats *gpu = &info->gpus[gpu_count];
-        gpu->supported = 0;  // Limited support for non-NVIDIA GPUs
-
-        // Try to read GPU name
-        snprintf(path, sizeof(path), "/sys/class/drm/card%u/device/product", i);
-        FILE *name_fp = fopen(path, "r");
-        if (name_fp) {
-            if (fgets(line, sizeof(line), name_fp)) {
-                line[strcspn(line, "\n")] = 0;
-                strncpy(gpu->name, line, MAX_GPU_NAME - 1);
-                gpu->name[MAX_GPU_NAME - 1] = '\0';
+static void update_nvml_device(GPUMonitor *monitor, NVMLDevice *dev, GPUStats *gpu) {
+    NVMLDeviceHandle device_handle = dev->handle;
+    int have_power = 0;
+
+    // Batched instantaneous metrics
+    if (NVML_WANTS(dev, NVML_METRIC_FIELDS)) {
+        NVMLFieldValue fields[3] = {
+            { .field_id = NVML_FI_DEV_POWER_INSTANT },
+            { .field_id = NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION },
+            { .field_id = NVML_FI_DEV_MEMORY_TEMP },
+        };
+        if (nvml_check(monitor, dev, NVML_METRIC_FIELDS,
+                       monitor->nvml.device_get_field_values(device_handle, 3, fields))) {
+            for (int f = 0; f < 3; f++) {
+                if (fields[f].nvml_return != NVML_SUCCESS) continue;
+                unsigned long long v = nvml_value_to_ull(&fields[f].value, fields[f].value_type);
+                switch (fields[f].field_id) {
+                    case NVML_FI_DEV_POWER_INSTANT: {
+                        // One point per tick keeps the history going without the sample buffer
+                        NVMLSample sample = { .timestamp = (unsigned long long)fields[f].timestamp,
+                                              .value = fields[f].value };
+                        push_samples(gpu->power_samples, &gpu->power_sample_count, &sample, 1,
+                                     fields[f].value_type);
+                        gpu->power_usage = (int)v;
+                        have_power = 1;
+                        break;
+                    }
+                    case NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION:
+                        gpu->energy_consumed = v;
+                        break;
+                    case NVML_FI_DEV_MEMORY_TEMP:
+                        gpu->memory_temperature = (int)v;
+                        break;
+                }
             }
-            fclose(name_fp);
-        } else {
-            strcpy(gpu->name, "Unknown GPU");
         }
+    }
+
+    // High-resolution utilization since the last tick
+    double mean;
+    int got_util = 0;
+    if (NVML_WANTS(dev, NVML_METRIC_UTIL_SAMPLES)) {
+        int n = fetch_samples(monitor, dev, NVML_GPU_UTILIZATION_SAMPLES, NVML_METRIC_UTIL_SAMPLES,
+                              &dev->last_util_ts, gpu->util_samples,
+                              &gpu->util_sample_count, &mean);
+        if (n > 0) gpu->utilization = mean;
+        // With no new samples keep the previous value rather than a second query
+        got_util = n >= 0;
+    }
+    if (!got_util && NVML_WANTS(dev, NVML_METRIC_UTILIZATION)) {
+        NVMLUtilization utilization = {0};
+        if (nvml_check(monitor, dev, NVML_METRIC_UTILIZATION,
+                       monitor->nvml.device_get_utilization_rates(device_handle, &utilization))) {
+            gpu->utilization = utilization.gpu;
+        }
+    }
 
-        gpu_count++;
-        fclose(fp);
-        
-        if (gpu_count >= MAX_GPUS) break;
+    // Power sample buffer, only needed when the batch had no instantaneous power
+    if (!have_power && NVML_WANTS(dev, NVML_METRIC_POWER_SAMPLES)) {
+        int n = fetch_samples(monitor, dev, NVML_TOTAL_POWER_SAMPLES, NVML_METRIC_POWER_SAMPLES,
+                              &dev->last_power_ts, gpu->power_samples,
+                              &gpu->power_sample_count, &mean);
+        if (n > 0) {
+            gpu->power_usage = (int)mean;
+            have_power = 1;
+        }
+    }
+    if (!have_power && NVML_WANTS(dev, NVML_METRIC_POWER)) {
+        unsigned int power;
+        if (nvml_check(monitor, dev, NVML_METRIC_POWER,
+                       monitor->nvml.device_get_power_usage(device_handle, &power))) {
+            gpu->power_usage = (int)power;
+        }
     }
 
-    info->count = gpu_count;
+    // Get temperature
+    unsigned int temp;
+    if (NVML_WANTS(dev, NVML_METRIC_TEMPERATURE) &&
+        nvml_check(monitor, dev, NVML_METRIC_TEMPERATURE,
+                   monitor->nvml.device_get_temperature(device_handle, NVML_TEMPERATURE_GPU, &temp))) {
+        gpu->temperature = (int)temp;
+    }
+
+    // Get memory info
+    NVMLMemoryInfo memory = {0};
+    if (NVML_WANTS(dev, NVML_METRIC_MEMORY) &&
+        nvml_check(monitor, dev, NVML_METRIC_MEMORY,
+                   nvml_get_memory_info(&monitor->nvml, device_handle, &memory))) {
+        gpu->memory_free = memory.free;
+        gpu->memory_used = memory.used;
+    }
+
+    // Get fan speed
+    unsigned int fan;
+    if (NVML_WANTS(dev, NVML_METRIC_FAN) &&
+        nvml_check(monitor, dev, NVML_METRIC_FAN, monitor->nvml.device_get_fan_speed(device_handle, &fan))) {
+        gpu->fan_speed = (int)fan;
+    }
 }
 
-int init_gpu_monitor(void) {
-    // Try to load NVML
-    if (load_nvml() == 0 && nvml.nvmlInit() == 0) {
-        return 0;
+/**
+ * @brief Open the first attribute of a list that exists
+ * @param dir Absolute directory the attributes live in
+ * @param names NULL-terminated list of attribute names, in order of preference
+ * @return File descriptor, or -1 if none exist
+ */
+static int open_first(const char *dir, const char *const *names) {
+    char path[512];
+    for (; *names; names++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, *names);
+        int fd = sysfs_open(path);
+        if (fd >= 0) return fd;
+    }
+    return -1;
+}
+
+/**
+ * @brief Compare card numbers for qsort
+ */
+static int compare_cards(const void *a, const void *b) {
+    unsigned int ca = *(const unsigned int *)a;
+    unsigned int cb = *(const unsigned int *)b;
+    return (ca > cb) - (ca < cb);
+}
+
+/**
+ * @brief Fill the descriptor of one DRM card
+ * @param dev Descriptor to fill
+ * @param card DRM card number
+ * @return 0 if the card is a GPU, -1 otherwise
+ */
+static int discover_sysfs_gpu(SysfsGPU *dev, unsigned int card) {
+    char card_dir[64];
+    char device_dir[96];
+    char path[512];
+    char buf[256];
+    unsigned long long value;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->card = card;
+    dev->busy_fd = dev->vram_used_fd = dev->temp_fd = -1;
+    dev->power_fd = dev->pwm_fd = dev->freq_fd = dev->rc6_fd = -1;
+    dev->freq_divisor = 1;
+
+    snprintf(card_dir, sizeof(card_dir), "/sys/class/drm/card%u", card);
+    snprintf(device_dir, sizeof(device_dir), "%s/device", card_dir);
+
+    snprintf(path, sizeof(path), "%s/vendor", device_dir);
+    if (sysfs_read_ull(path, &value) != 0) return -1;
+    dev->vendor = (unsigned int)value;
+
+    // Driver and PCI address come from the device's symlinks
+    char full[512];
+    ssize_t n;
+    if (sysfs_path(full, sizeof(full), "%s/driver", device_dir) == 0 &&
+        (n = readlink(full, buf, sizeof(buf) - 1)) > 0) {
+        buf[n] = '\0';
+        const char *base = strrchr(buf, '/');
+        strncpy(dev->driver, base ? base + 1 : buf, MAX_GPU_DRIVER - 1);
+    }
+    if (sysfs_path(full, sizeof(full), "%s", device_dir) == 0 &&
+        (n = readlink(full, buf, sizeof(buf) - 1)) > 0) {
+        buf[n] = '\0';
+        const char *base = strrchr(buf, '/');
+        strncpy(dev->pci_bus_id, base ? base + 1 : buf, MAX_GPU_BUS_ID - 1);
+    }
+
+    // Name: prefer what the driver reports, else the PCI ids
+    snprintf(path, sizeof(path), "%s/product_name", device_dir);
+    if (sysfs_read_string(path, buf, sizeof(buf)) != 0 || buf[0] == '\0') {
+        snprintf(path, sizeof(path), "%s/product", device_dir);
+        if (sysfs_read_string(path, buf, sizeof(buf)) != 0 || buf[0] == '\0') {
+            unsigned long long device_id = 0;
+            snprintf(path, sizeof(path), "%s/device", device_dir);
+            sysfs_read_ull(path, &device_id);
+            const char *vendor = dev->vendor == PCI_VENDOR_AMD ? "AMD" :
+                                 dev->vendor == PCI_VENDOR_INTEL ? "Intel" : "Unknown";
+            snprintf(buf, sizeof(buf), "%s GPU [%04x:%04llx]", vendor, dev->vendor, device_id);
+        }
+    }
+    strncpy(dev->name, buf, MAX_GPU_NAME - 1);
+
+    // amdgpu: busy percentage and VRAM accounting
+    snprintf(path, sizeof(path), "%s/gpu_busy_percent", device_dir);
+    dev->busy_fd = sysfs_open(path);
+    snprintf(path, sizeof(path), "%s/mem_info_vram_used", device_dir);
+    dev->vram_used_fd = sysfs_open(path);
+    snprintf(path, sizeof(path), "%s/mem_info_vram_total", device_dir);
+    if (sysfs_read_ull(path, &value) == 0) dev->memory_total = value;
+
+    // hwmon: temperature, power, fan and (amdgpu) shader clock
+    char hwmon_dir[512];
+    if (sysfs_find_hwmon(device_dir, hwmon_dir, sizeof(hwmon_dir)) == 0) {
+        static const char *const temp_names[] = {"temp1_input", NULL};
+        static const char *const power_names[] = {"power1_average", "power1_input", NULL};
+        static const char *const pwm_names[] = {"pwm1", NULL};
+        static const char *const freq_names[] = {"freq1_input", NULL};
+        dev->temp_fd = open_first(hwmon_dir, temp_names);
+        dev->power_fd = open_first(hwmon_dir, power_names);
+        dev->pwm_fd = open_first(hwmon_dir, pwm_names);
+        dev->freq_fd = open_first(hwmon_dir, freq_names);
+        if (dev->freq_fd >= 0) dev->freq_divisor = 1000000;  // Hz
+    }
+
+    // i915: GT frequency and RC6 residency on the card node
+    if (dev->freq_fd < 0) {
+        static const char *const freq_names[] = {"gt_act_freq_mhz", "gt_cur_freq_mhz", NULL};
+        static const char *const rc6_names[] = {"gt/gt0/rc6_residency_ms", "power/rc6_residency_ms", NULL};
+        dev->freq_fd = open_first(card_dir, freq_names);
+        dev->rc6_fd = open_first(card_dir, rc6_names);
+        snprintf(path, sizeof(path), "%s/gt_max_freq_mhz", card_dir);
+        if (sysfs_read_ull(path, &value) == 0) dev->max_freq_mhz = (unsigned int)value;
+    }
+
+    // xe: per-GT frequency and idle residency under the PCI device
+    if (dev->freq_fd < 0) {
+        char gt_dir[160];
+        snprintf(gt_dir, sizeof(gt_dir), "%s/tile0/gt0", device_dir);
+        static const char *const freq_names[] = {"freq0/act_freq", "freq0/cur_freq", NULL};
+        static const char *const rc6_names[] = {"gtidle/idle_residency_ms", NULL};
+        dev->freq_fd = open_first(gt_dir, freq_names);
+        if (dev->rc6_fd < 0) dev->rc6_fd = open_first(gt_dir, rc6_names);
+        snprintf(path, sizeof(path), "%s/freq0/max_freq", gt_dir);
+        if (sysfs_read_ull(path, &value) == 0) dev->max_freq_mhz = (unsigned int)value;
     }
 
-    // If NVML failed, we'll fall back to sysfs for basic GPU detection
     return 0;
 }
 
-int update_gpu_stats(GPUInfo *info) {
-    if (!info) return -1;
+/**
+ * @brief Close all descriptors held by a sysfs GPU
+ * @param dev Descriptor to release
+ */
+static void release_sysfs_gpu(SysfsGPU *dev) {
+    sysfs_close(&dev->busy_fd);
+    sysfs_close(&dev->vram_used_fd);
+    sysfs_close(&dev->temp_fd);
+    sysfs_close(&dev->power_fd);
+    sysfs_close(&dev->pwm_fd);
+    sysfs_close(&dev->freq_fd);
+    sysfs_close(&dev->rc6_fd);
+}
+
+/**
+ * @brief Discover DRM GPUs (for non-NVIDIA GPUs)
+ * @param monitor Monitor whose card table is filled
+ *
+ * @details Scans /sys/class/drm for cardN nodes once and opens the
+ * attributes each driver exposes: amdgpu's busy percentage and VRAM usage,
+ * hwmon temperature/power/fan, and i915/xe frequency and RC6 residency.
+ */
+static void discover_sysfs_gpus(GPUMonitor *monitor) {
+    unsigned int cards[64];
+    unsigned int card_count = 0;
+    char path[512];
+
+    monitor->sysfs_gpu_count = 0;
+    if (sysfs_path(path, sizeof(path), "/sys/class/drm") != 0) return;
+
+    DIR *dir = opendir(path);
+    if (!dir) return;
+
+    // Only cardN itself; cardN-<connector> entries are outputs
+    struct dirent *ent;
+    while ((ent = readdir(dir)) && card_count < 64) {
+        unsigned int card;
+        int consumed = 0;
+        if (sscanf(ent->d_name, "card%u%n", &card, &consumed) == 1 &&
+            ent->d_name[consumed] == '\0') {
+            cards[card_count++] = card;
+        }
+    }
+    closedir(dir);
+    qsort(cards, card_count, sizeof(cards[0]), compare_cards);
+
+    for (unsigned int i = 0; i < card_count && monitor->sysfs_gpu_count < MAX_GPUS; i++) {
+        if (discover_sysfs_gpu(&monitor->sysfs_gpus[monitor->sysfs_gpu_count], cards[i]) == 0) {
+            monitor->sysfs_gpu_count++;
+        }
+    }
+}
+
+/**
+ * @brief Refresh the dynamic metrics of one DRM GPU
+ * @param dev Card descriptor
+ * @param gpu GPUStats to update
+ */
+static void update_sysfs_gpu(SysfsGPU *dev, GPUStats *gpu) {
+    unsigned long long value;
+    int readable = 0;
+
+    memcpy(gpu->name, dev->name, MAX_GPU_NAME);
+    memcpy(gpu->pci_bus_id, dev->pci_bus_id, MAX_GPU_BUS_ID);
+    memcpy(gpu->driver, dev->driver, MAX_GPU_DRIVER);
+    gpu->memory_total = dev->memory_total;
+    gpu->max_freq_mhz = dev->max_freq_mhz;
+
+    if (sysfs_pread_ull(dev->busy_fd, &value) == 0) {
+        gpu->utilization = (double)value;
+        readable = 1;
+    }
+    if (sysfs_pread_ull(dev->vram_used_fd, &value) == 0) {
+        gpu->memory_used = value;
+        gpu->memory_free = dev->memory_total > value ? dev->memory_total - value : 0;
+        readable = 1;
+    }
+    if (sysfs_pread_ull(dev->temp_fd, &value) == 0) {
+        gpu->temperature = (int)(value / 1000);
+        readable = 1;
+    }
+    if (sysfs_pread_ull(dev->power_fd, &value) == 0) {
+        gpu->power_usage = (int)(value / 1000);  // microwatts to milliwatts
+        readable = 1;
+    }
+    if (sysfs_pread_ull(dev->pwm_fd, &value) == 0) {
+        gpu->fan_speed = (int)(value * 100 / 255);
+        readable = 1;
+    }
+    if (sysfs_pread_ull(dev->freq_fd, &value) == 0) {
+        gpu->freq_mhz = (unsigned int)(value / dev->freq_divisor);
+        readable = 1;
+    }
+
+    // RC6 is the GT's idle state: residency growth over wall time is the idle share
+    if (sysfs_pread_ull(dev->rc6_fd, &value) == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (dev->have_rc6_baseline) {
+            double elapsed_ms = (now.tv_sec - dev->prev_rc6_time.tv_sec) * 1e3 +
+                                (now.tv_nsec - dev->prev_rc6_time.tv_nsec) / 1e6;
+            if (elapsed_ms > 0 && value >= dev->prev_rc6_ms) {
+                double idle = 100.0 * (value - dev->prev_rc6_ms) / elapsed_ms;
+                gpu->rc6_residency = idle > 100.0 ? 100.0 : idle;
+                // No busy counter on Intel: report the time the GT was awake
+                if (dev->busy_fd < 0) gpu->utilization = 100.0 - gpu->rc6_residency;
+            }
+        }
+        dev->prev_rc6_ms = value;
+        dev->prev_rc6_time = now;
+        dev->have_rc6_baseline = 1;
+        readable = 1;
+    }
+
+    gpu->supported = readable;
+}
+
+/**
+ * @brief Read GPU information from sysfs (for non-NVIDIA GPUs)
+ * @param monitor Monitor holding the card table
+ * @param info Pointer to GPUInfo structure
+ */
+static void read_sysfs_gpu_info(GPUMonitor *monitor, GPUInfo *info) {
+    for (unsigned int i = 0; i < monitor->sysfs_gpu_count; i++) {
+        update_sysfs_gpu(&monitor->sysfs_gpus[i], &info->gpus[i]);
+    }
+    info->count = monitor->sysfs_gpu_count;
+}
+
+GPUMonitor *create_gpu_monitor(void) {
+    GPUMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+    monitor->nvml_devices_stale = 1;
+
+    monitor->pids = create_pidcache();
+    if (!monitor->pids) {
+        free(monitor);
+        return NULL;
+    }
+
+    // Try to load NVML; the driver counts nvmlInit calls, so monitors can share it
+    if (nvml_binding_load(&monitor->nvml) == 0) {
+        if (monitor->nvml.init() == NVML_SUCCESS) {
+            discover_nvml_devices(monitor);
+            return monitor;
+        }
+        // Don't keep a library around that we can't use
+        nvml_binding_unload(&monitor->nvml);
+    }
+
+    // If NVML failed, we'll fall back to DRM/sysfs
+    discover_sysfs_gpus(monitor);
+    return monitor;
+}
+
+int update_gpu_stats(GPUMonitor *monitor, GPUInfo *info) {
+    if (!monitor || !info) return -1;
 
     info->count = 0;
     info->nvidia_available = 0;
 
     // Try NVIDIA GPUs first
-    if (nvml.handle) {
-        unsigned int device_count = 0;
-        if (nvml.nvmlDeviceGetCount(&device_count) == 0) {
+    if (monitor->nvml.library) {
+        if (monitor->nvml_devices_stale) discover_nvml_devices(monitor);
+
+        if (!monitor->nvml_devices_stale) {
             info->nvidia_available = 1;
-            info->count = (device_count > MAX_GPUS) ? MAX_GPUS : device_count;
+            info->count = monitor->nvml_device_count;
 
             for (unsigned int i = 0; i < info->count; i++) {
-                void *device_handle = NULL;
+                NVMLDevice *dev = &monitor->nvml_devices[i];
                 GPUStats *gpu = &info->gpus[i];
                 gpu->supported = 1;
 
-                if (nvml.nvmlDeviceGetHandleByIndex(i, &device_handle) == 0) {
-                    // Get GPU name
-                    nvml.nvmlDeviceGetName(device_handle, gpu->name, MAX_GPU_NAME);
-
-                    // Get temperature
-                    unsigned int temp;
-                    if (nvml.nvmlDeviceGetTemperature(device_handle, 0, &temp) == 0) {
-                        gpu->temperature = (int)temp;
-                    }
-
-                    // Get utilization
-                    struct {
-                        unsigned int gpu;
-                        unsigned int memory;
-                    } utilization = {0};
-                    if (nvml.nvmlDeviceGetUtilizationRates(device_handle, &utilization) == 0) {
-                        gpu->utilization = utilization.gpu;
-                    }
-
-                    // Get memory info
-                    struct {
-                        unsigned long long total;
-                        unsigned long long free;
-                        unsigned long long used;
-                    } memory = {0};
-                    if (nvml.nvmlDeviceGetMemoryInfo(device_handle, &memory) == 0) {
-                        gpu->memory_total = memory.total;
-                        gpu->memory_free = memory.free;
-                        gpu->memory_used = memory.used;
-                    }
+                // Static properties come from the descriptor table
+                memcpy(gpu->name, dev->name, MAX_GPU_NAME);
+                memcpy(gpu->pci_bus_id, dev->pci_bus_id, MAX_GPU_BUS_ID);
+                gpu->memory_total = dev->memory_total;
 
-                    // Get power usage
-                    unsigned int power;
-                    if (nvml.nvmlDeviceGetPowerUsage(device_handle, &power) == 0) {
-                        gpu->power_usage = (int)power;
-                    }
-
-                    // Get fan speed
-                    unsigned int fan;
-                    if (nvml.nvmlDeviceGetFanSpeed(device_handle, &fan) == 0) {
-                        gpu->fan_speed = (int)fan;
-                    }
-                }
+                update_nvml_device(monitor, dev, gpu);
+                update_nvml_processes(monitor, dev, gpu);
             }
+            pidcache_sweep(monitor->pids);
             return 0;
         }
     }
 
     // Fall back to sysfs for non-NVIDIA GPUs
-    read_sysfs_gpu_info(info);
+    read_sysfs_gpu_info(monitor, info);
     return 0;
 }
 
-void cleanup_gpu_monitor(void) {
-    if (nvml.handle) {
-        if (nvml.nvmlShutdown) {
-            nvml.nvmlShutdown();
-        }
-        dlclose(nvml.handle);
-        nvml.handle = NULL;
+void destroy_gpu_monitor(GPUMonitor *monitor) {
+    if (!monitor) return;
+
+    if (monitor->nvml.library) {
+        monitor->nvml.shutdown();
+        nvml_binding_unload(&monitor->nvml);
     }
-} 
\ No newline at end of file
+    destroy_pidcache(monitor->pids);
+
+    for (unsigned int i = 0; i < monitor->sysfs_gpu_count; i++) {
+        release_sysfs_gpu(&monitor->sysfs_gpus[i]);
+    }
+    free(monitor);
+}
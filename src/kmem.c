@@ -0,0 +1,361 @@
+/**
+ * @file kmem.c
+ * @brief Implementation of the kernel memory breakdown
+ */
+
+#include "kmem.h"
+#include "sysfs.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KB_TO_BYTES (1024UL)
+#define MAX_TRACKED_CACHES 1024
+#define KMEM_UNKNOWN ((unsigned long)-1)  // Sample taken before a cache existed
+
+/**
+ * @brief Counters of one huge page pool, kept open
+ */
+typedef struct {
+    unsigned long size;
+    int total_fd;     // nr_hugepages
+    int free_fd;      // free_hugepages
+    int reserved_fd;  // resv_hugepages
+    int surplus_fd;   // surplus_hugepages
+} HugePagePool;
+
+/**
+ * @brief A slab cache seen in /proc/slabinfo and its size at each sample
+ */
+typedef struct {
+    char name[MAX_SLAB_NAME];
+    unsigned long size;
+    unsigned long active;
+    int present;  // Listed in the last read
+    unsigned long samples[KMEM_SAMPLES];
+} TrackedCache;
+
+/**
+ * @brief Open files, huge page pools and the growth samples
+ *
+ * @details The samples form a ring; sample_count grows up to KMEM_SAMPLES
+ * and next_sample is where the next one is written.
+ */
+struct KmemMonitor {
+    FILE *meminfo;
+    FILE *slabinfo;  // NULL if not readable
+    char slabinfo_error[64];
+    HugePagePool pools[MAX_HUGEPAGE_SIZES];
+    unsigned int pool_count;
+    TrackedCache *caches;
+    unsigned int cache_count;
+    unsigned int cache_capacity;
+    long long sample_times[KMEM_SAMPLES];  // Monotonic milliseconds
+    unsigned long kernel_samples[KMEM_SAMPLES];
+    unsigned long unreclaimable_samples[KMEM_SAMPLES];
+    unsigned long slab_samples[KMEM_SAMPLES];
+    unsigned int sample_count;
+    unsigned int next_sample;
+};
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Open the counters of every huge page size
+ * @param monitor Monitor to add the pools to
+ */
+static void open_hugepage_pools(KmemMonitor *monitor) {
+    unsigned int sizes[MAX_HUGEPAGE_SIZES];
+    unsigned int count = sysfs_list_indices("/sys/kernel/mm/hugepages", "hugepages-", "kB",
+                                            sizes, MAX_HUGEPAGE_SIZES);
+
+    for (unsigned int i = 0; i < count; i++) {
+        HugePagePool *pool = &monitor->pools[monitor->pool_count];
+        char path[128];
+        pool->size = sizes[i] * KB_TO_BYTES;
+        snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/nr_hugepages", sizes[i]);
+        pool->total_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/free_hugepages", sizes[i]);
+        pool->free_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/resv_hugepages", sizes[i]);
+        pool->reserved_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/surplus_hugepages", sizes[i]);
+        pool->surplus_fd = sysfs_open(path);
+        if (pool->total_fd < 0) {
+            sysfs_close(&pool->free_fd);
+            sysfs_close(&pool->reserved_fd);
+            sysfs_close(&pool->surplus_fd);
+            continue;
+        }
+        monitor->pool_count++;
+    }
+}
+
+KmemMonitor *create_kmem_monitor(void) {
+    KmemMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->meminfo = fopen("/proc/meminfo", "r");
+    if (!monitor->meminfo) {
+        free(monitor);
+        return NULL;
+    }
+    monitor->slabinfo = fopen("/proc/slabinfo", "r");
+    if (!monitor->slabinfo) {
+        snprintf(monitor->slabinfo_error, sizeof(monitor->slabinfo_error), "/proc/slabinfo: %s",
+                 strerror(errno));
+    }
+    open_hugepage_pools(monitor);
+    return monitor;
+}
+
+void destroy_kmem_monitor(KmemMonitor *monitor) {
+    if (!monitor) return;
+    for (unsigned int i = 0; i < monitor->pool_count; i++) {
+        sysfs_close(&monitor->pools[i].total_fd);
+        sysfs_close(&monitor->pools[i].free_fd);
+        sysfs_close(&monitor->pools[i].reserved_fd);
+        sysfs_close(&monitor->pools[i].surplus_fd);
+    }
+    if (monitor->slabinfo) fclose(monitor->slabinfo);
+    fclose(monitor->meminfo);
+    free(monitor->caches);
+    free(monitor);
+}
+
+/**
+ * @brief Read the kernel and huge page fields of /proc/meminfo
+ * @param fp Open /proc/meminfo
+ * @param stats Statistics to update
+ * @return 0 on success, -1 on failure
+ */
+static int read_meminfo(FILE *fp, KmemStats *stats) {
+    // Seeking back to the start makes procfs regenerate the file
+    rewind(fp);
+
+    char line[256];
+    unsigned long slab = KMEM_UNKNOWN, hugetlb = KMEM_UNKNOWN;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long value;
+        if (sscanf(line, "Slab: %lu kB", &value) == 1)
+            slab = value * KB_TO_BYTES;
+        else if (sscanf(line, "SReclaimable: %lu kB", &value) == 1)
+            stats->slab_reclaimable = value * KB_TO_BYTES;
+        else if (sscanf(line, "SUnreclaim: %lu kB", &value) == 1)
+            stats->slab_unreclaimable = value * KB_TO_BYTES;
+        else if (sscanf(line, "KernelStack: %lu kB", &value) == 1)
+            stats->kernel_stack = value * KB_TO_BYTES;
+        else if (sscanf(line, "PageTables: %lu kB", &value) == 1)
+            stats->page_tables = value * KB_TO_BYTES;
+        else if (sscanf(line, "VmallocUsed: %lu kB", &value) == 1)
+            stats->vmalloc_used = value * KB_TO_BYTES;
+        else if (sscanf(line, "Percpu: %lu kB", &value) == 1)
+            stats->percpu = value * KB_TO_BYTES;
+        else if (sscanf(line, "HugePages_Total: %lu", &value) == 1)
+            stats->hugepages_total = value;
+        else if (sscanf(line, "HugePages_Free: %lu", &value) == 1)
+            stats->hugepages_free = value;
+        else if (sscanf(line, "Hugepagesize: %lu kB", &value) == 1)
+            stats->hugepage_size = value * KB_TO_BYTES;
+        else if (sscanf(line, "Hugetlb: %lu kB", &value) == 1)
+            hugetlb = value * KB_TO_BYTES;
+    }
+    if (slab == KMEM_UNKNOWN) return -1;  // Failed to read memory info
+
+    stats->slab = slab;
+    stats->kernel = stats->slab_unreclaimable + stats->kernel_stack + stats->page_tables +
+                    stats->vmalloc_used + stats->percpu;
+
+    // Kernels before 4.16 have no Hugetlb line; only the default size is counted then
+    stats->hugetlb = hugetlb != KMEM_UNKNOWN ? hugetlb : stats->hugepages_total * stats->hugepage_size;
+    return 0;
+}
+
+/**
+ * @brief Read the huge page pools of every size
+ * @param monitor Monitor with the open pools
+ * @param stats Statistics to update
+ */
+static void read_hugepage_pools(KmemMonitor *monitor, KmemStats *stats) {
+    stats->hugepage_count = monitor->pool_count;
+    for (unsigned int i = 0; i < monitor->pool_count; i++) {
+        const HugePagePool *pool = &monitor->pools[i];
+        HugePageStats *out = &stats->hugepages[i];
+        unsigned long long value;
+        out->size = pool->size;
+        out->total = sysfs_pread_ull(pool->total_fd, &value) == 0 ? (unsigned long)value : 0;
+        out->free = sysfs_pread_ull(pool->free_fd, &value) == 0 ? (unsigned long)value : 0;
+        out->reserved = sysfs_pread_ull(pool->reserved_fd, &value) == 0 ? (unsigned long)value : 0;
+        out->surplus = sysfs_pread_ull(pool->surplus_fd, &value) == 0 ? (unsigned long)value : 0;
+    }
+}
+
+/**
+ * @brief Find a tracked cache by name, adding it if it is new
+ * @param monitor Monitor with the tracked caches
+ * @param name Cache name
+ * @param hint Index the cache had in the last read; slabinfo keeps its order
+ * @return Tracked cache, or NULL if no more can be tracked
+ */
+static TrackedCache *track_cache(KmemMonitor *monitor, const char *name, unsigned int hint) {
+    if (hint < monitor->cache_count && !strcmp(monitor->caches[hint].name, name)) {
+        return &monitor->caches[hint];
+    }
+    for (unsigned int i = 0; i < monitor->cache_count; i++) {
+        if (!strcmp(monitor->caches[i].name, name)) return &monitor->caches[i];
+    }
+
+    if (monitor->cache_count == monitor->cache_capacity) {
+        if (monitor->cache_capacity >= MAX_TRACKED_CACHES) return NULL;
+        unsigned int capacity = monitor->cache_capacity ? monitor->cache_capacity * 2 : 256;
+        TrackedCache *caches = realloc(monitor->caches, capacity * sizeof(*caches));
+        if (!caches) return NULL;
+        monitor->caches = caches;
+        monitor->cache_capacity = capacity;
+    }
+    TrackedCache *cache = &monitor->caches[monitor->cache_count++];
+    memset(cache, 0, sizeof(*cache));
+    snprintf(cache->name, sizeof(cache->name), "%s", name);
+    for (unsigned int i = 0; i < KMEM_SAMPLES; i++) cache->samples[i] = KMEM_UNKNOWN;
+    return cache;
+}
+
+/**
+ * @brief Read the size of every slab cache
+ * @param monitor Monitor with the open slabinfo
+ * @return 0 on success, -1 if slabinfo could not be read
+ *
+ * @details Lines are "name active_objs num_objs objsize ..."; the two
+ * header lines do not parse and are skipped.
+ */
+static int read_slabinfo(KmemMonitor *monitor) {
+    rewind(monitor->slabinfo);
+    for (unsigned int i = 0; i < monitor->cache_count; i++) monitor->caches[i].present = 0;
+
+    char line[512];
+    unsigned int index = 0;
+    while (fgets(line, sizeof(line), monitor->slabinfo)) {
+        char name[MAX_SLAB_NAME];
+        unsigned long active_objs, num_objs, objsize;
+        if (sscanf(line, "%31s %lu %lu %lu", name, &active_objs, &num_objs, &objsize) != 4) continue;
+
+        TrackedCache *cache = track_cache(monitor, name, index++);
+        if (!cache) continue;
+        cache->size = num_objs * objsize;
+        cache->active = active_objs * objsize;
+        cache->present = 1;
+    }
+    return ferror(monitor->slabinfo) ? -1 : 0;
+}
+
+/**
+ * @brief Change per second of a value since the oldest sample that has it
+ * @param monitor Monitor with the sample times
+ * @param samples Samples of the value, KMEM_UNKNOWN where missing
+ * @param current Current value
+ * @param now Current monotonic time in milliseconds
+ * @return Bytes per second, 0 without an earlier sample
+ */
+static double growth_rate(const KmemMonitor *monitor, const unsigned long *samples,
+                          unsigned long current, long long now) {
+    unsigned int oldest = monitor->sample_count < KMEM_SAMPLES ? 0 : monitor->next_sample;
+    for (unsigned int n = 0; n < monitor->sample_count; n++) {
+        unsigned int i = (oldest + n) % KMEM_SAMPLES;
+        if (samples[i] == KMEM_UNKNOWN) continue;
+        long long elapsed = now - monitor->sample_times[i];
+        if (elapsed <= 0) return 0;
+        return ((double)current - (double)samples[i]) * 1000.0 / elapsed;
+    }
+    return 0;
+}
+
+/**
+ * @brief Compute growth rates and keep a sample every KMEM_SAMPLE_MS
+ * @param monitor Monitor with the samples
+ * @param stats Statistics to update
+ * @param now Current monotonic time in milliseconds
+ */
+static void update_growth(KmemMonitor *monitor, KmemStats *stats, long long now) {
+    if (monitor->sample_count > 0) {
+        unsigned int oldest = monitor->sample_count < KMEM_SAMPLES ? 0 : monitor->next_sample;
+        stats->growth_window = (unsigned int)((now - monitor->sample_times[oldest]) / 1000);
+    }
+    stats->kernel_growth = growth_rate(monitor, monitor->kernel_samples, stats->kernel, now);
+    stats->slab_unreclaimable_growth = growth_rate(monitor, monitor->unreclaimable_samples,
+                                                   stats->slab_unreclaimable, now);
+    stats->slab_growth = growth_rate(monitor, monitor->slab_samples, stats->slab, now);
+
+    unsigned int last = (monitor->next_sample + KMEM_SAMPLES - 1) % KMEM_SAMPLES;
+    if (monitor->sample_count > 0 && now - monitor->sample_times[last] < KMEM_SAMPLE_MS) return;
+
+    unsigned int i = monitor->next_sample;
+    monitor->sample_times[i] = now;
+    monitor->kernel_samples[i] = stats->kernel;
+    monitor->unreclaimable_samples[i] = stats->slab_unreclaimable;
+    monitor->slab_samples[i] = stats->slab;
+    for (unsigned int c = 0; c < monitor->cache_count; c++) {
+        TrackedCache *cache = &monitor->caches[c];
+        cache->samples[i] = cache->present ? cache->size : KMEM_UNKNOWN;
+    }
+    monitor->next_sample = (i + 1) % KMEM_SAMPLES;
+    if (monitor->sample_count < KMEM_SAMPLES) monitor->sample_count++;
+}
+
+/**
+ * @brief Report the largest slab caches with their growth
+ * @param monitor Monitor with the tracked caches
+ * @param stats Statistics to update
+ * @param now Current monotonic time in milliseconds
+ *
+ * @details Picked by repeated selection; only a few of the caches are shown.
+ */
+static void select_caches(const KmemMonitor *monitor, KmemStats *stats, long long now) {
+    unsigned char *shown = calloc(monitor->cache_count ? monitor->cache_count : 1, 1);
+    stats->cache_count = 0;
+    if (!shown) return;
+
+    while (stats->cache_count < MAX_SLAB_CACHES) {
+        int best = -1;
+        for (unsigned int i = 0; i < monitor->cache_count; i++) {
+            if (shown[i] || !monitor->caches[i].present) continue;
+            if (best < 0 || monitor->caches[i].size > monitor->caches[best].size) best = (int)i;
+        }
+        if (best < 0) break;
+        shown[best] = 1;
+
+        const TrackedCache *cache = &monitor->caches[best];
+        SlabCacheStats *out = &stats->caches[stats->cache_count++];
+        snprintf(out->name, sizeof(out->name), "%s", cache->name);
+        out->size = cache->size;
+        out->active = cache->active;
+        out->growth = growth_rate(monitor, cache->samples, cache->size, now);
+    }
+    free(shown);
+}
+
+int update_kmem_stats(KmemMonitor *monitor, KmemStats *stats) {
+    if (!monitor || !stats) return -1;
+    if (read_meminfo(monitor->meminfo, stats) != 0) return -1;
+    read_hugepage_pools(monitor, stats);
+
+    stats->slabinfo_available = monitor->slabinfo && read_slabinfo(monitor) == 0;
+    snprintf(stats->slabinfo_error, sizeof(stats->slabinfo_error), "%s",
+             monitor->slabinfo ? (stats->slabinfo_available ? "" : "/proc/slabinfo: read error") :
+                                 monitor->slabinfo_error);
+
+    // Rates against the samples before this one, then this update may become a sample
+    long long now = now_ms();
+    if (stats->slabinfo_available) select_caches(monitor, stats, now);
+    else stats->cache_count = 0;
+    update_growth(monitor, stats, now);
+    return 0;
+}
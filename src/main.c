@@ -4,90 +4,577 @@
  */
 
 #include "system_monitor.h"
+#include <errno.h>
+#include <getopt.h>
+#include <libgen.h>
 #include <signal.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
 
-static volatile int keep_running = 1;
+/**
+ * @brief Settings given on the command line; they override the config file
+ */
+typedef struct {
+    const char *config_path;
+    int interval;  // 0 if not given
+    const char *rules_path;
+    const char *alert_log;
+    const char *alert_exec;
+    const char *plugin_dir;
+    const char *agent;      // Aggregator address to stream to, or NULL
+    const char *aggregate;  // Address to accept agents on, or NULL
+    char host_name[STREAM_HOST_MAX];
+} Options;
+
+/**
+ * @brief Descriptors the main loop waits on
+ */
+typedef struct {
+    int epoll;
+    int timer;
+    int signals;
+    int inotify;  // -1 without a config file
+    char config_name[256];  // Base name of the config file, matched against inotify events
+} EventSources;
 
 /**
- * @brief Signal handler for clean program termination
- * @param sig Signal number
+ * @brief Raise the soft open-file limit to the hard limit
+ *
+ * @details Collectors keep one descriptor open per sysfs attribute they
+ * poll, which on large machines (cpufreq and cpuidle per CPU) can exceed
+ * the default soft limit of 1024.
  */
-void sig_handler(int sig) {
-    (void)sig;  // Unused parameter
-    keep_running = 0;
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    if (limit.rlim_cur >= limit.rlim_max) return;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
 }
 
-int main(void) {
-    SystemStats stats = {0};
-    
-    // Set up signal handler for clean exit
-    signal(SIGINT, sig_handler);
-    
-    // Initialize CPU monitoring
-    if (init_cpu_monitor() != 0) {
-        fprintf(stderr, "Failed to initialize CPU monitor\n");
+/**
+ * @brief Print command line usage
+ * @param prog Program name
+ */
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [update_interval_ms]\n"
+            "  -c, --config FILE       Read settings from FILE (reloaded on change or SIGHUP)\n"
+            "  -i, --interval MS       Update interval in milliseconds (default 1000)\n"
+            "  -r, --rules FILE        Load alert rules from FILE\n"
+            "  -l, --alert-log FILE    Append alert transitions to FILE\n"
+            "  -x, --alert-exec CMD    Run CMD through /bin/sh on each alert transition\n"
+            "  -p, --plugin-dir DIR    Load collector plugins (*.so) from DIR\n"
+            "  -a, --agent ADDR        Stream snapshots to an aggregator instead of displaying them\n"
+            "  -A, --aggregate ADDR    Accept agents on ADDR and show a summary grid of their hosts\n"
+            "  -n, --host-name NAME    Name to announce as an agent (default: the host name)\n"
+            "                          ADDR is HOST:PORT, :PORT (listen on all) or unix:PATH\n"
+            "  -m, --list-metrics      List the built-in metrics and exit\n"
+            "  -h, --help              Show this help\n",
+            prog);
+}
+
+/**
+ * @brief Print the metric registry: name, instance label, type, unit and description
+ */
+static void list_metrics(void) {
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const MetricInfo *info = &metric_info[id];
+        char name[64];
+        const char *label = metric_instance_labels[info->instance];
+        if (label) snprintf(name, sizeof(name), "%s{%s}", info->name, label);
+        else snprintf(name, sizeof(name), "%s", info->name);
+        printf("%-36s %-8s %-5s %s\n", name, metric_type_names[info->type], info->unit, info->help);
+    }
+}
+
+/**
+ * @brief Parse an update interval in milliseconds
+ * @param text Interval text
+ * @param interval Parsed interval
+ * @return 0 on success, -1 if the text is not a positive number
+ */
+static int parse_interval(const char *text, int *interval) {
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end || value <= 0 || value > 3600000) return -1;
+    *interval = (int)value;
+    return 0;
+}
+
+/**
+ * @brief Parse the command line
+ * @param argc Argument count
+ * @param argv Arguments
+ * @param options Parsed options
+ * @return 0 to run, 1 to exit successfully (help, metric list), -1 on error
+ */
+static int parse_options(int argc, char *argv[], Options *options) {
+    static const struct option long_options[] = {
+        {"config", required_argument, NULL, 'c'},
+        {"interval", required_argument, NULL, 'i'},
+        {"rules", required_argument, NULL, 'r'},
+        {"alert-log", required_argument, NULL, 'l'},
+        {"alert-exec", required_argument, NULL, 'x'},
+        {"plugin-dir", required_argument, NULL, 'p'},
+        {"agent", required_argument, NULL, 'a'},
+        {"aggregate", required_argument, NULL, 'A'},
+        {"host-name", required_argument, NULL, 'n'},
+        {"list-metrics", no_argument, NULL, 'm'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    memset(options, 0, sizeof(*options));
+    while ((opt = getopt_long(argc, argv, "c:i:r:l:x:p:a:A:n:mh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'c': options->config_path = optarg; break;
+        case 'i':
+            if (parse_interval(optarg, &options->interval) != 0) {
+                fprintf(stderr, "Invalid update interval: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'r': options->rules_path = optarg; break;
+        case 'l': options->alert_log = optarg; break;
+        case 'x': options->alert_exec = optarg; break;
+        case 'p': options->plugin_dir = optarg; break;
+        case 'a': options->agent = optarg; break;
+        case 'A': options->aggregate = optarg; break;
+        case 'n':
+            if (!*optarg || strlen(optarg) >= sizeof(options->host_name)) {
+                fprintf(stderr, "Invalid host name: %s\n", optarg);
+                return -1;
+            }
+            snprintf(options->host_name, sizeof(options->host_name), "%s", optarg);
+            break;
+        case 'm':
+            list_metrics();
+            return 1;
+        case 'h':
+            usage(argv[0]);
+            return 1;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    // The interval may also be given positionally
+    if (optind < argc && parse_interval(argv[optind++], &options->interval) != 0) {
+        fprintf(stderr, "Invalid update interval: %s\n", argv[optind - 1]);
+        return -1;
+    }
+    if (optind < argc) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (options->agent && options->aggregate) {
+        fprintf(stderr, "--agent and --aggregate cannot be combined\n");
+        return -1;
+    }
+    if (!options->host_name[0] && gethostname(options->host_name, sizeof(options->host_name)) != 0) {
+        snprintf(options->host_name, sizeof(options->host_name), "localhost");
+    }
+    options->host_name[sizeof(options->host_name) - 1] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Build the configuration from the config file and the command line
+ * @param options Command line options
+ * @param config Configuration to fill
+ * @return 0 on success, -1 if the config file could not be loaded
+ */
+static int build_config(const Options *options, MonitorConfig *config) {
+    default_config(config);
+    if (options->config_path && load_config(options->config_path, config) != 0) return -1;
+
+    if (options->interval) config->interval_ms = options->interval;
+    if (options->rules_path) snprintf(config->alerts.rules, sizeof(config->alerts.rules), "%s", options->rules_path);
+    if (options->alert_log) snprintf(config->alerts.log, sizeof(config->alerts.log), "%s", options->alert_log);
+    if (options->alert_exec) snprintf(config->alerts.exec, sizeof(config->alerts.exec), "%s", options->alert_exec);
+    if (options->plugin_dir) {
+        snprintf(config->plugins.directory, sizeof(config->plugins.directory), "%s", options->plugin_dir);
+    }
+    return 0;
+}
+
+/**
+ * @brief Load alert rules and sinks from a configuration
+ * @param alerts Alert settings
+ * @return 0 on success, -1 on failure (see alert_error())
+ */
+static int start_alerts(const AlertConfig *alerts) {
+    return init_alerts(alerts->rules[0] ? alerts->rules : NULL,
+                       alerts->log[0] ? alerts->log : NULL,
+                       alerts->exec[0] ? alerts->exec : NULL);
+}
+
+/**
+ * @brief (Re)arm the update timer
+ * @param fd timerfd
+ * @param interval_ms Period in milliseconds
+ */
+static void set_timer(int fd, int interval_ms) {
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(fd, 0, &spec, NULL);
+}
+
+/**
+ * @brief Add a descriptor to the epoll set
+ * @param epoll epoll descriptor
+ * @param fd Descriptor to watch for input
+ * @return 0 on success, -1 on failure
+ */
+static int watch_fd(int epoll, int fd) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    return epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+/**
+ * @brief Wait on the kernel event watcher's descriptor, if it has one
+ * @param epoll epoll descriptor
+ *
+ * @details Called after every (re)configuration, since a restarted watcher
+ * has a new descriptor; closing the old one removed it from the set. A
+ * fixture file cannot be added to epoll and is only read on updates.
+ */
+static void watch_event_fd(int epoll) {
+    int fd = collector_event_fd();
+    if (fd >= 0) watch_fd(epoll, fd);  // EEXIST if it is still the same watcher
+}
+
+/**
+ * @brief Close all event sources
+ * @param sources Event sources
+ */
+static void close_event_sources(EventSources *sources) {
+    if (sources->inotify >= 0) close(sources->inotify);
+    if (sources->signals >= 0) close(sources->signals);
+    if (sources->timer >= 0) close(sources->timer);
+    if (sources->epoll >= 0) close(sources->epoll);
+}
+
+/**
+ * @brief Create the timer, signal and config file watch descriptors
+ * @param sources Event sources to fill
+ * @param config_path Config file to watch, or NULL
+ * @return 0 on success, -1 on failure
+ *
+ * @details SIGINT, SIGTERM and SIGHUP are blocked and read through a
+ * signalfd. SIGWINCH is left to ncurses; it interrupts epoll_wait(),
+ * which redraws at the new size. The config file's directory is watched
+ * rather than the file, since editors usually replace the file on save.
+ */
+static int open_event_sources(EventSources *sources, const char *config_path) {
+    sigset_t mask;
+
+    memset(sources, 0, sizeof(*sources));
+    sources->epoll = sources->timer = sources->signals = sources->inotify = -1;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) return -1;
+
+    sources->epoll = epoll_create1(EPOLL_CLOEXEC);
+    sources->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    sources->signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sources->epoll < 0 || sources->timer < 0 || sources->signals < 0 ||
+        watch_fd(sources->epoll, sources->timer) != 0 ||
+        watch_fd(sources->epoll, sources->signals) != 0) {
+        close_event_sources(sources);
+        return -1;
+    }
+
+    if (config_path) {
+        char dir[4096], name[4096];
+        snprintf(dir, sizeof(dir), "%s", config_path);
+        snprintf(name, sizeof(name), "%s", config_path);
+        snprintf(sources->config_name, sizeof(sources->config_name), "%s", basename(name));
+
+        // Without inotify the config can still be reloaded with SIGHUP
+        sources->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (sources->inotify >= 0 &&
+            (inotify_add_watch(sources->inotify, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+             watch_fd(sources->epoll, sources->inotify) != 0)) {
+            close(sources->inotify);
+            sources->inotify = -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Drain inotify events
+ * @param sources Event sources
+ * @return Non-zero if the config file was written or replaced
+ */
+static int config_changed(const EventSources *sources) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t n;
+
+    while ((n = read(sources->inotify, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len && strcmp(event->name, sources->config_name) == 0) changed = 1;
+            p += sizeof(*event) + event->len;
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Reload the config file and apply what changed
+ * @param options Command line options
+ * @param config Running configuration; replaced on success
+ * @param stats Current statistics
+ * @param sources Event sources; the update timer is re-armed for the new intervals
+ *
+ * @details A file that does not parse leaves everything as it was.
+ * Otherwise only collectors whose settings changed are restarted, and
+ * alert rules only if the alert settings changed, so collectors keep
+ * their state and firing alerts stay firing across unrelated edits.
+ */
+static void reload_config(const Options *options, MonitorConfig *config,
+                          SystemStats *stats, const EventSources *sources) {
+    MonitorConfig next;
+    if (build_config(options, &next) != 0) {
+        display_set_status(config_error());
+        return;
+    }
+
+    const char *status = NULL;
+    if (configure_collectors(&next, stats) != 0) status = collector_error();
+
+    if (memcmp(&next.alerts, &config->alerts, sizeof(next.alerts)) != 0) {
+        cleanup_alerts();
+        if (start_alerts(&next.alerts) != 0) {
+            // Keep the rules that were working
+            status = alert_error();
+            cleanup_alerts();
+            start_alerts(&config->alerts);
+            next.alerts = config->alerts;
+        }
+    }
+
+    configure_display(&next.layout);
+    set_timer(sources->timer, collector_tick());
+    watch_event_fd(sources->epoll);
+    *config = next;
+    display_set_status(status);
+}
+
+/**
+ * @brief Wall-clock time in milliseconds, the sample time sent by agents
+ */
+static long long wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Run as an aggregator: accept agents and show their hosts
+ * @param options Command line options
+ * @param config Configuration; only the update interval is used
+ * @param sources Event sources
+ * @return Exit status
+ *
+ * @details No collectors run locally. Agent connections are read as soon
+ * as data arrives and the grid is redrawn on every timer tick.
+ */
+static int run_aggregator(const Options *options, MonitorConfig *config, EventSources *sources) {
+    static HostStats hosts;
+
+    Aggregator *aggregator = create_aggregator(options->aggregate);
+    if (!aggregator) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", options->aggregate, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (watch_fd(sources->epoll, aggregator_fd(aggregator)) != 0 || init_display() != 0) {
+        fprintf(stderr, "Failed to initialize display\n");
+        destroy_aggregator(aggregator);
         return EXIT_FAILURE;
     }
-    
-    // Initialize Memory monitoring
-    if (init_memory_monitoring() != 0) {
-        fprintf(stderr, "Failed to initialize Memory monitor\n");
-        cleanup_cpu_monitor();
+
+    set_timer(sources->timer, config->interval_ms);
+    display_hosts(&hosts);
+
+    int keep_running = 1;
+    while (keep_running) {
+        struct epoll_event events[MAX_HOSTS + 4];
+        int n = epoll_wait(sources->epoll, events, MAX_HOSTS + 4, -1);
+        if (n < 0) {
+            if (errno != EINTR) break;
+            display_hosts(&hosts);  // Most likely SIGWINCH: redraw at the new size
+            continue;
+        }
+
+        int tick = 0, reload = 0;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == sources->timer) {
+                uint64_t expirations;
+                if (read(fd, &expirations, sizeof(expirations)) > 0) tick = 1;
+            } else if (fd == sources->signals) {
+                struct signalfd_siginfo info;
+                while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+                    if (info.ssi_signo == SIGHUP) reload = 1;
+                    else keep_running = 0;
+                }
+            } else if (fd == sources->inotify) {
+                reload |= config_changed(sources);
+            } else if (fd == aggregator_fd(aggregator)) {
+                int client;
+                while ((client = aggregator_accept(aggregator)) >= 0) {
+                    if (watch_fd(sources->epoll, client) != 0) close(client);
+                }
+            } else {
+                aggregator_read(aggregator, fd, &hosts);
+            }
+        }
+
+        if (reload && options->config_path) {
+            MonitorConfig next;
+            if (build_config(options, &next) != 0) {
+                display_set_status(config_error());
+            } else {
+                *config = next;
+                set_timer(sources->timer, config->interval_ms);
+                display_set_status(NULL);
+            }
+        }
+        if (tick && keep_running) display_hosts(&hosts);
+    }
+
+    cleanup_display();
+    destroy_aggregator(aggregator);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    SystemStats stats = {0};
+    MonitorConfig config;
+    EventSources sources;
+    Options options;
+
+    int ret = parse_options(argc, argv, &options);
+    if (ret != 0) return ret > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (build_config(&options, &config) != 0) {
+        fprintf(stderr, "%s\n", config_error());
         return EXIT_FAILURE;
     }
-    
-    // Initialize Disk monitoring
-    if (init_disk_monitor() != 0) {
-        fprintf(stderr, "Failed to initialize Disk monitor\n");
-        cleanup_memory_monitoring();
-        cleanup_cpu_monitor();
+
+    raise_fd_limit();
+    if (open_event_sources(&sources, options.config_path) != 0) {
+        perror("Failed to set up the event loop");
         return EXIT_FAILURE;
     }
-    
-    // Initialize GPU monitoring
-    if (init_gpu_monitor() != 0) {
-        fprintf(stderr, "Failed to initialize GPU monitor\n");
-        cleanup_disk_monitor();
-        cleanup_memory_monitoring();
-        cleanup_cpu_monitor();
+
+    if (options.aggregate) {
+        ret = run_aggregator(&options, &config, &sources);
+        close_event_sources(&sources);
+        return ret;
+    }
+
+    // Start the enabled collectors
+    if (configure_collectors(&config, &stats) != 0) {
+        fprintf(stderr, "%s\n", collector_error());
+        stop_collectors();
+        close_event_sources(&sources);
         return EXIT_FAILURE;
     }
-    
-    // Initialize Network monitoring
-    if (init_network_monitoring() != 0) {
-        fprintf(stderr, "Failed to initialize Network monitor\n");
-        cleanup_gpu_monitor();
-        cleanup_disk_monitor();
-        cleanup_memory_monitoring();
-        cleanup_cpu_monitor();
+
+    watch_event_fd(sources.epoll);
+
+    // Load alert rules
+    if (start_alerts(&config.alerts) != 0) {
+        fprintf(stderr, "%s\n", alert_error());
+        cleanup_alerts();
+        stop_collectors();
+        close_event_sources(&sources);
         return EXIT_FAILURE;
     }
-    
-    // Initialize ncurses
-    if (init_display() != 0) {
-        fprintf(stderr, "Failed to initialize display\n");
-        cleanup_network_monitoring();
-        cleanup_gpu_monitor();
-        cleanup_disk_monitor();
-        cleanup_memory_monitoring();
-        cleanup_cpu_monitor();
+
+    // Initialize ncurses, unless the snapshots go to an aggregator instead
+    StreamAgent *agent = NULL;
+    configure_display(&config.layout);
+    if (options.agent) agent = create_stream_agent(options.agent, options.host_name);
+    if (options.agent ? !agent : init_display() != 0) {
+        fprintf(stderr, "Failed to initialize %s\n", options.agent ? "the agent" : "display");
+        cleanup_alerts();
+        stop_collectors();
+        close_event_sources(&sources);
         return EXIT_FAILURE;
     }
-    
-    // Main program loop
+
+    // Main program loop: one update per timer tick
+    // A failed collector is flagged in stats and shown; the rest is still current
+    set_timer(sources.timer, collector_tick());
+    update_stats(&stats);
+    if (agent) stream_agent_send(agent, &stats.metrics, wall_ms());
+    else display_stats(&stats);
+
+    int keep_running = 1;
     while (keep_running) {
-        if (update_stats(&stats) == 0) {
-            display_stats(&stats);
+        struct epoll_event events[4];
+        int n = epoll_wait(sources.epoll, events, 4, -1);
+        if (n < 0) {
+            if (errno != EINTR) break;
+            if (!agent) display_stats(&stats);  // Most likely SIGWINCH: redraw at the new size
+            continue;
+        }
+
+        int tick = 0, reload = 0, kernel_events = 0;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == collector_event_fd()) {
+                kernel_events = update_events(&stats) == 0;
+            } else if (fd == sources.timer) {
+                uint64_t expirations;
+                if (read(fd, &expirations, sizeof(expirations)) > 0) tick = 1;
+            } else if (fd == sources.signals) {
+                struct signalfd_siginfo info;
+                while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+                    if (info.ssi_signo == SIGHUP) reload = 1;
+                    else keep_running = 0;
+                }
+            } else if (fd == sources.inotify) {
+                reload |= config_changed(&sources);
+            }
+        }
+
+        if (reload && options.config_path) reload_config(&options, &config, &stats, &sources);
+        if (tick && keep_running) {
+            update_stats(&stats);
+            if (agent) stream_agent_send(agent, &stats.metrics, wall_ms());
+            else display_stats(&stats);
+        } else if (kernel_events && !agent) {
+            display_stats(&stats);  // Show a new OOM kill without waiting for the next tick
         }
-        napms(1000);  // Update every second
     }
-    
+
     // Cleanup
-    cleanup_display();
-    cleanup_network_monitoring();
-    cleanup_gpu_monitor();
-    cleanup_disk_monitor();
-    cleanup_memory_monitoring();
-    cleanup_cpu_monitor();
+    if (agent) destroy_stream_agent(agent);
+    else cleanup_display();
+    cleanup_alerts();
+    stop_collectors();
+    close_event_sources(&sources);
     return EXIT_SUCCESS;
-} 
\ No newline at end of file
+}
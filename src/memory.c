@@ -5,6 +5,7 @@
 
 #include "memory.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/sysinfo.h>
 
@@ -14,32 +15,39 @@
 #define GB_TO_BYTES (1024UL * 1024UL * 1024UL)
 
 /**
- * @brief Initialize memory monitoring
- * @return 0 on success, -1 on failure
+ * @brief /proc/meminfo, kept open and re-read from the start on each update
  */
-int init_memory_monitoring(void) {
-    // Check if we can read memory information
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp) return -1;
-    fclose(fp);
-    return 0;
+struct MemoryMonitor {
+    FILE *meminfo;
+};
+
+MemoryMonitor *create_memory_monitor(void) {
+    MemoryMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->meminfo = fopen("/proc/meminfo", "r");
+    if (!monitor->meminfo) {
+        free(monitor);
+        return NULL;
+    }
+    return monitor;
 }
 
-/**
- * @brief Clean up memory monitoring resources
- */
-void cleanup_memory_monitoring(void) {
-    // No cleanup needed for memory monitoring
+void destroy_memory_monitor(MemoryMonitor *monitor) {
+    if (!monitor) return;
+    fclose(monitor->meminfo);
+    free(monitor);
 }
 
 /**
  * @brief Read memory information from /proc/meminfo
+ * @param fp Open /proc/meminfo
  * @param stats Pointer to MemoryStats structure to update
  * @return 0 on success, -1 on failure
  */
-static int read_proc_meminfo(MemoryStats *stats) {
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp) return -1;
+static int read_proc_meminfo(FILE *fp, MemoryStats *stats) {
+    // Seeking back to the start makes procfs regenerate the file
+    rewind(fp);
 
     char line[256];
     unsigned long memTotal = 0, memFree = 0, memAvailable = 0;
@@ -68,8 +76,6 @@ static int read_proc_meminfo(MemoryStats *stats) {
             sreclaimable = value * KB_TO_BYTES;
     }
 
-    fclose(fp);
-
     if (memTotal == 0) return -1;  // Failed to read memory info
 
     // Calculate actual memory values
@@ -96,11 +102,7 @@ static int read_proc_meminfo(MemoryStats *stats) {
     return 0;
 }
 
-int update_memory_stats(MemoryStats *stats) {
-    if (!stats) return -1;
-    return read_proc_meminfo(stats);
-}
-
-void cleanup_memory_monitor(void) {
-    // Nothing to clean up
+int update_memory_stats(MemoryMonitor *monitor, MemoryStats *stats) {
+    if (!monitor || !stats) return -1;
+    return read_proc_meminfo(monitor->meminfo, stats);
 } 
\ No newline at end of file
@@ -0,0 +1,116 @@
+/**
+ * @file metrics.c
+ * @brief Implementation of the metric registry
+ */
+
+#include "metrics.h"
+#include "system_monitor.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// C type of a SystemStats member; other types do not compile
+#define FIELD_TYPE(field) _Generic(((const SystemStats *)0)->field, \
+    double: METRIC_FIELD_DOUBLE, \
+    int: METRIC_FIELD_INT, \
+    unsigned int: METRIC_FIELD_UINT, \
+    unsigned long: METRIC_FIELD_ULONG, \
+    unsigned long long: METRIC_FIELD_ULLONG)
+
+const MetricInfo metric_info[METRIC_COUNT] = {
+#define METRIC_INFO(id, name, unit, type, instance, field, help) \
+    {name, unit, type, instance, help, METRIC_SLOT_##id, METRIC_SLOTS_##instance, \
+     FIELD_TYPE(field), offsetof(SystemStats, field)},
+    METRIC_TABLE(METRIC_INFO)
+#undef METRIC_INFO
+};
+
+const char *const metric_instance_labels[METRIC_INSTANCE_KINDS] = {
+    NULL, "cpu", "mount", "interface", "gpu"
+};
+
+const char *const metric_type_names[] = {"gauge", "counter", "rate"};
+
+// Distance between the fields of two consecutive instances
+static const size_t instance_stride[METRIC_INSTANCE_KINDS] = {
+    0, sizeof(double), sizeof(DiskStats), sizeof(NetworkInterfaceStats), sizeof(GPUStats)
+};
+
+int find_metric(const char *name, int per_instance) {
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        if ((metric_info[id].instance != METRIC_SCALAR) == (per_instance != 0) &&
+            strcmp(metric_info[id].name, name) == 0) return id;
+    }
+    return -1;
+}
+
+unsigned int metric_instance_count(const SystemStats *stats, MetricInstance kind) {
+    unsigned int count;
+    switch (kind) {
+    case METRIC_PER_CPU: count = stats->cpu.cpu_count < MAX_CPUS ? stats->cpu.cpu_count : MAX_CPUS; break;
+    case METRIC_PER_DISK: count = stats->disks.count > 0 ? (unsigned int)stats->disks.count : 0; break;
+    case METRIC_PER_INTERFACE:
+        count = stats->network.interface_count > 0 ? (unsigned int)stats->network.interface_count : 0;
+        break;
+    case METRIC_PER_GPU: count = stats->gpus.count; break;
+    default: return 1;
+    }
+    return count;
+}
+
+const char *metric_instance_label(const SystemStats *stats, MetricInstance kind,
+                                  unsigned int index, char *buf, size_t size) {
+    if (index >= metric_instance_count(stats, kind)) return NULL;
+    switch (kind) {
+    case METRIC_PER_DISK: return stats->disks.disks[index].mount_point;
+    case METRIC_PER_INTERFACE: return stats->network.interfaces[index].interface;
+    case METRIC_PER_CPU:
+    case METRIC_PER_GPU:
+        snprintf(buf, size, "%u", index);
+        return buf;
+    default:
+        return "";
+    }
+}
+
+/**
+ * @brief Read one field as a double
+ * @param field Address of the field
+ * @param type C type of the field
+ * @return Field value
+ */
+static double read_field(const char *field, MetricField type) {
+    switch (type) {
+    case METRIC_FIELD_DOUBLE: return *(const double *)field;
+    case METRIC_FIELD_INT: return *(const int *)field;
+    case METRIC_FIELD_UINT: return *(const unsigned int *)field;
+    case METRIC_FIELD_ULONG: return (double)*(const unsigned long *)field;
+    case METRIC_FIELD_ULLONG: return (double)*(const unsigned long long *)field;
+    }
+    return NAN;
+}
+
+void update_metric_snapshot(const SystemStats *stats, MetricSnapshot *snapshot) {
+    unsigned int counts[METRIC_INSTANCE_KINDS];
+    for (int kind = 0; kind < METRIC_INSTANCE_KINDS; kind++) {
+        counts[kind] = metric_instance_count(stats, (MetricInstance)kind);
+    }
+
+    // Fields are visited in table order, so each metric writes one contiguous run of slots
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const MetricInfo *info = &metric_info[id];
+        double *values = &snapshot->values[info->slot];
+        const char *field = (const char *)stats + info->offset;
+        size_t stride = instance_stride[info->instance];
+        unsigned int count = counts[info->instance];
+
+        unsigned int i;
+        for (i = 0; i < count; i++) values[i] = read_field(field + i * stride, info->field);
+        for (; i < info->slots; i++) values[i] = NAN;
+    }
+
+    // Offline CPUs have a negative usage
+    for (unsigned int i = 0; i < counts[METRIC_PER_CPU]; i++) {
+        if (stats->cpu.cpu_usage[i] < 0) snapshot->values[METRIC_SLOT_CPU_CORE_USAGE + i] = NAN;
+    }
+}
@@ -5,6 +5,7 @@
 
 #include "network.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -19,21 +20,24 @@ typedef struct {
     struct timespec timestamp;
 } PreviousStats;
 
-static PreviousStats previous_stats[MAX_INTERFACES];
-
 /**
- * @brief Initialize network monitoring
- * @return 0 on success, -1 on failure
+ * @brief Interface selection and readings of the previous update
  */
-int init_network_monitoring(void) {
+struct NetworkMonitor {
+    DeviceFilter filter;
+    PreviousStats previous_stats[MAX_INTERFACES];
+};
+
+NetworkMonitor *create_network_monitor(const DeviceFilter *filter) {
     // Check if we can read network statistics
     FILE *fp = fopen(PROC_NET_DEV, "r");
-    if (!fp) return -1;
+    if (!fp) return NULL;
     fclose(fp);
-    
-    // Initialize previous stats
-    memset(previous_stats, 0, sizeof(previous_stats));
-    return 0;
+
+    NetworkMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+    if (filter) monitor->filter = *filter;
+    return monitor;
 }
 
 /**
@@ -90,13 +94,8 @@ static void calculate_speeds(NetworkInterfaceStats *current, PreviousStats *prev
     prev->timestamp = now;
 }
 
-/**
- * @brief Update network statistics
- * @param stats Pointer to NetworkStats structure to update
- * @return 0 on success, -1 on failure
- */
-int update_network_stats(NetworkStats *stats) {
-    if (!stats) return -1;
+int update_network_stats(NetworkMonitor *monitor, NetworkStats *stats) {
+    if (!monitor || !stats) return -1;
     
     FILE *fp = fopen(PROC_NET_DEV, "r");
     if (!fp) return -1;
@@ -110,9 +109,10 @@ int update_network_stats(NetworkStats *stats) {
     
     // Read interface statistics
     while (fgets(line, sizeof(line), fp) && interface_count < MAX_INTERFACES) {
-        if (parse_interface_line(line, &stats->interfaces[interface_count]) == 0) {
+        if (parse_interface_line(line, &stats->interfaces[interface_count]) == 0 &&
+            filter_match(&monitor->filter, stats->interfaces[interface_count].interface)) {
             calculate_speeds(&stats->interfaces[interface_count],
-                           &previous_stats[interface_count]);
+                           &monitor->previous_stats[interface_count]);
             interface_count++;
         }
     }
@@ -122,9 +122,6 @@ int update_network_stats(NetworkStats *stats) {
     return 0;
 }
 
-/**
- * @brief Clean up network monitoring resources
- */
-void cleanup_network_monitoring(void) {
-    // Nothing to clean up
+void destroy_network_monitor(NetworkMonitor *monitor) {
+    free(monitor);
 } 
\ No newline at end of file
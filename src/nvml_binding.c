@@ -0,0 +1,233 @@
+/**
+ * @file nvml_binding.c
+ * @brief Implementation of the typed, versioned NVML binding
+ */
+
+#include "nvml_binding.h"
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+/**
+ * @brief Bind the first symbol of a list that the library exports
+ * @param library dlopen() handle
+ * @param slot Function pointer to fill
+ * @param names NULL-terminated candidate names, newest version first
+ * @return Index of the bound candidate, or -1 if none exist
+ */
+static int bind_first(void *library, void *slot, const char *const *names) {
+    for (int i = 0; names[i]; i++) {
+        void *sym = dlsym(library, names[i]);
+        if (sym) {
+            memcpy(slot, &sym, sizeof(sym));
+            return i;
+        }
+    }
+    return -1;
+}
+
+#define BIND(field, ...) \
+    bind_first(binding->library, &binding->field, (const char *const[]){ __VA_ARGS__, NULL })
+
+int nvml_binding_load(NVMLBinding *binding) {
+    memset(binding, 0, sizeof(*binding));
+
+    // An explicit library path (e.g. the fake NVML in tools/) takes precedence
+    const char *override = getenv("SYSMON_NVML_LIBRARY");
+    if (override && *override) {
+        binding->library = dlopen(override, RTLD_LAZY);
+    } else {
+        binding->library = dlopen("libnvidia-ml.so", RTLD_LAZY);
+        if (!binding->library) binding->library = dlopen("libnvidia-ml.so.1", RTLD_LAZY);
+    }
+    if (!binding->library) return -1;
+
+    BIND(init, "nvmlInit_v2", "nvmlInit");
+    BIND(shutdown, "nvmlShutdown");
+    BIND(device_get_count, "nvmlDeviceGetCount_v2", "nvmlDeviceGetCount");
+    BIND(device_get_handle_by_index, "nvmlDeviceGetHandleByIndex_v2", "nvmlDeviceGetHandleByIndex");
+    BIND(device_get_name, "nvmlDeviceGetName");
+    BIND(device_get_temperature, "nvmlDeviceGetTemperature");
+    BIND(device_get_utilization_rates, "nvmlDeviceGetUtilizationRates");
+    BIND(device_get_power_usage, "nvmlDeviceGetPowerUsage");
+    BIND(device_get_fan_speed, "nvmlDeviceGetFanSpeed");
+    BIND(device_get_memory_info, "nvmlDeviceGetMemoryInfo");
+    BIND(device_get_memory_info_v2, "nvmlDeviceGetMemoryInfo_v2");
+
+    // _v3 and _v2 share the current nvmlProcessInfo_t layout; the unversioned
+    // symbol still uses the two-field v1 layout
+    static const int process_versions[] = {3, 2, 1};
+    int compute = BIND(device_get_compute_processes,
+                       "nvmlDeviceGetComputeRunningProcesses_v3",
+                       "nvmlDeviceGetComputeRunningProcesses_v2",
+                       "nvmlDeviceGetComputeRunningProcesses");
+    int graphics = BIND(device_get_graphics_processes,
+                        "nvmlDeviceGetGraphicsRunningProcesses_v3",
+                        "nvmlDeviceGetGraphicsRunningProcesses_v2",
+                        "nvmlDeviceGetGraphicsRunningProcesses");
+    if (compute >= 0) {
+        binding->process_info_version = process_versions[compute];
+        // Both lists must share a layout; drop graphics rather than mix them
+        if (graphics >= 0 && process_versions[graphics] != binding->process_info_version &&
+            (process_versions[graphics] == 1 || binding->process_info_version == 1)) {
+            binding->device_get_graphics_processes = NULL;
+        }
+    } else if (graphics >= 0) {
+        binding->process_info_version = process_versions[graphics];
+    }
+
+    BIND(error_string, "nvmlErrorString");
+    BIND(device_get_uuid, "nvmlDeviceGetUUID");
+    // The unversioned nvmlDeviceGetPciInfo fills an older struct layout
+    BIND(device_get_pci_info, "nvmlDeviceGetPciInfo_v3", "nvmlDeviceGetPciInfo_v2");
+    BIND(device_get_field_values, "nvmlDeviceGetFieldValues");
+    BIND(device_get_samples, "nvmlDeviceGetSamples");
+    BIND(device_get_process_utilization, "nvmlDeviceGetProcessUtilization");
+
+    if (binding->init && binding->shutdown && binding->device_get_count &&
+        binding->device_get_handle_by_index && binding->device_get_name &&
+        binding->device_get_temperature && binding->device_get_utilization_rates &&
+        binding->device_get_power_usage && binding->device_get_fan_speed &&
+        (binding->device_get_memory_info || binding->device_get_memory_info_v2)) {
+        return 0;
+    }
+
+    nvml_binding_unload(binding);
+    return -1;
+}
+
+#undef BIND
+
+void nvml_binding_unload(NVMLBinding *binding) {
+    if (binding->library) dlclose(binding->library);
+    memset(binding, 0, sizeof(*binding));
+}
+
+NVMLPolicy nvml_error_policy(NVMLReturn ret) {
+    switch (ret) {
+        case NVML_SUCCESS:
+            return NVML_POLICY_OK;
+
+        // The device simply doesn't offer this metric (or not to us)
+        case NVML_ERROR_NOT_SUPPORTED:
+        case NVML_ERROR_NO_PERMISSION:
+        case NVML_ERROR_FUNCTION_NOT_FOUND:
+        case NVML_ERROR_ARGUMENT_VERSION_MISMATCH:
+        case NVML_ERROR_DEPRECATED:
+        case NVML_ERROR_CORRUPTED_INFOROM:
+        case NVML_ERROR_VGPU_ECC_NOT_SUPPORTED:
+        case NVML_ERROR_FREQ_NOT_SUPPORTED:
+            return NVML_POLICY_SKIP;
+
+        // Handles are stale or the driver went away underneath us
+        case NVML_ERROR_UNINITIALIZED:
+        case NVML_ERROR_INVALID_ARGUMENT:
+        case NVML_ERROR_DRIVER_NOT_LOADED:
+        case NVML_ERROR_GPU_IS_LOST:
+        case NVML_ERROR_RESET_REQUIRED:
+        case NVML_ERROR_LIB_RM_VERSION_MISMATCH:
+        case NVML_ERROR_GPU_NOT_FOUND:
+            return NVML_POLICY_REDISCOVER;
+
+        // Everything else is worth another try next tick
+        default:
+            return NVML_POLICY_RETRY;
+    }
+}
+
+const char *nvml_return_name(NVMLReturn ret) {
+    switch (ret) {
+        case NVML_SUCCESS: return "SUCCESS";
+        case NVML_ERROR_UNINITIALIZED: return "UNINITIALIZED";
+        case NVML_ERROR_INVALID_ARGUMENT: return "INVALID_ARGUMENT";
+        case NVML_ERROR_NOT_SUPPORTED: return "NOT_SUPPORTED";
+        case NVML_ERROR_NO_PERMISSION: return "NO_PERMISSION";
+        case NVML_ERROR_ALREADY_INITIALIZED: return "ALREADY_INITIALIZED";
+        case NVML_ERROR_NOT_FOUND: return "NOT_FOUND";
+        case NVML_ERROR_INSUFFICIENT_SIZE: return "INSUFFICIENT_SIZE";
+        case NVML_ERROR_INSUFFICIENT_POWER: return "INSUFFICIENT_POWER";
+        case NVML_ERROR_DRIVER_NOT_LOADED: return "DRIVER_NOT_LOADED";
+        case NVML_ERROR_TIMEOUT: return "TIMEOUT";
+        case NVML_ERROR_IRQ_ISSUE: return "IRQ_ISSUE";
+        case NVML_ERROR_LIBRARY_NOT_FOUND: return "LIBRARY_NOT_FOUND";
+        case NVML_ERROR_FUNCTION_NOT_FOUND: return "FUNCTION_NOT_FOUND";
+        case NVML_ERROR_CORRUPTED_INFOROM: return "CORRUPTED_INFOROM";
+        case NVML_ERROR_GPU_IS_LOST: return "GPU_IS_LOST";
+        case NVML_ERROR_RESET_REQUIRED: return "RESET_REQUIRED";
+        case NVML_ERROR_OPERATING_SYSTEM: return "OPERATING_SYSTEM";
+        case NVML_ERROR_LIB_RM_VERSION_MISMATCH: return "LIB_RM_VERSION_MISMATCH";
+        case NVML_ERROR_IN_USE: return "IN_USE";
+        case NVML_ERROR_MEMORY: return "MEMORY";
+        case NVML_ERROR_NO_DATA: return "NO_DATA";
+        case NVML_ERROR_VGPU_ECC_NOT_SUPPORTED: return "VGPU_ECC_NOT_SUPPORTED";
+        case NVML_ERROR_INSUFFICIENT_RESOURCES: return "INSUFFICIENT_RESOURCES";
+        case NVML_ERROR_FREQ_NOT_SUPPORTED: return "FREQ_NOT_SUPPORTED";
+        case NVML_ERROR_ARGUMENT_VERSION_MISMATCH: return "ARGUMENT_VERSION_MISMATCH";
+        case NVML_ERROR_DEPRECATED: return "DEPRECATED";
+        case NVML_ERROR_NOT_READY: return "NOT_READY";
+        case NVML_ERROR_GPU_NOT_FOUND: return "GPU_NOT_FOUND";
+        case NVML_ERROR_INVALID_STATE: return "INVALID_STATE";
+        default: return "UNKNOWN";
+    }
+}
+
+NVMLReturn nvml_get_memory_info(NVMLBinding *binding, NVMLDeviceHandle device, NVMLMemoryInfo *info) {
+    if (binding->device_get_memory_info_v2) {
+        NVMLMemoryV2 memory = { .version = NVML_STRUCT_VERSION(NVMLMemoryV2, 2) };
+        NVMLReturn ret = binding->device_get_memory_info_v2(device, &memory);
+        if (ret != NVML_ERROR_ARGUMENT_VERSION_MISMATCH && ret != NVML_ERROR_FUNCTION_NOT_FOUND) {
+            if (ret == NVML_SUCCESS) {
+                info->total = memory.total;
+                info->reserved = memory.reserved;
+                info->free = memory.free;
+                info->used = memory.used;
+            }
+            return ret;
+        }
+        // Driver exports the symbol but not this struct version: stay on v1
+        binding->device_get_memory_info_v2 = NULL;
+    }
+
+    if (!binding->device_get_memory_info) return NVML_ERROR_FUNCTION_NOT_FOUND;
+
+    NVMLMemory memory = {0};
+    NVMLReturn ret = binding->device_get_memory_info(device, &memory);
+    if (ret == NVML_SUCCESS) {
+        info->total = memory.total;
+        info->reserved = 0;
+        info->free = memory.free;
+        info->used = memory.used;
+    }
+    return ret;
+}
+
+NVMLReturn nvml_get_running_processes(const NVMLBinding *binding, NVMLDeviceHandle device,
+                                      int graphics, NVMLProcessInfo *infos, unsigned int *count) {
+    NVMLReturn (*get)(NVMLDeviceHandle, unsigned int *, void *) =
+        graphics ? binding->device_get_graphics_processes : binding->device_get_compute_processes;
+    if (!get) return NVML_ERROR_FUNCTION_NOT_FOUND;
+
+    if (binding->process_info_version >= 2) return get(device, count, infos);
+
+    // Legacy layout: fetch into the front of the buffer (it is smaller) and
+    // widen in place from the back so nothing is overwritten before it is read
+    unsigned int capacity = *count;
+    unsigned int legacy_capacity = (unsigned int)(capacity * sizeof(NVMLProcessInfo) /
+                                                  sizeof(NVMLProcessInfoV1));
+    unsigned int n = legacy_capacity < capacity ? legacy_capacity : capacity;
+    NVMLProcessInfoV1 *legacy = (NVMLProcessInfoV1 *)infos;
+
+    NVMLReturn ret = get(device, &n, legacy);
+    if (ret != NVML_SUCCESS && ret != NVML_ERROR_INSUFFICIENT_SIZE) return ret;
+
+    unsigned int filled = n < capacity ? n : capacity;
+    for (unsigned int i = filled; i-- > 0;) {
+        NVMLProcessInfoV1 entry = legacy[i];
+        infos[i].pid = entry.pid;
+        infos[i].used_gpu_memory = entry.used_gpu_memory;
+        infos[i].gpu_instance_id = ~0u;
+        infos[i].compute_instance_id = ~0u;
+    }
+    *count = n;
+    return ret;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file perf.c
+ * @brief Implementation of hardware performance counter monitoring
+ */
+
+#include "perf.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define MAX_PERF_EVENTS 6
+
+// Slots of the hardware group, in read order
+enum {
+    HW_CYCLES,
+    HW_INSTRUCTIONS,
+    HW_CACHE_MISSES,
+    HW_BRANCH_MISSES,
+    HW_STALLED_FRONTEND,
+    HW_STALLED_BACKEND
+};
+
+// Slots of the software fallback group
+enum {
+    SW_CONTEXT_SWITCHES,
+    SW_MIGRATIONS,
+    SW_PAGE_FAULTS
+};
+
+/**
+ * @brief One event of a counter group
+ */
+typedef struct {
+    unsigned int type;
+    unsigned long long config;
+    int required;  // The group is useless without it
+} PerfEventDef;
+
+static const PerfEventDef hardware_events[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 0},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, 0},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND, 0},
+};
+
+// cpu-clock/task-clock are left out: counted per CPU they just track wall time
+static const PerfEventDef software_events[] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, 1},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, 0},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, 0},
+};
+
+/**
+ * @brief Open counter group of one CPU and its previous readings
+ */
+typedef struct {
+    unsigned int cpu;
+    PerfMode mode;                  // Event set the group was opened with
+    int fds[MAX_PERF_EVENTS];       // fds[0] is the group leader; -1 if not opened
+    int position[MAX_PERF_EVENTS];  // Index of each slot in the group read, -1 if missing
+    unsigned int members;           // Number of opened events
+    unsigned long long prev[MAX_PERF_EVENTS];
+    unsigned long long prev_enabled;
+    unsigned long long prev_running;
+} PerfGroup;
+
+/**
+ * @brief Layout of a PERF_FORMAT_GROUP read with both time fields
+ */
+typedef struct {
+    unsigned long long nr;
+    unsigned long long time_enabled;
+    unsigned long long time_running;
+    unsigned long long values[MAX_PERF_EVENTS];
+} PerfGroupRead;
+
+/**
+ * @brief Counter groups of every online CPU
+ */
+struct PerfMonitor {
+    PerfGroup *groups;
+    unsigned int group_count;
+    PerfMode mode;
+    int paranoid;
+    struct timespec prev_read;
+};
+
+/**
+ * @brief Thin wrapper for the perf_event_open system call
+ */
+static int perf_event_open(struct perf_event_attr *attr, int cpu, int group_fd) {
+    return (int)syscall(SYS_perf_event_open, attr, -1, cpu, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief Close every descriptor of a group
+ * @param group Group to close
+ */
+static void close_group(PerfGroup *group) {
+    // Members first, then the leader
+    for (int i = MAX_PERF_EVENTS - 1; i >= 0; i--) sysfs_close(&group->fds[i]);
+    group->members = 0;
+}
+
+/**
+ * @brief Open one counter group on a CPU
+ * @param group Group to fill
+ * @param cpu Logical CPU number
+ * @param defs Event definitions; defs[0] becomes the leader
+ * @param count Number of definitions
+ * @return 0 on success, -1 if a required event could not be opened
+ */
+static int open_group(PerfGroup *group, unsigned int cpu, const PerfEventDef *defs, unsigned int count) {
+    memset(group, 0, sizeof(*group));
+    group->cpu = cpu;
+    for (unsigned int i = 0; i < MAX_PERF_EVENTS; i++) {
+        group->fds[i] = -1;
+        group->position[i] = -1;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = defs[i].type;
+        attr.config = defs[i].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = i == 0;  // Leader starts the whole group at once
+
+        int fd = perf_event_open(&attr, (int)cpu, i == 0 ? -1 : group->fds[0]);
+        if (fd < 0) {
+            if (defs[i].required) {
+                close_group(group);
+                return -1;
+            }
+            continue;
+        }
+        group->fds[i] = fd;
+        group->position[i] = (int)group->members++;
+    }
+
+    ioctl(group->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+/**
+ * @brief Open one group per CPU, hardware events where possible
+ * @param monitor Monitor whose groups are opened
+ * @param cpus Logical CPU numbers
+ * @param count Number of CPUs
+ * @return Number of CPUs with an open hardware group
+ *
+ * @details A CPU whose hardware group cannot be opened (its PMU is busy or
+ * missing) gets the software events instead of being dropped.
+ */
+static unsigned int open_groups(PerfMonitor *monitor, const unsigned int *cpus, unsigned int count) {
+    unsigned int hardware = 0;
+    monitor->group_count = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        PerfGroup *group = &monitor->groups[monitor->group_count];
+        if (open_group(group, cpus[i], hardware_events,
+                       sizeof(hardware_events) / sizeof(hardware_events[0])) == 0) {
+            group->mode = PERF_MODE_HARDWARE;
+            hardware++;
+        } else if (open_group(group, cpus[i], software_events,
+                              sizeof(software_events) / sizeof(software_events[0])) == 0) {
+            group->mode = PERF_MODE_SOFTWARE;
+        } else {
+            continue;
+        }
+        monitor->group_count++;
+    }
+    return hardware;
+}
+
+PerfMonitor *create_perf_monitor(void) {
+    unsigned int cpus[MAX_CPUS];
+    unsigned long long value;
+
+    PerfMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+    monitor->mode = PERF_MODE_NONE;
+
+    FILE *fp = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    if (fp) {
+        if (fscanf(fp, "%d", &monitor->paranoid) != 1) monitor->paranoid = 0;
+        fclose(fp);
+    }
+
+    // Online CPUs are the ones with a topology directory
+    unsigned int listed = sysfs_list_indices("/sys/devices/system/cpu", "cpu", "", cpus, MAX_CPUS);
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < listed; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", cpus[i]);
+        if (sysfs_read_ull(path, &value) == 0) cpus[count++] = cpus[i];
+    }
+    if (count == 0) return monitor;
+
+    monitor->groups = calloc(count, sizeof(*monitor->groups));
+    if (!monitor->groups) {
+        free(monitor);
+        return NULL;
+    }
+
+    if (open_groups(monitor, cpus, count) > 0) {
+        monitor->mode = PERF_MODE_HARDWARE;
+    } else if (monitor->group_count > 0) {
+        monitor->mode = PERF_MODE_SOFTWARE;
+    }
+    return monitor;
+}
+
+/**
+ * @brief Value of one slot over the last interval, scaled for multiplexing
+ * @param group Counter group
+ * @param data Current group read
+ * @param slot Event slot
+ * @param scale time_enabled / time_running over the interval
+ * @return Scaled delta, 0 if the event is missing
+ */
+static double slot_delta(PerfGroup *group, const PerfGroupRead *data, int slot, double scale) {
+    int pos = group->position[slot];
+    if (pos < 0) return 0;
+
+    unsigned long long value = data->values[pos];
+    unsigned long long delta = value >= group->prev[slot] ? value - group->prev[slot] : 0;
+    group->prev[slot] = value;
+    return delta * scale;
+}
+
+/**
+ * @brief Derive the per-CPU metrics from interval deltas
+ * @param mode Which event set the deltas come from
+ * @param out Metrics to fill
+ * @param delta Scaled deltas per slot
+ * @param seconds Wall time of the interval
+ * @param cpus Number of CPUs the deltas cover (for averaged values)
+ */
+static void derive_metrics(PerfMode mode, PerfCPUStats *out, const double *delta,
+                           double seconds, unsigned int cpus) {
+    if (seconds <= 0 || cpus == 0) return;
+
+    if (mode == PERF_MODE_HARDWARE) {
+        double cycles = delta[HW_CYCLES];
+        double instructions = delta[HW_INSTRUCTIONS];
+        out->cycles = cycles / seconds;
+        out->ghz = cycles / seconds / cpus / 1e9;
+        out->ipc = cycles > 0 ? instructions / cycles : 0;
+        out->cache_mpki = instructions > 0 ? delta[HW_CACHE_MISSES] * 1000 / instructions : 0;
+        out->branch_mpki = instructions > 0 ? delta[HW_BRANCH_MISSES] * 1000 / instructions : 0;
+        out->stalled_frontend = cycles > 0 ? 100 * delta[HW_STALLED_FRONTEND] / cycles : 0;
+        out->stalled_backend = cycles > 0 ? 100 * delta[HW_STALLED_BACKEND] / cycles : 0;
+    } else {
+        out->context_switches = delta[SW_CONTEXT_SWITCHES] / seconds;
+        out->migrations = delta[SW_MIGRATIONS] / seconds;
+        out->page_faults = delta[SW_PAGE_FAULTS] / seconds;
+    }
+}
+
+int update_perf_stats(PerfMonitor *monitor, PerfStats *stats) {
+    if (!monitor || !stats) return -1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    struct timespec *prev = &monitor->prev_read;
+    double seconds = prev->tv_sec ? (now.tv_sec - prev->tv_sec) + (now.tv_nsec - prev->tv_nsec) / 1e9 : 0;
+    *prev = now;
+
+    PerfMode mode = monitor->mode;
+    PerfGroup *groups = monitor->groups;
+    unsigned int group_count = monitor->group_count;
+
+    double totals[MAX_PERF_EVENTS] = {0};
+    unsigned int summed = 0;  // Counted CPUs on the monitor's event set
+    unsigned long long enabled_sum = 0, running_sum = 0;
+    const PerfGroup *first_hardware = NULL;
+    for (unsigned int i = 0; i < group_count && !first_hardware; i++) {
+        if (groups[i].mode == PERF_MODE_HARDWARE) first_hardware = &groups[i];
+    }
+
+    memset(&stats->total, 0, sizeof(stats->total));
+    stats->mode = mode;
+    stats->count = 0;
+    stats->counted = 0;
+    stats->fallback = 0;
+    stats->paranoid = monitor->paranoid;
+    stats->has_stalled_frontend = first_hardware && first_hardware->position[HW_STALLED_FRONTEND] >= 0;
+    stats->has_stalled_backend = first_hardware && first_hardware->position[HW_STALLED_BACKEND] >= 0;
+
+    for (unsigned int i = 0; i < group_count && stats->count < MAX_CPUS; i++) {
+        PerfGroup *group = &groups[i];
+        PerfGroupRead data;
+        if (group->mode != mode) stats->fallback++;
+
+        // One read() returns every counter of the group
+        ssize_t n = read(group->fds[0], &data, sizeof(data));
+        if (n < (ssize_t)(3 * sizeof(unsigned long long)) || data.nr != group->members) continue;
+
+        unsigned long long enabled = data.time_enabled - group->prev_enabled;
+        unsigned long long running = data.time_running - group->prev_running;
+        group->prev_enabled = data.time_enabled;
+        group->prev_running = data.time_running;
+        double scale = (running > 0 && running < enabled) ? (double)enabled / running : 1.0;
+        enabled_sum += enabled;
+        running_sum += running;
+
+        // A group that never got on the PMU (CPU offline, counters always
+        // preempted) has no values to scale: leave it out of the totals.
+        // Software fallback groups of a hardware monitor count other events.
+        int counted = running > 0;
+        int summing = counted && group->mode == mode;
+        double delta[MAX_PERF_EVENTS];
+        for (int slot = 0; slot < MAX_PERF_EVENTS; slot++) {
+            delta[slot] = slot_delta(group, &data, slot, scale);
+            if (summing) totals[slot] += delta[slot];
+        }
+        summed += summing;
+
+        PerfCPUStats *cpu = &stats->cpus[stats->count++];
+        memset(cpu, 0, sizeof(*cpu));
+        cpu->cpu = group->cpu;
+        cpu->mode = group->mode;
+        cpu->counted = counted;
+        if (!counted) continue;
+        derive_metrics(group->mode, cpu, delta, seconds, 1);
+        stats->counted++;
+    }
+
+    stats->total.mode = mode;
+    stats->total.counted = summed > 0;
+    derive_metrics(mode, &stats->total, totals, seconds, summed);
+    stats->multiplexed = enabled_sum ? 100.0 * running_sum / enabled_sum : 100.0;
+    return 0;
+}
+
+void destroy_perf_monitor(PerfMonitor *monitor) {
+    if (!monitor) return;
+    for (unsigned int i = 0; i < monitor->group_count; i++) close_group(&monitor->groups[i]);
+    free(monitor->groups);
+    free(monitor);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file pidcache.c
+ * @brief Implementation of cached pid to process name/cgroup lookups
+ */
+
+#include "pidcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Open-addressed table; must be a power of two and comfortably larger than
+// the number of processes looked up per cycle
+#define PIDCACHE_SLOTS 512
+
+struct PidCache {
+    ProcessIdentity table[PIDCACHE_SLOTS];
+    ProcessIdentity live[PIDCACHE_SLOTS];  // Scratch space for pidcache_sweep()
+    unsigned int current_generation;
+};
+
+/**
+ * @brief Hash a pid to its home slot
+ * @param pid Process id
+ * @return Slot index
+ */
+static unsigned int pid_slot(pid_t pid) {
+    return ((unsigned int)pid * 2654435761u) & (PIDCACHE_SLOTS - 1);
+}
+
+/**
+ * @brief Read the cgroup path of a process
+ * @param pid Process id
+ * @param buf Buffer to store the path
+ * @param size Size of the buffer
+ *
+ * @details Prefers the cgroup v2 unified entry ("0::/path"); on v1-only
+ * systems the first hierarchy's path is used.
+ */
+static void read_cgroup(pid_t pid, char *buf, size_t size) {
+    char path[64];
+    char line[512];
+
+    buf[0] = '\0';
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        // Format: hierarchy-id:controllers:path
+        char *p = strchr(line, ':');
+        if (!p) continue;
+        p = strchr(p + 1, ':');
+        if (!p) continue;
+
+        int unified = strncmp(line, "0::", 3) == 0;
+        if (unified || buf[0] == '\0') {
+            strncpy(buf, p + 1, size - 1);
+            buf[size - 1] = '\0';
+        }
+        if (unified) break;
+    }
+    fclose(fp);
+}
+
+/**
+ * @brief Fill an entry from /proc
+ * @param entry Entry to fill
+ * @param pid Process id
+ */
+static void read_identity(ProcessIdentity *entry, pid_t pid) {
+    char path[64];
+
+    entry->pid = pid;
+    strcpy(entry->name, "?");
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        if (fgets(entry->name, sizeof(entry->name), fp)) {
+            entry->name[strcspn(entry->name, "\n")] = '\0';
+        }
+        fclose(fp);
+    }
+
+    read_cgroup(pid, entry->cgroup, sizeof(entry->cgroup));
+}
+
+PidCache *create_pidcache(void) {
+    PidCache *cache = calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+    cache->current_generation = 1;
+    return cache;
+}
+
+const ProcessIdentity *pidcache_lookup(PidCache *cache, pid_t pid) {
+    ProcessIdentity *table = cache->table;
+    unsigned int slot = pid_slot(pid);
+
+    for (unsigned int probe = 0; probe < PIDCACHE_SLOTS; probe++) {
+        ProcessIdentity *entry = &table[(slot + probe) & (PIDCACHE_SLOTS - 1)];
+        if (entry->pid == pid) {
+            entry->generation = cache->current_generation;
+            return entry;
+        }
+        if (entry->pid == 0) {
+            read_identity(entry, pid);
+            entry->generation = cache->current_generation;
+            return entry;
+        }
+    }
+
+    // Table full: evict the home slot rather than fail the lookup
+    ProcessIdentity *entry = &table[slot];
+    read_identity(entry, pid);
+    entry->generation = cache->current_generation;
+    return entry;
+}
+
+void pidcache_sweep(PidCache *cache) {
+    ProcessIdentity *table = cache->table;
+    ProcessIdentity *live = cache->live;
+    unsigned int count = 0;
+
+    // Rebuild the table from live entries; cheaper than tombstones at this size
+    for (unsigned int i = 0; i < PIDCACHE_SLOTS; i++) {
+        if (table[i].pid != 0 && table[i].generation == cache->current_generation) {
+            live[count++] = table[i];
+        }
+    }
+
+    memset(cache->table, 0, sizeof(cache->table));
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int slot = pid_slot(live[i].pid);
+        while (table[slot].pid != 0) slot = (slot + 1) & (PIDCACHE_SLOTS - 1);
+        table[slot] = live[i];
+    }
+
+    cache->current_generation++;
+}
+
+void destroy_pidcache(PidCache *cache) {
+    free(cache);
+}
@@ -0,0 +1,294 @@
+/**
+ * @file plugin.c
+ * @brief Implementation of the plugin registry
+ */
+
+#include "plugin.h"
+#include <dirent.h>
+#include <dlfcn.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief A plugin that is loaded and initialized
+ */
+typedef struct {
+    void *handle;                    // From dlopen()
+    const SysmonPlugin *plugin;
+    void *context;                   // From init()
+    unsigned int metric_count;
+    int interval_ms;
+    long long next_due;              // Monotonic milliseconds
+    double raw[MAX_PLUGIN_METRICS];  // Last sampled values, for counter rates
+    long long raw_time;
+    int has_raw;
+} LoadedPlugin;
+
+static LoadedPlugin loaded[MAX_PLUGINS];
+static unsigned int loaded_count = 0;
+static MonitorConfig applied;  // Settings the loaded plugins were started with
+static char error[CONFIG_VALUE_MAX + 128] = "";
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Record the first load error of a configure_plugins() call
+ * @param fmt printf-style message
+ */
+static void set_error(const char *fmt, ...) {
+    if (error[0]) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(error, sizeof(error), fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * @brief Whether a directory entry looks like a plugin
+ * @param entry Directory entry
+ * @return Non-zero for names ending in ".so"
+ */
+static int is_plugin_file(const struct dirent *entry) {
+    size_t len = strlen(entry->d_name);
+    return entry->d_name[0] != '.' && len > 3 && strcmp(entry->d_name + len - 3, ".so") == 0;
+}
+
+/**
+ * @brief Effective sample interval of a plugin
+ * @param config Configuration
+ * @param name Plugin name
+ * @return Interval in milliseconds
+ */
+static int plugin_interval(const MonitorConfig *config, const char *name) {
+    const PluginSettings *settings = plugin_settings(config, name);
+    return settings && settings->interval_ms > 0 ? settings->interval_ms : config->interval_ms;
+}
+
+/**
+ * @brief Whether plugins must be reloaded for a new configuration
+ * @param config New configuration
+ * @return Non-zero if the directory or any plugin's enabled or args changed
+ */
+static int load_settings_changed(const MonitorConfig *config) {
+    if (strcmp(applied.plugins.directory, config->plugins.directory) != 0) return 1;
+
+    // Compare both ways so that added and removed sections count too
+    for (int pass = 0; pass < 2; pass++) {
+        const MonitorConfig *a = pass ? config : &applied;
+        const MonitorConfig *b = pass ? &applied : config;
+        for (unsigned int i = 0; i < a->plugins.count; i++) {
+            const PluginSettings *settings = &a->plugins.settings[i];
+            const PluginSettings *other = plugin_settings(b, settings->name);
+            int enabled = other ? other->enabled : 1;
+            const char *args = other ? other->args : "";
+            if (settings->enabled != enabled || strcmp(settings->args, args) != 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Unload one plugin
+ * @param entry Loaded plugin
+ */
+static void unload_plugin(LoadedPlugin *entry) {
+    if (entry->context) entry->plugin->cleanup(entry->context);
+    dlclose(entry->handle);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * @brief Load, check and initialize one plugin file
+ * @param config Configuration
+ * @param dir Plugin directory
+ * @param file File name within the directory
+ * @param stats Statistics; the plugin's descriptors are added on success
+ * @return 0 on success or if the plugin is disabled, -1 on failure
+ */
+static int load_plugin(const MonitorConfig *config, const char *dir, const char *file, PluginStats *stats) {
+    char path[CONFIG_VALUE_MAX + 256];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    if (loaded_count >= MAX_PLUGINS) {
+        set_error("%s: more than %d plugins", file, MAX_PLUGINS);
+        return -1;
+    }
+
+    LoadedPlugin *entry = &loaded[loaded_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!entry->handle) {
+        set_error("%s", dlerror());
+        return -1;
+    }
+
+    const SysmonPlugin *plugin = dlsym(entry->handle, SYSMON_PLUGIN_SYMBOL);
+    const char *problem = NULL;
+    if (!plugin) problem = "no " SYSMON_PLUGIN_SYMBOL " symbol";
+    else if (plugin->abi_version != SYSMON_PLUGIN_ABI_VERSION) problem = "built for another plugin ABI version";
+    else if (!plugin->name || !*plugin->name || strlen(plugin->name) >= PLUGIN_NAME_MAX ||
+             strchr(plugin->name, '.')) problem = "bad plugin name";
+    else if (!plugin->init || !plugin->describe || !plugin->sample || !plugin->cleanup) problem = "missing entry point";
+    for (unsigned int i = 0; !problem && i < loaded_count; i++) {
+        if (strcmp(loaded[i].plugin->name, plugin->name) == 0) problem = "duplicate plugin name";
+    }
+    if (problem) {
+        set_error("%s: %s", file, problem);
+        dlclose(entry->handle);
+        return -1;
+    }
+    entry->plugin = plugin;
+
+    const PluginSettings *settings = plugin_settings(config, plugin->name);
+    if (settings && !settings->enabled) {
+        dlclose(entry->handle);
+        return 0;
+    }
+
+    entry->context = plugin->init(settings ? settings->args : "");
+    if (!entry->context) {
+        set_error("%s: init failed", file);
+        dlclose(entry->handle);
+        return -1;
+    }
+
+    const SysmonMetricInfo *metrics = NULL;
+    int count = plugin->describe(entry->context, &metrics);
+    if (count < 0 || (count > 0 && !metrics)) {
+        set_error("%s: describe failed", file);
+        unload_plugin(entry);
+        return -1;
+    }
+    if (count > MAX_PLUGIN_METRICS) count = MAX_PLUGIN_METRICS;
+    entry->metric_count = (unsigned int)count;
+
+    PluginInfo *info = &stats->plugins[loaded_count];
+    memset(info, 0, sizeof(*info));
+    snprintf(info->name, sizeof(info->name), "%s", plugin->name);
+    snprintf(info->title, sizeof(info->title), "%s", plugin->title ? plugin->title : plugin->name);
+    info->metric_count = entry->metric_count;
+    for (int i = 0; i < count; i++) {
+        PluginMetric *metric = &info->metrics[i];
+        snprintf(metric->name, sizeof(metric->name), "%s", metrics[i].name ? metrics[i].name : "");
+        snprintf(metric->label, sizeof(metric->label), "%s", metrics[i].label ? metrics[i].label : metric->name);
+        snprintf(metric->unit, sizeof(metric->unit), "%s", metrics[i].unit ? metrics[i].unit : "");
+        metric->counter = metrics[i].kind == SYSMON_METRIC_COUNTER;
+        metric->value = NAN;
+    }
+
+    loaded_count++;
+    stats->count = loaded_count;
+    return 0;
+}
+
+int configure_plugins(const MonitorConfig *config, PluginStats *stats) {
+    if (!config || !stats) return -1;
+
+    int ret = 0;
+    error[0] = '\0';
+
+    if (load_settings_changed(config)) {
+        stop_plugins();
+        memset(stats, 0, sizeof(*stats));
+
+        const char *dir = config->plugins.directory;
+        if (dir[0]) {
+            struct dirent **entries;
+            int n = scandir(dir, &entries, is_plugin_file, alphasort);
+            if (n < 0) {
+                set_error("%s: cannot read plugin directory", dir);
+                ret = -1;
+            }
+            for (int i = 0; i < n; i++) {
+                if (load_plugin(config, dir, entries[i]->d_name, stats) != 0) ret = -1;
+                free(entries[i]);
+            }
+            if (n > 0) free(entries);
+        }
+    }
+
+    // Interval changes only reschedule
+    long long now = now_ms();
+    for (unsigned int i = 0; i < loaded_count; i++) {
+        int interval = plugin_interval(config, loaded[i].plugin->name);
+        if (interval != loaded[i].interval_ms) loaded[i].next_due = now;
+        loaded[i].interval_ms = interval;
+    }
+
+    applied = *config;
+    return ret;
+}
+
+const char *plugin_error(void) {
+    return error;
+}
+
+int update_plugins(PluginStats *stats) {
+    if (!stats) return -1;
+
+    // Same slack as the built-in collectors: due within half the shortest interval
+    long long now = now_ms();
+    long long slack = plugin_tick() / 2;
+    for (unsigned int i = 0; i < loaded_count; i++) {
+        LoadedPlugin *entry = &loaded[i];
+        PluginInfo *info = &stats->plugins[i];
+        if (now + slack < entry->next_due) continue;
+        entry->next_due = now + entry->interval_ms;
+        info->updated_ms = now;
+
+        double values[MAX_PLUGIN_METRICS];
+        for (unsigned int m = 0; m < entry->metric_count; m++) values[m] = NAN;
+        info->valid = entry->plugin->sample(entry->context, values, entry->metric_count) == 0;
+        if (!info->valid) {
+            for (unsigned int m = 0; m < entry->metric_count; m++) info->metrics[m].value = NAN;
+            entry->has_raw = 0;
+            continue;
+        }
+
+        double seconds = (now - entry->raw_time) / 1000.0;
+        for (unsigned int m = 0; m < entry->metric_count; m++) {
+            PluginMetric *metric = &info->metrics[m];
+            if (!metric->counter) {
+                metric->value = values[m];
+            } else if (entry->has_raw && seconds > 0 && values[m] >= entry->raw[m]) {
+                metric->value = (values[m] - entry->raw[m]) / seconds;
+            } else {
+                metric->value = NAN;  // First sample, counter reset or NAN
+            }
+            entry->raw[m] = values[m];
+        }
+        entry->raw_time = now;
+        entry->has_raw = 1;
+    }
+    return 0;
+}
+
+int plugin_tick(void) {
+    int tick = 0;
+    for (unsigned int i = 0; i < loaded_count; i++) {
+        if (tick == 0 || loaded[i].interval_ms < tick) tick = loaded[i].interval_ms;
+    }
+    return tick;
+}
+
+int plugin_rows(void) {
+    int rows = 0;
+    for (unsigned int i = 0; i < loaded_count; i++) rows += 1 + (int)loaded[i].metric_count;
+    return rows;
+}
+
+void stop_plugins(void) {
+    while (loaded_count > 0) unload_plugin(&loaded[--loaded_count]);
+}
@@ -0,0 +1,225 @@
+/**
+ * @file procmem.c
+ * @brief Implementation of per-process memory detail on a read budget
+ */
+
+#include "procmem.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KB_TO_BYTES (1024UL)
+
+/**
+ * @brief Last smaps_rollup values of one process
+ */
+typedef struct {
+    pid_t pid;
+    unsigned long pss;
+    unsigned long anonymous;
+    unsigned long swap;
+    unsigned long shared_clean;
+    long long read_ms;  // Monotonic time of the last read, -1 if never read
+    int valid;          // The last read succeeded
+} CachedRollup;
+
+/**
+ * @brief A process and its RSS, for ranking
+ */
+typedef struct {
+    pid_t pid;
+    unsigned long rss;
+} RankedProcess;
+
+/**
+ * @brief Settings, names and the cached values of the current top processes
+ */
+struct ProcessMemoryMonitor {
+    unsigned int top;
+    unsigned int budget;
+    unsigned long page_size;
+    PidCache *names;
+    CachedRollup cache[MAX_MEMORY_PROCESSES];  // Same order as the last top list
+    unsigned int cache_count;
+};
+
+ProcessMemoryMonitor *create_process_memory_monitor(unsigned int top, unsigned int budget) {
+    ProcessMemoryMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->names = create_pidcache();
+    if (!monitor->names) {
+        free(monitor);
+        return NULL;
+    }
+    monitor->top = top < 1 ? 1 : top > MAX_MEMORY_PROCESSES ? MAX_MEMORY_PROCESSES : top;
+    monitor->budget = budget < 1 ? 1 : budget;
+    long page_size = sysconf(_SC_PAGESIZE);
+    monitor->page_size = page_size > 0 ? (unsigned long)page_size : 4096;
+    return monitor;
+}
+
+void destroy_process_memory_monitor(ProcessMemoryMonitor *monitor) {
+    if (!monitor) return;
+    destroy_pidcache(monitor->names);
+    free(monitor);
+}
+
+/**
+ * @brief Read the resident set size of a process from /proc/[pid]/statm
+ * @param pid Process id
+ * @param page_size Page size in bytes
+ * @param rss Resident set size in bytes
+ * @return 0 on success, -1 if the process is gone
+ */
+static int read_rss(pid_t pid, unsigned long page_size, unsigned long *rss) {
+    char path[64], buf[128];
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+
+    unsigned long pages;
+    if (sscanf(buf, "%*s %lu", &pages) != 1) return -1;
+    *rss = pages * page_size;
+    return 0;
+}
+
+/**
+ * @brief Read the totals of a process from /proc/[pid]/smaps_rollup
+ * @param entry Cache entry to fill
+ * @return 0 on success, -1 if the file cannot be read (process gone,
+ *         no permission, or a kernel before 4.14)
+ */
+static int read_rollup(CachedRollup *entry) {
+    char path[64], line[128];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)entry->pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    int found = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long value;
+        if (sscanf(line, "Pss: %lu kB", &value) == 1) {
+            entry->pss = value * KB_TO_BYTES;
+            found = 1;
+        } else if (sscanf(line, "Anonymous: %lu kB", &value) == 1) {
+            entry->anonymous = value * KB_TO_BYTES;
+        } else if (sscanf(line, "Swap: %lu kB", &value) == 1) {
+            entry->swap = value * KB_TO_BYTES;
+        } else if (sscanf(line, "Shared_Clean: %lu kB", &value) == 1) {
+            entry->shared_clean = value * KB_TO_BYTES;
+        }
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
+/**
+ * @brief Rank all processes by RSS, keeping the largest
+ * @param monitor Monitor with the number to keep
+ * @param top Largest processes, largest first
+ * @param scanned Number of processes ranked
+ * @return Number of entries in top, or -1 if /proc cannot be listed
+ */
+static int rank_processes(const ProcessMemoryMonitor *monitor, RankedProcess *top, unsigned int *scanned) {
+    DIR *dir = opendir("/proc");
+    if (!dir) return -1;
+
+    unsigned int count = 0;
+    struct dirent *ent;
+    *scanned = 0;
+    while ((ent = readdir(dir))) {
+        if (!isdigit((unsigned char)ent->d_name[0])) continue;
+        pid_t pid = (pid_t)atoi(ent->d_name);
+        unsigned long rss;
+        if (read_rss(pid, monitor->page_size, &rss) != 0 || rss == 0) continue;  // Kernel threads have none
+        (*scanned)++;
+
+        // Insertion into the short sorted list
+        if (count == monitor->top && rss <= top[count - 1].rss) continue;
+        unsigned int i = count < monitor->top ? count++ : count - 1;
+        while (i > 0 && top[i - 1].rss < rss) {
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i].pid = pid;
+        top[i].rss = rss;
+    }
+    closedir(dir);
+    return (int)count;
+}
+
+int update_process_memory_stats(ProcessMemoryMonitor *monitor, ProcessMemoryInfo *stats) {
+    if (!monitor || !stats) return -1;
+
+    RankedProcess top[MAX_MEMORY_PROCESSES];
+    int count = rank_processes(monitor, top, &stats->scanned);
+    if (count < 0) return -1;
+
+    // Carry cached values over for processes still in the top; drop the rest
+    CachedRollup cache[MAX_MEMORY_PROCESSES];
+    for (int i = 0; i < count; i++) {
+        unsigned int j;
+        for (j = 0; j < monitor->cache_count && monitor->cache[j].pid != top[i].pid; j++) {}
+        if (j < monitor->cache_count) {
+            cache[i] = monitor->cache[j];
+        } else {
+            memset(&cache[i], 0, sizeof(cache[i]));
+            cache[i].pid = top[i].pid;
+            cache[i].read_ms = -1;
+        }
+    }
+    memcpy(monitor->cache, cache, count * sizeof(cache[0]));
+    monitor->cache_count = (unsigned int)count;
+
+    // Spend the budget on processes never read first, then on the stalest
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long long start = t0.tv_sec * 1000LL + t0.tv_nsec / 1000000;
+    unsigned char refreshed[MAX_MEMORY_PROCESSES] = {0};
+    stats->reads = 0;
+    while (stats->reads < monitor->budget) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if (refreshed[i]) continue;
+            if (best < 0 || monitor->cache[i].read_ms < monitor->cache[best].read_ms) best = i;
+        }
+        if (best < 0) break;
+        refreshed[best] = 1;
+
+        CachedRollup *entry = &monitor->cache[best];
+        entry->valid = read_rollup(entry) == 0;
+        entry->read_ms = start;
+        stats->reads++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->read_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    stats->budget = monitor->budget;
+
+    for (int i = 0; i < count; i++) {
+        const CachedRollup *entry = &monitor->cache[i];
+        ProcessMemoryStats *out = &stats->processes[i];
+        const ProcessIdentity *id = pidcache_lookup(monitor->names, top[i].pid);
+        out->pid = top[i].pid;
+        snprintf(out->name, sizeof(out->name), "%s", id->name);
+        out->rss = top[i].rss;
+        out->pss = entry->pss;
+        out->anonymous = entry->anonymous;
+        out->swap = entry->swap;
+        out->shared_clean = entry->shared_clean;
+        out->age_ms = entry->read_ms < 0 ? -1 : start - entry->read_ms;
+        out->detailed = entry->valid;
+    }
+    stats->count = (unsigned int)count;
+    pidcache_sweep(monitor->names);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file scheduler.c
+ * @brief Implementation of load average and run-queue delay monitoring
+ */
+
+#include "scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Previous cumulative per-CPU counters from /proc/schedstat
+ */
+struct SchedulerMonitor {
+    unsigned long long prev_run_delay[MAX_CPUS];
+    unsigned long long prev_timeslices[MAX_CPUS];
+    struct timespec prev_read;
+};
+
+/**
+ * @brief Read the load averages and runnable/total task counts
+ * @param stats Pointer to SchedulerStats structure to update
+ * @return 0 on success, -1 on failure
+ */
+static int read_loadavg(SchedulerStats *stats) {
+    FILE *fp = fopen("/proc/loadavg", "r");
+    if (!fp) return -1;
+
+    int ret = fscanf(fp, "%lf %lf %lf %u/%u", &stats->load1, &stats->load5, &stats->load15,
+                     &stats->runnable, &stats->threads) == 5 ? 0 : -1;
+    fclose(fp);
+    return ret;
+}
+
+/**
+ * @brief Read per-CPU run-queue delay from /proc/schedstat
+ * @param monitor Counters of the previous read; updated
+ * @param stats Pointer to SchedulerStats structure to update
+ * @param seconds Time since the previous read, or 0 before the first one
+ * @return 0 on success, -1 if schedstat is unavailable
+ *
+ * @details Per-CPU lines are "cpuN yld_count 0 sched_count sched_goidle
+ * ttwu_count ttwu_local rq_cpu_time run_delay pcount" (schedstat version 15
+ * and later), where run_delay is in nanoseconds and pcount counts timeslices.
+ */
+static int read_schedstat(SchedulerMonitor *monitor, SchedulerStats *stats, double seconds) {
+    FILE *fp = fopen("/proc/schedstat", "r");
+    if (!fp) return -1;
+
+    char line[512];
+    unsigned long long delay_sum = 0;
+    unsigned long long slice_sum = 0;
+
+    stats->cpu_count = 0;
+    stats->total_run_delay = 0;
+    stats->max_run_delay = 0;
+    stats->max_run_delay_cpu = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned int cpu;
+        unsigned long long skip, run_delay, timeslices;
+
+        if (sscanf(line, "cpu%u %llu %llu %llu %llu %llu %llu %llu %llu %llu", &cpu,
+                   &skip, &skip, &skip, &skip, &skip, &skip, &skip, &run_delay, &timeslices) != 10) {
+            continue;
+        }
+        if (cpu >= MAX_CPUS) continue;
+
+        unsigned long long delay = 0, slices = 0;
+        unsigned long long *prev_delay = &monitor->prev_run_delay[cpu];
+        unsigned long long *prev_slices = &monitor->prev_timeslices[cpu];
+        if (seconds > 0 && run_delay >= *prev_delay && timeslices >= *prev_slices) {
+            delay = run_delay - *prev_delay;
+            slices = timeslices - *prev_slices;
+        }
+        *prev_delay = run_delay;
+        *prev_slices = timeslices;
+
+        // ns waited per second of wall time, shown as ms/s
+        stats->run_delay[cpu] = seconds > 0 ? delay / 1e6 / seconds : 0;
+        stats->wait_per_slice[cpu] = slices ? delay / 1e3 / slices : 0;
+        stats->total_run_delay += stats->run_delay[cpu];
+        if (stats->run_delay[cpu] > stats->max_run_delay) {
+            stats->max_run_delay = stats->run_delay[cpu];
+            stats->max_run_delay_cpu = cpu;
+        }
+        delay_sum += delay;
+        slice_sum += slices;
+        if (cpu + 1 > stats->cpu_count) stats->cpu_count = cpu + 1;
+    }
+    fclose(fp);
+
+    stats->avg_wait_per_slice = slice_sum ? delay_sum / 1e3 / slice_sum : 0;
+    return stats->cpu_count ? 0 : -1;
+}
+
+SchedulerMonitor *create_scheduler_monitor(void) {
+    return calloc(1, sizeof(SchedulerMonitor));
+}
+
+int update_scheduler_stats(SchedulerMonitor *monitor, SchedulerStats *stats) {
+    if (!monitor || !stats) return -1;
+
+    if (read_loadavg(stats) != 0) return -1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    struct timespec *prev = &monitor->prev_read;
+    double seconds = prev->tv_sec ? (now.tv_sec - prev->tv_sec) + (now.tv_nsec - prev->tv_nsec) / 1e9 : 0;
+    *prev = now;
+
+    stats->schedstat_available = read_schedstat(monitor, stats, seconds) == 0;
+    return 0;
+}
+
+void destroy_scheduler_monitor(SchedulerMonitor *monitor) {
+    // All files are opened per read
+    free(monitor);
+}
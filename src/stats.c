@@ -1,45 +1,584 @@
 /**
  * @file stats.c
  * @brief Implementation of system statistics gathering functions
- * 
+ *
  * This file contains the implementation of functions that gather and update
  * various system statistics including CPU, memory, disk, GPU, and network
  * information. It serves as the central point for collecting all system metrics.
+ *
+ * Collectors are kept in a table in update order, each with its own update
+ * interval, so the configuration can enable, disable or restart them one at
+ * a time without touching the others. Each running collector is one context
+ * object owned here.
  */
 
 #include "system_monitor.h"
+#include <stddef.h>
 #include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief One collector and the part of SystemStats it fills
+ *
+ * @details Every collector keeps its state in a context object, so the table
+ * only holds adapters from the generic signatures to the typed ones.
+ */
+typedef struct {
+    const char *description;  // For error messages
+    void *(*create)(const MonitorConfig *config);
+    int (*update)(void *monitor, SystemStats *stats);
+    void (*destroy)(void *monitor);
+    size_t offset;  // Part of SystemStats cleared when the collector stops
+    size_t size;
+} Collector;
+
+/**
+ * @brief Create the CPU monitor
+ */
+static void *create_cpu_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_cpu_monitor();
+}
+
+/**
+ * @brief Update CPU statistics
+ */
+static int update_cpu_collector(void *monitor, SystemStats *stats) {
+    return update_cpu_stats(monitor, &stats->cpu);
+}
+
+/**
+ * @brief Destroy the CPU monitor
+ */
+static void destroy_cpu_collector(void *monitor) {
+    destroy_cpu_monitor(monitor);
+}
+
+/**
+ * @brief Create the CPU topology
+ */
+static void *create_topology_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_topology();
+}
+
+/**
+ * @brief Aggregate per-CPU usage over the topology
+ */
+static int update_topology_collector(void *monitor, SystemStats *stats) {
+    return update_topology_stats(monitor, &stats->cpu, &stats->topology);
+}
+
+/**
+ * @brief Destroy the CPU topology
+ */
+static void destroy_topology_collector(void *monitor) {
+    destroy_topology(monitor);
+}
+
+/**
+ * @brief Create the Scheduler monitor
+ */
+static void *create_scheduler_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_scheduler_monitor();
+}
+
+/**
+ * @brief Update load average and run-queue delay
+ */
+static int update_scheduler_collector(void *monitor, SystemStats *stats) {
+    return update_scheduler_stats(monitor, &stats->scheduler);
+}
+
+/**
+ * @brief Destroy the Scheduler monitor
+ */
+static void destroy_scheduler_collector(void *monitor) {
+    destroy_scheduler_monitor(monitor);
+}
+
+/**
+ * @brief Create the performance counters
+ */
+static void *create_perf_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_perf_monitor();
+}
+
+/**
+ * @brief Update hardware performance counters
+ */
+static int update_perf_collector(void *monitor, SystemStats *stats) {
+    return update_perf_stats(monitor, &stats->perf);
+}
+
+/**
+ * @brief Destroy the performance counters
+ */
+static void destroy_perf_collector(void *monitor) {
+    destroy_perf_monitor(monitor);
+}
+
+/**
+ * @brief Create the CPU frequency monitor
+ */
+static void *create_cpufreq_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_cpufreq_monitor();
+}
+
+/**
+ * @brief Update CPU frequency and idle state statistics
+ */
+static int update_cpufreq_collector(void *monitor, SystemStats *stats) {
+    return update_cpufreq_stats(monitor, &stats->cpufreq);
+}
+
+/**
+ * @brief Destroy the CPU frequency monitor
+ */
+static void destroy_cpufreq_collector(void *monitor) {
+    destroy_cpufreq_monitor(monitor);
+}
+
+/**
+ * @brief Create the Memory monitor
+ */
+static void *create_memory_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_memory_monitor();
+}
+
+/**
+ * @brief Update Memory statistics
+ */
+static int update_memory_collector(void *monitor, SystemStats *stats) {
+    return update_memory_stats(monitor, &stats->memory);
+}
+
+/**
+ * @brief Destroy the Memory monitor
+ */
+static void destroy_memory_collector(void *monitor) {
+    destroy_memory_monitor(monitor);
+}
+
+/**
+ * @brief Create the Disk monitor
+ */
+static void *create_disk_collector(const MonitorConfig *config) {
+    return create_disk_monitor(&config->disk_filter);
+}
+
+/**
+ * @brief Update Disk statistics
+ */
+static int update_disk_collector(void *monitor, SystemStats *stats) {
+    return update_disk_stats(monitor, &stats->disks);
+}
+
+/**
+ * @brief Destroy the Disk monitor
+ */
+static void destroy_disk_collector(void *monitor) {
+    destroy_disk_monitor(monitor);
+}
+
+/**
+ * @brief Create the GPU monitor
+ */
+static void *create_gpu_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_gpu_monitor();
+}
+
+/**
+ * @brief Update GPU statistics
+ */
+static int update_gpu_collector(void *monitor, SystemStats *stats) {
+    return update_gpu_stats(monitor, &stats->gpus);
+}
+
+/**
+ * @brief Destroy the GPU monitor
+ */
+static void destroy_gpu_collector(void *monitor) {
+    destroy_gpu_monitor(monitor);
+}
+
+/**
+ * @brief Create the Network monitor
+ */
+static void *create_network_collector(const MonitorConfig *config) {
+    return create_network_monitor(&config->network_filter);
+}
+
+/**
+ * @brief Update Network statistics
+ */
+static int update_network_collector(void *monitor, SystemStats *stats) {
+    return update_network_stats(monitor, &stats->network);
+}
+
+/**
+ * @brief Destroy the Network monitor
+ */
+static void destroy_network_collector(void *monitor) {
+    destroy_network_monitor(monitor);
+}
+
+/**
+ * @brief Create the Thermal monitor
+ */
+static void *create_thermal_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_thermal_monitor();
+}
+
+/**
+ * @brief Update thermal statistics
+ */
+static int update_thermal_collector(void *monitor, SystemStats *stats) {
+    return update_thermal_stats(monitor, &stats->thermal);
+}
+
+/**
+ * @brief Destroy the Thermal monitor
+ */
+static void destroy_thermal_collector(void *monitor) {
+    destroy_thermal_monitor(monitor);
+}
+
+/**
+ * @brief Create the kernel event watcher
+ */
+static void *create_events_collector(const MonitorConfig *config) {
+    return create_event_monitor(config->kmsg_path);
+}
+
+/**
+ * @brief Read new kernel log records and mark them on the memory history
+ */
+static int update_events_collector(void *monitor, SystemStats *stats) {
+    if (update_event_stats(monitor, &stats->events) != 0) return -1;
+    update_event_history(monitor, &stats->events, stats->memory.usage);
+    return 0;
+}
+
+/**
+ * @brief Destroy the kernel event watcher
+ */
+static void destroy_events_collector(void *monitor) {
+    destroy_event_monitor(monitor);
+}
+
+/**
+ * @brief Create the kernel memory monitor
+ */
+static void *create_kmem_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_kmem_monitor();
+}
+
+/**
+ * @brief Update the kernel memory breakdown
+ */
+static int update_kmem_collector(void *monitor, SystemStats *stats) {
+    return update_kmem_stats(monitor, &stats->kmem);
+}
+
+/**
+ * @brief Destroy the kernel memory monitor
+ */
+static void destroy_kmem_collector(void *monitor) {
+    destroy_kmem_monitor(monitor);
+}
+
+/**
+ * @brief Create the memory zone monitor
+ */
+static void *create_zones_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_zone_monitor();
+}
+
+/**
+ * @brief Update zone watermarks and fragmentation
+ */
+static int update_zones_collector(void *monitor, SystemStats *stats) {
+    return update_zone_stats(monitor, &stats->zones);
+}
+
+/**
+ * @brief Destroy the memory zone monitor
+ */
+static void destroy_zones_collector(void *monitor) {
+    destroy_zone_monitor(monitor);
+}
+
+/**
+ * @brief Create the process memory monitor
+ */
+static void *create_procmem_collector(const MonitorConfig *config) {
+    return create_process_memory_monitor((unsigned int)config->procmem_top, (unsigned int)config->procmem_budget);
+}
+
+/**
+ * @brief Rank processes and refresh some of their smaps_rollup values
+ */
+static int update_procmem_collector(void *monitor, SystemStats *stats) {
+    return update_process_memory_stats(monitor, &stats->procmem);
+}
+
+/**
+ * @brief Destroy the process memory monitor
+ */
+static void destroy_procmem_collector(void *monitor) {
+    destroy_process_memory_monitor(monitor);
+}
+
+/**
+ * @brief Create the working set monitor
+ */
+static void *create_workingset_collector(const MonitorConfig *config) {
+    return create_workingset_monitor((unsigned int)config->workingset_window_ms);
+}
+
+/**
+ * @brief Sweep part of the idle page bitmap and update the working set estimates
+ */
+static int update_workingset_collector(void *monitor, SystemStats *stats) {
+    return update_workingset_stats(monitor, &stats->workingset);
+}
+
+/**
+ * @brief Destroy the working set monitor
+ */
+static void destroy_workingset_collector(void *monitor) {
+    destroy_workingset_monitor(monitor);
+}
+
+/**
+ * @brief Create the swap monitor
+ */
+static void *create_swap_collector(const MonitorConfig *config) {
+    (void)config;
+    return create_swap_monitor();
+}
+
+/**
+ * @brief Update swap devices, traffic and zram/zswap compression
+ */
+static int update_swap_collector(void *monitor, SystemStats *stats) {
+    return update_swap_stats(monitor, &stats->swap);
+}
+
+/**
+ * @brief Destroy the swap monitor
+ */
+static void destroy_swap_collector(void *monitor) {
+    destroy_swap_monitor(monitor);
+}
+
+// Indexed by CollectorId
+static const Collector collectors[COLLECTOR_COUNT] = {
+    {"CPU monitor", create_cpu_collector, update_cpu_collector,
+     destroy_cpu_collector, offsetof(SystemStats, cpu), sizeof(CPUStats)},
+    {"CPU topology", create_topology_collector, update_topology_collector,
+     destroy_topology_collector, offsetof(SystemStats, topology), sizeof(TopologyStats)},
+    {"Scheduler monitor", create_scheduler_collector, update_scheduler_collector,
+     destroy_scheduler_collector, offsetof(SystemStats, scheduler), sizeof(SchedulerStats)},
+    {"performance counters", create_perf_collector, update_perf_collector,
+     destroy_perf_collector, offsetof(SystemStats, perf), sizeof(PerfStats)},
+    {"CPU frequency monitor", create_cpufreq_collector, update_cpufreq_collector,
+     destroy_cpufreq_collector, offsetof(SystemStats, cpufreq), sizeof(CPUFreqStats)},
+    {"Memory monitor", create_memory_collector, update_memory_collector,
+     destroy_memory_collector, offsetof(SystemStats, memory), sizeof(MemoryStats)},
+    {"Disk monitor", create_disk_collector, update_disk_collector,
+     destroy_disk_collector, offsetof(SystemStats, disks), sizeof(DiskInfo)},
+    {"GPU monitor", create_gpu_collector, update_gpu_collector,
+     destroy_gpu_collector, offsetof(SystemStats, gpus), sizeof(GPUInfo)},
+    {"Network monitor", create_network_collector, update_network_collector,
+     destroy_network_collector, offsetof(SystemStats, network), sizeof(NetworkStats)},
+    {"Thermal monitor", create_thermal_collector, update_thermal_collector,
+     destroy_thermal_collector, offsetof(SystemStats, thermal), sizeof(ThermalStats)},
+    {"kernel event watcher", create_events_collector, update_events_collector,
+     destroy_events_collector, offsetof(SystemStats, events), sizeof(EventStats)},
+    {"kernel memory monitor", create_kmem_collector, update_kmem_collector,
+     destroy_kmem_collector, offsetof(SystemStats, kmem), sizeof(KmemStats)},
+    {"memory zone monitor", create_zones_collector, update_zones_collector,
+     destroy_zones_collector, offsetof(SystemStats, zones), sizeof(ZoneInfo)},
+    {"process memory monitor", create_procmem_collector, update_procmem_collector,
+     destroy_procmem_collector, offsetof(SystemStats, procmem), sizeof(ProcessMemoryInfo)},
+    {"working set monitor", create_workingset_collector, update_workingset_collector,
+     destroy_workingset_collector, offsetof(SystemStats, workingset), sizeof(WorkingSetStats)},
+    {"swap monitor", create_swap_collector, update_swap_collector,
+     destroy_swap_collector, offsetof(SystemStats, swap), sizeof(SwapStats)},
+};
+
+static void *monitors[COLLECTOR_COUNT];    // Context of each running collector, NULL when stopped
+static int intervals[COLLECTOR_COUNT];     // Milliseconds
+static long long next_due[COLLECTOR_COUNT]; // Monotonic milliseconds
+static MonitorConfig applied;             // Settings the running collectors were started with
+static char error[128] = "";
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Stop one collector and clear its statistics
+ * @param id Collector
+ * @param stats Statistics to clear, or NULL
+ */
+static void stop_collector(CollectorId id, SystemStats *stats) {
+    if (!monitors[id]) return;
+    collectors[id].destroy(monitors[id]);
+    monitors[id] = NULL;
+    if (stats) {
+        memset((char *)stats + collectors[id].offset, 0, collectors[id].size);
+        stats->updated_ms[id] = 0;
+        stats->update_failed[id] = 0;
+    }
+}
+
+/**
+ * @brief Whether a running collector must be restarted for new settings
+ * @param id Collector
+ * @param config New configuration
+ * @return Non-zero if settings it was initialized with changed
+ */
+static int settings_changed(CollectorId id, const MonitorConfig *config) {
+    if (id == COLLECTOR_DISK) {
+        return memcmp(&applied.disk_filter, &config->disk_filter, sizeof(DeviceFilter)) != 0;
+    }
+    if (id == COLLECTOR_NETWORK) {
+        return memcmp(&applied.network_filter, &config->network_filter, sizeof(DeviceFilter)) != 0;
+    }
+    if (id == COLLECTOR_EVENTS) return strcmp(applied.kmsg_path, config->kmsg_path) != 0;
+    if (id == COLLECTOR_PROCMEM) {
+        return applied.procmem_top != config->procmem_top || applied.procmem_budget != config->procmem_budget;
+    }
+    if (id == COLLECTOR_WORKINGSET) return applied.workingset_window_ms != config->workingset_window_ms;
+    return 0;
+}
+
+int configure_collectors(const MonitorConfig *config, SystemStats *stats) {
+    if (!config) return -1;
+
+    int ret = 0;
+    error[0] = '\0';
+
+    // Stop what is disabled or changed, in reverse order
+    for (int id = COLLECTOR_COUNT - 1; id >= 0; id--) {
+        if (monitors[id] && (!config->collectors[id].enabled || settings_changed(id, config))) {
+            stop_collector(id, stats);
+        }
+    }
+
+    long long now = now_ms();
+    for (int id = 0; id < COLLECTOR_COUNT; id++) {
+        int interval = collector_interval(config, id);
+        if (interval != intervals[id]) next_due[id] = now;  // Run at the next update
+        intervals[id] = interval;
+
+        if (monitors[id] || !config->collectors[id].enabled) continue;
+        monitors[id] = collectors[id].create(config);
+        if (!monitors[id]) {
+            if (!error[0]) snprintf(error, sizeof(error), "Failed to initialize %s", collectors[id].description);
+            ret = -1;
+            continue;
+        }
+        next_due[id] = now;
+    }
+
+    if (configure_plugins(config, &stats->plugins) != 0) {
+        if (!error[0]) snprintf(error, sizeof(error), "%s", plugin_error());
+        ret = -1;
+    }
+
+    applied = *config;
+    return ret;
+}
+
+const char *collector_error(void) {
+    return error;
+}
+
+int collector_of_field(size_t offset) {
+    for (int id = 0; id < COLLECTOR_COUNT; id++) {
+        if (offset >= collectors[id].offset && offset < collectors[id].offset + collectors[id].size) return id;
+    }
+    return -1;
+}
+
+int collector_tick(void) {
+    int tick = 0;
+    for (int id = 0; id < COLLECTOR_COUNT; id++) {
+        if (monitors[id] && (tick == 0 || intervals[id] < tick)) tick = intervals[id];
+    }
+    int plugins = plugin_tick();
+    if (plugins > 0 && (tick == 0 || plugins < tick)) tick = plugins;
+    return tick > 0 ? tick : applied.interval_ms;
+}
+
+int collector_event_fd(void) {
+    return event_monitor_fd(monitors[COLLECTOR_EVENTS]);
+}
+
+int update_events(SystemStats *stats) {
+    if (!stats || !monitors[COLLECTOR_EVENTS]) return -1;
+    if (update_event_stats(monitors[COLLECTOR_EVENTS], &stats->events) != 0) return -1;
+    stats->updated_ms[COLLECTOR_EVENTS] = now_ms();
+    return 0;
+}
+
+void stop_collectors(void) {
+    stop_plugins();
+    for (int id = COLLECTOR_COUNT - 1; id >= 0; id--) stop_collector(id, NULL);
+}
 
 /**
  * @brief Updates all system statistics
  * @param stats Pointer to SystemStats structure to be updated
  * @return 0 on successful update of all statistics, -1 if any update fails
- * 
+ *
  * @details This function coordinates the update of all system statistics by calling
- * individual update functions for each subsystem (CPU, memory, disk, GPU, network).
- * If any of these updates fail, the function returns immediately with -1.
- * 
- * @note All statistics are updated atomically - either all succeed or none are updated
- * 
+ * the update function of every running collector whose interval has elapsed,
+ * in a fixed order (topology after CPU). A collector whose update fails is
+ * flagged in update_failed and the rest still run, as do the plugins, the
+ * metric snapshot and the alert rules; the function then returns -1.
+ *
  * @warning The stats parameter must not be NULL
  */
 int update_stats(SystemStats *stats) {
     if (!stats) return -1;
 
-    // Update CPU statistics
-    if (update_cpu_stats(&stats->cpu) != 0) return -1;
-
-    // Update Memory statistics
-    if (update_memory_stats(&stats->memory) != 0) return -1;
-
-    // Update Disk statistics
-    if (update_disk_stats(&stats->disks) != 0) return -1;
+    // A collector is due if its deadline falls within half of the shortest interval
+    long long now = now_ms();
+    long long slack = collector_tick() / 2;
+    int ret = 0;
+    for (int id = 0; id < COLLECTOR_COUNT; id++) {
+        if (!monitors[id] || now + slack < next_due[id]) continue;
+        next_due[id] = now + intervals[id];
+        stats->update_failed[id] = collectors[id].update(monitors[id], stats) != 0;
+        if (stats->update_failed[id]) {
+            ret = -1;
+            continue;
+        }
+        stats->updated_ms[id] = now;
+    }
+    if (update_plugins(&stats->plugins) != 0) ret = -1;
+    update_metric_snapshot(stats, &stats->metrics);
 
-    // Update GPU statistics
-    if (update_gpu_stats(&stats->gpus) != 0) return -1;
+    // Evaluate alert rules against the fresh snapshot
+    if (update_alert_stats(stats, &stats->alerts) != 0) ret = -1;
 
-    // Update Network statistics
-    if (update_network_stats(&stats->network) != 0) return -1;
-
-    return 0;
-} 
\ No newline at end of file
+    return ret;
+}
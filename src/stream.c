@@ -0,0 +1,351 @@
+/**
+ * @file stream.c
+ * @brief Implementation of snapshot streaming
+ */
+
+#include "stream.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RECONNECT_MS 3000
+#define SEND_TIMEOUT_MS 1000
+#define CONNECT_TIMEOUT_MS 1000
+
+struct StreamAgent {
+    char address[256];
+    char host[STREAM_HOST_MAX];
+    int fd;                  // -1 while disconnected
+    long long next_attempt;  // Monotonic ms of the next connection attempt
+    CodecState codec;        // Encoder state of the current connection
+    uint8_t frame[STREAM_FRAME_MAX];
+};
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Store little-endian integers
+ */
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+/**
+ * @brief Load little-endian integers
+ */
+static uint16_t get_u16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+/**
+ * @brief Fill a Unix socket address if the address names one
+ * @param address Stream address
+ * @param sun Address to fill
+ * @return 1 for a Unix address, 0 for TCP, -1 if the path is too long
+ */
+static int unix_address(const char *address, struct sockaddr_un *sun) {
+    const char *path = !strncmp(address, "unix:", 5) ? address + 5 :
+                       strchr(address, '/') ? address : NULL;
+    if (!path) return 0;
+
+    memset(sun, 0, sizeof(*sun));
+    sun->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sun->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(sun->sun_path, path);
+    return 1;
+}
+
+/**
+ * @brief Resolve a HOST:PORT address
+ * @param address Stream address
+ * @param passive Non-zero to resolve for listening (empty host means any)
+ * @return Address list to free with freeaddrinfo(), or NULL with errno set
+ */
+static struct addrinfo *tcp_address(const char *address, int passive) {
+    char host[256];
+    const char *colon = strrchr(address, ':');
+    if (!colon || !colon[1] || (size_t)(colon - address) >= sizeof(host)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    struct addrinfo hints, *list;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &list) != 0) {
+        errno = EADDRNOTAVAIL;
+        return NULL;
+    }
+    return list;
+}
+
+int stream_listen(const char *address) {
+    struct sockaddr_un sun;
+    int kind = unix_address(address, &sun);
+    if (kind < 0) return -1;
+
+    if (kind) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        unlink(sun.sun_path);  // Left behind by an earlier aggregator
+        if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0 || listen(fd, 64) != 0) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        return fd;
+    }
+
+    struct addrinfo *list = tcp_address(address, 1);
+    if (!list) return -1;
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 64) != 0) {
+            int saved = errno;
+            close(fd);
+            fd = -1;
+            errno = saved;
+        }
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+/**
+ * @brief Connect a non-blocking socket, waiting for completion in epoll
+ * @param fd Non-blocking socket
+ * @param addr Peer address
+ * @param len Address length
+ * @param deadline Monotonic ms by which the connection must be up
+ * @return 0 once connected (the socket is left blocking), -1 with errno set
+ *
+ * @details A peer that never answers (a filtered port, a host that is
+ * down) would otherwise hold connect() for the kernel's SYN retry time,
+ * minutes, with the agent's updates stalled behind it.
+ */
+static int connect_until(int fd, const struct sockaddr *addr, socklen_t len, long long deadline) {
+    if (connect(fd, addr, len) != 0) {
+        if (errno != EINPROGRESS) return -1;
+
+        int epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll < 0) return -1;
+        struct epoll_event ev = { .events = EPOLLOUT, .data.fd = fd };
+        int n = -1;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) == 0) {
+            do {
+                long long left = deadline - now_ms();
+                n = epoll_wait(epoll, &ev, 1, left > 0 ? (int)left : 0);
+            } while (n < 0 && errno == EINTR);
+        }
+        int saved = errno;
+        close(epoll);
+        if (n <= 0) {
+            errno = n == 0 ? ETIMEDOUT : saved;
+            return -1;
+        }
+
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0) return -1;
+        if (err) {
+            errno = err;
+            return -1;
+        }
+    }
+
+    // Frames are sent blocking, bounded by SO_SNDTIMEO
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+int stream_connect(const char *address) {
+    struct sockaddr_un sun;
+    int kind = unix_address(address, &sun);
+    if (kind < 0) return -1;
+
+    long long deadline = now_ms() + CONNECT_TIMEOUT_MS;
+    if (kind) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (connect_until(fd, (struct sockaddr *)&sun, sizeof(sun), deadline) != 0) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        return fd;
+    }
+
+    struct addrinfo *list = tcp_address(address, 0);
+    if (!list) return -1;
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect_until(fd, ai->ai_addr, ai->ai_addrlen, deadline) != 0) {
+            int saved = errno;
+            close(fd);
+            fd = -1;
+            errno = saved;
+        }
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+long stream_frame_length(const uint8_t *buf, size_t have) {
+    if (have < STREAM_HEADER_SIZE) return 0;
+    uint32_t payload = get_u32(buf);
+    if (payload == 0 || payload > STREAM_FRAME_MAX - STREAM_HEADER_SIZE) return -1;
+    return have >= STREAM_HEADER_SIZE + payload ? (long)(STREAM_HEADER_SIZE + payload) : 0;
+}
+
+size_t stream_encode_hello(uint8_t *buf, const char *host) {
+    size_t host_len = strnlen(host, STREAM_HOST_MAX - 1);
+    uint8_t *p = buf + STREAM_HEADER_SIZE;
+    *p++ = STREAM_HELLO;
+    put_u16(p, STREAM_VERSION);
+    put_u16(p + 2, METRIC_SLOT_COUNT);
+    memcpy(p + 4, host, host_len);
+    p += 4 + host_len;
+
+    put_u32(buf, (uint32_t)(p - buf - STREAM_HEADER_SIZE));
+    return (size_t)(p - buf);
+}
+
+int stream_decode_hello(const uint8_t *frame, size_t len, char *host) {
+    const uint8_t *p = frame + STREAM_HEADER_SIZE;
+    if (len < STREAM_HEADER_SIZE + 5 || p[0] != STREAM_HELLO ||
+        get_u16(p + 1) != STREAM_VERSION || get_u16(p + 3) != METRIC_SLOT_COUNT) return -1;
+
+    size_t host_len = len - STREAM_HEADER_SIZE - 5;
+    if (host_len == 0 || host_len >= STREAM_HOST_MAX) return -1;
+    memcpy(host, p + 5, host_len);
+    host[host_len] = '\0';
+    return 0;
+}
+
+size_t stream_encode_snapshot(uint8_t *buf, CodecState *codec, const MetricSnapshot *next,
+                              long long time_ms) {
+    size_t len = codec_encode(codec, next, time_ms, buf + STREAM_HEADER_SIZE);
+    put_u32(buf, (uint32_t)len);
+    return STREAM_HEADER_SIZE + len;
+}
+
+int stream_decode_snapshot(const uint8_t *frame, size_t len, CodecState *codec) {
+    if (len < STREAM_HEADER_SIZE) return -1;
+    return codec_decode(codec, frame + STREAM_HEADER_SIZE, len - STREAM_HEADER_SIZE);
+}
+
+StreamAgent *create_stream_agent(const char *address, const char *host) {
+    StreamAgent *agent = calloc(1, sizeof(*agent));
+    if (!agent) return NULL;
+    snprintf(agent->address, sizeof(agent->address), "%s", address);
+    snprintf(agent->host, sizeof(agent->host), "%s", host);
+    agent->fd = -1;
+    return agent;
+}
+
+/**
+ * @brief Write a whole frame
+ * @param fd Connected socket
+ * @param buf Frame
+ * @param len Frame length
+ * @return 0 on success, -1 on failure or timeout
+ */
+static int send_frame(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Drop the connection; the next send reconnects after a pause
+ * @param agent Agent
+ */
+static void disconnect_agent(StreamAgent *agent) {
+    close(agent->fd);
+    agent->fd = -1;
+    agent->next_attempt = now_ms() + RECONNECT_MS;
+}
+
+int stream_agent_send(StreamAgent *agent, const MetricSnapshot *snapshot, long long time_ms) {
+    if (!agent || !snapshot) return -1;
+
+    if (agent->fd < 0) {
+        if (now_ms() < agent->next_attempt) return -1;
+        agent->fd = stream_connect(agent->address);
+        if (agent->fd < 0) {
+            agent->next_attempt = now_ms() + RECONNECT_MS;
+            return -1;
+        }
+
+        // A slow aggregator must not stall the agent's updates for long
+        struct timeval timeout = {SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(agent->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // The new connection starts from nothing: a keyframe comes first
+        codec_reset(&agent->codec, CODEC_KEYFRAME_INTERVAL);
+        size_t len = stream_encode_hello(agent->frame, agent->host);
+        if (send_frame(agent->fd, agent->frame, len) != 0) {
+            disconnect_agent(agent);
+            return -1;
+        }
+    }
+
+    size_t len = stream_encode_snapshot(agent->frame, &agent->codec, snapshot, time_ms);
+    if (send_frame(agent->fd, agent->frame, len) != 0) {
+        disconnect_agent(agent);
+        return -1;
+    }
+    return 0;
+}
+
+void destroy_stream_agent(StreamAgent *agent) {
+    if (!agent) return;
+    if (agent->fd >= 0) close(agent->fd);
+    free(agent);
+}
@@ -0,0 +1,396 @@
+/**
+ * @file swap.c
+ * @brief Implementation of swap device, traffic and compression monitoring
+ */
+
+#include "swap.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KB_TO_BYTES (1024UL)
+#define SECTOR_SIZE 512UL                  // Unit of the block layer's stat file
+#define ZRAM_MIN_DATA (1024UL * 1024UL)    // Below this a ratio says nothing
+#define ZSWAP_DEBUGFS "/sys/kernel/debug/zswap"
+
+// zswap debugfs counters of pages it refused to store
+static const char *const zswap_rejects[] = {
+    "reject_compress_poor", "reject_compress_fail", "reject_alloc_fail",
+    "reject_kmemcache_fail", "reject_reclaim_fail", "pool_limit_hit"
+};
+
+#define ZSWAP_REJECTS (sizeof(zswap_rejects) / sizeof(zswap_rejects[0]))
+
+/**
+ * @brief Open attributes and previous counters of one zram device
+ */
+typedef struct {
+    unsigned int index;
+    char algorithm[16];
+    int disksize_fd;
+    int mm_stat_fd;
+    int io_stat_fd;
+    int stat_fd;
+    unsigned long long read_sectors;
+    unsigned long long write_sectors;
+    unsigned long long failed_writes;
+} ZramDevice;
+
+/**
+ * @brief Open files and the counters of the previous update
+ */
+struct SwapMonitor {
+    FILE *swaps;
+    FILE *vmstat;
+    FILE *meminfo;
+    unsigned long page_size;
+    ZramDevice zram[MAX_ZRAM_DEVICES];
+    unsigned int zram_count;
+    int zswap_enabled_fd;
+    int zswap_pool_fd;                  // Debugfs; -1 when not mounted or not root
+    int zswap_stored_fd;
+    int zswap_written_back_fd;
+    int zswap_reject_fds[ZSWAP_REJECTS];
+    unsigned long long swap_in;         // Pages, since boot
+    unsigned long long swap_out;
+    unsigned long long zswap_in;
+    unsigned long long zswap_out;
+    unsigned long long zswap_written_back;
+    unsigned long long zswap_rejected;
+    long long last_update;              // Monotonic milliseconds, 0 before the first update
+};
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Per-second change of a counter, remembering the new value
+ * @param value Current value
+ * @param previous Previous value; replaced with value
+ * @param seconds Time since the previous value, 0 on the first update
+ * @return Change per second, 0 on the first update or if the counter went back
+ */
+static double counter_rate(unsigned long long value, unsigned long long *previous, double seconds) {
+    double rate = seconds > 0 && value >= *previous ? (value - *previous) / seconds : 0.0;
+    *previous = value;
+    return rate;
+}
+
+/**
+ * @brief Open the attributes of every zram device
+ * @param monitor Monitor to add the devices to
+ *
+ * @details The algorithm in use is the bracketed one of comp_algorithm,
+ * e.g. "lzo lzo-rle [lz4] zstd"; it only changes when the device is reset.
+ */
+static void open_zram_devices(SwapMonitor *monitor) {
+    unsigned int indices[MAX_ZRAM_DEVICES];
+    unsigned int count = sysfs_list_indices("/sys/block", "zram", "", indices, MAX_ZRAM_DEVICES);
+
+    for (unsigned int i = 0; i < count; i++) {
+        ZramDevice *zram = &monitor->zram[monitor->zram_count];
+        char path[128], algorithms[128];
+        memset(zram, 0, sizeof(*zram));
+        zram->index = indices[i];
+        snprintf(path, sizeof(path), "/sys/block/zram%u/disksize", indices[i]);
+        zram->disksize_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/block/zram%u/mm_stat", indices[i]);
+        zram->mm_stat_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/block/zram%u/io_stat", indices[i]);
+        zram->io_stat_fd = sysfs_open(path);
+        snprintf(path, sizeof(path), "/sys/block/zram%u/stat", indices[i]);
+        zram->stat_fd = sysfs_open(path);
+        if (zram->disksize_fd < 0 || zram->mm_stat_fd < 0) {
+            sysfs_close(&zram->disksize_fd);
+            sysfs_close(&zram->mm_stat_fd);
+            sysfs_close(&zram->io_stat_fd);
+            sysfs_close(&zram->stat_fd);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/sys/block/zram%u/comp_algorithm", indices[i]);
+        const char *open_bracket = NULL, *close_bracket = NULL;
+        if (sysfs_read_string(path, algorithms, sizeof(algorithms)) == 0) {
+            open_bracket = strchr(algorithms, '[');
+            close_bracket = open_bracket ? strchr(open_bracket, ']') : NULL;
+        }
+        if (close_bracket) {
+            snprintf(zram->algorithm, sizeof(zram->algorithm), "%.*s",
+                     (int)(close_bracket - open_bracket - 1), open_bracket + 1);
+        } else {
+            snprintf(zram->algorithm, sizeof(zram->algorithm), "?");
+        }
+        monitor->zram_count++;
+    }
+}
+
+/**
+ * @brief Open the zswap parameter and debugfs counters
+ * @param monitor Monitor to store the descriptors in
+ */
+static void open_zswap(SwapMonitor *monitor) {
+    monitor->zswap_enabled_fd = sysfs_open("/sys/module/zswap/parameters/enabled");
+    monitor->zswap_pool_fd = sysfs_open(ZSWAP_DEBUGFS "/pool_total_size");
+    monitor->zswap_stored_fd = sysfs_open(ZSWAP_DEBUGFS "/stored_pages");
+    monitor->zswap_written_back_fd = sysfs_open(ZSWAP_DEBUGFS "/written_back_pages");
+    for (unsigned int i = 0; i < ZSWAP_REJECTS; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), ZSWAP_DEBUGFS "/%s", zswap_rejects[i]);
+        monitor->zswap_reject_fds[i] = sysfs_open(path);
+    }
+}
+
+SwapMonitor *create_swap_monitor(void) {
+    SwapMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->swaps = fopen("/proc/swaps", "r");
+    monitor->vmstat = fopen("/proc/vmstat", "r");
+    monitor->meminfo = fopen("/proc/meminfo", "r");
+    if (!monitor->swaps || !monitor->vmstat || !monitor->meminfo) {
+        if (monitor->swaps) fclose(monitor->swaps);
+        if (monitor->vmstat) fclose(monitor->vmstat);
+        if (monitor->meminfo) fclose(monitor->meminfo);
+        free(monitor);
+        return NULL;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    monitor->page_size = page_size > 0 ? (unsigned long)page_size : 4096;
+    open_zram_devices(monitor);
+    open_zswap(monitor);
+    return monitor;
+}
+
+void destroy_swap_monitor(SwapMonitor *monitor) {
+    if (!monitor) return;
+    for (unsigned int i = 0; i < monitor->zram_count; i++) {
+        sysfs_close(&monitor->zram[i].disksize_fd);
+        sysfs_close(&monitor->zram[i].mm_stat_fd);
+        sysfs_close(&monitor->zram[i].io_stat_fd);
+        sysfs_close(&monitor->zram[i].stat_fd);
+    }
+    sysfs_close(&monitor->zswap_enabled_fd);
+    sysfs_close(&monitor->zswap_pool_fd);
+    sysfs_close(&monitor->zswap_stored_fd);
+    sysfs_close(&monitor->zswap_written_back_fd);
+    for (unsigned int i = 0; i < ZSWAP_REJECTS; i++) sysfs_close(&monitor->zswap_reject_fds[i]);
+    fclose(monitor->swaps);
+    fclose(monitor->vmstat);
+    fclose(monitor->meminfo);
+    free(monitor);
+}
+
+/**
+ * @brief Read the active swap areas from /proc/swaps
+ * @param fp Open /proc/swaps
+ * @param stats Statistics to update
+ * @return 0 on success, -1 on failure
+ */
+static int read_swaps(FILE *fp, SwapStats *stats) {
+    // Seeking back to the start makes procfs regenerate the file
+    rewind(fp);
+
+    char line[256];
+    stats->device_count = 0;
+    if (!fgets(line, sizeof(line), fp)) return -1;  // Header
+    while (fgets(line, sizeof(line), fp) && stats->device_count < MAX_SWAP_DEVICES) {
+        SwapDeviceStats *device = &stats->devices[stats->device_count];
+        unsigned long size, used;
+        if (sscanf(line, "%63s %11s %lu %lu %d", device->name, device->type, &size, &used,
+                   &device->priority) != 5) {
+            continue;
+        }
+        device->size = size * KB_TO_BYTES;
+        device->used = used * KB_TO_BYTES;
+
+        const char *base = strrchr(device->name, '/');
+        base = base ? base + 1 : device->name;
+        unsigned int index;
+        device->zram = sscanf(base, "zram%u", &index) == 1 ? (int)index : -1;
+        stats->device_count++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the swap and zswap counters of /proc/vmstat
+ * @param fp Open /proc/vmstat
+ * @param counters pswpin, pswpout, zswpin, zswpout and zswpwb, in pages; 0 if absent
+ */
+static void read_vmstat(FILE *fp, unsigned long long counters[5]) {
+    rewind(fp);
+
+    char line[128];
+    memset(counters, 0, 5 * sizeof(counters[0]));
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] != 'p' && line[0] != 'z') continue;  // Skip the other counters cheaply
+        unsigned long long value;
+        if (sscanf(line, "pswpin %llu", &value) == 1) counters[0] = value;
+        else if (sscanf(line, "pswpout %llu", &value) == 1) counters[1] = value;
+        else if (sscanf(line, "zswpin %llu", &value) == 1) counters[2] = value;
+        else if (sscanf(line, "zswpout %llu", &value) == 1) counters[3] = value;
+        else if (sscanf(line, "zswpwb %llu", &value) == 1) counters[4] = value;
+    }
+}
+
+/**
+ * @brief Read the zswap pool and stored sizes from /proc/meminfo
+ * @param fp Open /proc/meminfo
+ * @param stats Statistics to update; left at 0 on kernels before 5.19
+ */
+static void read_meminfo_zswap(FILE *fp, SwapStats *stats) {
+    rewind(fp);
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long value;
+        if (line[0] != 'Z') continue;
+        if (sscanf(line, "Zswap: %lu kB", &value) == 1) stats->zswap_pool = value * KB_TO_BYTES;
+        else if (sscanf(line, "Zswapped: %lu kB", &value) == 1) stats->zswap_stored = value * KB_TO_BYTES;
+    }
+}
+
+/**
+ * @brief Read one zram device and decide whether it keeps up
+ * @param zram Device with its open attributes and previous counters
+ * @param swap Its swap area in /proc/swaps, NULL if it is not used for swap
+ * @param seconds Time since the previous update, 0 on the first
+ * @param out Statistics to fill
+ * @return 0 on success, -1 if the device is not initialised
+ */
+static int read_zram(ZramDevice *zram, const SwapDeviceStats *swap, double seconds, ZramStats *out) {
+    unsigned long long disksize, data, compressed, memory, limit;
+    char buf[256];
+    if (sysfs_pread_ull(zram->disksize_fd, &disksize) != 0 || disksize == 0) return -1;
+    if (sysfs_pread(zram->mm_stat_fd, buf, sizeof(buf)) < 0 ||
+        sscanf(buf, "%llu %llu %llu %llu", &data, &compressed, &memory, &limit) != 4) {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->index = zram->index;
+    memcpy(out->algorithm, zram->algorithm, sizeof(out->algorithm));
+    out->disksize = (unsigned long)disksize;
+    out->data = (unsigned long)data;
+    out->compressed = (unsigned long)compressed;
+    out->memory = (unsigned long)memory;
+    out->memory_limit = (unsigned long)limit;
+    out->ratio = memory > 0 ? (double)data / memory : 0.0;
+
+    unsigned long long read_sectors, write_sectors, failed_writes;
+    if (zram->stat_fd >= 0 && sysfs_pread(zram->stat_fd, buf, sizeof(buf)) >= 0 &&
+        sscanf(buf, "%*s %*s %llu %*s %*s %*s %llu", &read_sectors, &write_sectors) == 2) {
+        out->read_rate = counter_rate(read_sectors, &zram->read_sectors, seconds) * SECTOR_SIZE;
+        out->write_rate = counter_rate(write_sectors, &zram->write_sectors, seconds) * SECTOR_SIZE;
+    }
+    if (zram->io_stat_fd >= 0 && sysfs_pread(zram->io_stat_fd, buf, sizeof(buf)) >= 0 &&
+        sscanf(buf, "%*s %llu", &failed_writes) == 1) {
+        out->failed_writes = counter_rate(failed_writes, &zram->failed_writes, seconds);
+    }
+
+    // Full by data stored, by swap slots in use, or by memory against the limit
+    int full = data * 100 >= disksize * ZRAM_FULL_PERCENT ||
+               (swap && swap->size > 0 && (double)swap->used * 100 >= (double)swap->size * ZRAM_FULL_PERCENT) ||
+               (limit > 0 && memory * 100 >= limit * ZRAM_FULL_PERCENT);
+    if (out->failed_writes > 0) out->state = ZRAM_FAILING;
+    else if (full) out->state = ZRAM_FULL;
+    else if (data >= ZRAM_MIN_DATA && out->ratio < ZRAM_POOR_RATIO) out->state = ZRAM_POOR;
+    else out->state = ZRAM_OK;
+    return 0;
+}
+
+/**
+ * @brief Read the zswap state and counters
+ * @param monitor Monitor with the open attributes
+ * @param vmstat Counters from read_vmstat()
+ * @param seconds Time since the previous update, 0 on the first
+ * @param stats Statistics to update
+ *
+ * @details The debugfs pool size and stored pages take precedence over the
+ * meminfo lines; written back pages come from debugfs or, without it,
+ * from zswpwb (6.8 and later).
+ */
+static void read_zswap(SwapMonitor *monitor, const unsigned long long vmstat[5], double seconds,
+                       SwapStats *stats) {
+    char enabled[8];
+    stats->zswap_enabled = monitor->zswap_enabled_fd >= 0 &&
+                           sysfs_pread(monitor->zswap_enabled_fd, enabled, sizeof(enabled)) > 0 &&
+                           (enabled[0] == 'Y' || enabled[0] == '1');
+
+    stats->zswap_pool = stats->zswap_stored = 0;
+    read_meminfo_zswap(monitor->meminfo, stats);
+
+    unsigned long long value, written_back = vmstat[4], rejected = 0;
+    stats->zswap_debugfs = monitor->zswap_pool_fd >= 0;
+    if (stats->zswap_debugfs) {
+        if (sysfs_pread_ull(monitor->zswap_pool_fd, &value) == 0) stats->zswap_pool = (unsigned long)value;
+        if (sysfs_pread_ull(monitor->zswap_stored_fd, &value) == 0) {
+            stats->zswap_stored = (unsigned long)(value * monitor->page_size);
+        }
+        if (sysfs_pread_ull(monitor->zswap_written_back_fd, &value) == 0) written_back = value;
+        for (unsigned int i = 0; i < ZSWAP_REJECTS; i++) {
+            if (sysfs_pread_ull(monitor->zswap_reject_fds[i], &value) == 0) rejected += value;
+        }
+    }
+    stats->zswap_ratio = stats->zswap_pool > 0 ? (double)stats->zswap_stored / stats->zswap_pool : 0.0;
+    stats->zswap_in = counter_rate(vmstat[2], &monitor->zswap_in, seconds) * monitor->page_size;
+    stats->zswap_out = counter_rate(vmstat[3], &monitor->zswap_out, seconds) * monitor->page_size;
+    stats->zswap_written_back = counter_rate(written_back, &monitor->zswap_written_back, seconds) *
+                                monitor->page_size;
+    stats->zswap_rejected = counter_rate(rejected, &monitor->zswap_rejected, seconds);
+}
+
+int update_swap_stats(SwapMonitor *monitor, SwapStats *stats) {
+    if (!monitor || !stats) return -1;
+    if (read_swaps(monitor->swaps, stats) != 0) return -1;
+
+    long long now = now_ms();
+    double seconds = monitor->last_update > 0 ? (now - monitor->last_update) / 1000.0 : 0.0;
+    monitor->last_update = now;
+
+    unsigned long long vmstat[5];
+    read_vmstat(monitor->vmstat, vmstat);
+    stats->swap_in = counter_rate(vmstat[0], &monitor->swap_in, seconds) * monitor->page_size;
+    stats->swap_out = counter_rate(vmstat[1], &monitor->swap_out, seconds) * monitor->page_size;
+
+    // zram devices, and the swap-outs the ones used for swap took
+    double zram_swap_writes = 0;
+    unsigned long long data = 0, memory = 0;
+    int zram_swap = 0;
+    stats->zram_count = 0;
+    stats->zram_struggling = 0;
+    stats->zram_failed_writes = 0;
+    for (unsigned int i = 0; i < monitor->zram_count; i++) {
+        ZramDevice *zram = &monitor->zram[i];
+        const SwapDeviceStats *swap = NULL;
+        for (unsigned int d = 0; d < stats->device_count && !swap; d++) {
+            if (stats->devices[d].zram == (int)zram->index) swap = &stats->devices[d];
+        }
+
+        ZramStats *out = &stats->zram[stats->zram_count];
+        if (read_zram(zram, swap, seconds, out) != 0) continue;
+        stats->zram_count++;
+        data += out->data;
+        memory += out->memory;
+        stats->zram_failed_writes += out->failed_writes;
+        if (out->state == ZRAM_FULL || out->state == ZRAM_FAILING) stats->zram_struggling++;
+        if (swap) {
+            zram_swap = 1;
+            zram_swap_writes += out->write_rate;
+        }
+    }
+    stats->zram_ratio = memory > 0 ? (double)data / memory : 0.0;
+    stats->spill = zram_swap && stats->swap_out > zram_swap_writes ? stats->swap_out - zram_swap_writes : 0.0;
+
+    read_zswap(monitor, vmstat, seconds, stats);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file sysfs.c
+ * @brief Implementation of sysfs attribute helpers
+ */
+
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+int sysfs_path(char *buf, size_t size, const char *fmt, ...) {
+    const char *root = getenv("SYSMON_SYSFS_ROOT");
+    size_t len = 0;
+
+    if (root && *root) {
+        len = (size_t)snprintf(buf, size, "%s", root);
+        if (len >= size) return -1;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + len, size - len, fmt, ap);
+    va_end(ap);
+
+    return (n < 0 || (size_t)n >= size - len) ? -1 : 0;
+}
+
+int sysfs_open(const char *path) {
+    char full[512];
+    if (sysfs_path(full, sizeof(full), "%s", path) != 0) return -1;
+    return open(full, O_RDONLY | O_CLOEXEC);
+}
+
+void sysfs_close(int *fd) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+}
+
+int sysfs_pread(int fd, char *buf, size_t size) {
+    if (fd < 0 || size == 0) return -1;
+
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n < 0) return -1;
+
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) n--;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+int sysfs_pread_ull(int fd, unsigned long long *value) {
+    char buf[32];
+    char *end;
+
+    if (sysfs_pread(fd, buf, sizeof(buf)) <= 0) return -1;
+    *value = strtoull(buf, &end, 0);
+    return end == buf ? -1 : 0;
+}
+
+int sysfs_read_string(const char *path, char *buf, size_t size) {
+    int fd = sysfs_open(path);
+    if (fd < 0) return -1;
+    int n = sysfs_pread(fd, buf, size);
+    close(fd);
+    return n < 0 ? -1 : 0;
+}
+
+int sysfs_read_ull(const char *path, unsigned long long *value) {
+    int fd = sysfs_open(path);
+    if (fd < 0) return -1;
+    int ret = sysfs_pread_ull(fd, value);
+    close(fd);
+    return ret;
+}
+
+int sysfs_find_hwmon(const char *device_dir, char *buf, size_t size) {
+    char dir_path[512];
+    if (sysfs_path(dir_path, sizeof(dir_path), "%s/hwmon", device_dir) != 0) return -1;
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) return -1;
+
+    int ret = -1;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (strncmp(ent->d_name, "hwmon", 5) != 0) continue;
+        if ((size_t)snprintf(buf, size, "%s/hwmon/%s", device_dir, ent->d_name) < size) ret = 0;
+        break;
+    }
+    closedir(dir);
+    return ret;
+}
+
+/**
+ * @brief Compare two unsigned indices for qsort
+ */
+static int compare_indices(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *)a;
+    unsigned int y = *(const unsigned int *)b;
+    return (x > y) - (x < y);
+}
+
+unsigned int sysfs_list_indices(const char *dir_path, const char *prefix, const char *suffix,
+                                unsigned int *indices, unsigned int max) {
+    char path[512];
+    size_t prefix_len = strlen(prefix);
+
+    if (sysfs_path(path, sizeof(path), "%s", dir_path) != 0) return 0;
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+
+    // readdir order is arbitrary: collect every entry so the lowest max are kept
+    unsigned int *all = NULL;
+    unsigned int count = 0, capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        unsigned int index;
+        int consumed = 0;
+        if (strncmp(ent->d_name, prefix, prefix_len) != 0) continue;
+        if (sscanf(ent->d_name + prefix_len, "%u%n", &index, &consumed) != 1) continue;
+        if (strcmp(ent->d_name + prefix_len + consumed, suffix) != 0) continue;
+        if (count == capacity) {
+            unsigned int *grown = realloc(all, (capacity ? capacity * 2 : 64) * sizeof(*all));
+            if (!grown) break;
+            all = grown;
+            capacity = capacity ? capacity * 2 : 64;
+        }
+        all[count++] = index;
+    }
+    closedir(dir);
+
+    if (count > 0) {
+        qsort(all, count, sizeof(all[0]), compare_indices);
+        if (count > max) count = max;
+        memcpy(indices, all, count * sizeof(indices[0]));
+    }
+    free(all);
+    return count;
+}
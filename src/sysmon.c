@@ -0,0 +1,244 @@
+/**
+ * @file sysmon.c
+ * @brief Implementation of the libsysmon handle API
+ */
+
+#include "sysmon.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct Sysmon {
+    unsigned int collectors;
+    CPUMonitor *cpu;
+    MemoryMonitor *memory;
+    DiskMonitor *disk;
+    NetworkMonitor *network;
+    GPUMonitor *gpu;
+};
+
+struct SysmonSnapshot {
+    unsigned int valid;  // SysmonCollector bits filled by the last sample
+    long long time_ms;
+    CPUStats cpu;
+    MemoryStats memory;
+    DiskInfo disks;
+    NetworkStats network;
+    GPUInfo gpus;
+};
+
+struct SysmonSampler {
+    Sysmon *mon;
+    unsigned int interval_ms;
+    pthread_t thread;
+    pthread_mutex_t lock;    // Guards latest, has_sample and stopping
+    pthread_cond_t wake;     // Signalled to stop the thread early
+    SysmonSnapshot scratch;  // Written by the thread only
+    SysmonSnapshot latest;
+    int has_sample;
+    int stopping;
+};
+
+unsigned int sysmon_version(void) {
+    return SYSMON_API_VERSION;
+}
+
+Sysmon *sysmon_open(const SysmonOptions *options) {
+    SysmonOptions defaults = { .api_version = SYSMON_API_VERSION };
+    if (!options) options = &defaults;
+
+    unsigned int collectors = options->collectors ? options->collectors : SYSMON_ALL;
+    if (options->api_version != SYSMON_API_VERSION || (collectors & ~SYSMON_ALL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    Sysmon *mon = calloc(1, sizeof(*mon));
+    if (!mon) return NULL;
+    mon->collectors = collectors;
+
+    errno = 0;
+    int ok = 1;
+    if (collectors & SYSMON_CPU) ok = ok && (mon->cpu = create_cpu_monitor());
+    if (collectors & SYSMON_MEMORY) ok = ok && (mon->memory = create_memory_monitor());
+    if (collectors & SYSMON_DISK) ok = ok && (mon->disk = create_disk_monitor(&options->disk_filter));
+    if (collectors & SYSMON_NETWORK) ok = ok && (mon->network = create_network_monitor(&options->network_filter));
+    if (collectors & SYSMON_GPU) ok = ok && (mon->gpu = create_gpu_monitor());
+    if (!ok) {
+        int saved = errno ? errno : ENODEV;
+        sysmon_close(mon);
+        errno = saved;
+        return NULL;
+    }
+    return mon;
+}
+
+int sysmon_sample(Sysmon *mon, SysmonSnapshot *snapshot) {
+    if (!mon || !snapshot) return -1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    snapshot->time_ms = now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+    snapshot->valid = 0;
+
+    if (mon->cpu && update_cpu_stats(mon->cpu, &snapshot->cpu) == 0) snapshot->valid |= SYSMON_CPU;
+    if (mon->memory && update_memory_stats(mon->memory, &snapshot->memory) == 0) snapshot->valid |= SYSMON_MEMORY;
+    if (mon->disk && update_disk_stats(mon->disk, &snapshot->disks) == 0) snapshot->valid |= SYSMON_DISK;
+    if (mon->network && update_network_stats(mon->network, &snapshot->network) == 0) snapshot->valid |= SYSMON_NETWORK;
+    if (mon->gpu && update_gpu_stats(mon->gpu, &snapshot->gpus) == 0) snapshot->valid |= SYSMON_GPU;
+
+    return snapshot->valid == mon->collectors ? 0 : -1;
+}
+
+unsigned int sysmon_collectors(const Sysmon *mon) {
+    return mon ? mon->collectors : 0;
+}
+
+void sysmon_close(Sysmon *mon) {
+    if (!mon) return;
+    destroy_gpu_monitor(mon->gpu);
+    destroy_network_monitor(mon->network);
+    destroy_disk_monitor(mon->disk);
+    destroy_memory_monitor(mon->memory);
+    destroy_cpu_monitor(mon->cpu);
+    free(mon);
+}
+
+SysmonSnapshot *sysmon_snapshot_create(void) {
+    return calloc(1, sizeof(SysmonSnapshot));
+}
+
+void sysmon_snapshot_destroy(SysmonSnapshot *snapshot) {
+    free(snapshot);
+}
+
+unsigned int sysmon_snapshot_valid(const SysmonSnapshot *snapshot) {
+    return snapshot ? snapshot->valid : 0;
+}
+
+long long sysmon_snapshot_time(const SysmonSnapshot *snapshot) {
+    return snapshot ? snapshot->time_ms : 0;
+}
+
+const CPUStats *sysmon_snapshot_cpu(const SysmonSnapshot *snapshot) {
+    return snapshot && (snapshot->valid & SYSMON_CPU) ? &snapshot->cpu : NULL;
+}
+
+const MemoryStats *sysmon_snapshot_memory(const SysmonSnapshot *snapshot) {
+    return snapshot && (snapshot->valid & SYSMON_MEMORY) ? &snapshot->memory : NULL;
+}
+
+const DiskInfo *sysmon_snapshot_disks(const SysmonSnapshot *snapshot) {
+    return snapshot && (snapshot->valid & SYSMON_DISK) ? &snapshot->disks : NULL;
+}
+
+const NetworkStats *sysmon_snapshot_network(const SysmonSnapshot *snapshot) {
+    return snapshot && (snapshot->valid & SYSMON_NETWORK) ? &snapshot->network : NULL;
+}
+
+const GPUInfo *sysmon_snapshot_gpus(const SysmonSnapshot *snapshot) {
+    return snapshot && (snapshot->valid & SYSMON_GPU) ? &snapshot->gpus : NULL;
+}
+
+/**
+ * @brief Body of a sampler thread
+ * @param arg Sampler
+ * @return NULL
+ *
+ * @details Samples into a private buffer and only takes the lock to publish
+ * the result, so readers never wait for a collector. Deadlines advance by
+ * whole intervals from the start, so the cadence does not drift with the
+ * time spent sampling.
+ */
+static void *sampler_thread(void *arg) {
+    SysmonSampler *sampler = arg;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    pthread_mutex_lock(&sampler->lock);
+    while (!sampler->stopping) {
+        pthread_mutex_unlock(&sampler->lock);
+        sysmon_sample(sampler->mon, &sampler->scratch);
+        pthread_mutex_lock(&sampler->lock);
+        sampler->latest = sampler->scratch;
+        sampler->has_sample = 1;
+
+        deadline.tv_sec += sampler->interval_ms / 1000;
+        deadline.tv_nsec += (sampler->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!sampler->stopping &&
+               pthread_cond_timedwait(&sampler->wake, &sampler->lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&sampler->lock);
+    return NULL;
+}
+
+SysmonSampler *sysmon_sampler_start(const SysmonOptions *options, unsigned int interval_ms) {
+    if (interval_ms == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    SysmonSampler *sampler = calloc(1, sizeof(*sampler));
+    if (!sampler) return NULL;
+    sampler->interval_ms = interval_ms;
+
+    sampler->mon = sysmon_open(options);
+    if (!sampler->mon) {
+        int saved = errno;
+        free(sampler);
+        errno = saved;
+        return NULL;
+    }
+
+    // Deadlines are CLOCK_MONOTONIC so wall clock changes do not stall sampling
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sampler->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&sampler->lock, NULL);
+
+    int err = pthread_create(&sampler->thread, NULL, sampler_thread, sampler);
+    if (err != 0) {
+        pthread_cond_destroy(&sampler->wake);
+        pthread_mutex_destroy(&sampler->lock);
+        sysmon_close(sampler->mon);
+        free(sampler);
+        errno = err;
+        return NULL;
+    }
+    return sampler;
+}
+
+int sysmon_sampler_read(SysmonSampler *sampler, SysmonSnapshot *snapshot) {
+    if (!sampler || !snapshot) return -1;
+
+    pthread_mutex_lock(&sampler->lock);
+    int ok = sampler->has_sample;
+    if (ok) *snapshot = sampler->latest;
+    pthread_mutex_unlock(&sampler->lock);
+    return ok ? 0 : -1;
+}
+
+void sysmon_sampler_stop(SysmonSampler *sampler) {
+    if (!sampler) return;
+
+    pthread_mutex_lock(&sampler->lock);
+    sampler->stopping = 1;
+    pthread_cond_signal(&sampler->wake);
+    pthread_mutex_unlock(&sampler->lock);
+    pthread_join(sampler->thread, NULL);
+
+    pthread_cond_destroy(&sampler->wake);
+    pthread_mutex_destroy(&sampler->lock);
+    sysmon_close(sampler->mon);
+    free(sampler);
+}
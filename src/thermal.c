@@ -0,0 +1,362 @@
+/**
+ * @file thermal.c
+ * @brief Implementation of temperature and thermal throttling monitoring
+ */
+
+#include "thermal.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_THERMAL_INPUTS 32
+#define MAX_THERMAL_PACKAGES 64
+
+/**
+ * @brief A discovered temperature input and its open descriptor
+ */
+typedef struct {
+    int fd;              // tempN_input or thermal_zoneN/temp
+    ThermalSensor info;  // Static label, chip, kind and critical point
+} ThermalSource;
+
+/**
+ * @brief The thermal_throttle counters of one CPU
+ *
+ * Package counters are shared by every CPU of a package, so only the first
+ * CPU seen in each package keeps them open.
+ */
+typedef struct {
+    int core_fd;
+    int core_time_fd;
+    int package_fd;
+    int package_time_fd;
+    unsigned long long prev_core;
+    unsigned long long prev_core_time;
+    unsigned long long prev_package;
+    unsigned long long prev_package_time;
+} ThrottleCPU;
+
+/**
+ * @brief Discovered sensors and throttle counters
+ */
+struct ThermalMonitor {
+    ThermalSource sources[MAX_THERMAL_SENSORS];
+    unsigned int source_count;
+    ThrottleCPU *throttle_cpus;
+    unsigned int throttle_cpu_count;
+    int throttle_primed;
+};
+
+/**
+ * @brief Parse a millidegree Celsius attribute, which may be negative
+ * @param buf Attribute contents
+ * @param celsius Pointer to store the temperature in °C
+ * @return 0 on success, -1 on failure
+ */
+static int parse_millidegrees(const char *buf, double *celsius) {
+    char *end;
+    long value = strtol(buf, &end, 10);
+    if (end == buf) return -1;
+    *celsius = value / 1000.0;
+    return 0;
+}
+
+/**
+ * @brief Read a millidegree attribute once
+ * @param path Absolute path (the sysfs root is prepended)
+ * @return Temperature in °C, or 0 if unavailable
+ */
+static double read_millidegrees(const char *path) {
+    char buf[32];
+    double celsius;
+    if (sysfs_read_string(path, buf, sizeof(buf)) != 0) return 0;
+    return parse_millidegrees(buf, &celsius) == 0 ? celsius : 0;
+}
+
+/**
+ * @brief Check whether a chip name belongs to an already discovered hwmon sensor
+ * @param monitor Monitor holding the sensors
+ * @param chip hwmon chip name or thermal zone type
+ * @return Non-zero if a sensor from that chip is known
+ */
+static int have_chip(const ThermalMonitor *monitor, const char *chip) {
+    for (unsigned int i = 0; i < monitor->source_count; i++) {
+        if (strcmp(monitor->sources[i].info.chip, chip) == 0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Check whether any package sensor has been discovered
+ * @param monitor Monitor holding the sensors
+ */
+static int have_package_sensor(const ThermalMonitor *monitor) {
+    for (unsigned int i = 0; i < monitor->source_count; i++) {
+        if (monitor->sources[i].info.kind == THERMAL_SENSOR_PACKAGE) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Classify an hwmon temperature input by its chip and label
+ * @param chip hwmon chip name
+ * @param label Sensor label (may be empty)
+ * @param has_tdie Non-zero if the same chip also reports Tdie
+ * @return Sensor kind
+ */
+static ThermalSensorKind classify_hwmon(const char *chip, const char *label, int has_tdie) {
+    if (strcmp(chip, "coretemp") == 0) {
+        if (strncmp(label, "Package id", 10) == 0) return THERMAL_SENSOR_PACKAGE;
+        if (strncmp(label, "Core", 4) == 0) return THERMAL_SENSOR_CORE;
+    } else if (strcmp(chip, "k10temp") == 0 || strcmp(chip, "zenpower") == 0) {
+        // Tctl carries a fan-control offset on some parts; Tdie is the real die temperature
+        if (strcmp(label, "Tdie") == 0) return THERMAL_SENSOR_PACKAGE;
+        if (strcmp(label, "Tctl") == 0) return has_tdie ? THERMAL_SENSOR_OTHER : THERMAL_SENSOR_PACKAGE;
+        if (strncmp(label, "Tccd", 4) == 0) return THERMAL_SENSOR_CORE;
+    } else if (strcmp(chip, "x86_pkg_temp") == 0 || strcmp(chip, "cpu_thermal") == 0) {
+        return THERMAL_SENSOR_PACKAGE;
+    }
+    return THERMAL_SENSOR_OTHER;
+}
+
+/**
+ * @brief Add every temperature input of one hwmon chip
+ * @param monitor Monitor to add to
+ * @param hwmon hwmon directory index
+ */
+static void discover_hwmon_chip(ThermalMonitor *monitor, unsigned int hwmon) {
+    char dir[256];
+    char path[320];
+    char chip[MAX_THERMAL_LABEL] = "";
+    unsigned int inputs[MAX_THERMAL_INPUTS];
+    char labels[MAX_THERMAL_INPUTS][MAX_THERMAL_LABEL];
+    int has_tdie = 0;
+
+    snprintf(dir, sizeof(dir), "/sys/class/hwmon/hwmon%u", hwmon);
+    snprintf(path, sizeof(path), "%s/name", dir);
+    if (sysfs_read_string(path, chip, sizeof(chip)) != 0) return;
+
+    unsigned int count = sysfs_list_indices(dir, "temp", "_input", inputs, MAX_THERMAL_INPUTS);
+    for (unsigned int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/temp%u_label", dir, inputs[i]);
+        if (sysfs_read_string(path, labels[i], sizeof(labels[i])) != 0) {
+            snprintf(labels[i], sizeof(labels[i]), "%.20s temp%u", chip, inputs[i]);
+        }
+        if (strcmp(labels[i], "Tdie") == 0) has_tdie = 1;
+    }
+
+    for (unsigned int i = 0; i < count && monitor->source_count < MAX_THERMAL_SENSORS; i++) {
+        ThermalSource *src = &monitor->sources[monitor->source_count];
+        snprintf(path, sizeof(path), "%s/temp%u_input", dir, inputs[i]);
+        src->fd = sysfs_open(path);
+        if (src->fd < 0) continue;
+
+        memset(&src->info, 0, sizeof(src->info));
+        memcpy(src->info.label, labels[i], MAX_THERMAL_LABEL);
+        memcpy(src->info.chip, chip, MAX_THERMAL_LABEL);
+        src->info.kind = classify_hwmon(chip, labels[i], has_tdie);
+        snprintf(path, sizeof(path), "%s/temp%u_crit", dir, inputs[i]);
+        src->info.critical = read_millidegrees(path);
+        monitor->source_count++;
+    }
+}
+
+/**
+ * @brief Add a thermal zone unless hwmon already exposes the same sensor
+ * @param monitor Monitor to add to
+ * @param zone thermal_zone directory index
+ *
+ * @details Most thermal zone drivers also register an hwmon chip named after
+ * the zone type, so zones are only used for sensors hwmon does not cover.
+ */
+static void discover_thermal_zone(ThermalMonitor *monitor, unsigned int zone) {
+    char dir[256];
+    char path[320];
+    char type[MAX_THERMAL_LABEL];
+    unsigned int trips[MAX_THERMAL_INPUTS];
+
+    snprintf(dir, sizeof(dir), "/sys/class/thermal/thermal_zone%u", zone);
+    snprintf(path, sizeof(path), "%s/type", dir);
+    if (sysfs_read_string(path, type, sizeof(type)) != 0) return;
+    if (have_chip(monitor, type)) return;
+
+    ThermalSensorKind kind = classify_hwmon(type, "", 0);
+    if (kind == THERMAL_SENSOR_PACKAGE && have_package_sensor(monitor)) return;
+    if (monitor->source_count >= MAX_THERMAL_SENSORS) return;
+
+    ThermalSource *src = &monitor->sources[monitor->source_count];
+    snprintf(path, sizeof(path), "%s/temp", dir);
+    src->fd = sysfs_open(path);
+    if (src->fd < 0) return;
+
+    memset(&src->info, 0, sizeof(src->info));
+    snprintf(src->info.label, sizeof(src->info.label), "zone%u", zone);
+    memcpy(src->info.chip, type, MAX_THERMAL_LABEL);
+    src->info.kind = kind;
+
+    unsigned int trip_count = sysfs_list_indices(dir, "trip_point_", "_type", trips, MAX_THERMAL_INPUTS);
+    for (unsigned int i = 0; i < trip_count; i++) {
+        char trip_type[16];
+        snprintf(path, sizeof(path), "%s/trip_point_%u_type", dir, trips[i]);
+        if (sysfs_read_string(path, trip_type, sizeof(trip_type)) != 0) continue;
+        if (strcmp(trip_type, "critical") != 0) continue;
+        snprintf(path, sizeof(path), "%s/trip_point_%u_temp", dir, trips[i]);
+        src->info.critical = read_millidegrees(path);
+        break;
+    }
+    monitor->source_count++;
+}
+
+/**
+ * @brief Open the thermal_throttle counters of every CPU
+ * @param monitor Monitor to add to
+ */
+static void discover_throttle_counters(ThermalMonitor *monitor) {
+    unsigned int cpus[4096];
+    int packages[MAX_THERMAL_PACKAGES];
+    unsigned int package_count = 0;
+    char path[320];
+
+    unsigned int count = sysfs_list_indices("/sys/devices/system/cpu", "cpu", "", cpus, 4096);
+    if (count == 0) return;
+
+    monitor->throttle_cpus = calloc(count, sizeof(*monitor->throttle_cpus));
+    if (!monitor->throttle_cpus) return;
+
+    for (unsigned int i = 0; i < count; i++) {
+        ThrottleCPU *cpu = &monitor->throttle_cpus[monitor->throttle_cpu_count];
+        cpu->package_fd = cpu->package_time_fd = -1;
+
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/thermal_throttle/core_throttle_count", cpus[i]);
+        cpu->core_fd = sysfs_open(path);
+        if (cpu->core_fd < 0) continue;  // Offline, or no thermal_throttle support
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/thermal_throttle/core_throttle_total_time_ms", cpus[i]);
+        cpu->core_time_fd = sysfs_open(path);
+
+        // First CPU of each package owns the package counters
+        unsigned long long package = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpus[i]);
+        sysfs_read_ull(path, &package);
+        int seen = 0;
+        for (unsigned int p = 0; p < package_count; p++) {
+            if (packages[p] == (int)package) seen = 1;
+        }
+        if (!seen && package_count < MAX_THERMAL_PACKAGES) {
+            packages[package_count++] = (int)package;
+            snprintf(path, sizeof(path),
+                     "/sys/devices/system/cpu/cpu%u/thermal_throttle/package_throttle_count", cpus[i]);
+            cpu->package_fd = sysfs_open(path);
+            snprintf(path, sizeof(path),
+                     "/sys/devices/system/cpu/cpu%u/thermal_throttle/package_throttle_total_time_ms", cpus[i]);
+            cpu->package_time_fd = sysfs_open(path);
+        }
+        monitor->throttle_cpu_count++;
+    }
+}
+
+/**
+ * @brief Return the growth of a counter and remember its new value
+ * @param primed Whether the previous value is valid
+ * @param fd Counter descriptor
+ * @param prev Previous value; updated
+ * @param total Running total to add the current value to (may be NULL)
+ * @return Increase since the previous read, 0 on the first read or a reset
+ */
+static unsigned long long counter_delta(int primed, int fd, unsigned long long *prev,
+                                        unsigned long long *total) {
+    unsigned long long value;
+    if (fd < 0 || sysfs_pread_ull(fd, &value) != 0) return 0;
+    if (total) *total += value;
+
+    unsigned long long delta = (primed && value > *prev) ? value - *prev : 0;
+    *prev = value;
+    return delta;
+}
+
+ThermalMonitor *create_thermal_monitor(void) {
+    unsigned int indices[MAX_THERMAL_SENSORS];
+    unsigned int count;
+
+    ThermalMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    count = sysfs_list_indices("/sys/class/hwmon", "hwmon", "", indices, MAX_THERMAL_SENSORS);
+    for (unsigned int i = 0; i < count; i++) discover_hwmon_chip(monitor, indices[i]);
+
+    count = sysfs_list_indices("/sys/class/thermal", "thermal_zone", "", indices, MAX_THERMAL_SENSORS);
+    for (unsigned int i = 0; i < count; i++) discover_thermal_zone(monitor, indices[i]);
+
+    discover_throttle_counters(monitor);
+    return monitor;
+}
+
+int update_thermal_stats(ThermalMonitor *monitor, ThermalStats *stats) {
+    if (!monitor || !stats) return -1;
+
+    double core_sum = 0;
+    unsigned int core_count = 0;
+    char buf[32];
+
+    stats->count = monitor->source_count;
+    stats->package_temp = 0;
+    stats->core_temp_max = 0;
+    for (unsigned int i = 0; i < monitor->source_count; i++) {
+        ThermalSensor *sensor = &stats->sensors[i];
+        *sensor = monitor->sources[i].info;
+        sensor->valid = sysfs_pread(monitor->sources[i].fd, buf, sizeof(buf)) > 0 &&
+                        parse_millidegrees(buf, &sensor->temperature) == 0;
+        if (!sensor->valid) continue;
+
+        if (sensor->kind == THERMAL_SENSOR_PACKAGE && sensor->temperature > stats->package_temp) {
+            stats->package_temp = sensor->temperature;
+        } else if (sensor->kind == THERMAL_SENSOR_CORE) {
+            if (sensor->temperature > stats->core_temp_max) stats->core_temp_max = sensor->temperature;
+            core_sum += sensor->temperature;
+            core_count++;
+        }
+    }
+    stats->core_temp_avg = core_count ? core_sum / core_count : 0;
+
+    stats->core_throttle_count = 0;
+    stats->package_throttle_count = 0;
+    stats->core_throttle_events = 0;
+    stats->package_throttle_events = 0;
+    stats->core_throttle_ms = 0;
+    stats->package_throttle_ms = 0;
+    stats->throttling_cpus = 0;
+    int primed = monitor->throttle_primed;
+    for (unsigned int i = 0; i < monitor->throttle_cpu_count; i++) {
+        ThrottleCPU *cpu = &monitor->throttle_cpus[i];
+        unsigned long long core = counter_delta(primed, cpu->core_fd, &cpu->prev_core,
+                                                &stats->core_throttle_count);
+        if (core > 0) stats->throttling_cpus++;
+        stats->core_throttle_events += core;
+        stats->package_throttle_events += counter_delta(primed, cpu->package_fd, &cpu->prev_package,
+                                                        &stats->package_throttle_count);
+        // Core time adds up over CPUs; package time is read from one CPU per package
+        stats->core_throttle_ms += counter_delta(primed, cpu->core_time_fd, &cpu->prev_core_time, NULL);
+        stats->package_throttle_ms += counter_delta(primed, cpu->package_time_fd,
+                                                    &cpu->prev_package_time, NULL);
+    }
+    stats->throttling = stats->core_throttle_events > 0 || stats->package_throttle_events > 0;
+    monitor->throttle_primed = 1;
+    return 0;
+}
+
+void destroy_thermal_monitor(ThermalMonitor *monitor) {
+    if (!monitor) return;
+    for (unsigned int i = 0; i < monitor->source_count; i++) sysfs_close(&monitor->sources[i].fd);
+
+    for (unsigned int i = 0; i < monitor->throttle_cpu_count; i++) {
+        ThrottleCPU *cpu = &monitor->throttle_cpus[i];
+        sysfs_close(&cpu->core_fd);
+        sysfs_close(&cpu->core_time_fd);
+        sysfs_close(&cpu->package_fd);
+        sysfs_close(&cpu->package_time_fd);
+    }
+    free(monitor->throttle_cpus);
+    free(monitor);
+}
@@ -0,0 +1,206 @@
+/**
+ * @file topology.c
+ * @brief Implementation of CPU topology discovery and usage aggregation
+ */
+
+#include "topology.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CACHE_INDICES 8
+
+/**
+ * @brief Topology discovered at creation
+ */
+struct CPUTopology {
+    // Group templates; usage fields are filled per update
+    TopologyGroup packages[MAX_TOPOLOGY_PACKAGES];
+    unsigned int package_count;
+    TopologyGroup l3_domains[MAX_TOPOLOGY_L3];
+    unsigned int l3_count;
+    TopologyGroup cores[MAX_TOPOLOGY_CORES];
+    unsigned int core_count;
+    unsigned int threads_per_core;
+
+    // Keys identifying groups during discovery
+    long l3_keys[MAX_TOPOLOGY_L3];                   // First CPU sharing the L3, or -1 - package
+    unsigned long long core_keys[MAX_TOPOLOGY_CORES]; // die_id << 32 | core_id
+
+    // Core index of every logical CPU, -1 if unknown
+    int cpu_core[MAX_CPUS];
+};
+
+/**
+ * @brief Read an unsigned topology attribute of one CPU
+ * @param cpu Logical CPU number
+ * @param name Attribute name below topology/
+ * @param fallback Value to return if the attribute is missing
+ * @return Attribute value or fallback
+ */
+static unsigned long long read_topology_value(unsigned int cpu, const char *name,
+                                              unsigned long long fallback) {
+    char path[256];
+    unsigned long long value;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/%s", cpu, name);
+    return sysfs_read_ull(path, &value) == 0 ? value : fallback;
+}
+
+/**
+ * @brief Find the first CPU sharing this CPU's L3 cache
+ * @param cpu Logical CPU number
+ * @return First CPU in the L3's shared_cpu_list, or -1 if no L3 is reported
+ */
+static long find_l3_leader(unsigned int cpu) {
+    unsigned int indices[MAX_CACHE_INDICES];
+    char dir[128];
+    char path[256];
+    char buf[512];
+
+    snprintf(dir, sizeof(dir), "/sys/devices/system/cpu/cpu%u/cache", cpu);
+    unsigned int count = sysfs_list_indices(dir, "index", "", indices, MAX_CACHE_INDICES);
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned long long level;
+        snprintf(path, sizeof(path), "%s/index%u/level", dir, indices[i]);
+        if (sysfs_read_ull(path, &level) != 0 || level != 3) continue;
+
+        // shared_cpu_list is sorted ("0-7,64-71"), so its first number is the lowest CPU
+        snprintf(path, sizeof(path), "%s/index%u/shared_cpu_list", dir, indices[i]);
+        if (sysfs_read_string(path, buf, sizeof(buf)) != 0) continue;
+        char *end;
+        unsigned long first = strtoul(buf, &end, 10);
+        if (end != buf) return (long)first;
+    }
+    return -1;
+}
+
+/**
+ * @brief Start a group with one CPU
+ * @param group Group to initialize
+ * @param id Group id
+ * @param parent Parent group index, or -1
+ * @param cpu First CPU of the group
+ */
+static void start_group(TopologyGroup *group, unsigned int id, int parent, unsigned int cpu) {
+    memset(group, 0, sizeof(*group));
+    group->id = id;
+    group->parent = parent;
+    group->first_cpu = cpu;
+}
+
+/**
+ * @brief Place one online CPU into its package, L3 domain and core
+ * @param topo Topology being discovered
+ * @param cpu Logical CPU number
+ * @return 0 on success (or if the CPU is offline or beyond MAX_CPUS), -1 if a table is full
+ */
+static int add_cpu(CPUTopology *topo, unsigned int cpu) {
+    if (cpu >= MAX_CPUS) return 0;  // Beyond the per-CPU tables, like cpu.c
+    // Offline CPUs have no topology directory
+    unsigned long long core_id = read_topology_value(cpu, "core_id", ~0ULL);
+    if (core_id == ~0ULL) return 0;
+    unsigned int package_id = (unsigned int)read_topology_value(cpu, "physical_package_id", 0);
+    unsigned long long die_id = read_topology_value(cpu, "die_id", 0);
+    unsigned int p, l, c;
+
+    for (p = 0; p < topo->package_count && topo->packages[p].id != package_id; p++);
+    if (p == topo->package_count) {
+        if (topo->package_count >= MAX_TOPOLOGY_PACKAGES) return -1;
+        start_group(&topo->packages[topo->package_count++], package_id, -1, cpu);
+    }
+    topo->packages[p].cpu_count++;
+
+    long l3_key = find_l3_leader(cpu);
+    if (l3_key < 0) l3_key = -1 - (long)p;  // One domain per package without L3 info
+    for (l = 0; l < topo->l3_count && topo->l3_keys[l] != l3_key; l++);
+    if (l == topo->l3_count) {
+        if (topo->l3_count >= MAX_TOPOLOGY_L3) return -1;
+        topo->l3_keys[topo->l3_count] = l3_key;
+        start_group(&topo->l3_domains[topo->l3_count], topo->l3_count, (int)p, cpu);
+        topo->l3_count++;
+    }
+    topo->l3_domains[l].cpu_count++;
+
+    // core_id is only unique within a die of a package
+    unsigned long long core_key = die_id << 32 | (core_id & 0xffffffffULL);
+    for (c = 0; c < topo->core_count; c++) {
+        const TopologyGroup *l3 = &topo->l3_domains[topo->cores[c].parent];
+        if (topo->core_keys[c] == core_key && l3->parent == (int)p) break;
+    }
+    if (c == topo->core_count) {
+        if (topo->core_count >= MAX_TOPOLOGY_CORES) return -1;
+        topo->core_keys[topo->core_count] = core_key;
+        start_group(&topo->cores[topo->core_count], topo->core_count, (int)l, cpu);
+        topo->core_count++;
+    }
+    unsigned int siblings = ++topo->cores[c].cpu_count;
+    if (siblings > topo->threads_per_core) topo->threads_per_core = siblings;
+
+    topo->cpu_core[cpu] = (int)c;
+    return 0;
+}
+
+CPUTopology *create_topology(void) {
+    unsigned int cpus[MAX_CPUS];
+
+    CPUTopology *topo = calloc(1, sizeof(*topo));
+    if (!topo) return NULL;
+    for (unsigned int i = 0; i < MAX_CPUS; i++) topo->cpu_core[i] = -1;
+
+    unsigned int count = sysfs_list_indices("/sys/devices/system/cpu", "cpu", "", cpus, MAX_CPUS);
+    for (unsigned int i = 0; i < count; i++) {
+        if (add_cpu(topo, cpus[i]) != 0) break;
+    }
+    return topo;
+}
+
+/**
+ * @brief Fold one CPU's usage into a group
+ * @param group Group to update
+ * @param usage CPU usage in percent
+ */
+static void accumulate(TopologyGroup *group, double usage) {
+    group->sampled++;
+    group->usage += usage;
+    if (usage > group->max_usage) group->max_usage = usage;
+}
+
+/**
+ * @brief Turn a group's usage sum into the average over its sampled CPUs
+ * @param group Group to update; usage stays 0 if no CPU had a sample
+ */
+static void average(TopologyGroup *group) {
+    if (group->sampled) group->usage /= group->sampled;
+}
+
+int update_topology_stats(const CPUTopology *topo, const CPUStats *cpu, TopologyStats *stats) {
+    if (!topo || !cpu || !stats) return -1;
+
+    memcpy(stats->packages, topo->packages, topo->package_count * sizeof(topo->packages[0]));
+    memcpy(stats->l3, topo->l3_domains, topo->l3_count * sizeof(topo->l3_domains[0]));
+    memcpy(stats->cores, topo->cores, topo->core_count * sizeof(topo->cores[0]));
+    stats->package_count = topo->package_count;
+    stats->l3_count = topo->l3_count;
+    stats->core_count = topo->core_count;
+    stats->threads_per_core = topo->threads_per_core;
+
+    for (unsigned int i = 0; i < cpu->cpu_count && i < MAX_CPUS; i++) {
+        if (topo->cpu_core[i] < 0 || cpu->cpu_usage[i] < 0) continue;
+        TopologyGroup *core = &stats->cores[topo->cpu_core[i]];
+        TopologyGroup *l3 = &stats->l3[core->parent];
+        accumulate(core, cpu->cpu_usage[i]);
+        accumulate(l3, cpu->cpu_usage[i]);
+        accumulate(&stats->packages[l3->parent], cpu->cpu_usage[i]);
+    }
+
+    // Turn sums into averages over the CPUs that had a sample
+    for (unsigned int i = 0; i < topo->core_count; i++) average(&stats->cores[i]);
+    for (unsigned int i = 0; i < topo->l3_count; i++) average(&stats->l3[i]);
+    for (unsigned int i = 0; i < topo->package_count; i++) average(&stats->packages[i]);
+    return 0;
+}
+
+void destroy_topology(CPUTopology *topo) {
+    free(topo);
+}
@@ -0,0 +1,511 @@
+/**
+ * @file workingset.c
+ * @brief Implementation of the working set estimator
+ */
+
+#include "workingset.h"
+#include "sysfs.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KB_TO_BYTES (1024UL)
+#define WS_BLOCK_WORDS 512   // Bitmap words per block: 32768 page frames
+#define WS_SAMPLES 16        // Refault samples spread over the window
+#define MAX_TRACKED_CGROUPS 64
+#define CGROUP_PATH_MAX 512
+
+/**
+ * @brief Sweep state of one bitmap block
+ */
+typedef enum {
+    BLOCK_UNMARKED,  // Not visited yet; its bits say nothing
+    BLOCK_MARKED,    // Marked idle once, measured on the next visit
+    BLOCK_MEASURED   // idle_counts holds the idle pages of the last visit
+} BlockState;
+
+/**
+ * @brief A child cgroup of the root and its refault count at each sample
+ */
+typedef struct {
+    char name[MAX_CGROUP_NAME];
+    unsigned long usage;
+    unsigned long active;
+    unsigned long refaults;  // Pages, since boot
+    int present;             // Listed in the last update
+    unsigned long samples[WS_SAMPLES];
+} TrackedCgroup;
+
+/**
+ * @brief Open files, sweep position and the refault samples
+ *
+ * @details The bitmap is swept one block at a time: "due" accumulates the
+ * words the elapsed time allows, so that a full pass takes the window
+ * whatever the update interval. The samples form a ring as in kmem.c.
+ */
+struct WorkingSetMonitor {
+    FILE *meminfo;
+    FILE *vmstat;
+    unsigned int window_ms;
+    unsigned long page_size;
+
+    int bitmap_fd;                    // -1 without idle page tracking
+    char idle_error[64];
+    unsigned long words;              // 64-bit words in the bitmap
+    unsigned long blocks;
+    unsigned char *block_states;      // BlockState of each block
+    unsigned int *idle_counts;        // Idle pages of each measured block
+    unsigned long measured_blocks;
+    unsigned long measured_words;
+    unsigned long idle_pages;         // Sum of idle_counts over measured blocks
+    unsigned long next_block;
+    double due;                       // Words the elapsed time allows to sweep
+    long long last_sweep;
+    uint64_t buffer[WS_BLOCK_WORDS];
+    uint64_t ones[WS_BLOCK_WORDS];
+
+    int cgroup_version;               // 1, 2, or 0 without a memory controller
+    char cgroup_root[CGROUP_PATH_MAX];
+    TrackedCgroup cgroups[MAX_TRACKED_CGROUPS];
+    unsigned int cgroup_count;
+
+    long long sample_times[WS_SAMPLES];  // Monotonic milliseconds
+    unsigned long refault_samples[WS_SAMPLES];
+    unsigned int sample_count;
+    unsigned int next_sample;
+};
+
+/**
+ * @brief Current monotonic time in milliseconds
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Highest page frame number from /proc/zoneinfo
+ * @return One past the last page frame of any zone, 0 if unknown
+ *
+ * @details Each zone lists "spanned" before "start_pfn".
+ */
+static unsigned long read_max_pfn(void) {
+    FILE *fp = fopen("/proc/zoneinfo", "r");
+    if (!fp) return 0;
+
+    char line[256];
+    unsigned long spanned = 0, max_pfn = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long value;
+        if (sscanf(line, " spanned %lu", &value) == 1) {
+            spanned = value;
+        } else if (sscanf(line, " start_pfn: %lu", &value) == 1) {
+            if (value + spanned > max_pfn) max_pfn = value + spanned;
+            spanned = 0;
+        }
+    }
+    fclose(fp);
+    return max_pfn;
+}
+
+/**
+ * @brief Open the page_idle bitmap and allocate the sweep state
+ * @param monitor Monitor to set up; idle_error is set on failure
+ * @return 0 on success, -1 if idle page tracking cannot be used
+ */
+static int open_idle_bitmap(WorkingSetMonitor *monitor) {
+    char path[CGROUP_PATH_MAX];
+    monitor->bitmap_fd = -1;
+    if (sysfs_path(path, sizeof(path), "/sys/kernel/mm/page_idle/bitmap") != 0) return -1;
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(monitor->idle_error, sizeof(monitor->idle_error), "page_idle: %s", strerror(errno));
+        return -1;
+    }
+
+    // Whole words only: the kernel does not return a partial last word
+    monitor->words = read_max_pfn() / 64;
+    monitor->blocks = (monitor->words + WS_BLOCK_WORDS - 1) / WS_BLOCK_WORDS;
+    monitor->block_states = calloc(monitor->blocks ? monitor->blocks : 1, sizeof(*monitor->block_states));
+    monitor->idle_counts = calloc(monitor->blocks ? monitor->blocks : 1, sizeof(*monitor->idle_counts));
+    if (monitor->words == 0 || !monitor->block_states || !monitor->idle_counts) {
+        snprintf(monitor->idle_error, sizeof(monitor->idle_error), "page_idle: no page frame count");
+        free(monitor->block_states);
+        free(monitor->idle_counts);
+        monitor->block_states = NULL;
+        monitor->idle_counts = NULL;
+        close(fd);
+        return -1;
+    }
+    memset(monitor->ones, 0xff, sizeof(monitor->ones));
+    monitor->bitmap_fd = fd;
+    return 0;
+}
+
+/**
+ * @brief Stop idle page tracking after an error and fall back to the counters
+ * @param monitor Monitor with the open bitmap
+ * @param what What failed
+ */
+static void close_idle_bitmap(WorkingSetMonitor *monitor, const char *what) {
+    snprintf(monitor->idle_error, sizeof(monitor->idle_error), "page_idle: %s: %s", what, strerror(errno));
+    close(monitor->bitmap_fd);
+    monitor->bitmap_fd = -1;
+}
+
+/**
+ * @brief Find the memory controller's cgroup root
+ * @param monitor Monitor to store the root and version in
+ *
+ * @details A v2 hierarchy with the memory controller is preferred, at
+ * /sys/fs/cgroup or at /sys/fs/cgroup/unified of a hybrid setup; then a
+ * v1 memory hierarchy at /sys/fs/cgroup/memory.
+ */
+static void find_cgroup_root(WorkingSetMonitor *monitor) {
+    static const char *const unified[] = {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"};
+    char path[CGROUP_PATH_MAX], controllers[256];
+
+    for (unsigned int i = 0; i < sizeof(unified) / sizeof(unified[0]); i++) {
+        snprintf(path, sizeof(path), "%s/cgroup.controllers", unified[i]);
+        if (sysfs_read_string(path, controllers, sizeof(controllers)) != 0) continue;
+        if (!strstr(controllers, "memory")) continue;
+        if (sysfs_path(monitor->cgroup_root, sizeof(monitor->cgroup_root), "%s", unified[i]) == 0) {
+            monitor->cgroup_version = 2;
+            return;
+        }
+    }
+    if (sysfs_path(monitor->cgroup_root, sizeof(monitor->cgroup_root), "/sys/fs/cgroup/memory") == 0 &&
+        snprintf(path, sizeof(path), "%s/memory.stat", monitor->cgroup_root) < (int)sizeof(path) &&
+        access(path, R_OK) == 0) {
+        monitor->cgroup_version = 1;
+    }
+}
+
+WorkingSetMonitor *create_workingset_monitor(unsigned int window_ms) {
+    WorkingSetMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->meminfo = fopen("/proc/meminfo", "r");
+    monitor->vmstat = fopen("/proc/vmstat", "r");
+    if (!monitor->meminfo || !monitor->vmstat) {
+        if (monitor->meminfo) fclose(monitor->meminfo);
+        if (monitor->vmstat) fclose(monitor->vmstat);
+        free(monitor);
+        return NULL;
+    }
+    monitor->window_ms = window_ms > 0 ? window_ms : DEFAULT_WORKINGSET_WINDOW_MS;
+    long page_size = sysconf(_SC_PAGESIZE);
+    monitor->page_size = page_size > 0 ? (unsigned long)page_size : 4096;
+    open_idle_bitmap(monitor);
+    find_cgroup_root(monitor);
+    return monitor;
+}
+
+void destroy_workingset_monitor(WorkingSetMonitor *monitor) {
+    if (!monitor) return;
+    if (monitor->bitmap_fd >= 0) close(monitor->bitmap_fd);
+    fclose(monitor->meminfo);
+    fclose(monitor->vmstat);
+    free(monitor->block_states);
+    free(monitor->idle_counts);
+    free(monitor);
+}
+
+/**
+ * @brief Read the LRU list sizes from /proc/meminfo
+ * @param fp Open /proc/meminfo
+ * @param stats Statistics to update
+ * @return 0 on success, -1 on failure
+ */
+static int read_meminfo(FILE *fp, WorkingSetStats *stats) {
+    // Seeking back to the start makes procfs regenerate the file
+    rewind(fp);
+
+    char line[256];
+    int found = 0;
+    stats->lru = stats->active = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long value;
+        if (sscanf(line, "Active(anon): %lu kB", &value) == 1 ||
+            sscanf(line, "Active(file): %lu kB", &value) == 1) {
+            stats->active += value * KB_TO_BYTES;
+            stats->lru += value * KB_TO_BYTES;
+            found++;
+        } else if (sscanf(line, "Inactive(anon): %lu kB", &value) == 1 ||
+                   sscanf(line, "Inactive(file): %lu kB", &value) == 1 ||
+                   sscanf(line, "Unevictable: %lu kB", &value) == 1) {
+            stats->lru += value * KB_TO_BYTES;
+        }
+    }
+    return found ? 0 : -1;
+}
+
+/**
+ * @brief Add up the workingset_refault counters of /proc/vmstat
+ * @param fp Open /proc/vmstat
+ * @return Refaulted pages since boot
+ *
+ * @details Kernels before 5.9 have a single workingset_refault; later ones
+ * split it into _anon and _file.
+ */
+static unsigned long read_vmstat_refaults(FILE *fp) {
+    rewind(fp);
+
+    char line[128];
+    unsigned long refaults = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] != 'w' || strncmp(line, "workingset_refault", 18) != 0) continue;
+        const char *value = strchr(line, ' ');
+        if (value) refaults += strtoul(value, NULL, 10);
+    }
+    return refaults;
+}
+
+/**
+ * @brief Read the active pages, refaults and usage of one cgroup
+ * @param monitor Monitor with the root and version
+ * @param cgroup Cgroup to update
+ * @return 0 on success, -1 if memory.stat cannot be read
+ *
+ * @details v1 lists each counter of the cgroup alone and, prefixed with
+ * "total_", including its descendants; the totals are used, as v2 counts.
+ */
+static int read_cgroup(const WorkingSetMonitor *monitor, TrackedCgroup *cgroup) {
+    char path[CGROUP_PATH_MAX + MAX_CGROUP_NAME + 32], line[128];
+    snprintf(path, sizeof(path), "%s%s/memory.stat", monitor->cgroup_root, cgroup->name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    cgroup->active = cgroup->refaults = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        const char *key = line;
+        if (monitor->cgroup_version == 1) {
+            if (strncmp(key, "total_", 6) != 0) continue;
+            key += 6;
+        }
+        const char *value = strchr(key, ' ');
+        if (!value) continue;
+        if (!strncmp(key, "active_anon ", 12) || !strncmp(key, "active_file ", 12)) {
+            cgroup->active += strtoul(value, NULL, 10);
+        } else if (!strncmp(key, "workingset_refault", 18)) {
+            cgroup->refaults += strtoul(value, NULL, 10);
+        }
+    }
+    fclose(fp);
+
+    snprintf(path, sizeof(path), "%s%s/%s", monitor->cgroup_root, cgroup->name,
+             monitor->cgroup_version == 2 ? "memory.current" : "memory.usage_in_bytes");
+    fp = fopen(path, "r");
+    cgroup->usage = 0;
+    if (fp) {
+        if (fscanf(fp, "%lu", &cgroup->usage) != 1) cgroup->usage = 0;
+        fclose(fp);
+    }
+    return 0;
+}
+
+/**
+ * @brief Read every child cgroup of the root, tracking new ones and forgetting removed ones
+ * @param monitor Monitor with the tracked cgroups
+ *
+ * @details A cgroup's refaults are counted from when it was first seen.
+ */
+static void read_cgroups(WorkingSetMonitor *monitor) {
+    DIR *dir = opendir(monitor->cgroup_root);
+    if (!dir) return;
+
+    for (unsigned int i = 0; i < monitor->cgroup_count; i++) monitor->cgroups[i].present = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_type != DT_DIR || ent->d_name[0] == '.') continue;
+        size_t len = strlen(ent->d_name);
+        if (len + 1 >= MAX_CGROUP_NAME) continue;
+
+        unsigned int i;
+        for (i = 0; i < monitor->cgroup_count && strcmp(monitor->cgroups[i].name + 1, ent->d_name); i++) {}
+        int found = i < monitor->cgroup_count;
+        if (!found && monitor->cgroup_count == MAX_TRACKED_CGROUPS) continue;
+
+        TrackedCgroup *cgroup = &monitor->cgroups[i];
+        if (!found) {
+            cgroup->name[0] = '/';
+            memcpy(cgroup->name + 1, ent->d_name, len + 1);
+        }
+        if (read_cgroup(monitor, cgroup) != 0) continue;
+        if (!found) {
+            for (unsigned int s = 0; s < WS_SAMPLES; s++) cgroup->samples[s] = cgroup->refaults;
+            monitor->cgroup_count++;
+        }
+        cgroup->present = 1;
+    }
+    closedir(dir);
+
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < monitor->cgroup_count; i++) {
+        if (!monitor->cgroups[i].present) continue;
+        if (kept != i) monitor->cgroups[kept] = monitor->cgroups[i];
+        kept++;
+    }
+    monitor->cgroup_count = kept;
+}
+
+/**
+ * @brief Measure one block of the bitmap and mark its pages idle again
+ * @param monitor Monitor with the open bitmap
+ * @param block Block to sweep
+ * @return 0 on success, -1 if the bitmap cannot be read or written
+ *
+ * @details A set bit is a page not touched since the block was last
+ * marked. Pages that are not on the LRU lists read as 0 and ignore the
+ * mark, so only set bits are counted.
+ */
+static int sweep_block(WorkingSetMonitor *monitor, unsigned long block) {
+    unsigned long first = block * WS_BLOCK_WORDS;
+    unsigned long count = monitor->words - first < WS_BLOCK_WORDS ? monitor->words - first : WS_BLOCK_WORDS;
+    off_t offset = (off_t)(first * sizeof(uint64_t));
+
+    ssize_t n = pread(monitor->bitmap_fd, monitor->buffer, count * sizeof(uint64_t), offset);
+    if (n <= 0) {
+        if (n == 0) errno = ENXIO;
+        close_idle_bitmap(monitor, "read");
+        return -1;
+    }
+    count = (unsigned long)n / sizeof(uint64_t);
+
+    if (monitor->block_states[block] != BLOCK_UNMARKED) {
+        unsigned int idle = 0;
+        for (unsigned long i = 0; i < count; i++) {
+            if (monitor->buffer[i]) idle += (unsigned int)__builtin_popcountll(monitor->buffer[i]);
+        }
+        if (monitor->block_states[block] == BLOCK_MEASURED) {
+            monitor->idle_pages -= monitor->idle_counts[block];
+        } else {
+            monitor->block_states[block] = BLOCK_MEASURED;
+            monitor->measured_blocks++;
+            monitor->measured_words += count;
+        }
+        monitor->idle_counts[block] = idle;
+        monitor->idle_pages += idle;
+    } else {
+        monitor->block_states[block] = BLOCK_MARKED;
+    }
+
+    if (pwrite(monitor->bitmap_fd, monitor->ones, count * sizeof(uint64_t), offset) < 0) {
+        close_idle_bitmap(monitor, "write");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sweep as much of the bitmap as the time since the last sweep allows
+ * @param monitor Monitor with the open bitmap
+ * @param now Current monotonic time in milliseconds
+ * @param stats Statistics to store the sweep time in
+ */
+static void sweep_bitmap(WorkingSetMonitor *monitor, long long now, WorkingSetStats *stats) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (monitor->last_sweep > 0) {
+        monitor->due += (double)monitor->words * (now - monitor->last_sweep) / monitor->window_ms;
+        if (monitor->due > monitor->words) monitor->due = monitor->words;  // After a stall, one pass at most
+    }
+    monitor->last_sweep = now;
+
+    while (monitor->bitmap_fd >= 0) {
+        unsigned long first = monitor->next_block * WS_BLOCK_WORDS;
+        unsigned long count = monitor->words - first < WS_BLOCK_WORDS ? monitor->words - first : WS_BLOCK_WORDS;
+        if (monitor->due < count) break;
+        if (sweep_block(monitor, monitor->next_block) != 0) break;
+        monitor->due -= count;
+        monitor->next_block = (monitor->next_block + 1) % monitor->blocks;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->scan_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+}
+
+/**
+ * @brief Order cgroups by working set, largest first
+ */
+static int compare_working_set(const void *a, const void *b) {
+    const CgroupWorkingSet *x = a, *y = b;
+    return (x->working_set < y->working_set) - (x->working_set > y->working_set);
+}
+
+int update_workingset_stats(WorkingSetMonitor *monitor, WorkingSetStats *stats) {
+    if (!monitor || !stats) return -1;
+    if (read_meminfo(monitor->meminfo, stats) != 0) return -1;
+
+    long long now = now_ms();
+    unsigned long refaults = read_vmstat_refaults(monitor->vmstat);
+    if (monitor->cgroup_version) read_cgroups(monitor);
+
+    // Refaults since the oldest sample, which is about a window old once the ring is full
+    unsigned int oldest = monitor->sample_count < WS_SAMPLES ? 0 : monitor->next_sample;
+    int sampled = monitor->sample_count > 0;
+    unsigned long base = sampled ? monitor->refault_samples[oldest] : refaults;
+    stats->refaulted = (refaults - base) * monitor->page_size;
+    stats->span = sampled ? (unsigned int)((now - monitor->sample_times[oldest]) / 1000) : 0;
+    stats->window = monitor->window_ms / 1000;
+
+    // Per-cgroup estimates, largest kept
+    CgroupWorkingSet all[MAX_TRACKED_CGROUPS];
+    for (unsigned int i = 0; i < monitor->cgroup_count; i++) {
+        const TrackedCgroup *cgroup = &monitor->cgroups[i];
+        CgroupWorkingSet *out = &all[i];
+        memcpy(out->name, cgroup->name, sizeof(out->name));
+        out->usage = cgroup->usage;
+        out->active = cgroup->active;
+        out->refaulted = (cgroup->refaults - cgroup->samples[oldest]) * monitor->page_size;
+        out->working_set = out->active + out->refaulted;
+    }
+    qsort(all, monitor->cgroup_count, sizeof(all[0]), compare_working_set);
+    stats->cgroup_count = monitor->cgroup_count < MAX_WORKINGSET_CGROUPS ?
+                          monitor->cgroup_count : MAX_WORKINGSET_CGROUPS;
+    memcpy(stats->cgroups, all, stats->cgroup_count * sizeof(all[0]));
+
+    // Take a sample every window / (WS_SAMPLES - 1)
+    long long spacing = monitor->window_ms / (WS_SAMPLES - 1);
+    unsigned int last = (monitor->next_sample + WS_SAMPLES - 1) % WS_SAMPLES;
+    if (!sampled || now - monitor->sample_times[last] >= spacing) {
+        unsigned int slot = monitor->next_sample;
+        monitor->sample_times[slot] = now;
+        monitor->refault_samples[slot] = refaults;
+        for (unsigned int i = 0; i < monitor->cgroup_count; i++) {
+            monitor->cgroups[i].samples[slot] = monitor->cgroups[i].refaults;
+        }
+        monitor->next_sample = (slot + 1) % WS_SAMPLES;
+        if (monitor->sample_count < WS_SAMPLES) monitor->sample_count++;
+    }
+
+    stats->scan_ms = 0;
+    if (monitor->bitmap_fd >= 0) sweep_bitmap(monitor, now, stats);
+    snprintf(stats->idle_error, sizeof(stats->idle_error), "%s", monitor->idle_error);
+
+    if (monitor->bitmap_fd >= 0) {
+        // Idle pages of the unmeasured part are assumed to be in the same proportion
+        stats->method = WORKINGSET_IDLE_PAGES;
+        stats->coverage = 100.0 * monitor->measured_words / monitor->words;
+        unsigned long idle = monitor->measured_words ?
+            (unsigned long)((double)monitor->idle_pages * monitor->words / monitor->measured_words) : 0;
+        stats->idle = idle * monitor->page_size;
+        stats->working_set = !monitor->measured_words ? stats->lru :  // Nothing measured yet: all of it
+                             stats->lru > stats->idle ? stats->lru - stats->idle : 0;
+    } else {
+        stats->method = WORKINGSET_COUNTERS;
+        stats->coverage = 0;
+        stats->idle = 0;
+        stats->working_set = stats->active + stats->refaulted;
+    }
+    return 0;
+}
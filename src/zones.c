@@ -0,0 +1,242 @@
+/**
+ * @file zones.c
+ * @brief Implementation of memory zone watermark and fragmentation monitoring
+ */
+
+#include "zones.h"
+#include "sysfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ZONE_LINE_MAX 512
+#define DEFAULT_THP_ORDER 9
+
+/**
+ * @brief The two procfs files with stdio buffers of their own
+ *
+ * @details setvbuf() hands the buffers to stdio before the first read, so
+ * reading never allocates.
+ */
+struct ZoneMonitor {
+    FILE *zoneinfo;
+    FILE *buddyinfo;
+    unsigned long page_size;
+    unsigned int thp_order;
+    char zoneinfo_buf[32768];
+    char buddyinfo_buf[4096];
+};
+
+/**
+ * @brief Order of a transparent huge page
+ * @param page_size Page size in bytes
+ * @return log2 of the PMD size in pages, DEFAULT_THP_ORDER if unknown
+ */
+static unsigned int read_thp_order(unsigned long page_size) {
+    unsigned long long pmd_size;
+    if (sysfs_read_ull("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &pmd_size) != 0 ||
+        pmd_size < page_size) {
+        return DEFAULT_THP_ORDER;
+    }
+    unsigned int order = 0;
+    while ((unsigned long long)page_size << (order + 1) <= pmd_size) order++;
+    return order < MAX_ZONE_ORDERS ? order : DEFAULT_THP_ORDER;
+}
+
+ZoneMonitor *create_zone_monitor(void) {
+    ZoneMonitor *monitor = calloc(1, sizeof(*monitor));
+    if (!monitor) return NULL;
+
+    monitor->zoneinfo = fopen("/proc/zoneinfo", "r");
+    monitor->buddyinfo = fopen("/proc/buddyinfo", "r");
+    if (!monitor->zoneinfo || !monitor->buddyinfo) {
+        destroy_zone_monitor(monitor);
+        return NULL;
+    }
+    setvbuf(monitor->zoneinfo, monitor->zoneinfo_buf, _IOFBF, sizeof(monitor->zoneinfo_buf));
+    setvbuf(monitor->buddyinfo, monitor->buddyinfo_buf, _IOFBF, sizeof(monitor->buddyinfo_buf));
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    monitor->page_size = page_size > 0 ? (unsigned long)page_size : 4096;
+    monitor->thp_order = read_thp_order(monitor->page_size);
+    return monitor;
+}
+
+void destroy_zone_monitor(ZoneMonitor *monitor) {
+    if (!monitor) return;
+    if (monitor->zoneinfo) fclose(monitor->zoneinfo);
+    if (monitor->buddyinfo) fclose(monitor->buddyinfo);
+    free(monitor);
+}
+
+/**
+ * @brief Finish the zone read last, once the next zone or the end of the file is reached
+ * @param stats Zones being read
+ * @param zone Zone read last, may be NULL
+ * @param spare Scratch zone used once the table is full
+ *
+ * @details An empty zone gives its slot back; it is always the last one
+ * taken. A populated zone that did not fit is counted as dropped.
+ */
+static void end_zone(ZoneInfo *stats, const ZoneStats *zone, const ZoneStats *spare) {
+    if (!zone) return;
+    if (zone == spare) {
+        if (zone->managed) stats->dropped++;
+    } else if (zone->managed == 0) {
+        stats->count--;
+    }
+}
+
+/**
+ * @brief Read free pages and watermarks of every zone from /proc/zoneinfo
+ * @param fp Open /proc/zoneinfo
+ * @param stats Zones to fill; replaces the previous list
+ *
+ * @details Only the first word of each line is looked at before parsing,
+ * so the per-node counters and per-CPU page sets are skipped cheaply.
+ * Zones without managed pages (an empty Movable or Device zone) are dropped
+ * as soon as the next zone starts, so they do not take a slot; populated
+ * zones beyond MAX_ZONES are counted in ZoneInfo.dropped.
+ */
+static void read_zoneinfo(FILE *fp, ZoneInfo *stats) {
+    // Seeking back to the start makes procfs regenerate the file
+    rewind(fp);
+
+    char line[ZONE_LINE_MAX];
+    ZoneStats *zone = NULL;
+    ZoneStats spare;  // Parses zones past MAX_ZONES, only to tell whether they are populated
+    stats->count = 0;
+    stats->dropped = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == 'N') {
+            end_zone(stats, zone, &spare);
+            zone = NULL;
+            int node;
+            char name[MAX_ZONE_NAME];
+            if (sscanf(line, "Node %d, zone %11s", &node, name) != 2) continue;
+            zone = stats->count < MAX_ZONES ? &stats->zones[stats->count++] : &spare;
+            memset(zone, 0, sizeof(*zone));
+            zone->node = node;
+            memcpy(zone->name, name, sizeof(name));
+            continue;
+        }
+        if (!zone) continue;
+
+        const char *p = line;
+        while (*p == ' ') p++;
+        switch (*p) {
+        case 'p': sscanf(p, "pages free %lu", &zone->free); break;
+        case 'm':
+            if (sscanf(p, "min %lu", &zone->min) != 1) sscanf(p, "managed %lu", &zone->managed);
+            break;
+        case 'l': sscanf(p, "low %lu", &zone->low); break;
+        case 'h': sscanf(p, "high %lu", &zone->high); break;  // Not the per-CPU "high:"
+        default: break;
+        }
+    }
+    end_zone(stats, zone, &spare);
+}
+
+/**
+ * @brief Read the free blocks per order of every zone from /proc/buddyinfo
+ * @param fp Open /proc/buddyinfo
+ * @param stats Zones from read_zoneinfo() to add the blocks to
+ *
+ * @details Both files list zones in the same order, so each line is
+ * matched by looking ahead from the previous match.
+ */
+static void read_buddyinfo(FILE *fp, ZoneInfo *stats) {
+    rewind(fp);
+
+    char line[ZONE_LINE_MAX];
+    unsigned int next = 0;
+    stats->order_count = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        int node, consumed = 0;
+        char name[MAX_ZONE_NAME];
+        if (sscanf(line, "Node %d, zone %11s%n", &node, name, &consumed) != 2) continue;
+
+        ZoneStats *zone = NULL;
+        for (unsigned int n = 0; n < stats->count && !zone; n++) {
+            ZoneStats *candidate = &stats->zones[(next + n) % stats->count];
+            if (candidate->node == node && !strcmp(candidate->name, name)) {
+                zone = candidate;
+                next = (unsigned int)(candidate - stats->zones) + 1;
+            }
+        }
+        if (!zone) continue;
+
+        const char *p = line + consumed;
+        unsigned int order = 0;
+        while (order < MAX_ZONE_ORDERS) {
+            char *end;
+            unsigned long blocks = strtoul(p, &end, 10);
+            if (end == p) break;
+            zone->blocks[order++] = blocks;
+            p = end;
+        }
+        if (order > stats->order_count) stats->order_count = order;
+    }
+}
+
+/**
+ * @brief Unusable free space index of each order
+ * @param blocks Free blocks of each order
+ * @param order_count Number of orders
+ * @param unusable Index of each order, 0-1
+ * @return Free pages in the blocks
+ *
+ * @details Free pages in blocks of a lower order than requested divided by
+ * all free pages, as in the kernel's debugfs extfrag/unusable_index; 1 for
+ * an order without free pages at all.
+ */
+static unsigned long unusable_index(const unsigned long *blocks, unsigned int order_count, double *unusable) {
+    unsigned long total = 0;
+    for (unsigned int order = 0; order < order_count; order++) total += blocks[order] << order;
+
+    unsigned long suitable = total;  // Free pages in blocks of this order or larger
+    for (unsigned int order = 0; order < order_count; order++) {
+        unusable[order] = total ? (double)(total - suitable) / total : 1.0;
+        suitable -= blocks[order] << order;
+    }
+    return total;
+}
+
+int update_zone_stats(ZoneMonitor *monitor, ZoneInfo *stats) {
+    if (!monitor || !stats) return -1;
+
+    read_zoneinfo(monitor->zoneinfo, stats);
+    read_buddyinfo(monitor->buddyinfo, stats);
+    if (ferror(monitor->zoneinfo) || ferror(monitor->buddyinfo)) {
+        clearerr(monitor->zoneinfo);
+        clearerr(monitor->buddyinfo);
+        return -1;
+    }
+    stats->page_size = monitor->page_size;
+    stats->thp_order = monitor->thp_order;
+
+    unsigned long all_blocks[MAX_ZONE_ORDERS] = {0};
+    stats->near_low = stats->below_low = stats->below_min = 0;
+    for (unsigned int i = 0; i < stats->count; i++) {
+        ZoneStats *zone = &stats->zones[i];
+        unusable_index(zone->blocks, stats->order_count, zone->unusable);
+        for (unsigned int order = 0; order < stats->order_count; order++) all_blocks[order] += zone->blocks[order];
+
+        if (zone->free < zone->min) zone->watermark = ZONE_BELOW_MIN;
+        else if (zone->free < zone->low) zone->watermark = ZONE_BELOW_LOW;
+        else if (zone->free < zone->high) zone->watermark = ZONE_NEAR_LOW;
+        else zone->watermark = ZONE_OK;
+
+        if (zone->watermark == ZONE_NEAR_LOW) stats->near_low++;
+        if (zone->watermark >= ZONE_BELOW_LOW) stats->below_low++;
+        if (zone->watermark == ZONE_BELOW_MIN) stats->below_min++;
+    }
+
+    // The whole machine as one zone: free pages weighted by where they are
+    unusable_index(all_blocks, stats->order_count, stats->unusable);
+    stats->unusable_costly = ZONE_COSTLY_ORDER < stats->order_count ?
+                             100.0 * stats->unusable[ZONE_COSTLY_ORDER] : 0.0;
+    stats->unusable_thp = stats->thp_order < stats->order_count ? 100.0 * stats->unusable[stats->thp_order] : 0.0;
+    return 0;
+}
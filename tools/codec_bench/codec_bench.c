@@ -0,0 +1,219 @@
+/**
+ * @file codec_bench.c
+ * @brief Round-trip check and size/throughput benchmark of the snapshot codec
+ *
+ * Usage: codec_bench [ticks] [interval_ms]
+ *
+ * First round-trips hand-picked edge values (NAN transitions, negative and
+ * fractional values, values beyond the integer range, infinities). Then
+ * samples this host with the regular collectors for the given number of
+ * ticks (default 10 at 1000 ms), decodes every frame and checks that the
+ * decoder's values match the encoder's and are within the codec's
+ * resolution of the samples, and prints the keyframe and delta sizes.
+ * Finally it times encoding and decoding of jittered copies of the last
+ * sample. Exits non-zero if any round trip fails.
+ */
+
+#include "system_monitor.h"
+#include "codec.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_FRAMES 20000
+
+static int failures = 0;
+
+/**
+ * @brief Current monotonic time in seconds
+ */
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Encode a snapshot, decode it and compare
+ * @param encoder Encoder state
+ * @param decoder Decoder state
+ * @param next Values to send
+ * @param time_ms Sample time
+ * @param what Description for error messages
+ * @return Frame length
+ */
+static size_t round_trip(CodecState *encoder, CodecState *decoder, const MetricSnapshot *next,
+                         long long time_ms, const char *what) {
+    static uint8_t frame[CODEC_FRAME_MAX];
+    size_t len = codec_encode(encoder, next, time_ms, frame);
+
+    if (codec_decode(decoder, frame, len) != 0) {
+        fprintf(stderr, "%s: frame does not decode\n", what);
+        failures++;
+        return len;
+    }
+    if (decoder->time_ms != time_ms) {
+        fprintf(stderr, "%s: time %lld, expected %lld\n", what, decoder->time_ms, time_ms);
+        failures++;
+    }
+    for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) {
+        double sent = next->values[slot];
+        double got = decoder->values.values[slot];
+        double have = encoder->values.values[slot];
+        int same_state = memcmp(&got, &have, sizeof(double)) == 0;
+        int close = isnan(sent) ? isnan(got) :
+                    sent == got || fabs(sent - got) <= 0.005 + fabs(sent) * 1e-12;
+        if (!same_state || !close) {
+            fprintf(stderr, "%s: slot %u sent %.17g, decoded %.17g, encoder has %.17g\n",
+                    what, slot, sent, got, have);
+            failures++;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Round-trip edge values through every slot position
+ */
+static void check_edge_values(void) {
+    static const double values[] = {
+        0, -0.0, 1, -1, 0.5, -0.125, 17.634, 99.995, 1e6 + 0.25, 4294967296.0,
+        18446744073709551615.0, 1e300, -1e300, 1e-300, INFINITY, -INFINITY, NAN, 3, NAN, 2.5
+    };
+    static MetricSnapshot snapshot;
+    CodecState encoder, decoder;
+    codec_reset(&encoder, 4);
+    codec_reset(&decoder, 0);
+
+    long long time_ms = 1700000000000LL;
+    for (unsigned int step = 0; step < 2 * sizeof(values) / sizeof(values[0]); step++) {
+        for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) {
+            snapshot.values[slot] = values[(slot + step) % (sizeof(values) / sizeof(values[0]))];
+        }
+        round_trip(&encoder, &decoder, &snapshot, time_ms, "edge values");
+        time_ms += step % 3 ? 1000 : -250;  // Clocks can step back
+    }
+}
+
+/**
+ * @brief Sample this host and report frame sizes
+ * @param ticks Number of updates
+ * @param interval_ms Time between updates
+ * @param last Set to the last sample
+ * @return 0 on success, -1 if the collectors did not start
+ */
+static int measure_host(int ticks, int interval_ms, MetricSnapshot *last) {
+    static SystemStats stats;
+    MonitorConfig config;
+    default_config(&config);
+    config.interval_ms = interval_ms;
+    if (configure_collectors(&config, &stats) != 0) {
+        fprintf(stderr, "%s\n", collector_error());
+        return -1;
+    }
+
+    CodecState encoder, decoder;
+    codec_reset(&encoder, CODEC_KEYFRAME_INTERVAL);
+    codec_reset(&decoder, 0);
+
+    size_t keyframe = 0, deltas = 0, largest = 0;
+    unsigned int values = 0;
+    struct timespec pause = {interval_ms / 1000, (interval_ms % 1000) * 1000000L};
+    for (int tick = 0; tick < ticks; tick++) {
+        if (tick > 0) nanosleep(&pause, NULL);
+        update_stats(&stats);
+        size_t len = round_trip(&encoder, &decoder, &stats.metrics, (long long)(time(NULL) * 1000LL),
+                                "live sample");
+        if (tick == 0) {
+            keyframe = len;
+            for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) values += !isnan(stats.metrics.values[slot]);
+        } else {
+            deltas += len;
+            if (len > largest) largest = len;
+        }
+    }
+    *last = stats.metrics;
+    stop_collectors();
+
+    printf("Raw snapshot:     %zu bytes (%u slots, %u with a value)\n",
+           sizeof(MetricSnapshot), (unsigned int)METRIC_SLOT_COUNT, values);
+    printf("Keyframe:         %zu bytes\n", keyframe);
+    if (ticks > 1) {
+        printf("Delta frames:     %.1f bytes average, %zu largest, over %d ticks of %d ms\n",
+               (double)deltas / (ticks - 1), largest, ticks - 1, interval_ms);
+    }
+    return 0;
+}
+
+/**
+ * @brief Time encoding and decoding of jittered copies of a sample
+ * @param base Sample to jitter
+ */
+static void benchmark(const MetricSnapshot *base) {
+    static MetricSnapshot inputs[16];
+    static uint8_t frames[16][CODEC_FRAME_MAX];
+    size_t lengths[16], bytes = 0;
+    CodecState encoder, decoder;
+    unsigned int seed = 1;
+
+    // Every copy moves about one slot in eight, like a busy host
+    for (int i = 0; i < 16; i++) {
+        inputs[i] = *base;
+        for (unsigned int slot = 0; slot < METRIC_SLOT_COUNT; slot++) {
+            seed = seed * 1103515245 + 12345;
+            if (!isnan(inputs[i].values[slot]) && (seed >> 16) % 8 == 0) {
+                inputs[i].values[slot] += (double)((seed >> 8) % 1000) / 10;
+            }
+        }
+    }
+
+    codec_reset(&encoder, CODEC_KEYFRAME_INTERVAL);
+    double start = now_s();
+    for (int n = 0; n < BENCH_FRAMES; n++) {
+        size_t len = codec_encode(&encoder, &inputs[n % 16], n * 1000LL, frames[n % 16]);
+        lengths[n % 16] = len;
+        bytes += len;
+    }
+    double encode = now_s() - start;
+
+    // Decode the last 16 frames repeatedly, starting from a keyframe each time
+    codec_reset(&encoder, 1);
+    for (int i = 0; i < 16; i++) lengths[i] = codec_encode(&encoder, &inputs[i], i * 1000LL, frames[i]);
+    codec_reset(&decoder, 0);
+    start = now_s();
+    for (int n = 0; n < BENCH_FRAMES; n++) {
+        if (codec_decode(&decoder, frames[n % 16], lengths[n % 16]) != 0) {
+            fprintf(stderr, "benchmark: frame does not decode\n");
+            failures++;
+            return;
+        }
+    }
+    double decode = now_s() - start;
+
+    printf("Encode:           %.2f us/frame, %.0f frames/s (%.1f bytes/frame)\n",
+           encode * 1e6 / BENCH_FRAMES, BENCH_FRAMES / encode, (double)bytes / BENCH_FRAMES);
+    printf("Decode:           %.2f us/frame, %.0f frames/s (keyframes)\n",
+           decode * 1e6 / BENCH_FRAMES, BENCH_FRAMES / decode);
+}
+
+int main(int argc, char *argv[]) {
+    int ticks = argc > 1 ? atoi(argv[1]) : 10;
+    int interval_ms = argc > 2 ? atoi(argv[2]) : 1000;
+    if (ticks < 1 || interval_ms < 1) {
+        fprintf(stderr, "Usage: %s [ticks] [interval_ms]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    check_edge_values();
+
+    static MetricSnapshot last;
+    if (measure_host(ticks, interval_ms, &last) != 0) return EXIT_FAILURE;
+    benchmark(&last);
+
+    if (failures) {
+        fprintf(stderr, "%d round-trip failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("Round trips:      ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,720 @@
+/**
+ * @file fake_nvml.c
+ * @brief Scripted stand-in for libnvidia-ml.so
+ *
+ * Implements the subset of NVML used by src/gpu.c so the NVML path can be
+ * exercised and benchmarked on machines without an NVIDIA GPU. Behaviour is
+ * driven by a scenario file named by the FAKE_NVML_SCENARIO environment
+ * variable; see scenarios/basic.scn for the format. Point the monitor at the
+ * library with SYSMON_NVML_LIBRARY=/path/to/libnvidia-ml.so.
+ *
+ * When FAKE_NVML_STATS is set, per-function call counts and latencies are
+ * written to that file ("-" for stderr) on nvmlShutdown().
+ *
+ * Built with -DFAKE_NVML_LEGACY it instead exports the unversioned entry
+ * points of older drivers (nvmlInit, nvmlDeviceGetCount, v1 process lists)
+ * and omits nvmlDeviceGetMemoryInfo_v2, nvmlDeviceGetPciInfo_v3 and
+ * nvmlDeviceGetFieldValues, to exercise the binding layer's fallbacks.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "nvml_binding.h"
+
+#define FAKE_MAX_DEVICES 16
+#define FAKE_MAX_CURVE 64
+#define FAKE_MAX_ERRORS 32
+#define FAKE_NAME_LEN 96
+#define FAKE_MAX_PROCESSES 16
+
+// Every exported entry point, used for error injection and call statistics
+#define FAKE_FUNCTIONS(X) \
+    X(nvmlInit_v2) \
+    X(nvmlInit) \
+    X(nvmlShutdown) \
+    X(nvmlDeviceGetCount_v2) \
+    X(nvmlDeviceGetCount) \
+    X(nvmlDeviceGetHandleByIndex_v2) \
+    X(nvmlDeviceGetHandleByIndex) \
+    X(nvmlDeviceGetName) \
+    X(nvmlDeviceGetUUID) \
+    X(nvmlDeviceGetPciInfo_v3) \
+    X(nvmlDeviceGetTemperature) \
+    X(nvmlDeviceGetUtilizationRates) \
+    X(nvmlDeviceGetMemoryInfo) \
+    X(nvmlDeviceGetMemoryInfo_v2) \
+    X(nvmlDeviceGetPowerUsage) \
+    X(nvmlDeviceGetFanSpeed) \
+    X(nvmlDeviceGetFieldValues) \
+    X(nvmlDeviceGetSamples) \
+    X(nvmlDeviceGetComputeRunningProcesses_v3) \
+    X(nvmlDeviceGetGraphicsRunningProcesses_v3) \
+    X(nvmlDeviceGetComputeRunningProcesses) \
+    X(nvmlDeviceGetGraphicsRunningProcesses) \
+    X(nvmlDeviceGetProcessUtilization)
+
+#define FAKE_ENUM(name) FN_##name,
+enum { FAKE_FUNCTIONS(FAKE_ENUM) FN_COUNT };
+#undef FAKE_ENUM
+
+#define FAKE_NAME(name) #name,
+static const char *function_names[FN_COUNT] = { FAKE_FUNCTIONS(FAKE_NAME) };
+#undef FAKE_NAME
+
+/**
+ * @brief A sequence of values returned on successive queries, repeating
+ */
+typedef struct {
+    unsigned long long values[FAKE_MAX_CURVE];
+    unsigned int length;
+    unsigned int position;
+} Curve;
+
+typedef struct {
+    char name[FAKE_NAME_LEN];
+    char uuid[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
+    char pci_bus_id[32];
+    unsigned int pci_device_id;
+    unsigned long long memory_total;
+    Curve temperature;
+    Curve utilization;
+    Curve memory_used;
+    Curve power;
+    Curve fan;
+    Curve memory_temperature;
+    struct {
+        unsigned int pid;
+        unsigned long long memory;
+        int graphics;
+        Curve sm_util;
+    } processes[FAKE_MAX_PROCESSES];
+    unsigned int process_count;
+    unsigned long long process_sample_seq; // Process utilization rounds generated
+    unsigned long long energy_mj;          // Accumulated from power readings
+    unsigned long long util_sample_seq;    // Utilization samples generated so far
+    unsigned long long power_sample_seq;   // Power samples generated so far
+} FakeDevice;
+
+/**
+ * @brief Injected failure: calls number [after, after + count) of a function
+ *        (optionally restricted to one device) return @c code
+ */
+typedef struct {
+    int function;
+    int device;              // -1 matches any device
+    int code;
+    unsigned long after;
+    unsigned long count;     // 0 means forever
+    unsigned long seen;
+} ErrorRule;
+
+typedef struct {
+    unsigned long calls;
+    unsigned long errors;
+    double total_ns;
+} CallStats;
+
+static FakeDevice devices[FAKE_MAX_DEVICES];
+static unsigned int device_count = 1;
+static ErrorRule errors[FAKE_MAX_ERRORS];
+static unsigned int error_count = 0;
+static unsigned long latency_us = 0;
+static unsigned int samples_per_call = 6;
+static unsigned long long sample_period_us = 166667;
+static CallStats call_stats[FN_COUNT];
+static int init_refs = 0;
+static int scenario_loaded = 0;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void set_constant(Curve *curve, unsigned long long value) {
+    curve->values[0] = value;
+    curve->length = 1;
+    curve->position = 0;
+}
+
+static unsigned long long curve_next(Curve *curve) {
+    if (curve->length == 0) return 0;
+    unsigned long long value = curve->values[curve->position];
+    curve->position = (curve->position + 1) % curve->length;
+    return value;
+}
+
+static void default_device(FakeDevice *dev, unsigned int index) {
+    memset(dev, 0, sizeof(*dev));
+    snprintf(dev->name, sizeof(dev->name), "Fake GPU %u", index);
+    snprintf(dev->uuid, sizeof(dev->uuid), "GPU-%08x-0000-0000-0000-000000000000", index);
+    snprintf(dev->pci_bus_id, sizeof(dev->pci_bus_id), "00000000:%02X:00.0", index + 1);
+    dev->pci_device_id = 0x1EB810DE;
+    dev->memory_total = 16ULL << 30;
+    set_constant(&dev->temperature, 40);
+    set_constant(&dev->utilization, 0);
+    set_constant(&dev->memory_used, 0);
+    set_constant(&dev->power, 50000);
+    set_constant(&dev->fan, 30);
+    set_constant(&dev->memory_temperature, 0);
+}
+
+static int lookup_function(const char *name) {
+    for (int i = 0; i < FN_COUNT; i++) {
+        if (strcmp(function_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static void parse_curve(Curve *curve, char *values) {
+    char *save = NULL;
+    curve->length = 0;
+    curve->position = 0;
+    for (char *tok = strtok_r(values, " \t,", &save);
+         tok && curve->length < FAKE_MAX_CURVE;
+         tok = strtok_r(NULL, " \t,", &save)) {
+        curve->values[curve->length++] = strtoull(tok, NULL, 0);
+    }
+}
+
+/**
+ * @brief Parse an "error" directive
+ * @details Format: error <function> <code> [device N] [after N] [count N]
+ */
+static void parse_error(char *args, const char *path, int line_no) {
+    char function[64];
+    int code;
+    int consumed = 0;
+
+    if (error_count >= FAKE_MAX_ERRORS) return;
+    if (sscanf(args, "%63s %d %n", function, &code, &consumed) < 2) {
+        fprintf(stderr, "fake_nvml: %s:%d: malformed error directive\n", path, line_no);
+        return;
+    }
+
+    ErrorRule *rule = &errors[error_count];
+    memset(rule, 0, sizeof(*rule));
+    rule->function = lookup_function(function);
+    if (rule->function < 0) {
+        fprintf(stderr, "fake_nvml: %s:%d: unknown function %s\n", path, line_no, function);
+        return;
+    }
+    rule->code = code;
+    rule->device = -1;
+
+    char key[16];
+    unsigned long value;
+    char *rest = args + consumed;
+    int n;
+    while (sscanf(rest, "%15s %lu %n", key, &value, &n) == 2) {
+        if (strcmp(key, "device") == 0) rule->device = (int)value;
+        else if (strcmp(key, "after") == 0) rule->after = value;
+        else if (strcmp(key, "count") == 0) rule->count = value;
+        rest += n;
+    }
+    error_count++;
+}
+
+/**
+ * @brief Load the scenario named by FAKE_NVML_SCENARIO, if any
+ */
+static void load_scenario(void) {
+    if (scenario_loaded) return;
+    scenario_loaded = 1;
+
+    for (unsigned int i = 0; i < FAKE_MAX_DEVICES; i++) default_device(&devices[i], i);
+
+    const char *path = getenv("FAKE_NVML_SCENARIO");
+    if (!path) return;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "fake_nvml: cannot open scenario %s\n", path);
+        return;
+    }
+
+    char line[1024];
+    int line_no = 0;
+    FakeDevice *dev = NULL;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0';
+
+        char *key = line;
+        while (isspace((unsigned char)*key)) key++;
+        if (*key == '\0') continue;
+        char *args = key + strcspn(key, " \t");
+        if (*args) *args++ = '\0';
+        while (isspace((unsigned char)*args)) args++;
+        // Trim trailing whitespace so names compare cleanly
+        for (char *end = args + strlen(args); end > args && isspace((unsigned char)end[-1]); end--) {
+            end[-1] = '\0';
+        }
+
+        if (strcmp(key, "devices") == 0) {
+            device_count = (unsigned int)strtoul(args, NULL, 0);
+            if (device_count > FAKE_MAX_DEVICES) device_count = FAKE_MAX_DEVICES;
+        } else if (strcmp(key, "latency_us") == 0) {
+            latency_us = strtoul(args, NULL, 0);
+        } else if (strcmp(key, "samples_per_call") == 0) {
+            samples_per_call = (unsigned int)strtoul(args, NULL, 0);
+        } else if (strcmp(key, "sample_period_us") == 0) {
+            sample_period_us = strtoull(args, NULL, 0);
+        } else if (strcmp(key, "error") == 0) {
+            parse_error(args, path, line_no);
+        } else if (strcmp(key, "device") == 0) {
+            unsigned int index = (unsigned int)strtoul(args, NULL, 0);
+            dev = (index < FAKE_MAX_DEVICES) ? &devices[index] : NULL;
+        } else if (!dev) {
+            fprintf(stderr, "fake_nvml: %s:%d: %s outside of a device block\n", path, line_no, key);
+        } else if (strcmp(key, "name") == 0) {
+            snprintf(dev->name, sizeof(dev->name), "%s", args);
+        } else if (strcmp(key, "uuid") == 0) {
+            snprintf(dev->uuid, sizeof(dev->uuid), "%s", args);
+        } else if (strcmp(key, "pci") == 0) {
+            snprintf(dev->pci_bus_id, sizeof(dev->pci_bus_id), "%s", args);
+        } else if (strcmp(key, "pci_device_id") == 0) {
+            dev->pci_device_id = (unsigned int)strtoul(args, NULL, 0);
+        } else if (strcmp(key, "memory_total") == 0) {
+            dev->memory_total = strtoull(args, NULL, 0);
+        } else if (strcmp(key, "temperature") == 0) {
+            parse_curve(&dev->temperature, args);
+        } else if (strcmp(key, "utilization") == 0) {
+            parse_curve(&dev->utilization, args);
+        } else if (strcmp(key, "memory_used") == 0) {
+            parse_curve(&dev->memory_used, args);
+        } else if (strcmp(key, "power") == 0) {
+            parse_curve(&dev->power, args);
+        } else if (strcmp(key, "fan") == 0) {
+            parse_curve(&dev->fan, args);
+        } else if (strcmp(key, "memory_temperature") == 0) {
+            parse_curve(&dev->memory_temperature, args);
+        } else if (strcmp(key, "process") == 0 || strcmp(key, "graphics_process") == 0) {
+            // process PID MEMORY_BYTES SM_UTIL_CURVE...
+            if (dev->process_count < FAKE_MAX_PROCESSES) {
+                char *rest;
+                unsigned int slot = dev->process_count++;
+                dev->processes[slot].pid = (unsigned int)strtoul(args, &rest, 0);
+                dev->processes[slot].memory = strtoull(rest, &rest, 0);
+                dev->processes[slot].graphics = key[0] == 'g';
+                parse_curve(&dev->processes[slot].sm_util, rest);
+            }
+        } else {
+            fprintf(stderr, "fake_nvml: %s:%d: unknown key %s\n", path, line_no, key);
+        }
+    }
+    fclose(fp);
+}
+
+static void write_stats(void) {
+    const char *path = getenv("FAKE_NVML_STATS");
+    if (!path) return;
+
+    FILE *fp = strcmp(path, "-") == 0 ? stderr : fopen(path, "w");
+    if (!fp) return;
+
+    fprintf(fp, "%-32s %10s %8s %12s\n", "function", "calls", "errors", "avg_ns");
+    for (int i = 0; i < FN_COUNT; i++) {
+        const CallStats *st = &call_stats[i];
+        if (st->calls == 0) continue;
+        fprintf(fp, "%-32s %10lu %8lu %12.0f\n", function_names[i],
+                st->calls, st->errors, st->total_ns / st->calls);
+    }
+    if (fp != stderr) fclose(fp);
+}
+
+/**
+ * @brief Common prologue of every entry point
+ * @param function Function id
+ * @param device Device index the call targets, or -1
+ * @param start Receives the call start time
+ * @return Injected error code, or NVML_SUCCESS
+ */
+static int fake_enter(int function, int device, double *start) {
+    *start = now_ns();
+    load_scenario();
+
+    if (latency_us) {
+        struct timespec ts = { latency_us / 1000000, (latency_us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+
+    for (unsigned int i = 0; i < error_count; i++) {
+        ErrorRule *rule = &errors[i];
+        if (rule->function != function) continue;
+        if (rule->device >= 0 && rule->device != device) continue;
+        unsigned long n = rule->seen++;
+        if (n >= rule->after && (rule->count == 0 || n < rule->after + rule->count)) {
+            return rule->code;
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+static int fake_leave(int function, double start, int ret) {
+    CallStats *st = &call_stats[function];
+    st->calls++;
+    if (ret != NVML_SUCCESS) st->errors++;
+    st->total_ns += now_ns() - start;
+    return ret;
+}
+
+/**
+ * @brief Map an opaque device handle back to its index
+ */
+static int device_index(void *handle) {
+    FakeDevice *dev = handle;
+    if (dev < devices || dev >= devices + device_count) return -1;
+    return (int)(dev - devices);
+}
+
+#define FAKE_DEVICE_CALL(fn, handle)                                    \
+    double start;                                                       \
+    int index = device_index(handle);                                   \
+    int ret = fake_enter(FN_##fn, index, &start);                       \
+    if (ret != NVML_SUCCESS) return fake_leave(FN_##fn, start, ret);    \
+    if (!init_refs) return fake_leave(FN_##fn, start, NVML_ERROR_UNINITIALIZED); \
+    if (index < 0) return fake_leave(FN_##fn, start, NVML_ERROR_INVALID_ARGUMENT); \
+    FakeDevice *dev = &devices[index]
+
+/**
+ * @brief Shared body of the nvmlInit variants
+ */
+static NVMLReturn fake_init(int function) {
+    double start;
+    int ret = fake_enter(function, -1, &start);
+    if (ret == NVML_SUCCESS) init_refs++;
+    return fake_leave(function, start, ret);
+}
+
+/**
+ * @brief Shared body of the nvmlDeviceGetCount variants
+ */
+static NVMLReturn fake_get_count(int function, unsigned int *count) {
+    double start;
+    int ret = fake_enter(function, -1, &start);
+    if (ret == NVML_SUCCESS && !init_refs) ret = NVML_ERROR_UNINITIALIZED;
+    if (ret == NVML_SUCCESS && !count) ret = NVML_ERROR_INVALID_ARGUMENT;
+    if (ret == NVML_SUCCESS) *count = device_count;
+    return fake_leave(function, start, ret);
+}
+
+/**
+ * @brief Shared body of the nvmlDeviceGetHandleByIndex variants
+ */
+static NVMLReturn fake_get_handle(int function, unsigned int index, NVMLDeviceHandle *handle) {
+    double start;
+    int ret = fake_enter(function, (int)index, &start);
+    if (ret == NVML_SUCCESS && !init_refs) ret = NVML_ERROR_UNINITIALIZED;
+    if (ret == NVML_SUCCESS && (index >= device_count || !handle)) ret = NVML_ERROR_INVALID_ARGUMENT;
+    if (ret == NVML_SUCCESS) *handle = (NVMLDeviceHandle)&devices[index];
+    return fake_leave(function, start, ret);
+}
+
+/**
+ * @brief Shared body of the compute/graphics running-process queries
+ * @param dev Device
+ * @param graphics Non-zero to list graphics contexts
+ * @param count In: capacity; out: number of processes
+ * @param infos Output array, or NULL to query the count
+ * @param legacy Non-zero to fill the v1 (two-field) layout
+ */
+static NVMLReturn list_processes(FakeDevice *dev, int graphics, unsigned int *count,
+                                 void *infos, int legacy) {
+    unsigned int capacity = *count;
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; i < dev->process_count; i++) {
+        if (dev->processes[i].graphics != graphics) continue;
+        if (n < capacity && infos) {
+            if (legacy) {
+                NVMLProcessInfoV1 *info = (NVMLProcessInfoV1 *)infos + n;
+                info->pid = dev->processes[i].pid;
+                info->used_gpu_memory = dev->processes[i].memory;
+            } else {
+                NVMLProcessInfo *info = (NVMLProcessInfo *)infos + n;
+                info->pid = dev->processes[i].pid;
+                info->used_gpu_memory = dev->processes[i].memory;
+                info->gpu_instance_id = ~0u;
+                info->compute_instance_id = ~0u;
+            }
+        }
+        n++;
+    }
+    *count = n;
+    return n > capacity ? NVML_ERROR_INSUFFICIENT_SIZE : NVML_SUCCESS;
+}
+
+/**
+ * @brief Fill a v1 memory struct from the device's memory curve
+ */
+static void fill_memory(FakeDevice *dev, NVMLMemory *memory) {
+    memory->total = dev->memory_total;
+    memory->used = curve_next(&dev->memory_used);
+    if (memory->used > memory->total) memory->used = memory->total;
+    memory->free = memory->total - memory->used;
+}
+
+NVMLReturn nvmlShutdown(void) {
+    double start;
+    int ret = fake_enter(FN_nvmlShutdown, -1, &start);
+    if (ret == NVML_SUCCESS) {
+        if (!init_refs) ret = NVML_ERROR_UNINITIALIZED;
+        else init_refs--;
+    }
+    fake_leave(FN_nvmlShutdown, start, ret);
+    if (init_refs == 0) write_stats();
+    return ret;
+}
+
+const char *nvmlErrorString(NVMLReturn result) {
+    static char buf[48];
+    snprintf(buf, sizeof(buf), "fake NVML error %d", (int)result);
+    return buf;
+}
+
+NVMLReturn nvmlDeviceGetName(NVMLDeviceHandle handle, char *name, unsigned int length) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetName, handle);
+    if (strlen(dev->name) >= length) return fake_leave(FN_nvmlDeviceGetName, start, NVML_ERROR_INSUFFICIENT_SIZE);
+    strcpy(name, dev->name);
+    return fake_leave(FN_nvmlDeviceGetName, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetUUID(NVMLDeviceHandle handle, char *uuid, unsigned int length) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetUUID, handle);
+    if (strlen(dev->uuid) >= length) return fake_leave(FN_nvmlDeviceGetUUID, start, NVML_ERROR_INSUFFICIENT_SIZE);
+    strcpy(uuid, dev->uuid);
+    return fake_leave(FN_nvmlDeviceGetUUID, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetTemperature(NVMLDeviceHandle handle, NVMLTemperatureSensor sensor,
+                                    unsigned int *temp) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetTemperature, handle);
+    if (sensor != NVML_TEMPERATURE_GPU) return fake_leave(FN_nvmlDeviceGetTemperature, start, NVML_ERROR_NOT_SUPPORTED);
+    *temp = (unsigned int)curve_next(&dev->temperature);
+    return fake_leave(FN_nvmlDeviceGetTemperature, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetUtilizationRates(NVMLDeviceHandle handle, NVMLUtilization *utilization) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetUtilizationRates, handle);
+    utilization->gpu = (unsigned int)curve_next(&dev->utilization);
+    utilization->memory = dev->memory_total ?
+        (unsigned int)(100 * dev->memory_used.values[dev->memory_used.position] / dev->memory_total) : 0;
+    return fake_leave(FN_nvmlDeviceGetUtilizationRates, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetMemoryInfo(NVMLDeviceHandle handle, NVMLMemory *memory) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetMemoryInfo, handle);
+    fill_memory(dev, memory);
+    return fake_leave(FN_nvmlDeviceGetMemoryInfo, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetPowerUsage(NVMLDeviceHandle handle, unsigned int *power) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetPowerUsage, handle);
+    *power = (unsigned int)curve_next(&dev->power);
+    return fake_leave(FN_nvmlDeviceGetPowerUsage, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetFanSpeed(NVMLDeviceHandle handle, unsigned int *speed) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetFanSpeed, handle);
+    *speed = (unsigned int)curve_next(&dev->fan);
+    return fake_leave(FN_nvmlDeviceGetFanSpeed, start, NVML_SUCCESS);
+}
+
+/**
+ * @details Every call generates samples_per_call new samples, sample_period_us
+ * apart, from the device's utilization or power curve. Samples newer than
+ * last_seen are returned; a NULL buffer only reports the count.
+ */
+NVMLReturn nvmlDeviceGetSamples(NVMLDeviceHandle handle, NVMLSamplingType type,
+                                unsigned long long last_seen, NVMLValueType *value_type,
+                                unsigned int *count, NVMLSample *samples) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetSamples, handle);
+    Curve *curve;
+    unsigned long long *seq;
+    if (type == NVML_GPU_UTILIZATION_SAMPLES) {
+        curve = &dev->utilization;
+        seq = &dev->util_sample_seq;
+    } else if (type == NVML_TOTAL_POWER_SAMPLES) {
+        curve = &dev->power;
+        seq = &dev->power_sample_seq;
+    } else {
+        return fake_leave(FN_nvmlDeviceGetSamples, start, NVML_ERROR_NOT_SUPPORTED);
+    }
+    if (!count) return fake_leave(FN_nvmlDeviceGetSamples, start, NVML_ERROR_INVALID_ARGUMENT);
+
+    *value_type = NVML_VALUE_TYPE_UNSIGNED_INT;
+    if (!samples) {
+        *count = samples_per_call;
+        return fake_leave(FN_nvmlDeviceGetSamples, start, NVML_SUCCESS);
+    }
+    if (*count < samples_per_call) {
+        *count = samples_per_call;
+        return fake_leave(FN_nvmlDeviceGetSamples, start, NVML_ERROR_INSUFFICIENT_SIZE);
+    }
+
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < samples_per_call; i++) {
+        unsigned long long ts = ++(*seq) * sample_period_us;
+        unsigned long long value = curve_next(curve);
+        if (ts <= last_seen) continue;
+        samples[n].timestamp = ts;
+        samples[n].value.ui = (unsigned int)value;
+        n++;
+    }
+    *count = n;
+    return fake_leave(FN_nvmlDeviceGetSamples, start, n ? NVML_SUCCESS : NVML_ERROR_NOT_FOUND);
+}
+
+/**
+ * @details Every call generates one sample per process from its SM
+ * utilization curve, timestamped one sample period after the previous round.
+ */
+NVMLReturn nvmlDeviceGetProcessUtilization(NVMLDeviceHandle handle,
+                                           NVMLProcessUtilizationSample *samples,
+                                           unsigned int *count, unsigned long long last_seen) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetProcessUtilization, handle);
+    if (!count) return fake_leave(FN_nvmlDeviceGetProcessUtilization, start, NVML_ERROR_INVALID_ARGUMENT);
+    if (!samples || *count < dev->process_count) {
+        *count = dev->process_count;
+        return fake_leave(FN_nvmlDeviceGetProcessUtilization, start,
+                          samples ? NVML_ERROR_INSUFFICIENT_SIZE : NVML_SUCCESS);
+    }
+
+    unsigned long long ts = ++dev->process_sample_seq * sample_period_us;
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < dev->process_count; i++) {
+        unsigned int sm = (unsigned int)curve_next(&dev->processes[i].sm_util);
+        if (ts <= last_seen) continue;
+        memset(&samples[n], 0, sizeof(samples[n]));
+        samples[n].pid = dev->processes[i].pid;
+        samples[n].timestamp = ts;
+        samples[n].sm_util = sm;
+        samples[n].mem_util = sm / 2;
+        n++;
+    }
+    *count = n;
+    return fake_leave(FN_nvmlDeviceGetProcessUtilization, start, n ? NVML_SUCCESS : NVML_ERROR_NOT_FOUND);
+}
+
+#ifndef FAKE_NVML_LEGACY
+
+NVMLReturn nvmlInit_v2(void) {
+    return fake_init(FN_nvmlInit_v2);
+}
+
+NVMLReturn nvmlDeviceGetCount_v2(unsigned int *count) {
+    return fake_get_count(FN_nvmlDeviceGetCount_v2, count);
+}
+
+NVMLReturn nvmlDeviceGetHandleByIndex_v2(unsigned int index, NVMLDeviceHandle *handle) {
+    return fake_get_handle(FN_nvmlDeviceGetHandleByIndex_v2, index, handle);
+}
+
+NVMLReturn nvmlDeviceGetPciInfo_v3(NVMLDeviceHandle handle, NVMLPciInfo *pci) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetPciInfo_v3, handle);
+    memset(pci, 0, sizeof(*pci));
+    snprintf(pci->bus_id, sizeof(pci->bus_id), "%s", dev->pci_bus_id);
+    snprintf(pci->bus_id_legacy, sizeof(pci->bus_id_legacy), "%.15s", dev->pci_bus_id);
+    sscanf(dev->pci_bus_id, "%x:%x:%x", &pci->domain, &pci->bus, &pci->device);
+    pci->pci_device_id = dev->pci_device_id;
+    return fake_leave(FN_nvmlDeviceGetPciInfo_v3, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetMemoryInfo_v2(NVMLDeviceHandle handle, NVMLMemoryV2 *memory) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetMemoryInfo_v2, handle);
+    if (memory->version != NVML_STRUCT_VERSION(NVMLMemoryV2, 2)) {
+        return fake_leave(FN_nvmlDeviceGetMemoryInfo_v2, start, NVML_ERROR_ARGUMENT_VERSION_MISMATCH);
+    }
+    NVMLMemory v1;
+    fill_memory(dev, &v1);
+    // Pretend the driver reserves a small slice, as real v2 drivers report
+    memory->total = v1.total;
+    memory->reserved = v1.total / 200;
+    memory->used = v1.used;
+    memory->free = v1.total > v1.used + memory->reserved ? v1.total - v1.used - memory->reserved : 0;
+    return fake_leave(FN_nvmlDeviceGetMemoryInfo_v2, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetFieldValues(NVMLDeviceHandle handle, int count, NVMLFieldValue *values) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetFieldValues, handle);
+    for (int i = 0; i < count; i++) {
+        NVMLFieldValue *fv = &values[i];
+        fv->timestamp = (long long)(now_ns() / 1000);
+        fv->latency_usec = 0;
+        fv->nvml_return = NVML_SUCCESS;
+        switch (fv->field_id) {
+            case NVML_FI_DEV_POWER_INSTANT:
+                fv->value_type = NVML_VALUE_TYPE_UNSIGNED_INT;
+                fv->value.ui = (unsigned int)curve_next(&dev->power);
+                // Pretend the reading held for one sample period
+                dev->energy_mj += fv->value.ui * sample_period_us / 1000000;
+                break;
+            case NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION:
+                fv->value_type = NVML_VALUE_TYPE_UNSIGNED_LONG_LONG;
+                fv->value.ull = dev->energy_mj;
+                break;
+            case NVML_FI_DEV_MEMORY_TEMP:
+                fv->value_type = NVML_VALUE_TYPE_UNSIGNED_INT;
+                fv->value.ui = (unsigned int)curve_next(&dev->memory_temperature);
+                if (fv->value.ui == 0) fv->nvml_return = NVML_ERROR_NOT_SUPPORTED;
+                break;
+            default:
+                fv->nvml_return = NVML_ERROR_NOT_SUPPORTED;
+                break;
+        }
+    }
+    return fake_leave(FN_nvmlDeviceGetFieldValues, start, NVML_SUCCESS);
+}
+
+NVMLReturn nvmlDeviceGetComputeRunningProcesses_v3(NVMLDeviceHandle handle, unsigned int *count,
+                                                   NVMLProcessInfo *infos) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetComputeRunningProcesses_v3, handle);
+    if (!count) return fake_leave(FN_nvmlDeviceGetComputeRunningProcesses_v3, start, NVML_ERROR_INVALID_ARGUMENT);
+    return fake_leave(FN_nvmlDeviceGetComputeRunningProcesses_v3, start,
+                      list_processes(dev, 0, count, infos, 0));
+}
+
+NVMLReturn nvmlDeviceGetGraphicsRunningProcesses_v3(NVMLDeviceHandle handle, unsigned int *count,
+                                                    NVMLProcessInfo *infos) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetGraphicsRunningProcesses_v3, handle);
+    if (!count) return fake_leave(FN_nvmlDeviceGetGraphicsRunningProcesses_v3, start, NVML_ERROR_INVALID_ARGUMENT);
+    return fake_leave(FN_nvmlDeviceGetGraphicsRunningProcesses_v3, start,
+                      list_processes(dev, 1, count, infos, 0));
+}
+
+#else /* FAKE_NVML_LEGACY */
+
+NVMLReturn nvmlInit(void) {
+    return fake_init(FN_nvmlInit);
+}
+
+NVMLReturn nvmlDeviceGetCount(unsigned int *count) {
+    return fake_get_count(FN_nvmlDeviceGetCount, count);
+}
+
+NVMLReturn nvmlDeviceGetHandleByIndex(unsigned int index, NVMLDeviceHandle *handle) {
+    return fake_get_handle(FN_nvmlDeviceGetHandleByIndex, index, handle);
+}
+
+NVMLReturn nvmlDeviceGetComputeRunningProcesses(NVMLDeviceHandle handle, unsigned int *count,
+                                                NVMLProcessInfoV1 *infos) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetComputeRunningProcesses, handle);
+    if (!count) return fake_leave(FN_nvmlDeviceGetComputeRunningProcesses, start, NVML_ERROR_INVALID_ARGUMENT);
+    return fake_leave(FN_nvmlDeviceGetComputeRunningProcesses, start,
+                      list_processes(dev, 0, count, infos, 1));
+}
+
+NVMLReturn nvmlDeviceGetGraphicsRunningProcesses(NVMLDeviceHandle handle, unsigned int *count,
+                                                 NVMLProcessInfoV1 *infos) {
+    FAKE_DEVICE_CALL(nvmlDeviceGetGraphicsRunningProcesses, handle);
+    if (!count) return fake_leave(FN_nvmlDeviceGetGraphicsRunningProcesses, start, NVML_ERROR_INVALID_ARGUMENT);
+    return fake_leave(FN_nvmlDeviceGetGraphicsRunningProcesses, start,
+                      list_processes(dev, 1, count, infos, 1));
+}
+
+#endif /* FAKE_NVML_LEGACY */
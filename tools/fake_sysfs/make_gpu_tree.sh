@@ -0,0 +1,68 @@
+#!/bin/sh
+# Build a fake /sys tree with one AMD (amdgpu), one Intel (i915) and one
+# Intel (xe) GPU for exercising the DRM/sysfs GPU path without hardware.
+#
+# Usage: tools/fake_sysfs/make_gpu_tree.sh DIR
+#        SYSMON_SYSFS_ROOT=DIR ./build/system_monitor
+#
+# Values are plain files, so they can be rewritten while the monitor runs
+# (e.g. echo 87 > DIR/sys/devices/pci0000:00/0000:03:00.0/gpu_busy_percent).
+
+set -e
+
+root=${1:?usage: $0 DIR}
+sys=$root/sys
+
+put() {
+    mkdir -p "$(dirname "$1")"
+    printf '%s\n' "$2" > "$1"
+}
+
+mkdir -p "$sys/class/drm" "$sys/bus/pci/drivers/amdgpu" "$sys/bus/pci/drivers/i915" "$sys/bus/pci/drivers/xe"
+
+# card0: amdgpu discrete card
+amd=$sys/devices/pci0000:00/0000:03:00.0
+put "$amd/vendor" 0x1002
+put "$amd/device" 0x73bf
+put "$amd/gpu_busy_percent" 42
+put "$amd/mem_info_vram_total" 17163091968
+put "$amd/mem_info_vram_used" 2147483648
+put "$amd/hwmon/hwmon3/name" amdgpu
+put "$amd/hwmon/hwmon3/temp1_input" 61000
+put "$amd/hwmon/hwmon3/power1_average" 187000000
+put "$amd/hwmon/hwmon3/pwm1" 102
+put "$amd/hwmon/hwmon3/freq1_input" 2250000000
+ln -sfn ../../../bus/pci/drivers/amdgpu "$amd/driver"
+mkdir -p "$amd/drm/card0"
+ln -sfn ../../../0000:03:00.0 "$amd/drm/card0/device"
+ln -sfn ../../devices/pci0000:00/0000:03:00.0/drm/card0 "$sys/class/drm/card0"
+mkdir -p "$amd/drm/card0-DP-1"
+ln -sfn ../../devices/pci0000:00/0000:03:00.0/drm/card0-DP-1 "$sys/class/drm/card0-DP-1"
+
+# card1: i915 integrated graphics
+igpu=$sys/devices/pci0000:00/0000:00:02.0
+put "$igpu/vendor" 0x8086
+put "$igpu/device" 0x4680
+ln -sfn ../../../bus/pci/drivers/i915 "$igpu/driver"
+card1=$igpu/drm/card1
+put "$card1/gt_act_freq_mhz" 1100
+put "$card1/gt_max_freq_mhz" 1450
+put "$card1/gt/gt0/rc6_residency_ms" 1000000
+ln -sfn ../../../0000:00:02.0 "$card1/device"
+ln -sfn ../../devices/pci0000:00/0000:00:02.0/drm/card1 "$sys/class/drm/card1"
+
+# card2: xe discrete card
+xe=$sys/devices/pci0000:00/0000:04:00.0
+put "$xe/vendor" 0x8086
+put "$xe/device" 0xe20b
+put "$xe/tile0/gt0/freq0/act_freq" 2400
+put "$xe/tile0/gt0/freq0/max_freq" 2850
+put "$xe/tile0/gt0/gtidle/idle_residency_ms" 500000
+put "$xe/hwmon/hwmon5/name" xe
+put "$xe/hwmon/hwmon5/power1_input" 95000000
+ln -sfn ../../../bus/pci/drivers/xe "$xe/driver"
+mkdir -p "$xe/drm/card2"
+ln -sfn ../../../0000:04:00.0 "$xe/drm/card2/device"
+ln -sfn ../../devices/pci0000:00/0000:04:00.0/drm/card2 "$sys/class/drm/card2"
+
+echo "fake sysfs GPU tree created under $root"
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Build a fake /sys tree with a two-package, four-CPU Intel machine
+# (coretemp + x86_pkg_temp), an ACPI thermal zone, an NVMe hwmon chip and
+# per-CPU thermal_throttle counters for exercising the thermal collector.
+#
+# Usage: tools/fake_sysfs/make_thermal_tree.sh DIR
+#        SYSMON_SYSFS_ROOT=DIR ./build/system_monitor
+#
+# Bump a counter while the monitor runs to simulate throttling, e.g.
+#   echo 12 > DIR/sys/devices/system/cpu/cpu1/thermal_throttle/core_throttle_count
+
+set -e
+
+root=${1:?usage: $0 DIR}
+sys=$root/sys
+
+put() {
+    mkdir -p "$(dirname "$1")"
+    printf '%s\n' "$2" > "$1"
+}
+
+# hwmon0/1: coretemp, one chip per package
+for pkg in 0 1; do
+    hw=$sys/class/hwmon/hwmon$pkg
+    put "$hw/name" coretemp
+    put "$hw/temp1_label" "Package id $pkg"
+    put "$hw/temp1_input" $((71000 + pkg * 4000))
+    put "$hw/temp1_crit" 100000
+    for core in 0 1; do
+        n=$((core + 2))
+        put "$hw/temp${n}_label" "Core $core"
+        put "$hw/temp${n}_input" $((64000 + pkg * 3000 + core * 2000))
+        put "$hw/temp${n}_crit" 100000
+    done
+done
+
+# hwmon2: NVMe drive, unlabelled composite sensor
+put "$sys/class/hwmon/hwmon2/name" nvme
+put "$sys/class/hwmon/hwmon2/temp1_input" 41850
+put "$sys/class/hwmon/hwmon2/temp1_crit" 84850
+
+# hwmon3 mirrors thermal_zone0, as the kernel registers one per zone
+put "$sys/class/hwmon/hwmon3/name" acpitz
+put "$sys/class/hwmon/hwmon3/temp1_input" 27800
+
+# thermal_zone0 is covered by hwmon3; thermal_zone1 only exists as a zone
+put "$sys/class/thermal/thermal_zone0/type" acpitz
+put "$sys/class/thermal/thermal_zone0/temp" 27800
+put "$sys/class/thermal/thermal_zone1/type" x86_pkg_temp
+put "$sys/class/thermal/thermal_zone1/temp" 71000
+put "$sys/class/thermal/thermal_zone2/type" pch_cannonlake
+put "$sys/class/thermal/thermal_zone2/temp" 48000
+put "$sys/class/thermal/thermal_zone2/trip_point_0_type" critical
+put "$sys/class/thermal/thermal_zone2/trip_point_0_temp" 115000
+
+# cpu0-1 on package 0, cpu2-3 on package 1
+for cpu in 0 1 2 3; do
+    c=$sys/devices/system/cpu/cpu$cpu
+    put "$c/topology/physical_package_id" $((cpu / 2))
+    put "$c/thermal_throttle/core_throttle_count" 0
+    put "$c/thermal_throttle/core_throttle_total_time_ms" 0
+    put "$c/thermal_throttle/package_throttle_count" 0
+    put "$c/thermal_throttle/package_throttle_total_time_ms" 0
+done
@@ -0,0 +1,350 @@
+/**
+ * @file nvml_check.c
+ * @brief Check of the NVML binding against the fake NVML library
+ *
+ * Usage: nvml_check [-l] LIBRARY
+ *
+ * Loads LIBRARY (a build of tools/fake_nvml) through nvml_binding_load()
+ * and checks, with -l for the -DFAKE_NVML_LEGACY build:
+ *
+ * - which variant of each versioned entry point was bound (_v2/_v3, or the
+ *   unversioned ones of old drivers) and which optional ones are missing;
+ * - that nvml_get_memory_info() drops to the v1 entry point when the v2 one
+ *   fails with NVML_ERROR_ARGUMENT_VERSION_MISMATCH, and stays there;
+ * - that process lists come back in the current layout, widened from the
+ *   legacy one with ~0 instance ids, also when the buffer is too small;
+ * - that nvml_error_policy() maps every NVML return code to the expected
+ *   action, with the codes injected into calls through the scenario.
+ *
+ * The scenario is written to a temporary file and passed to the library in
+ * FAKE_NVML_SCENARIO. Exits non-zero if any check fails.
+ */
+
+#include "nvml_binding.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MEMORY_TOTAL 8589934592ULL
+#define MEMORY_USED 1073741824ULL
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+        failures++; \
+    } \
+} while (0)
+
+/**
+ * @brief Expected policy of each NVML return code
+ */
+static const struct {
+    NVMLReturn ret;
+    NVMLPolicy policy;
+} policies[] = {
+    { NVML_ERROR_UNINITIALIZED, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_INVALID_ARGUMENT, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_NOT_SUPPORTED, NVML_POLICY_SKIP },
+    { NVML_ERROR_NO_PERMISSION, NVML_POLICY_SKIP },
+    { NVML_ERROR_ALREADY_INITIALIZED, NVML_POLICY_RETRY },
+    { NVML_ERROR_NOT_FOUND, NVML_POLICY_RETRY },
+    { NVML_ERROR_INSUFFICIENT_SIZE, NVML_POLICY_RETRY },
+    { NVML_ERROR_INSUFFICIENT_POWER, NVML_POLICY_RETRY },
+    { NVML_ERROR_DRIVER_NOT_LOADED, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_TIMEOUT, NVML_POLICY_RETRY },
+    { NVML_ERROR_IRQ_ISSUE, NVML_POLICY_RETRY },
+    { NVML_ERROR_LIBRARY_NOT_FOUND, NVML_POLICY_RETRY },
+    { NVML_ERROR_FUNCTION_NOT_FOUND, NVML_POLICY_SKIP },
+    { NVML_ERROR_CORRUPTED_INFOROM, NVML_POLICY_SKIP },
+    { NVML_ERROR_GPU_IS_LOST, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_RESET_REQUIRED, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_OPERATING_SYSTEM, NVML_POLICY_RETRY },
+    { NVML_ERROR_LIB_RM_VERSION_MISMATCH, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_IN_USE, NVML_POLICY_RETRY },
+    { NVML_ERROR_MEMORY, NVML_POLICY_RETRY },
+    { NVML_ERROR_NO_DATA, NVML_POLICY_RETRY },
+    { NVML_ERROR_VGPU_ECC_NOT_SUPPORTED, NVML_POLICY_SKIP },
+    { NVML_ERROR_INSUFFICIENT_RESOURCES, NVML_POLICY_RETRY },
+    { NVML_ERROR_FREQ_NOT_SUPPORTED, NVML_POLICY_SKIP },
+    { NVML_ERROR_ARGUMENT_VERSION_MISMATCH, NVML_POLICY_SKIP },
+    { NVML_ERROR_DEPRECATED, NVML_POLICY_SKIP },
+    { NVML_ERROR_NOT_READY, NVML_POLICY_RETRY },
+    { NVML_ERROR_GPU_NOT_FOUND, NVML_POLICY_REDISCOVER },
+    { NVML_ERROR_INVALID_STATE, NVML_POLICY_RETRY },
+    { NVML_ERROR_UNKNOWN, NVML_POLICY_RETRY },
+};
+
+#define POLICY_COUNT (sizeof(policies) / sizeof(policies[0]))
+
+/**
+ * @brief Processes on device 0: two compute contexts, then one graphics
+ */
+static const struct {
+    unsigned int pid;
+    unsigned long long memory;
+    int graphics;
+} processes[] = {
+    { 4101, 2147483648ULL, 0 },
+    { 4102, 536870912ULL, 0 },
+    { 4103, 268435456ULL, 1 },
+};
+
+#define PROCESS_COUNT (sizeof(processes) / sizeof(processes[0]))
+
+/**
+ * @brief Write the scenario the checks below rely on
+ * @param path Receives the file name
+ * @param length Size of @p path
+ * @return 0 on success, -1 on failure
+ *
+ * @details Each policy code fails exactly one nvmlDeviceGetTemperature
+ * call, in table order: a rule only counts the calls no earlier rule took,
+ * so "after 0 count 1" on every rule hands out the codes one per call.
+ * The second nvmlDeviceGetMemoryInfo_v2 call is rejected as a struct
+ * version mismatch.
+ */
+static int write_scenario(char *path, size_t length) {
+    snprintf(path, length, "/tmp/nvml_check.XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return -1;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (!file) {
+        perror("fdopen");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    fprintf(file, "devices 1\n");
+    fprintf(file, "error nvmlDeviceGetMemoryInfo_v2 %d after 1 count 1\n",
+            NVML_ERROR_ARGUMENT_VERSION_MISMATCH);
+    for (size_t i = 0; i < POLICY_COUNT; i++) {
+        fprintf(file, "error nvmlDeviceGetTemperature %d after 0 count 1\n", (int)policies[i].ret);
+    }
+    fprintf(file, "device 0\n");
+    fprintf(file, "  memory_total %llu\n", MEMORY_TOTAL);
+    fprintf(file, "  memory_used %llu\n", MEMORY_USED);
+    fprintf(file, "  temperature 50\n");
+    for (size_t i = 0; i < PROCESS_COUNT; i++) {
+        fprintf(file, "  %s %u %llu 10\n", processes[i].graphics ? "graphics_process" : "process",
+                processes[i].pid, processes[i].memory);
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Check that a binding slot points at the named library symbol
+ * @param library dlopen() handle the binding uses
+ * @param bound Bound function, as a data pointer
+ * @param name Symbol expected to be bound, NULL if the slot must be empty
+ * @param what Slot name for error messages
+ */
+static void check_symbol(void *library, void *bound, const char *name, const char *what) {
+    if (!name) {
+        CHECK(!bound, "%s: bound, expected unbound", what);
+        return;
+    }
+    void *expected = dlsym(library, name);
+    CHECK(expected, "%s: library does not export %s", what, name);
+    CHECK(bound == expected, "%s: not bound to %s", what, name);
+}
+
+#define SLOT(field) (*(void **)&binding->field)
+
+/**
+ * @brief Check which entry point variants were bound
+ * @param binding Loaded binding
+ * @param legacy Non-zero for the legacy library
+ */
+static void check_symbols(NVMLBinding *binding, int legacy) {
+    void *lib = binding->library;
+
+    check_symbol(lib, SLOT(init), legacy ? "nvmlInit" : "nvmlInit_v2", "init");
+    check_symbol(lib, SLOT(device_get_count),
+                 legacy ? "nvmlDeviceGetCount" : "nvmlDeviceGetCount_v2", "device_get_count");
+    check_symbol(lib, SLOT(device_get_handle_by_index),
+                 legacy ? "nvmlDeviceGetHandleByIndex" : "nvmlDeviceGetHandleByIndex_v2",
+                 "device_get_handle_by_index");
+    check_symbol(lib, SLOT(device_get_memory_info), "nvmlDeviceGetMemoryInfo",
+                 "device_get_memory_info");
+    check_symbol(lib, SLOT(device_get_memory_info_v2), legacy ? NULL : "nvmlDeviceGetMemoryInfo_v2",
+                 "device_get_memory_info_v2");
+    check_symbol(lib, SLOT(device_get_compute_processes),
+                 legacy ? "nvmlDeviceGetComputeRunningProcesses" : "nvmlDeviceGetComputeRunningProcesses_v3",
+                 "device_get_compute_processes");
+    check_symbol(lib, SLOT(device_get_graphics_processes),
+                 legacy ? "nvmlDeviceGetGraphicsRunningProcesses" : "nvmlDeviceGetGraphicsRunningProcesses_v3",
+                 "device_get_graphics_processes");
+    check_symbol(lib, SLOT(device_get_uuid), "nvmlDeviceGetUUID", "device_get_uuid");
+    check_symbol(lib, SLOT(device_get_pci_info), legacy ? NULL : "nvmlDeviceGetPciInfo_v3",
+                 "device_get_pci_info");
+    check_symbol(lib, SLOT(device_get_field_values), legacy ? NULL : "nvmlDeviceGetFieldValues",
+                 "device_get_field_values");
+    CHECK(binding->process_info_version == (legacy ? 1 : 3),
+          "process_info_version %d, expected %d", binding->process_info_version, legacy ? 1 : 3);
+}
+
+/**
+ * @brief Query memory and compare with the scenario
+ * @param binding Loaded binding
+ * @param device Device 0
+ * @param reserved Non-zero if the v2 entry point should have answered
+ * @param what Description for error messages
+ */
+static void check_memory_call(NVMLBinding *binding, NVMLDeviceHandle device, int reserved,
+                              const char *what) {
+    NVMLMemoryInfo info;
+    memset(&info, 0xff, sizeof(info));
+    NVMLReturn ret = nvml_get_memory_info(binding, device, &info);
+
+    CHECK(ret == NVML_SUCCESS, "%s: %s", what, nvml_return_name(ret));
+    if (ret != NVML_SUCCESS) return;
+    CHECK(info.total == MEMORY_TOTAL, "%s: total %llu", what, info.total);
+    CHECK(info.used == MEMORY_USED, "%s: used %llu", what, info.used);
+    if (reserved) {
+        CHECK(info.reserved == MEMORY_TOTAL / 200, "%s: reserved %llu, expected the v2 value",
+              what, info.reserved);
+    } else {
+        CHECK(info.reserved == 0, "%s: reserved %llu, expected 0 from v1", what, info.reserved);
+    }
+}
+
+/**
+ * @brief Check the v2 memory query and its fallback to v1
+ * @param binding Loaded binding
+ * @param device Device 0
+ * @param legacy Non-zero for the legacy library
+ */
+static void check_memory(NVMLBinding *binding, NVMLDeviceHandle device, int legacy) {
+    if (legacy) {
+        check_memory_call(binding, device, 0, "memory (v1 only)");
+        return;
+    }
+    check_memory_call(binding, device, 1, "memory (v2)");
+    check_memory_call(binding, device, 0, "memory (v2 version mismatch)");
+    CHECK(!binding->device_get_memory_info_v2, "memory: v2 entry point kept after version mismatch");
+    check_memory_call(binding, device, 0, "memory (after fallback)");
+}
+
+/**
+ * @brief Check one process list against the scenario
+ * @param binding Loaded binding
+ * @param device Device 0
+ * @param graphics Non-zero for graphics contexts
+ * @param capacity Entries to offer; fewer than listed to check truncation
+ */
+static void check_process_list(const NVMLBinding *binding, NVMLDeviceHandle device, int graphics,
+                               unsigned int capacity) {
+    const char *what = graphics ? "graphics processes" : "compute processes";
+    NVMLProcessInfo infos[PROCESS_COUNT];
+    unsigned int expected = 0;
+    unsigned int count = capacity;
+
+    for (size_t i = 0; i < PROCESS_COUNT; i++) {
+        if (processes[i].graphics == graphics) expected++;
+    }
+    memset(infos, 0x5a, sizeof(infos));
+    NVMLReturn ret = nvml_get_running_processes(binding, device, graphics, infos, &count);
+
+    NVMLReturn want = expected > capacity ? NVML_ERROR_INSUFFICIENT_SIZE : NVML_SUCCESS;
+    CHECK(ret == want, "%s (capacity %u): %s, expected %s", what, capacity,
+          nvml_return_name(ret), nvml_return_name(want));
+    CHECK(count == expected, "%s (capacity %u): count %u, expected %u", what, capacity,
+          count, expected);
+
+    unsigned int slot = 0;
+    for (size_t i = 0; i < PROCESS_COUNT && slot < capacity; i++) {
+        if (processes[i].graphics != graphics) continue;
+        const NVMLProcessInfo *info = &infos[slot];
+        CHECK(info->pid == processes[i].pid && info->used_gpu_memory == processes[i].memory,
+              "%s (capacity %u): entry %u is pid %u with %llu bytes, expected pid %u with %llu",
+              what, capacity, slot, info->pid, info->used_gpu_memory, processes[i].pid,
+              processes[i].memory);
+        CHECK(info->gpu_instance_id == ~0u && info->compute_instance_id == ~0u,
+              "%s (capacity %u): entry %u has instance ids %u/%u, expected ~0", what, capacity,
+              slot, info->gpu_instance_id, info->compute_instance_id);
+        slot++;
+    }
+    // Entries past the ones filled must be left alone
+    for (; slot < capacity && slot < PROCESS_COUNT; slot++) {
+        CHECK(infos[slot].pid == 0x5a5a5a5au, "%s (capacity %u): entry %u written past the count",
+              what, capacity, slot);
+    }
+}
+
+/**
+ * @brief Check that every injected return code maps to its policy
+ * @param binding Loaded binding
+ * @param device Device 0
+ */
+static void check_policies(const NVMLBinding *binding, NVMLDeviceHandle device) {
+    for (size_t i = 0; i < POLICY_COUNT; i++) {
+        unsigned int temp = 0;
+        NVMLReturn ret = binding->device_get_temperature(device, NVML_TEMPERATURE_GPU, &temp);
+        CHECK(ret == policies[i].ret, "policy: call %zu returned %s, expected injected %s",
+              i, nvml_return_name(ret), nvml_return_name(policies[i].ret));
+        NVMLPolicy policy = nvml_error_policy(policies[i].ret);
+        CHECK(policy == policies[i].policy, "policy: %s maps to %d, expected %d",
+              nvml_return_name(policies[i].ret), policy, policies[i].policy);
+    }
+
+    // Injections used up: the next call succeeds
+    unsigned int temp = 0;
+    NVMLReturn ret = binding->device_get_temperature(device, NVML_TEMPERATURE_GPU, &temp);
+    CHECK(ret == NVML_SUCCESS && temp == 50, "policy: call after the injections returned %s, %u C",
+          nvml_return_name(ret), temp);
+    CHECK(nvml_error_policy(ret) == NVML_POLICY_OK, "policy: SUCCESS does not map to OK");
+}
+
+int main(int argc, char *argv[]) {
+    int legacy = argc == 3 && strcmp(argv[1], "-l") == 0;
+    if (argc != 2 + legacy) {
+        fprintf(stderr, "Usage: %s [-l] LIBRARY\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char scenario[64];
+    if (write_scenario(scenario, sizeof(scenario)) != 0) return EXIT_FAILURE;
+    setenv("SYSMON_NVML_LIBRARY", argv[argc - 1], 1);
+    setenv("FAKE_NVML_SCENARIO", scenario, 1);
+
+    NVMLBinding binding;
+    if (nvml_binding_load(&binding) != 0) {
+        fprintf(stderr, "%s: cannot load the binding\n", argv[argc - 1]);
+        unlink(scenario);
+        return EXIT_FAILURE;
+    }
+    check_symbols(&binding, legacy);
+
+    NVMLDeviceHandle device = NULL;
+    NVMLReturn ret = binding.init();
+    if (ret == NVML_SUCCESS) ret = binding.device_get_handle_by_index(0, &device);
+    CHECK(ret == NVML_SUCCESS, "init: %s", nvml_return_name(ret));
+    if (ret == NVML_SUCCESS) {
+        check_memory(&binding, device, legacy);
+        for (int graphics = 0; graphics <= 1; graphics++) {
+            check_process_list(&binding, device, graphics, PROCESS_COUNT);
+            check_process_list(&binding, device, graphics, 1);
+        }
+        check_policies(&binding, device);
+        binding.shutdown();
+    }
+    nvml_binding_unload(&binding);
+    unlink(scenario);
+
+    if (failures) {
+        fprintf(stderr, "%s: %d NVML binding checks failed\n", argv[argc - 1], failures);
+        return EXIT_FAILURE;
+    }
+    printf("NVML binding (%s): ok\n", legacy ? "legacy" : "current");
+    return EXIT_SUCCESS;
+}